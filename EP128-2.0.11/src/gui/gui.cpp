@@ -552,6 +552,8 @@ void Ep128EmuGUI::createMenus()
                    (char *) 0, &menuCallback_File_QSSave, (void *) this);
   mainMenuBar->add("File/Quick snapshot/Load (Ctrl+F10)",
                    (char *) 0, &menuCallback_File_QSLoad, (void *) this);
+  mainMenuBar->add("File/Rewind (Ctrl+F12)",
+                   (char *) 0, &menuCallback_File_Rewind, (void *) this);
   mainMenuBar->add("File/Record demo",
                    (char *) 0, &menuCallback_File_RecordDemo, (void *) this);
   mainMenuBar->add("File/Stop demo (Alt+K)",
@@ -1051,6 +1053,9 @@ int Ep128EmuGUI::handleFLTKEvent(void *userData, int event)
             case 10:                                    // Ctrl+F11:
               gui_.menuCallback_Machine_ColdReset((Fl_Widget *) 0, userData);
               break;
+            case 11:                                    // Ctrl+F12:
+              gui_.menuCallback_File_Rewind((Fl_Widget *) 0, userData);
+              break;
             case 12:                                    // PageDown:
               gui_.menuCallback_Machine_QuickCfgL1((Fl_Widget *) 0, userData);
               break;
@@ -1276,6 +1281,8 @@ void Ep128EmuGUI::applyEmulatorConfiguration(bool updateWindowFlag_)
       vmThread.setSpeedPercentage(config.vm.speedPercentage == 100U &&
                                   config.sound.enabled ?
                                   0 : int(config.vm.speedPercentage));
+      vmThread.setRewindParameters(int(config.vm.rewindInterval),
+                                   size_t(config.vm.rewindBufferSize) << 20);
       if (config.joystickSettingsChanged) {
         joystickInput.setConfiguration(config.joystick);
         config.joystickSettingsChanged = false;
@@ -1682,6 +1689,18 @@ void Ep128EmuGUI::menuCallback_File_QSSave(Fl_Widget *o, void *v)
   }
 }
 
+void Ep128EmuGUI::menuCallback_File_Rewind(Fl_Widget *o, void *v)
+{
+  (void) o;
+  Ep128EmuGUI&  gui_ = *(reinterpret_cast<Ep128EmuGUI *>(v));
+  try {
+    gui_.vmThread.rewind();
+  }
+  catch (std::exception& e) {
+    gui_.errorMessage(e.what());
+  }
+}
+
 void Ep128EmuGUI::menuCallback_File_SaveSnapshot(Fl_Widget *o, void *v)
 {
   (void) o;
@@ -749,6 +749,176 @@ void Ep128EmuGUIMonitor::command_trace(const std::vector<std::string>& args)
   debugWindow->deactivate();
 }
 
+void Ep128EmuGUIMonitor::command_binaryTrace(
+    const std::vector<std::string>& args)
+{
+  if (args.size() == 1) {
+    // stop trace
+    if (gui->vm.getIsExecutionTraceOn()) {
+      gui->vm.closeExecutionTrace();
+      printMessage("Execution trace stopped");
+    }
+    return;
+  }
+  if (args.size() > 5)
+    throw Ep128Emu::Exception("invalid number of arguments");
+  if (args[1].length() < 1 || args[1][0] != '"')
+    throw Ep128Emu::Exception("file name is not a string");
+  uint32_t  maxInsns = 0U;
+  int32_t   startAddr = int32_t(-1);
+  bool      ringMode = false;
+  if (args.size() > 4)
+    ringMode = bool(parseHexNumberEx(args[4].c_str()));
+  if (args.size() > 2)
+    maxInsns = parseHexNumberEx(args[2].c_str());
+  if (!maxInsns)
+    maxInsns = 0x01000000U;
+  if (ringMode && maxInsns > 0x01000000U)
+    throw Ep128Emu::Exception("invalid instruction count");
+  if (args.size() > 3) {
+    if (args[3] != "*") {
+      uint32_t  n = parseHexNumberEx(args[3].c_str());
+      if (n > 0xFFFFU)
+        throw Ep128Emu::Exception("address is out of range");
+      startAddr = int32_t(n);
+    }
+  }
+  std::string fileName(args[1].c_str() + 1);
+  std::FILE *f = (std::FILE *) 0;
+  int       err = gui->vm.openFileInWorkingDirectory(f, fileName, "wb");
+  if (err != 0) {
+    printMessage(gui->vm.getFileOpenErrorMessage(err));
+    return;
+  }
+  gui->vm.openExecutionTrace(f, size_t(maxInsns), ringMode);
+  if (startAddr >= 0)
+    gui->vm.setProgramCounter(uint16_t(startAddr));
+  debugWindow->focusWidget = this;
+  gui->vm.setSingleStepMode(0);
+  debugWindow->deactivate();
+}
+
+void Ep128EmuGUIMonitor::command_perfCounters(
+    const std::vector<std::string>& args)
+{
+  if (args.size() > 2)
+    throw Ep128Emu::Exception("too many arguments");
+  if (args.size() == 2) {
+    if (parseHexNumberEx(args[1].c_str()) != 0U)
+      throw Ep128Emu::Exception("invalid argument");
+    gui->vm.resetPerfCounters();
+    printMessage("Performance counters cleared");
+    return;
+  }
+  Ep128Emu::PerfCounters::Status  s;
+  gui->vm.getPerfCounters(s);
+  char    tmpBuf[80];
+  double  t = 0.0;
+  double  elapsedTime = (s.elapsedTime > 0.000001 ? s.elapsedTime : 0.000001);
+  printMessage("counter          time (ms)     %      units");
+  for (int i = 0; i < Ep128Emu::PerfCounters::nCounters; i++) {
+    std::sprintf(&(tmpBuf[0]), "%-14s %11.3f %5.1f %10lu",
+                 Ep128Emu::PerfCounters::getCounterName(i),
+                 s.time[i] * 1000.0, s.time[i] * 100.0 / elapsedTime,
+                 (unsigned long) s.units[i]);
+    printMessage(&(tmpBuf[0]));
+    t += s.time[i];
+  }
+  t = s.elapsedTime - t;
+  std::sprintf(&(tmpBuf[0]), "%-14s %11.3f %5.1f", "other",
+               t * 1000.0, t * 100.0 / elapsedTime);
+  printMessage(&(tmpBuf[0]));
+  std::sprintf(&(tmpBuf[0]), "%-14s %11.3f", "elapsed",
+               s.elapsedTime * 1000.0);
+  printMessage(&(tmpBuf[0]));
+}
+
+void Ep128EmuGUIMonitor::command_perfCounterLog(
+    const std::vector<std::string>& args)
+{
+  if (args.size() == 1) {
+    // stop logging
+    if (gui->vm.getIsPerfCounterLogOpen()) {
+      gui->vm.closePerfCounterLog();
+      printMessage("Performance counter log closed");
+    }
+    return;
+  }
+  if (args.size() > 3)
+    throw Ep128Emu::Exception("invalid number of arguments");
+  if (args[1].length() < 1 || args[1][0] != '"')
+    throw Ep128Emu::Exception("file name is not a string");
+  uint32_t  interval = 1000U;
+  if (args.size() > 2) {
+    interval = parseHexNumberEx(args[2].c_str());
+    if (interval < 1U || interval > 0x00FFFFFFU)
+      throw Ep128Emu::Exception("invalid interval");
+  }
+  std::string fileName(args[1].c_str() + 1);
+  std::FILE *f = (std::FILE *) 0;
+  int       err = gui->vm.openFileInWorkingDirectory(f, fileName, "w");
+  if (err != 0) {
+    printMessage(gui->vm.getFileOpenErrorMessage(err));
+    return;
+  }
+  gui->vm.openPerfCounterLog(f, double(long(interval)) * 0.001);
+  printMessage("Performance counter log opened");
+}
+
+void Ep128EmuGUIMonitor::command_profiler(
+    const std::vector<std::string>& args)
+{
+  if (args.size() < 2 || args.size() > 4)
+    throw Ep128Emu::Exception("invalid number of arguments");
+  if (args[1].length() < 1 || args[1][0] != '"') {
+    if (args.size() != 2)
+      throw Ep128Emu::Exception("invalid number of arguments");
+    if (parseHexNumberEx(args[1].c_str()) != 0U) {
+      try {
+        gui->vm.startProfiler();
+      }
+      catch (std::exception& e) {
+        printMessage(e.what());
+        return;
+      }
+      printMessage("Profiler started");
+    }
+    else if (gui->vm.getIsProfilerOn()) {
+      gui->vm.stopProfiler();
+      printMessage("Profiler stopped");
+    }
+    return;
+  }
+  uint32_t  format = 0U;
+  if (args.size() > 2)
+    format = parseHexNumberEx(args[2].c_str());
+  if (format > 1U)
+    throw Ep128Emu::Exception("invalid report format");
+  std::string symbolFileName;
+  if (args.size() > 3) {
+    if (args[3].length() < 1 || args[3][0] != '"')
+      throw Ep128Emu::Exception("file name is not a string");
+    symbolFileName = args[3].c_str() + 1;
+  }
+  std::string fileName(args[1].c_str() + 1);
+  std::FILE *f = (std::FILE *) 0;
+  int       err = gui->vm.openFileInWorkingDirectory(f, fileName, "w");
+  if (err != 0) {
+    printMessage(gui->vm.getFileOpenErrorMessage(err));
+    return;
+  }
+  try {
+    gui->vm.writeProfilerReport(f, int(format), symbolFileName.c_str());
+  }
+  catch (std::exception& e) {
+    std::fclose(f);
+    printMessage(e.what());
+    return;
+  }
+  std::fclose(f);
+  printMessage("Profiler report written");
+}
+
 void Ep128EmuGUIMonitor::command_load(const std::vector<std::string>& args,
                                       bool verifyMode)
 {
@@ -862,10 +1032,14 @@ void Ep128EmuGUIMonitor::command_help(const std::vector<std::string>& args)
     printMessage("L       load binary or ASCII file to memory");
     printMessage("M       dump memory");
     printMessage("O       modify I/O registers");
+    printMessage("P       print performance counters");
+    printMessage("PL      log performance counters to CSV file");
+    printMessage("PR      Z80 profiler");
     printMessage("R       print CPU registers");
     printMessage("S       save memory to binary or ASCII file");
     printMessage("SR      search and replace pattern in memory");
     printMessage("T       copy memory");
+    printMessage("TB      binary trace (use eptrace to decode)");
     printMessage("TR      trace (log instructions to file)");
     printMessage("V       verify (compare memory and file)");
     printMessage("X       continue");
@@ -939,6 +1113,24 @@ void Ep128EmuGUIMonitor::command_help(const std::vector<std::string>& args)
   else if (args[1] == "O") {
     printMessage("O<address> [value1 [value2 [...]]]");
   }
+  else if (args[1] == "P") {
+    printMessage("P       print host time spent in each subsystem");
+    printMessage("P 0     clear performance counters");
+  }
+  else if (args[1] == "PL") {
+    printMessage("PL <\"filename\"> [interval]");
+    printMessage("PL      stop logging");
+    printMessage("interval is in milliseconds of emulated time");
+    printMessage("(default: 3E8)");
+  }
+  else if (args[1] == "PR") {
+    printMessage("PR 1    clear data and start profiler");
+    printMessage("PR 0    stop profiler");
+    printMessage("PR <\"filename\"> [format [\"symfile\"]]");
+    printMessage("format is 0 (default) for flat profile and call");
+    printMessage("graph, or 1 for collapsed stacks (flame graph);");
+    printMessage("symfile is a symbol file written by Sjasm");
+  }
   else if (args[1] == "R") {
     printMessage("R       print CPU registers");
   }
@@ -957,6 +1149,14 @@ void Ep128EmuGUIMonitor::command_help(const std::vector<std::string>& args)
   else if (args[1] == "T") {
     printMessage("T <srcStart> <srcEnd> <dstStart>");
   }
+  else if (args[1] == "TB") {
+    printMessage("TB <\"filename\"> [maxInsns [addr [ring]]]");
+    printMessage("TB      stop binary trace");
+    printMessage("maxInsns=0 (default) is interpreted as 1000000h");
+    printMessage("addr can be * to continue from the current PC");
+    printMessage("if ring is 1, only the last maxInsns instructions");
+    printMessage("are written when the trace is stopped");
+  }
   else if (args[1] == "TR") {
     printMessage("TR <\"filename\"> [maxInsns [addr [flags]]]");
     printMessage("maxInsns=0 (default) is interpreted as 65536L");
@@ -1066,6 +1266,12 @@ void Ep128EmuGUIMonitor::parseCommand(const char *s)
     command_memoryDump(args);
   else if (args[0] == "O")
     command_ioModify(args);
+  else if (args[0] == "P")
+    command_perfCounters(args);
+  else if (args[0] == "PL")
+    command_perfCounterLog(args);
+  else if (args[0] == "PR")
+    command_profiler(args);
   else if (args[0] == "R")
     command_printRegisters(args);
   else if (args[0] == "S")
@@ -1074,6 +1280,8 @@ void Ep128EmuGUIMonitor::parseCommand(const char *s)
     command_searchAndReplace(args);
   else if (args[0] == "T")
     command_memoryCopy(args);
+  else if (args[0] == "TB")
+    command_binaryTrace(args);
   else if (args[0] == "TR")
     command_trace(args);
   else if (args[0] == "V")
@@ -64,6 +64,10 @@ class Ep128EmuGUIMonitor : public Fl_Text_Editor {
   void command_step(const std::vector<std::string>& args);
   void command_stepOver(const std::vector<std::string>& args);
   void command_trace(const std::vector<std::string>& args);
+  void command_binaryTrace(const std::vector<std::string>& args);
+  void command_perfCounters(const std::vector<std::string>& args);
+  void command_perfCounterLog(const std::vector<std::string>& args);
+  void command_profiler(const std::vector<std::string>& args);
   void command_load(const std::vector<std::string>& args,
                     bool verifyMode = false);
   void command_save(const std::vector<std::string>& args);
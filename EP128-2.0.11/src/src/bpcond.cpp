@@ -0,0 +1,582 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "bpcond.hpp"
+
+#include <cstring>
+
+namespace Ep128Emu {
+
+  enum {
+    // push operands
+    BPCOND_OP_CONST = 0,
+    BPCOND_OP_REG,
+    BPCOND_OP_ADDR,
+    BPCOND_OP_VALUE,
+    BPCOND_OP_HITS,
+    // unary operators (replace the top of the stack)
+    BPCOND_OP_PEEK,
+    BPCOND_OP_PEEKW,
+    BPCOND_OP_NEG,
+    BPCOND_OP_CPL,
+    BPCOND_OP_NOT,
+    // binary operators (pop two values, and push the result)
+    BPCOND_OP_MUL,
+    BPCOND_OP_DIV,
+    BPCOND_OP_MOD,
+    BPCOND_OP_ADD,
+    BPCOND_OP_SUB,
+    BPCOND_OP_SHL,
+    BPCOND_OP_SHR,
+    BPCOND_OP_LT,
+    BPCOND_OP_LE,
+    BPCOND_OP_GT,
+    BPCOND_OP_GE,
+    BPCOND_OP_EQ,
+    BPCOND_OP_NE,
+    BPCOND_OP_AND,
+    BPCOND_OP_XOR,
+    BPCOND_OP_OR,
+    BPCOND_OP_LAND,
+    BPCOND_OP_LOR
+  };
+
+  enum {
+    BPCOND_REG_A = 0,
+    BPCOND_REG_F,
+    BPCOND_REG_B,
+    BPCOND_REG_C,
+    BPCOND_REG_D,
+    BPCOND_REG_E,
+    BPCOND_REG_H,
+    BPCOND_REG_L,
+    BPCOND_REG_IXH,
+    BPCOND_REG_IXL,
+    BPCOND_REG_IYH,
+    BPCOND_REG_IYL,
+    BPCOND_REG_I,
+    BPCOND_REG_R,
+    BPCOND_REG_IM,
+    BPCOND_REG_AF,
+    BPCOND_REG_BC,
+    BPCOND_REG_DE,
+    BPCOND_REG_HL,
+    BPCOND_REG_IX,
+    BPCOND_REG_IY,
+    BPCOND_REG_SP,
+    BPCOND_REG_PC
+  };
+
+  static const char *bpcondRegisterNames[23] = {
+    "a",    "f",    "b",    "c",    "d",    "e",    "h",    "l",
+    "ixh",  "ixl",  "iyh",  "iyl",  "i",    "r",    "im",   "af",
+    "bc",   "de",   "hl",   "ix",   "iy",   "sp",   "pc"
+  };
+
+  static const struct {
+    const char  *name;
+    uint8_t     op;
+    int         precedence;
+  } bpcondBinaryOperators[18] = {
+    // two character operators need to be checked first
+    { "||", BPCOND_OP_LOR,  1 },    { "&&", BPCOND_OP_LAND, 2 },
+    { "==", BPCOND_OP_EQ,   6 },    { "!=", BPCOND_OP_NE,   6 },
+    { "<=", BPCOND_OP_LE,   7 },    { ">=", BPCOND_OP_GE,   7 },
+    { "<<", BPCOND_OP_SHL,  8 },    { ">>", BPCOND_OP_SHR,  8 },
+    { "|",  BPCOND_OP_OR,   3 },    { "^",  BPCOND_OP_XOR,  4 },
+    { "&",  BPCOND_OP_AND,  5 },    { "<",  BPCOND_OP_LT,   7 },
+    { ">",  BPCOND_OP_GT,   7 },    { "+",  BPCOND_OP_ADD,  9 },
+    { "-",  BPCOND_OP_SUB,  9 },    { "*",  BPCOND_OP_MUL,  10 },
+    { "/",  BPCOND_OP_DIV,  10 },   { "%",  BPCOND_OP_MOD,  10 }
+  };
+
+  static inline bool bpcondIsAlpha(char c)
+  {
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_');
+  }
+
+  static inline bool bpcondIsAlnum(char c)
+  {
+    return (bpcondIsAlpha(c) || (c >= '0' && c <= '9'));
+  }
+
+  static inline int bpcondHexDigit(char c)
+  {
+    if (c >= '0' && c <= '9')
+      return int(c - '0');
+    if (c >= 'A' && c <= 'F')
+      return int(c - 'A') + 10;
+    if (c >= 'a' && c <= 'f')
+      return int(c - 'a') + 10;
+    return -1;
+  }
+
+  // --------------------------------------------------------------------------
+
+  struct BreakPointCondition::Parser {
+    const std::string&  s;
+    size_t      pos;
+    std::vector< Instruction >& code;
+    size_t      depth;
+    size_t      maxDepth;
+    // ----------------
+    Parser(const std::string& s_, std::vector< Instruction >& code_)
+      : s(s_),
+        pos(0),
+        code(code_),
+        depth(0),
+        maxDepth(0)
+    {
+    }
+    void skipSpace()
+    {
+      while (pos < s.length() &&
+             (s[pos] == ' ' || s[pos] == '\t' ||
+              s[pos] == '\r' || s[pos] == '\n')) {
+        pos++;
+      }
+    }
+    void emit(uint8_t op, int32_t arg = 0)
+    {
+      Instruction tmp;
+      tmp.op = op;
+      tmp.arg = arg;
+      code.push_back(tmp);
+      if (op < BPCOND_OP_PEEK) {
+        if (++depth > maxDepth)
+          maxDepth = depth;
+      }
+      else if (op >= BPCOND_OP_MUL) {
+        depth--;
+      }
+    }
+    void expect(char c)
+    {
+      skipSpace();
+      if (pos >= s.length() || s[pos] != c)
+        throw Exception("syntax error in breakpoint condition");
+      pos++;
+    }
+    void parseNumber();
+    void parseIdentifier();
+    void parseUnary();
+    void parseExpression(int minPrecedence);
+  };
+
+  void BreakPointCondition::Parser::parseNumber()
+  {
+    uint32_t  n = 0U;
+    size_t    nDigits = 0;
+    if (s[pos] == '$' ||
+        (s[pos] == '0' && (pos + 1) < s.length() &&
+         (s[pos + 1] == 'x' || s[pos + 1] == 'X'))) {
+      pos += (s[pos] == '$' ? 1 : 2);
+      for ( ; pos < s.length() && bpcondHexDigit(s[pos]) >= 0; pos++) {
+        n = (n << 4) + uint32_t(bpcondHexDigit(s[pos]));
+        nDigits++;
+      }
+    }
+    else {
+      for ( ; pos < s.length() && s[pos] >= '0' && s[pos] <= '9'; pos++) {
+        n = (n * 10U) + uint32_t(s[pos] - '0');
+        nDigits++;
+      }
+    }
+    if (nDigits < 1 || (pos < s.length() && bpcondIsAlnum(s[pos])))
+      throw Exception("syntax error in breakpoint condition");
+    emit(BPCOND_OP_CONST, int32_t(n));
+  }
+
+  void BreakPointCondition::Parser::parseIdentifier()
+  {
+    std::string name;
+    for ( ; pos < s.length() && bpcondIsAlnum(s[pos]); pos++) {
+      char    c = s[pos];
+      if (c >= 'A' && c <= 'Z')
+        c = c + ('a' - 'A');
+      name += c;
+    }
+    if (name == "peek" || name == "peekw") {
+      expect('(');
+      parseExpression(1);
+      expect(')');
+      emit(name == "peek" ? BPCOND_OP_PEEK : BPCOND_OP_PEEKW);
+      return;
+    }
+    if (name == "addr") {
+      emit(BPCOND_OP_ADDR);
+      return;
+    }
+    if (name == "value") {
+      emit(BPCOND_OP_VALUE);
+      return;
+    }
+    if (name == "hits") {
+      emit(BPCOND_OP_HITS);
+      return;
+    }
+    for (int i = 0; i < 23; i++) {
+      if (name == bpcondRegisterNames[i]) {
+        emit(BPCOND_OP_REG, i);
+        return;
+      }
+    }
+    throw Exception("unknown identifier in breakpoint condition");
+  }
+
+  void BreakPointCondition::Parser::parseUnary()
+  {
+    skipSpace();
+    if (pos >= s.length())
+      throw Exception("syntax error in breakpoint condition");
+    char    c = s[pos];
+    switch (c) {
+    case '-':
+      pos++;
+      parseUnary();
+      emit(BPCOND_OP_NEG);
+      break;
+    case '~':
+      pos++;
+      parseUnary();
+      emit(BPCOND_OP_CPL);
+      break;
+    case '!':
+      pos++;
+      parseUnary();
+      emit(BPCOND_OP_NOT);
+      break;
+    case '+':
+      pos++;
+      parseUnary();
+      break;
+    case '(':
+      pos++;
+      parseExpression(1);
+      expect(')');
+      break;
+    default:
+      if ((c >= '0' && c <= '9') || c == '$')
+        parseNumber();
+      else if (bpcondIsAlpha(c))
+        parseIdentifier();
+      else
+        throw Exception("syntax error in breakpoint condition");
+      break;
+    }
+  }
+
+  void BreakPointCondition::Parser::parseExpression(int minPrecedence)
+  {
+    parseUnary();
+    while (true) {
+      skipSpace();
+      int     n = -1;
+      size_t  len = 0;
+      for (int i = 0; i < 18; i++) {
+        len = std::strlen(bpcondBinaryOperators[i].name);
+        if (s.compare(pos, len, bpcondBinaryOperators[i].name) == 0) {
+          n = i;
+          break;
+        }
+      }
+      if (n < 0 || bpcondBinaryOperators[n].precedence < minPrecedence)
+        break;
+      pos += len;
+      // all operators are left associative
+      parseExpression(bpcondBinaryOperators[n].precedence + 1);
+      emit(bpcondBinaryOperators[n].op);
+    }
+  }
+
+  // --------------------------------------------------------------------------
+
+  BreakPointCondition::BreakPointCondition(const std::string& expr)
+    : expr_(expr),
+      hitCount(0U)
+  {
+    Parser  parser(expr_, code);
+    parser.parseExpression(1);
+    parser.skipSpace();
+    if (parser.pos < expr_.length())
+      throw Exception("syntax error in breakpoint condition");
+    stack.resize(parser.maxDepth);
+  }
+
+  BreakPointCondition::~BreakPointCondition()
+  {
+  }
+
+  static EP128EMU_INLINE int32_t bpcondGetRegister(
+      const Ep128::Z80_REGISTERS& r, int32_t n)
+  {
+    switch (n) {
+    case BPCOND_REG_A:
+      return r.AF.B.h;
+    case BPCOND_REG_F:
+      return r.AF.B.l;
+    case BPCOND_REG_B:
+      return r.BC.B.h;
+    case BPCOND_REG_C:
+      return r.BC.B.l;
+    case BPCOND_REG_D:
+      return r.DE.B.h;
+    case BPCOND_REG_E:
+      return r.DE.B.l;
+    case BPCOND_REG_H:
+      return r.HL.B.h;
+    case BPCOND_REG_L:
+      return r.HL.B.l;
+    case BPCOND_REG_IXH:
+      return r.IX.B.h;
+    case BPCOND_REG_IXL:
+      return r.IX.B.l;
+    case BPCOND_REG_IYH:
+      return r.IY.B.h;
+    case BPCOND_REG_IYL:
+      return r.IY.B.l;
+    case BPCOND_REG_I:
+      return r.I;
+    case BPCOND_REG_R:
+      return ((r.R & 0x7F) | (r.RBit7 & 0x80));
+    case BPCOND_REG_IM:
+      return r.IM;
+    case BPCOND_REG_AF:
+      return r.AF.W;
+    case BPCOND_REG_BC:
+      return r.BC.W;
+    case BPCOND_REG_DE:
+      return r.DE.W;
+    case BPCOND_REG_HL:
+      return r.HL.W;
+    case BPCOND_REG_IX:
+      return r.IX.W;
+    case BPCOND_REG_IY:
+      return r.IY.W;
+    case BPCOND_REG_SP:
+      return r.SP.W;
+    }
+    return r.PC.W.l;
+  }
+
+  bool BreakPointCondition::evaluate(
+      const Ep128::Z80_REGISTERS& r,
+      uint8_t (*readMemoryFunc)(void *userData, uint16_t addr),
+      void *userData, uint16_t addr, uint8_t value)
+  {
+    hitCount++;
+    int32_t *sp = &(stack.front()) - 1;
+    for (size_t i = 0; i < code.size(); i++) {
+      const Instruction&  c = code[i];
+      if (c.op >= BPCOND_OP_MUL) {
+        sp--;
+        uint32_t  a = uint32_t(sp[0]);
+        uint32_t  b = uint32_t(sp[1]);
+        switch (c.op) {
+        case BPCOND_OP_MUL:
+          a = a * b;
+          break;
+        case BPCOND_OP_DIV:
+          if (sp[1] == -1)
+            a = 0U - a;
+          else if (b != 0U)
+            a = uint32_t(sp[0] / sp[1]);
+          else
+            a = 0U;
+          break;
+        case BPCOND_OP_MOD:
+          if (b != 0U && sp[1] != -1)
+            a = uint32_t(sp[0] % sp[1]);
+          else
+            a = 0U;
+          break;
+        case BPCOND_OP_ADD:
+          a = a + b;
+          break;
+        case BPCOND_OP_SUB:
+          a = a - b;
+          break;
+        case BPCOND_OP_SHL:
+          a = a << (b & 31U);
+          break;
+        case BPCOND_OP_SHR:
+          a = uint32_t(sp[0] >> (b & 31U));
+          break;
+        case BPCOND_OP_LT:
+          a = uint32_t(sp[0] < sp[1]);
+          break;
+        case BPCOND_OP_LE:
+          a = uint32_t(sp[0] <= sp[1]);
+          break;
+        case BPCOND_OP_GT:
+          a = uint32_t(sp[0] > sp[1]);
+          break;
+        case BPCOND_OP_GE:
+          a = uint32_t(sp[0] >= sp[1]);
+          break;
+        case BPCOND_OP_EQ:
+          a = uint32_t(a == b);
+          break;
+        case BPCOND_OP_NE:
+          a = uint32_t(a != b);
+          break;
+        case BPCOND_OP_AND:
+          a = a & b;
+          break;
+        case BPCOND_OP_XOR:
+          a = a ^ b;
+          break;
+        case BPCOND_OP_OR:
+          a = a | b;
+          break;
+        case BPCOND_OP_LAND:
+          a = uint32_t(a != 0U && b != 0U);
+          break;
+        case BPCOND_OP_LOR:
+          a = uint32_t(a != 0U || b != 0U);
+          break;
+        }
+        sp[0] = int32_t(a);
+        continue;
+      }
+      switch (c.op) {
+      case BPCOND_OP_CONST:
+        *(++sp) = c.arg;
+        break;
+      case BPCOND_OP_REG:
+        *(++sp) = bpcondGetRegister(r, c.arg);
+        break;
+      case BPCOND_OP_ADDR:
+        *(++sp) = int32_t(addr);
+        break;
+      case BPCOND_OP_VALUE:
+        *(++sp) = int32_t(value);
+        break;
+      case BPCOND_OP_HITS:
+        *(++sp) = int32_t(hitCount);
+        break;
+      case BPCOND_OP_PEEK:
+        *sp = readMemoryFunc(userData, uint16_t(*sp));
+        break;
+      case BPCOND_OP_PEEKW:
+        {
+          uint16_t  a = uint16_t(*sp);
+          *sp = int32_t(readMemoryFunc(userData, a))
+                | (int32_t(readMemoryFunc(userData, uint16_t(a + 1))) << 8);
+        }
+        break;
+      case BPCOND_OP_NEG:
+        *sp = int32_t(0U - uint32_t(*sp));
+        break;
+      case BPCOND_OP_CPL:
+        *sp = ~(*sp);
+        break;
+      case BPCOND_OP_NOT:
+        *sp = int32_t(*sp == 0);
+        break;
+      }
+    }
+    return (*sp != 0);
+  }
+
+  // --------------------------------------------------------------------------
+
+  BreakPointConditionTable::BreakPointConditionTable()
+  {
+  }
+
+  BreakPointConditionTable::~BreakPointConditionTable()
+  {
+    clear();
+  }
+
+  void BreakPointConditionTable::releaseCondition(BreakPointCondition *p)
+  {
+    std::map< std::string, SharedCondition >::iterator  i =
+        conditions.find(p->getExpression());
+    if (i != conditions.end()) {
+      if (--(i->second.refCnt) < 1) {
+        delete i->second.cond;
+        conditions.erase(i);
+      }
+    }
+  }
+
+  void BreakPointConditionTable::setCondition(uint32_t addr,
+                                              const std::string& expr)
+  {
+    std::map< uint32_t, BreakPointCondition * >::iterator i =
+        addrMap.find(addr);
+    if (expr.empty()) {
+      if (i != addrMap.end()) {
+        BreakPointCondition *p = i->second;
+        addrMap.erase(i);
+        releaseCondition(p);
+      }
+      return;
+    }
+    if (i != addrMap.end() && i->second->getExpression() == expr)
+      return;
+    std::map< std::string, SharedCondition >::iterator  j =
+        conditions.find(expr);
+    if (j == conditions.end()) {
+      SharedCondition tmp;
+      tmp.cond = new BreakPointCondition(expr);
+      tmp.refCnt = 0;
+      try {
+        j = conditions.insert(
+                std::pair< std::string, SharedCondition >(expr, tmp)).first;
+      }
+      catch (...) {
+        delete tmp.cond;
+        throw;
+      }
+    }
+    if (i == addrMap.end()) {
+      addrMap.insert(std::pair< uint32_t, BreakPointCondition * >(
+                         addr, j->second.cond));
+      j->second.refCnt++;
+    }
+    else {
+      BreakPointCondition *p = i->second;
+      i->second = j->second.cond;
+      j->second.refCnt++;
+      releaseCondition(p);
+    }
+  }
+
+  std::string BreakPointConditionTable::getExpression(uint32_t addr) const
+  {
+    BreakPointCondition *p = findCondition(addr);
+    if (!p)
+      return std::string();
+    return p->getExpression();
+  }
+
+  void BreakPointConditionTable::clear()
+  {
+    addrMap.clear();
+    std::map< std::string, SharedCondition >::iterator  i;
+    for (i = conditions.begin(); i != conditions.end(); i++)
+      delete i->second.cond;
+    conditions.clear();
+  }
+
+}       // namespace Ep128Emu
@@ -0,0 +1,126 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_BPCOND_HPP
+#define EP128EMU_BPCOND_HPP
+
+#include "ep128emu.hpp"
+#include "z80/z80.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Ep128Emu {
+
+  // Breakpoint condition, compiled from a C-like integer expression to a
+  // simple stack machine code, so that it can be evaluated by the emulation
+  // thread on each breakpoint hit without calling the Lua interpreter.
+  // The expression may use the following operands:
+  //   123, 0x7B, $7B   decimal or hexadecimal constants
+  //   a, f, b, c, d, e, h, l, ixh, ixl, iyh, iyl, i, r, im
+  //                    8-bit Z80 registers
+  //   af, bc, de, hl, ix, iy, sp, pc
+  //                    16-bit Z80 registers
+  //   addr             the address that triggered the breakpoint
+  //   value            the value read or written
+  //   hits             the number of times the condition was evaluated,
+  //                    including the current hit
+  //   peek(n)          the byte at CPU address n
+  //   peekw(n)         the 16-bit little endian word at CPU address n
+  // and operators, with the same precedence as in C:
+  //   ( ) - ~ ! * / % + - << >> < <= > >= == != & ^ | && ||
+  // All calculations are done on 32-bit signed integers, division by zero
+  // returns zero. The breakpoint is triggered if the result is non-zero.
+
+  class BreakPointCondition {
+   private:
+    struct Instruction {
+      uint8_t   op;
+      int32_t   arg;
+    };
+    std::string expr_;
+    std::vector< Instruction >  code;
+    std::vector< int32_t >      stack;
+    uint32_t    hitCount;
+    // ----------------
+    struct Parser;
+   public:
+    // compile 'expr', throws Ep128Emu::Exception on syntax errors
+    BreakPointCondition(const std::string& expr);
+    ~BreakPointCondition();
+    const std::string& getExpression() const
+    {
+      return expr_;
+    }
+    uint32_t getHitCount() const
+    {
+      return hitCount;
+    }
+    void resetHitCount()
+    {
+      hitCount = 0U;
+    }
+    // evaluate the condition for a breakpoint hit at 'addr' with 'value',
+    // 'readMemoryFunc' is called with 'userData' to read CPU memory without
+    // side effects
+    bool evaluate(const Ep128::Z80_REGISTERS& r,
+                  uint8_t (*readMemoryFunc)(void *userData, uint16_t addr),
+                  void *userData, uint16_t addr, uint8_t value);
+  };
+
+  // --------------------------------------------------------------------------
+
+  // Table of compiled breakpoint conditions indexed by an address chosen by
+  // the caller. Addresses using the same expression share a single compiled
+  // condition (and hit counter).
+
+  class BreakPointConditionTable {
+   private:
+    struct SharedCondition {
+      BreakPointCondition *cond;
+      size_t    refCnt;
+    };
+    std::map< std::string, SharedCondition >        conditions;
+    std::map< uint32_t, BreakPointCondition * >     addrMap;
+    // ----------------
+    void releaseCondition(BreakPointCondition *p);
+   public:
+    BreakPointConditionTable();
+    ~BreakPointConditionTable();
+    // set the condition for 'addr', or remove it if 'expr' is empty;
+    // throws Ep128Emu::Exception on syntax errors
+    void setCondition(uint32_t addr, const std::string& expr);
+    // returns NULL if there is no condition for 'addr'
+    BreakPointCondition * findCondition(uint32_t addr) const
+    {
+      std::map< uint32_t, BreakPointCondition * >::const_iterator i =
+          addrMap.find(addr);
+      if (i == addrMap.end())
+        return (BreakPointCondition *) 0;
+      return i->second;
+    }
+    // returns the expression for 'addr', or an empty string
+    std::string getExpression(uint32_t addr) const;
+    void clear();
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_BPCOND_HPP
@@ -19,6 +19,7 @@
 
 #include "ep128emu.hpp"
 #include "bplist.hpp"
+#include "bpcond.hpp"
 
 #include <map>
 #include <sstream>
@@ -29,7 +30,9 @@ namespace Ep128Emu {
 
   BreakPoint::BreakPoint(bool isIO_, bool haveSegment_,
                          bool r_, bool w_, bool x_, bool ignoreFlag_,
-                         uint8_t segment_, uint16_t addr_, int priority_)
+                         uint8_t segment_, uint16_t addr_, int priority_,
+                         const std::string& condition_)
+    : cond_(condition_)
   {
     n_ = (r_ ? 0x01000000U : 0x00000000U)
          | (w_ ? 0x02000000U : 0x00000000U)
@@ -57,15 +60,22 @@ namespace Ep128Emu {
   {
     std::map<uint32_t, BreakPoint>  bpList;
     std::string curToken = "";
+    int         bracketLevel = 0;
 
     for (size_t i = 0; i < lst.length(); i++) {
       {
         char    ch = lst[i];
-        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+        if ((ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') &&
+            bracketLevel == 0) {
           if (curToken.length() < 1)
             continue;
         }
         else {
+          // conditions in brackets may contain whitespace
+          if (ch == '[')
+            bracketLevel++;
+          else if (ch == ']' && bracketLevel > 0)
+            bracketLevel--;
           curToken += ch;
           if ((i + 1) < lst.length())
             continue;
@@ -78,6 +88,7 @@ namespace Ep128Emu {
       bool      isRead = false, isWrite = false, isExecute = false;
       bool      isIgnore = false;
       int       priority = -1;
+      std::string condition;
       uint32_t  n;
 
       n = 0;
@@ -167,6 +178,35 @@ namespace Ep128Emu {
             throw Exception("syntax error in breakpoint list");
           priority = int(curToken[j] - '0');
           break;
+        case '[':
+          {
+            size_t  k = curToken.find(']', j);
+            if (k == std::string::npos || !condition.empty())
+              throw Exception("syntax error in breakpoint list");
+            // remove leading, trailing, and repeated whitespace
+            bool    prvSpace = true;
+            for (j++; j < k; j++) {
+              char    c = curToken[j];
+              if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                if (!prvSpace)
+                  condition += ' ';
+                prvSpace = true;
+              }
+              else {
+                condition += c;
+                prvSpace = false;
+              }
+            }
+            while (!condition.empty() &&
+                   condition[condition.length() - 1] == ' ') {
+              condition.resize(condition.length() - 1);
+            }
+            if (condition.empty())
+              throw Exception("syntax error in breakpoint list");
+            // check syntax
+            BreakPointCondition tmp(condition);
+          }
+          break;
         default:
           throw Exception("syntax error in breakpoint list");
         }
@@ -174,9 +214,11 @@ namespace Ep128Emu {
       if (isIgnore) {
         if (isIO)
           throw Exception("ignore flag is not allowed for I/O breakpoints");
-        if (isRead || isWrite || isExecute || priority >= 0)
-          throw Exception("read/write flags and priority are not allowed "
-                          "for ignore breakpoints");
+        if (isRead || isWrite || isExecute || priority >= 0 ||
+            !condition.empty()) {
+          throw Exception("read/write flags, priority, and condition are "
+                          "not allowed for ignore breakpoints");
+        }
         priority = 0;
       }
       else if (isIO && isExecute) {
@@ -194,7 +236,7 @@ namespace Ep128Emu {
       else if (haveSegment)
         addr_ |= (uint32_t(0x40000000UL) | (uint32_t(segment) << 14));
       BreakPoint  bp(isIO, haveSegment, isRead, isWrite, isExecute, isIgnore,
-                     segment, addr, priority);
+                     segment, addr, priority, condition);
       while (true) {
         std::map<uint32_t, BreakPoint>::iterator  i_ = bpList.find(addr_);
         if (i_ == bpList.end()) {
@@ -213,6 +255,16 @@ namespace Ep128Emu {
             uint32_t  tmp1 = bpp->n_ & 0x18FFFFFFU;
             uint32_t  tmp2 = bp.n_ & 0x18FFFFFFU;
             // combine read, write, execute, and ignore flags
+            // combine conditions
+            if (!(bpp->n_ & 0x07000000U)) {
+              bpp->cond_ = bp.cond_;
+            }
+            else if (bpp->cond_ != bp.cond_) {
+              if (bpp->cond_.empty() || bp.cond_.empty())
+                bpp->cond_.clear();
+              else
+                bpp->cond_ = "(" + bpp->cond_ + ") || (" + bp.cond_ + ")";
+            }
             bpp->n_ = ((bpp->n_ | bp.n_) & 0x27000000U)
                       | (tmp1 >= tmp2 ? tmp1 : tmp2);
           }
@@ -236,25 +288,28 @@ namespace Ep128Emu {
 
   void BreakPointList::addMemoryBreakPoint(uint8_t segment, uint16_t addr,
                                            bool r, bool w, bool x,
-                                           bool ignoreFlag, int priority)
+                                           bool ignoreFlag, int priority,
+                                           const std::string& condition)
   {
     lst_.push_back(BreakPoint(false, true, r, w, x, ignoreFlag,
-                              segment, addr, priority));
+                              segment, addr, priority, condition));
   }
 
   void BreakPointList::addMemoryBreakPoint(uint16_t addr,
                                            bool r, bool w, bool x,
-                                           bool ignoreFlag, int priority)
+                                           bool ignoreFlag, int priority,
+                                           const std::string& condition)
   {
     lst_.push_back(BreakPoint(false, false, r, w, x, ignoreFlag,
-                              0, addr, priority));
+                              0, addr, priority, condition));
   }
 
   void BreakPointList::addIOBreakPoint(uint16_t addr,
-                                       bool r, bool w, int priority)
+                                       bool r, bool w, int priority,
+                                       const std::string& condition)
   {
     lst_.push_back(BreakPoint(true, false, r, w, false, false,
-                              0, addr & 0xFF, priority));
+                              0, addr & 0xFF, priority, condition));
   }
 
   std::string BreakPointList::getBreakPointList()
@@ -265,13 +320,11 @@ namespace Ep128Emu {
       std::stable_sort(lst_.begin(), lst_.end());
       BreakPoint  prv_bp(lst_[0]);
       uint16_t    firstAddr = prv_bp.addr();
-      for (size_t i = 1; i < lst_.size(); i++) {
-        BreakPoint  bp(lst_[i]);
+      // the last iteration (i == lst_.size()) only prints the pending range
+      for (size_t i = 1; i <= lst_.size(); i++) {
         uint16_t    lastAddr = prv_bp.addr();
-        if (i >= (lst_.size() - 1)) {
-          lastAddr = bp.addr();
-        }
-        else {
+        if (i < lst_.size()) {
+          const BreakPoint& bp = lst_[i];
           if ((bp.addr() == (lastAddr + 1U) || bp.addr() == lastAddr) &&
               bp.isIO() == prv_bp.isIO() &&
               bp.haveSegment() == prv_bp.haveSegment() &&
@@ -280,7 +333,8 @@ namespace Ep128Emu {
               bp.isExecute() == prv_bp.isExecute() &&
               bp.isIgnore() == prv_bp.isIgnore() &&
               bp.priority() == prv_bp.priority() &&
-              bp.segment() == prv_bp.segment()) {
+              bp.segment() == prv_bp.segment() &&
+              bp.cond_ == prv_bp.cond_) {
             prv_bp = bp;
             continue;
           }
@@ -320,10 +374,14 @@ namespace Ep128Emu {
           }
           if (prv_bp.priority() != 2)
             lst << "p" << std::setw(1) << prv_bp.priority();
+          if (prv_bp.haveCondition())
+            lst << "[" << prv_bp.cond_ << "]";
           lst << "\n";
         }
-        prv_bp = bp;
-        firstAddr = bp.addr();
+        if (i < lst_.size()) {
+          prv_bp = lst_[i];
+          firstAddr = prv_bp.addr();
+        }
       }
     }
     lst << "\n";
@@ -357,7 +415,7 @@ namespace Ep128Emu {
   void BreakPointList::saveState(File::Buffer& buf)
   {
     buf.setPosition(0);
-    buf.writeUInt32(0x01000002);        // version number
+    buf.writeUInt32(0x01000003);        // version number
     for (size_t i = 0; i < lst_.size(); i++) {
       buf.writeBoolean(lst_[i].isIO());
       buf.writeBoolean(lst_[i].haveSegment());
@@ -368,6 +426,7 @@ namespace Ep128Emu {
       buf.writeByte(lst_[i].segment());
       buf.writeUInt32(lst_[i].addr());
       buf.writeByte(uint8_t(lst_[i].priority()));
+      buf.writeString(lst_[i].condition());
     }
   }
 
@@ -383,7 +442,7 @@ namespace Ep128Emu {
     buf.setPosition(0);
     // check version number
     unsigned int  version = buf.readUInt32();
-    if (!(version >= 0x01000001 && version <= 0x01000002)) {
+    if (!(version >= 0x01000001 && version <= 0x01000003)) {
       buf.setPosition(buf.getDataSize());
       throw Exception("incompatible breakpoint list format");
     }
@@ -402,8 +461,11 @@ namespace Ep128Emu {
       uint8_t   segment = buf.readByte();
       uint16_t  addr = uint16_t(buf.readUInt32());
       int       priority = buf.readByte();
+      std::string condition;
+      if (version >= 0x01000003)
+        condition = buf.readString();
       BreakPoint  bp(isIO, haveSegment, isRead, isWrite, isExecute, isIgnore,
-                     segment, addr, priority);
+                     segment, addr, priority, condition);
       lst_.push_back(bp);
     }
   }
@@ -21,6 +21,7 @@
 #define EP128EMU_BPLIST_HPP
 
 #include "ep128emu.hpp"
+#include <string>
 #include <vector>
 
 namespace Ep128Emu {
@@ -37,10 +38,14 @@ namespace Ep128Emu {
     // + priority (0 to 3) * 0x00400000
     // + address
     uint32_t  n_;
+    // condition expression (see bpcond.hpp), or empty string if the
+    // breakpoint is unconditional
+    std::string cond_;
    public:
     BreakPoint(bool isIO_, bool haveSegment_,
                bool r_, bool w_, bool x_, bool ignoreFlag_,
-               uint8_t segment_, uint16_t addr_, int priority_);
+               uint8_t segment_, uint16_t addr_, int priority_,
+               const std::string& condition_ = std::string());
     bool isIO() const
     {
       return bool(this->n_ & 0x10000000);
@@ -81,6 +86,14 @@ namespace Ep128Emu {
         return ((uint16_t) (this->n_ & 0x3FFF));
       return ((uint16_t) this->n_ & 0xFFFF);
     }
+    bool haveCondition() const
+    {
+      return !this->cond_.empty();
+    }
+    const std::string& condition() const
+    {
+      return this->cond_;
+    }
     bool operator<(const BreakPoint& bp) const
     {
       return (this->n_ < bp.n_);
@@ -119,22 +132,35 @@ namespace Ep128Emu {
      *                  is at an address for which this breakpoint is set
      *                  (read/write flags and priority are not used in
      *                  this case)
+     *   [expr]         the breakpoint is only triggered if the expression
+     *                  is true (non-zero); it is compiled by
+     *                  Ep128Emu::BreakPointCondition, and may contain
+     *                  whitespace. Conditions are evaluated by the
+     *                  emulation thread, before any Lua callback is run.
+     *                  If more than one definition is used for the same
+     *                  address, the conditions are combined with '||',
+     *                  and a definition without a condition makes the
+     *                  breakpoint unconditional
      * by default, the breakpoint is triggered on both reads and writes if
      * 'r', 'w', or 'x' is not used, and has a priority of 2.
      * Example: 8000-8003rp1 means break on reading CPU addresses 0x8000,
      * 0x8001, 0x8002, and 0x8003, if the breakpoint priority threshold is
-     * less than or equal to 1.
+     * less than or equal to 1, and 0200w[value==0xC9 && pc<0x4000] means
+     * break on writing 0xC9 to address 0x0200 from code in page 0.
      * If there are any syntax errors in the list, Ep128Emu::Exception is
      * thrown, and no breakpoints are added.
      */
     BreakPointList(const std::string& lst);
     void addMemoryBreakPoint(uint8_t segment, uint16_t addr,
                              bool r, bool w, bool x, bool ignoreFlag,
-                             int priority);
+                             int priority,
+                             const std::string& condition = std::string());
     void addMemoryBreakPoint(uint16_t addr,
                              bool r, bool w, bool x, bool ignoreFlag,
-                             int priority);
-    void addIOBreakPoint(uint16_t addr, bool r, bool w, int priority);
+                             int priority,
+                             const std::string& condition = std::string());
+    void addIOBreakPoint(uint16_t addr, bool r, bool w, int priority,
+                         const std::string& condition = std::string());
     size_t getBreakPointCnt() const
     {
       return this->lst_.size();
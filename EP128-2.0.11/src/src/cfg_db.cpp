@@ -403,6 +403,10 @@ namespace Ep128Emu {
 
 }       // namespace Ep128Emu
 
+// dotconf uses static buffers, so only one thread at a time can be parsing
+// a configuration file
+static Ep128Emu::Mutex  dotconfMutex;
+
 static const char * dotconfCommandCallback(command_t *cmd, context_t *context_)
 {
   (void) context_;
@@ -805,13 +809,17 @@ namespace Ep128Emu {
       configoption_t  tmp = LAST_CONTEXT_OPTION;
       options.push_back(tmp);
     }
+    dotconfMutex.lock();
     configfile_t  *cfgFile = dotconf_create(
         const_cast<char *>(fullName.c_str()), &(options.front()),
         reinterpret_cast<context_t *>(this), CASE_INSENSITIVE);
-    if (!cfgFile)
+    if (!cfgFile) {
+      dotconfMutex.unlock();
       throw Exception("error opening configuration file");
+    }
     const char  *errMsg = dotconf_command_loop_until_error(cfgFile);
     dotconf_cleanup(cfgFile);
+    dotconfMutex.unlock();
     if (errMsg) {
       // FIXME: should include more information in the error message
       throw Exception("error reading configuration file");
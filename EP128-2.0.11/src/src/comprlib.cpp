@@ -19,6 +19,8 @@
 #include "ep128emu.hpp"
 #include "comprlib.hpp"
 
+#include <algorithm>
+
 namespace Ep128Compress {
 
   class HuffmanNode {
@@ -1141,6 +1143,206 @@ namespace Ep128Compress {
 
   // --------------------------------------------------------------------------
 
+  // SA-IS suffix array construction (G. Nong, S. Zhang, W. H. Chan: "Linear
+  // Suffix Array Construction by Almost Pure Induced-Sorting", 2009)
+  // 's' is the input string of 'n' characters in the range 0 to K - 1, the
+  // last character must be a unique zero value, and 'sa' is the output
+  // buffer of 'n' elements
+
+  static void saisGetBuckets(const int *s, size_t n, int *bkt, size_t K,
+                             bool getEnd)
+  {
+    for (size_t i = 0; i < K; i++)
+      bkt[i] = 0;
+    for (size_t i = 0; i < n; i++)
+      bkt[s[i]]++;
+    int     sum = 0;
+    for (size_t i = 0; i < K; i++) {
+      sum = sum + bkt[i];
+      bkt[i] = (getEnd ? sum : (sum - bkt[i]));
+    }
+  }
+
+  static void saisInduceSA(const int *s, int *sa, const unsigned char *t,
+                           size_t n, int *bkt, size_t K)
+  {
+    // induce L-type suffixes from the start of each bucket
+    saisGetBuckets(s, n, bkt, K, false);
+    for (size_t i = 0; i < n; i++) {
+      int     j = sa[i] - 1;
+      if (j >= 0 && !t[j])
+        sa[bkt[s[j]]++] = j;
+    }
+    // induce S-type suffixes from the end of each bucket
+    saisGetBuckets(s, n, bkt, K, true);
+    for (size_t i = n; i-- > 0; ) {
+      int     j = sa[i] - 1;
+      if (j >= 0 && t[j])
+        sa[--bkt[s[j]]] = j;
+    }
+  }
+
+  static EP128EMU_INLINE bool saisIsLMS(const unsigned char *t, int i)
+  {
+    return (i > 0 && t[i] && !t[i - 1]);
+  }
+
+  static void saisSort(const int *s, int *sa, size_t n, size_t K)
+  {
+    // classify characters as S-type (1) or L-type (0)
+    std::vector< unsigned char >  t(n, 1);
+    std::vector< int >  bkt(K);
+    if (n > 1)
+      t[n - 2] = 0;
+    for (size_t i = n - 2; i-- > 0; )
+      t[i] = (unsigned char) (s[i] < s[i + 1] || (s[i] == s[i + 1] && t[i + 1]));
+    // sort LMS substrings
+    saisGetBuckets(s, n, &(bkt.front()), K, true);
+    for (size_t i = 0; i < n; i++)
+      sa[i] = -1;
+    for (size_t i = 1; i < n; i++) {
+      if (saisIsLMS(&(t.front()), int(i)))
+        sa[--bkt[s[i]]] = int(i);
+    }
+    saisInduceSA(s, sa, &(t.front()), n, &(bkt.front()), K);
+    // move all sorted LMS substrings to the first n1 elements of 'sa'
+    size_t  n1 = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (saisIsLMS(&(t.front()), sa[i]))
+        sa[n1++] = sa[i];
+    }
+    // name the LMS substrings
+    for (size_t i = n1; i < n; i++)
+      sa[i] = -1;
+    int     name = 0;
+    int     prv = -1;
+    for (size_t i = 0; i < n1; i++) {
+      int     pos = sa[i];
+      bool    diff = false;
+      for (int d = 0; size_t(d) < n; d++) {
+        if (prv < 0 || s[pos + d] != s[prv + d] || t[pos + d] != t[prv + d]) {
+          diff = true;
+          break;
+        }
+        if (d > 0 && (saisIsLMS(&(t.front()), pos + d) ||
+                      saisIsLMS(&(t.front()), prv + d))) {
+          break;
+        }
+      }
+      if (diff) {
+        name++;
+        prv = pos;
+      }
+      sa[n1 + size_t(pos >> 1)] = name - 1;
+    }
+    for (size_t i = n, j = n; i-- > n1; ) {
+      if (sa[i] >= 0)
+        sa[--j] = sa[i];
+    }
+    // sort the reduced string recursively if the names are not unique
+    int     *sa1 = sa;
+    int     *s1 = sa + (n - n1);
+    if (size_t(name) < n1) {
+      saisSort(s1, sa1, n1, size_t(name));
+    }
+    else {
+      for (size_t i = 0; i < n1; i++)
+        sa1[s1[i]] = int(i);
+    }
+    // induce the final suffix array from the sorted LMS suffixes
+    saisGetBuckets(s, n, &(bkt.front()), K, true);
+    for (size_t i = 1, j = 0; i < n; i++) {
+      if (saisIsLMS(&(t.front()), int(i)))
+        s1[j++] = int(i);
+    }
+    for (size_t i = 0; i < n1; i++)
+      sa1[i] = s1[sa1[i]];
+    for (size_t i = n1; i < n; i++)
+      sa[i] = -1;
+    for (size_t i = n1; i-- > 0; ) {
+      int     j = sa[i];
+      sa[i] = -1;
+      sa[--bkt[s[j]]] = j;
+    }
+    saisInduceSA(s, sa, &(t.front()), n, &(bkt.front()), K);
+  }
+
+  bool LZSearchTable::useSAIS = true;
+
+  void LZSearchTable::setSuffixSortAlgorithm(int n)
+  {
+    useSAIS = (n != 0);
+  }
+
+  void LZSearchTable::sortSuffixes_SAIS(unsigned int *suffixArray,
+                                        unsigned short *prvMatchLenTable,
+                                        const unsigned char *buf,
+                                        size_t bufSize,
+                                        size_t startPos, size_t endPos,
+                                        size_t minLen, size_t maxLen)
+  {
+    // only the first maxLen characters of each suffix need to be compared
+    size_t  textEnd = (endPos + maxLen) < bufSize ? (endPos + maxLen) : bufSize;
+    size_t  n = textEnd - startPos;
+    size_t  nBytes = endPos - startPos;
+    const unsigned char *p = buf + startPos;
+    std::vector< int >  s(n + 1);
+    std::vector< int >  sa(n + 1);
+    for (size_t i = 0; i < n; i++)
+      s[i] = int(p[i]) + 1;
+    s[n] = 0;
+    saisSort(&(s.front()), &(sa.front()), n + 1, 257);
+    // calculate the longest common prefix of each suffix and the previous
+    // one in the suffix array (Kasai et al., 2001), sa[0] is the terminator
+    int     *rank = &(s.front());
+    std::vector< unsigned int > lcpTable(n + 1, 0U);
+    for (size_t i = 1; i <= n; i++)
+      rank[sa[i]] = int(i);
+    size_t  h = 0;
+    for (size_t i = 0; i < n; i++) {
+      size_t  r = size_t(rank[i]);
+      if (r > 1) {
+        size_t  j = size_t(sa[r - 1]);
+        while ((i + h) < n && (j + h) < n && p[i + h] == p[j + h])
+          h++;
+        lcpTable[r] = (unsigned int) (h < maxLen ? h : maxLen);
+        if (h > 0)
+          h--;
+      }
+      else {
+        h = 0;
+      }
+    }
+    // remove positions >= endPos, which were only needed for the comparisons
+    size_t  k = 0;
+    unsigned int  l = 0U;
+    for (size_t i = 1; i <= n; i++) {
+      l = (lcpTable[i] < l ? lcpTable[i] : l);
+      if (size_t(sa[i]) < nBytes) {
+        suffixArray[k] = (unsigned int) (startPos + size_t(sa[i]));
+        prvMatchLenTable[k] = (unsigned short) (k > 0 ? l : 0U);
+        k++;
+        l = (unsigned int) maxLen;
+      }
+    }
+    // sort suffixes with maxLen equal characters by buffer position
+    for (size_t i = 1; i < nBytes; ) {
+      if (prvMatchLenTable[i] < maxLen) {
+        i++;
+        continue;
+      }
+      size_t  j = i + 1;
+      while (j < nBytes && prvMatchLenTable[j] >= maxLen)
+        j++;
+      std::sort(suffixArray + (i - 1), suffixArray + j);
+      i = j;
+    }
+    for (size_t i = 0; i < nBytes; i++) {
+      if (prvMatchLenTable[i] < minLen)
+        prvMatchLenTable[i] = 0;
+    }
+  }
+
   void LZSearchTable::sortFunc(unsigned int *startPtr, unsigned int *endPtr,
                                const unsigned char *buf, size_t bufSize,
                                unsigned int *tmpBuf, size_t maxLen,
@@ -1301,22 +1503,48 @@ namespace Ep128Compress {
       suffixArray.resize(nBytes);
       invSuffixArray.resize(nBytes);
       prvMatchLenTable.resize(nBytes + 1);
-      // create temporary RLE length table to optimize sorting the suffix array
-      prvMatchLenTable[nBytes - 1] = 1;
-      for (size_t i = nBytes - 1; i-- > 0; ) {
-        prvMatchLenTable[i] = 1;
-        if (buf[startPos_ + i] == buf[startPos_ + i + 1]) {
-          unsigned short  l = prvMatchLenTable[i + 1];
-          prvMatchLenTable[i] = l + (unsigned short) (l < maxLength);
-        }
+      if (useSAIS) {
+        sortSuffixes_SAIS(&(suffixArray.front()), &(prvMatchLenTable.front()),
+                          buf, bufSize, startPos_, endPos,
+                          rtMaxLen + 1, maxLength);
       }
-      for (size_t i = 0; i < nBytes; i++)
-        suffixArray[i] = (unsigned int) (startPos_ + i);
-      if (nBytes > 1) {
-        sortFunc(&(suffixArray.front()), &(suffixArray.front()) + nBytes,
-                 buf, bufSize, &(invSuffixArray.front()), maxLength,
-                 &(prvMatchLenTable.front()) - startPos_);
+      else {
+        // create temporary RLE length table to optimize sorting the suffix
+        // array
+        prvMatchLenTable[nBytes - 1] = 1;
+        for (size_t i = nBytes - 1; i-- > 0; ) {
+          prvMatchLenTable[i] = 1;
+          if (buf[startPos_ + i] == buf[startPos_ + i + 1]) {
+            unsigned short  l = prvMatchLenTable[i + 1];
+            prvMatchLenTable[i] = l + (unsigned short) (l < maxLength);
+          }
+        }
+        for (size_t i = 0; i < nBytes; i++)
+          suffixArray[i] = (unsigned int) (startPos_ + i);
+        if (nBytes > 1) {
+          sortFunc(&(suffixArray.front()), &(suffixArray.front()) + nBytes,
+                   buf, bufSize, &(invSuffixArray.front()), maxLength,
+                   &(prvMatchLenTable.front()) - startPos_);
+        }
+        prvMatchLenTable[0] = 0;
+        for (size_t i = 1; i < nBytes; i++) {
+          const unsigned char *p1 = &(buf[suffixArray[i - 1]]);
+          const unsigned char *p2 = &(buf[suffixArray[i]]);
+          size_t  maxLen = size_t((buf + bufSize) - (p1 > p2 ? p1 : p2));
+          maxLen = (maxLen < maxLength ? maxLen : maxLength);
+          size_t  minLen = rtMaxLen + 1;
+          // find longest common prefix
+          prvMatchLenTable[i] = 0U;
+          if (maxLen >= minLen && std::memcmp(p1, p2, minLen) == 0) {
+            maxLen = maxLen - minLen;
+            prvMatchLenTable[i] =
+                (unsigned short) (minLen + RadixTree::compareStrings(
+                                               p1 + minLen, maxLen,
+                                               p2 + minLen, maxLen));
+          }
+        }
       }
+      prvMatchLenTable[nBytes] = 0;
       // invert suffix array
       for (size_t i = 0; i < nBytes; i++)
         invSuffixArray[suffixArray[i] - startPos_] = (unsigned int) i;
@@ -1324,24 +1552,6 @@ namespace Ep128Compress {
       // suffixArray[n - 1], and nxtMatchLenTable[n] characters with
       // suffixArray[n + 1]
       const unsigned short  *nxtMatchLenTable = &(prvMatchLenTable.front()) + 1;
-      prvMatchLenTable[0] = 0;
-      for (size_t i = 1; i < nBytes; i++) {
-        const unsigned char *p1 = &(buf[suffixArray[i - 1]]);
-        const unsigned char *p2 = &(buf[suffixArray[i]]);
-        size_t  maxLen = size_t((buf + bufSize) - (p1 > p2 ? p1 : p2));
-        maxLen = (maxLen < maxLength ? maxLen : maxLength);
-        size_t  minLen = rtMaxLen + 1;
-        // find longest common prefix
-        prvMatchLenTable[i] = 0U;
-        if (maxLen >= minLen && std::memcmp(p1, p2, minLen) == 0) {
-          maxLen = maxLen - minLen;
-          prvMatchLenTable[i] =
-              (unsigned short) (minLen + RadixTree::compareStrings(
-                                             p1 + minLen, maxLen,
-                                             p2 + minLen, maxLen));
-        }
-      }
-      prvMatchLenTable[nBytes] = 0;
       // find all matches:
       for (size_t i = startPos_; i < startPos; i++) {
         size_t  maxLen = ((bufSize - i) < rtMaxLen ? (bufSize - i) : rtMaxLen);
@@ -242,10 +242,23 @@ namespace Ep128Compress {
     uint32_t    maxOffs2_;
     uint32_t    maxOffs_;
     // --------
+    // use SA-IS instead of merge sort for creating the suffix array
+    static bool useSAIS;
+    // --------
     static void sortFunc(unsigned int *startPtr, unsigned int *endPtr,
                          const unsigned char *buf, size_t bufSize,
                          unsigned int *tmpBuf, size_t maxLen,
                          const unsigned short *rleLenTable);
+    // store the suffix array of buffer positions startPos to endPos - 1
+    // in 'suffixArray', using the linear time SA-IS algorithm, and the
+    // length of the common prefix with the previous element (limited to
+    // maxLen, or zero if less than minLen) in 'prvMatchLenTable'; suffixes
+    // with maxLen equal characters are sorted by buffer position
+    static void sortSuffixes_SAIS(unsigned int *suffixArray,
+                                  unsigned short *prvMatchLenTable,
+                                  const unsigned char *buf, size_t bufSize,
+                                  size_t startPos, size_t endPos,
+                                  size_t minLen, size_t maxLen);
     void addMatches(size_t bufPos, unsigned int *offsTable, size_t maxLen);
    public:
     // minLength:   minimum match length
@@ -257,6 +270,11 @@ namespace Ep128Compress {
     LZSearchTable(size_t minLength, size_t maxLength, size_t lengthMaxValue,
                   size_t maxOffs1, size_t maxOffs2, size_t maxOffs);
     virtual ~LZSearchTable();
+    // Select the algorithm used by findMatches() for creating the suffix
+    // array: 0 = merge sort, 1 = SA-IS (default). SA-IS runs in linear time,
+    // and avoids the slow string comparisons of merge sort on highly
+    // redundant input data. The matches found do not depend on this setting
+    static void setSuffixSortAlgorithm(int n);
     // buf:     input data to be searched
     // offs_:   start position in 'buf', this will be at bufPos == 0 in
     //          getMatches(), but up to 'maxOffs' bytes before 'offs_' are
@@ -177,6 +177,10 @@ namespace CPC464 {
   {
     uint16_t  addr = uint16_t(R.PC.W.l);
     vm.memoryWaitM1();
+    if (EP128EMU_UNLIKELY(int32_t(addr) == vm.exitAddress)) {
+      vm.updateCPUHalfCycles(4);
+      return vm.stopAtExitAddress();
+    }
     if (!vm.singleStepMode) {
       uint8_t   retval = vm.memory.readOpcode(addr);
       vm.updateCPUHalfCycles(4);
@@ -464,6 +468,7 @@ namespace CPC464 {
         retval &= vm.ppiPortAState;
         break;
       case 0x0100:              // port B data
+        vm.tapeInputRead();
         retval &= vm.ppiPortBState;
         break;
       case 0x0200:              // port C data
@@ -831,6 +836,17 @@ namespace CPC464 {
     vm.videoCapture->runOneCycle(vm.soundOutputSignal);
   }
 
+  uint8_t CPC464VM::stopAtExitAddress()
+  {
+    exitAddressReached = true;
+    // the HALT opcode returned is not executed while the CPU is stopped
+    z80.setStopFlag(true);
+    // return from run() after the current instruction
+    if (crtcCyclesRemainingH > 0)
+      crtcCyclesRemainingH = 0;
+    return 0x76;
+  }
+
   uint8_t CPC464VM::checkSingleStepModeBreak()
   {
     uint16_t  addr = z80.getReg().PC.W.l;
@@ -1168,17 +1184,8 @@ namespace CPC464 {
     // load file into memory
     std::vector<uint8_t>  buf;
     buf.resize(0x4000);
-    std::FILE   *f = Ep128Emu::fileOpen(fileName, "rb");
-    if (!f)
-      throw Ep128Emu::Exception("cannot open ROM file");
-    std::fseek(f, 0L, SEEK_END);
-    if (std::ftell(f) < long(offs + 0x4000)) {
-      std::fclose(f);
+    if (readROMFile(&(buf.front()), fileName, offs, 0x4000) < 0x4000L)
       throw Ep128Emu::Exception("ROM file is shorter than expected");
-    }
-    std::fseek(f, long(offs), SEEK_SET);
-    std::fread(&(buf.front()), 1, 0x4000, f);
-    std::fclose(f);
     // load new segment, or replace existing ROM
     memory.loadROMSegment(n, &(buf.front()), 0x4000);
   }
@@ -1240,6 +1247,10 @@ namespace CPC464 {
     if (demoFile != (Ep128Emu::File *) 0 && !isRecordingDemo)
       stopDemoRecording(true);
     vmStatus_.isRecordingDemo = isRecordingDemo;
+    perfCounters.getStatus(vmStatus_.perfCounters);
+    getAudioOutput().getBufferStatistics(vmStatus_.audioBufferLevel,
+                                         vmStatus_.audioUnderrunCnt,
+                                         vmStatus_.audioOverrunCnt);
   }
 
   void CPC464VM::openVideoCapture(
@@ -1300,6 +1311,11 @@ namespace CPC464 {
       floppyDrive->openDiskImage(n, fileName_.c_str());
   }
 
+  void CPC464VM::setFloppyCacheSize(int nTracks)
+  {
+    floppyDrive->setCacheSize(nTracks);
+  }
+
   uint32_t CPC464VM::getFloppyDriveLEDState()
   {
     return floppyDrive->getLEDState(0x0C);
@@ -1460,6 +1476,12 @@ namespace CPC464 {
     singleStepModeNextAddr = addr;
   }
 
+  void CPC464VM::setExitAddress(int32_t addr)
+  {
+    VirtualMachine::setExitAddress(addr);
+    z80.setStopFlag(false);
+  }
+
   uint8_t CPC464VM::getMemoryPage(int n) const
   {
     return memory.getPage(uint8_t(n & 3));
@@ -26,6 +26,13 @@ namespace CPC464 {
 
   void CPC464VM::saveState(Ep128Emu::File& f)
   {
+    if (floppyDrive && !f.getIsCheckpoint()) {
+      // the disk images are not included in the snapshot, but they should
+      // be up to date when the snapshot is loaded (rewind checkpoints do not
+      // restore disk images, so these are left to the background flushing)
+      if (!floppyDrive->flushImages())
+        throw Ep128Emu::Exception("error writing floppy disk image file");
+    }
     memory.saveState(f);
     crtc.saveState(f);
     ay3.saveState(f);
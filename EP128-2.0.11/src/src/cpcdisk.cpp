@@ -352,6 +352,37 @@ namespace CPC464 {
 
   // --------------------------------------------------------------------------
 
+  CPCDiskImage::ImageCache::ImageCache(CPCDiskImage& cpcDiskImage_)
+    : Ep128Emu::DiskImageCache(),
+      cpcDiskImage(cpcDiskImage_)
+  {
+  }
+
+  CPCDiskImage::ImageCache::~ImageCache()
+  {
+    (void) closeCache();                // FIXME: errors are ignored here
+  }
+
+  bool CPCDiskImage::ImageCache::readImageData(uint8_t *buf, size_t filePos,
+                                               size_t nBytes)
+  {
+    if (std::fseek(cpcDiskImage.imageFile, long(filePos), SEEK_SET) < 0)
+      return false;
+    return (std::fread(buf, sizeof(uint8_t), nBytes, cpcDiskImage.imageFile)
+            == nBytes);
+  }
+
+  bool CPCDiskImage::ImageCache::writeImageData(const uint8_t *buf,
+                                                size_t filePos, size_t nBytes)
+  {
+    if (std::fseek(cpcDiskImage.imageFile, long(filePos), SEEK_SET) < 0)
+      return false;
+    return (std::fwrite(buf, sizeof(uint8_t), nBytes, cpcDiskImage.imageFile)
+            == nBytes);
+  }
+
+  // --------------------------------------------------------------------------
+
   CPCDiskImage::CPCDiskImage()
     : trackTable((CPCDiskTrackInfo *) 0),
       sectorTableBuf((CPCDiskSectorInfo *) 0),
@@ -360,7 +391,9 @@ namespace CPC464 {
       nSides(0),
       writeProtectFlag(true),
       currentCylinder(1),
-      randomSeed(0)
+      randomSeed(0),
+      cacheTracks(0),
+      imageCache(*this)
   {
     Ep128Emu::setRandomSeed(randomSeed,
                             uint32_t(uintptr_t((void *) this) & 0xFFFFFFFFUL));
@@ -378,6 +411,7 @@ namespace CPC464 {
   void CPCDiskImage::openDiskImage(const char *fileName)
   {
     // close any previous image file first
+    (void) imageCache.closeCache();     // FIXME: errors are ignored here
     if (imageFile)
       std::fclose(imageFile);           // FIXME: errors are ignored here
     imageFile = (std::FILE *) 0;
@@ -430,10 +464,24 @@ namespace CPC464 {
       nSides = tmpBuf[49];
       if (nCylinders < 1 || nCylinders > 240 || nSides < 1 || nSides > 2)
         throw Ep128Emu::Exception("invalid CPC disk image file header");
+      // use the (largest) track size as the cache block size
+      size_t  trackSize = size_t(tmpBuf[50]) | (size_t(tmpBuf[51]) << 8);
+      if (isExtendedFormat) {
+        trackSize = 0;
+        for (int i = 0; i < (nCylinders * nSides) && i < 204; i++) {
+          if ((size_t(tmpBuf[i + 52]) << 8) > trackSize)
+            trackSize = size_t(tmpBuf[i + 52]) << 8;
+        }
+      }
       if (!isExtendedFormat)            // standard disk image format
         parseDSKFileHeaders(&(tmpBuf[0]), size_t(fileSize));
       else                              // extended disk image format
         parseEXTFileHeaders(&(tmpBuf[0]), size_t(fileSize));
+      if (cacheTracks != 0 && trackSize > 0) {
+        imageCache.openCache(size_t(fileSize), trackSize,
+                             size_t(cacheTracks > 0 ? cacheTracks : 0),
+                             writeProtectFlag);
+      }
     }
     catch (...) {
       openDiskImage((char *) 0);
@@ -519,11 +567,17 @@ namespace CPC464 {
                 + (sectorBytes
                    * size_t(getRandomNumber(int(dataSize) / int(sectorBytes))));
     }
-    if (std::fseek(imageFile, long(filePos), SEEK_SET) < 0)
-      return FDC765::CPCDISK_ERROR_SECTOR_NOT_FOUND;
     size_t  nBytes = (dataSize < sectorBytes ? dataSize : sectorBytes);
-    if (std::fread(buf, sizeof(uint8_t), nBytes, imageFile) != nBytes)
-      return FDC765::CPCDISK_ERROR_READ_FAILED;
+    if (imageCache.isCacheOpen()) {
+      if (!imageCache.readCached(buf, filePos, nBytes))
+        return FDC765::CPCDISK_ERROR_READ_FAILED;
+    }
+    else {
+      if (std::fseek(imageFile, long(filePos), SEEK_SET) < 0)
+        return FDC765::CPCDISK_ERROR_SECTOR_NOT_FOUND;
+      if (std::fread(buf, sizeof(uint8_t), nBytes, imageFile) != nBytes)
+        return FDC765::CPCDISK_ERROR_READ_FAILED;
+    }
     if (dataSize < sectorBytes) {
       for (size_t i = dataSize; i < sectorBytes; i++)
         buf[i] = buf[i - dataSize];
@@ -553,15 +607,21 @@ namespace CPC464 {
       err = FDC765::CPCDISK_ERROR_WRITE_FAILED;
       if (t.sectorTableFileOffset != 0U) {
         // deleted sector flag changed: update status register 2 in image file
-        if (std::fseek(imageFile, long(t.sectorTableFileOffset)
-                                  + (long(&s - t.sectorTable) * 8L) + 5L,
-                       SEEK_SET) >= 0) {
-          uint8_t newStatusRegister2 =
-              (s.statusRegister2 & 0xBF) | (statusRegister2 & 0x40);
-          if (std::fputc(newStatusRegister2, imageFile) != EOF) {
-            s.statusRegister2 = newStatusRegister2;
-            err = FDC765::CPCDISK_NO_ERROR;
-          }
+        size_t  st2FilePos = size_t(t.sectorTableFileOffset)
+                             + (size_t(&s - t.sectorTable) * 8) + 5;
+        uint8_t newStatusRegister2 =
+            (s.statusRegister2 & 0xBF) | (statusRegister2 & 0x40);
+        bool    st2Written = false;
+        if (imageCache.isCacheOpen()) {
+          st2Written =
+              imageCache.writeCached(&newStatusRegister2, st2FilePos, 1);
+        }
+        else if (std::fseek(imageFile, long(st2FilePos), SEEK_SET) >= 0) {
+          st2Written = (std::fputc(newStatusRegister2, imageFile) != EOF);
+        }
+        if (st2Written) {
+          s.statusRegister2 = newStatusRegister2;
+          err = FDC765::CPCDISK_NO_ERROR;
         }
       }
     }
@@ -576,11 +636,17 @@ namespace CPC464 {
                    * size_t(getRandomNumber(int(dataSize) / int(sectorBytes))));
       err = FDC765::CPCDISK_ERROR_WRITE_FAILED;
     }
-    if (std::fseek(imageFile, long(filePos), SEEK_SET) < 0)
-      return FDC765::CPCDISK_ERROR_SECTOR_NOT_FOUND;
     size_t  nBytes = (dataSize < sectorBytes ? dataSize : sectorBytes);
-    if (std::fwrite(buf, sizeof(uint8_t), nBytes, imageFile) != nBytes)
-      return FDC765::CPCDISK_ERROR_WRITE_FAILED;
+    if (imageCache.isCacheOpen()) {
+      if (!imageCache.writeCached(buf, filePos, nBytes))
+        return FDC765::CPCDISK_ERROR_WRITE_FAILED;
+    }
+    else {
+      if (std::fseek(imageFile, long(filePos), SEEK_SET) < 0)
+        return FDC765::CPCDISK_ERROR_SECTOR_NOT_FOUND;
+      if (std::fwrite(buf, sizeof(uint8_t), nBytes, imageFile) != nBytes)
+        return FDC765::CPCDISK_ERROR_WRITE_FAILED;
+    }
     return err;
   }
 
@@ -618,6 +684,29 @@ namespace CPC464 {
     }
   }
 
+  void FDC765_CPC::setCacheSize(int nTracks)
+  {
+    for (int i = 0; i < 4; i++)
+      floppyDrives[i].setCacheSize(nTracks);
+  }
+
+  void FDC765_CPC::reset()
+  {
+    FDC765::reset();
+    for (int i = 0; i < 4; i++)
+      (void) floppyDrives[i].flushImage();  // FIXME: errors are ignored here
+  }
+
+  bool FDC765_CPC::flushImages()
+  {
+    bool    retval = true;
+    for (int i = 0; i < 4; i++) {
+      if (!floppyDrives[i].flushImage())
+        retval = false;
+    }
+    return retval;
+  }
+
   bool FDC765_CPC::haveDisk(int driveNum) const
   {
     return floppyDrives[driveNum & 3].haveDisk();
@@ -23,6 +23,7 @@
 #include "ep128emu.hpp"
 #include "fdc765.hpp"
 #include "system.hpp"
+#include "diskcache.hpp"
 
 namespace CPC464 {
 
@@ -40,6 +41,18 @@ namespace CPC464 {
       uint16_t  physicalPosition;       // offset (in bytes) of ID address mark
     };                                  // from the IDAM of the first sector
    protected:
+    class ImageCache : public Ep128Emu::DiskImageCache {
+     private:
+      CPCDiskImage& cpcDiskImage;
+     public:
+      ImageCache(CPCDiskImage& cpcDiskImage_);
+      virtual ~ImageCache();
+     protected:
+      virtual bool readImageData(uint8_t *buf, size_t filePos,
+                                 size_t nBytes);
+      virtual bool writeImageData(const uint8_t *buf, size_t filePos,
+                                  size_t nBytes);
+    };
     struct CPCDiskTrackInfo {
       CPCDiskSectorInfo *sectorTable;   // array of sector info structures
       uint8_t   nSectors;               // number of sectors (0 to 29)
@@ -56,6 +69,8 @@ namespace CPC464 {
     bool      writeProtectFlag;
     uint8_t   currentCylinder;          // drive head position
     int       randomSeed;               // for emulating weak sectors
+    int       cacheTracks;              // 0: no image cache, < 0: whole disk
+    ImageCache  imageCache;
     // ----------------
     void readImageFile(uint8_t *buf, size_t filePos, size_t nBytes);
     void parseDSKFileHeaders(uint8_t *buf, size_t fileSize);
@@ -66,6 +81,17 @@ namespace CPC464 {
     CPCDiskImage();
     virtual ~CPCDiskImage();
     virtual void openDiskImage(const char *fileName);
+    // set the number of tracks to be cached in memory (0: disable the cache,
+    // < 0: whole disk), takes effect when the next image file is opened
+    inline void setCacheSize(int nTracks)
+    {
+      cacheTracks = nTracks;
+    }
+    // write any cached changes to the image file, returns false on error
+    inline bool flushImage()
+    {
+      return imageCache.flushCache();
+    }
     inline bool haveDisk() const
     {
       return (imageFile != (std::FILE *) 0);
@@ -132,6 +158,10 @@ namespace CPC464 {
     FDC765_CPC();
     virtual ~FDC765_CPC();
     virtual void openDiskImage(int n, const char *fileName);
+    virtual void setCacheSize(int nTracks);
+    virtual void reset();
+    // write any cached changes to the image files, returns false on error
+    bool flushImages();
    protected:
     virtual bool haveDisk(int driveNum) const;
     virtual bool getIsTrack0(int driveNum) const;
@@ -0,0 +1,342 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "diskcache.hpp"
+
+#include <vector>
+
+namespace Ep128Emu {
+
+  DiskImageCache::FlushThread::FlushThread(DiskImageCache& diskImageCache_)
+    : Thread(),
+      diskImageCache(diskImageCache_)
+  {
+  }
+
+  DiskImageCache::FlushThread::~FlushThread()
+  {
+  }
+
+  void DiskImageCache::FlushThread::run()
+  {
+    diskImageCache.runFlushThread();
+  }
+
+  // --------------------------------------------------------------------------
+
+  DiskImageCache::DiskImageCache()
+    : imageSize(0),
+      blockSize(0),
+      nBlocks(0),
+      nSlots(0),
+      lruCounter(0U),
+      dirtyBlockCnt(0),
+      readOnlyFlag(true),
+      writeErrorFlag(false),
+      flushThreadExitFlag(false),
+      flushThread((FlushThread *) 0)
+  {
+  }
+
+  DiskImageCache::~DiskImageCache()
+  {
+    // the derived class should have called closeCache() already, the image
+    // data cannot be written at this point
+    stopFlushThread();
+  }
+
+  void DiskImageCache::openCache(size_t imageSize_, size_t blockSize_,
+                                 size_t maxBlocks, bool isReadOnly)
+  {
+    (void) closeCache();                // FIXME: errors are ignored here
+    if (imageSize_ < 1 || blockSize_ < 1)
+      throw Exception("invalid disk image cache parameters");
+    size_t  nBlocks_ = (imageSize_ + blockSize_ - 1) / blockSize_;
+    size_t  nSlots_ = nBlocks_;
+    if (maxBlocks > 0 && maxBlocks < nBlocks_)
+      nSlots_ = maxBlocks;
+    try {
+      blockTable.resize(nBlocks_, size_t(invalidBlock));
+      slotBlocks.resize(nSlots_, size_t(invalidBlock));
+      slotLRU.resize(nSlots_, 0U);
+      slotDirty.resize(nSlots_, false);
+      cacheBuf.resize(nSlots_ * blockSize_);
+      if (!isReadOnly)
+        flushBuf.resize(blockSize_);
+    }
+    catch (...) {
+      (void) closeCache();
+      throw;
+    }
+    imageSize = imageSize_;
+    blockSize = blockSize_;
+    nBlocks = nBlocks_;
+    nSlots = nSlots_;
+    lruCounter = 0U;
+    dirtyBlockCnt = 0;
+    readOnlyFlag = isReadOnly;
+    writeErrorFlag = false;
+    if (nSlots == nBlocks) {
+      // whole image is cached: read all blocks in advance
+      fileMutex.lock();
+      cacheMutex.lock();
+      bool    errorFlag = false;
+      for (size_t i = 0; i < nBlocks && !errorFlag; i++)
+        errorFlag = (loadBlock(i) == invalidBlock);
+      cacheMutex.unlock();
+      fileMutex.unlock();
+      if (errorFlag) {
+        (void) closeCache();
+        throw Exception("error reading disk image file");
+      }
+    }
+    if (!readOnlyFlag) {
+      flushThreadExitFlag = false;
+      flushThread = new FlushThread(*this);
+      flushThread->start();
+    }
+  }
+
+  bool DiskImageCache::closeCache()
+  {
+    stopFlushThread();
+    bool    retval = true;
+    if (isCacheOpen())
+      retval = flushBlocks(false);
+    imageSize = 0;
+    blockSize = 0;
+    nBlocks = 0;
+    nSlots = 0;
+    blockTable.clear();
+    slotBlocks.clear();
+    slotLRU.clear();
+    slotDirty.clear();
+    cacheBuf.clear();
+    flushBuf.clear();
+    dirtyBlockCnt = 0;
+    readOnlyFlag = true;
+    writeErrorFlag = false;
+    return retval;
+  }
+
+  size_t DiskImageCache::loadBlock(size_t blockNum)
+  {
+    size_t  n = blockTable[blockNum];
+    if (n != invalidBlock) {
+      slotLRU[n] = ++lruCounter;
+      return n;
+    }
+    // find an unused slot, or replace the least recently used block
+    n = 0;
+    for (size_t i = 0; i < nSlots; i++) {
+      if (slotBlocks[i] == invalidBlock) {
+        n = i;
+        break;
+      }
+      if ((lruCounter - slotLRU[i]) > (lruCounter - slotLRU[n]))
+        n = i;
+    }
+    if (slotBlocks[n] != invalidBlock) {
+      if (slotDirty[n])
+        (void) writeSlot(n);            // errors are reported by flushCache()
+      blockTable[slotBlocks[n]] = invalidBlock;
+      slotBlocks[n] = invalidBlock;
+    }
+    uint8_t *p = getSlotData(n);
+    size_t  nBytes = getBlockBytes(blockNum);
+    if (!readImageData(p, blockNum * blockSize, nBytes))
+      return invalidBlock;
+    if (nBytes < blockSize)
+      std::memset(p + nBytes, 0x00, blockSize - nBytes);
+    slotBlocks[n] = blockNum;
+    blockTable[blockNum] = n;
+    slotLRU[n] = ++lruCounter;
+    return n;
+  }
+
+  bool DiskImageCache::writeSlot(size_t n)
+  {
+    size_t  blockNum = slotBlocks[n];
+    slotDirty[n] = false;
+    dirtyBlockCnt--;
+    if (!writeImageData(getSlotData(n), blockNum * blockSize,
+                        getBlockBytes(blockNum))) {
+      writeErrorFlag = true;
+      return false;
+    }
+    return true;
+  }
+
+  bool DiskImageCache::readCached(uint8_t *buf, size_t filePos, size_t nBytes)
+  {
+    if (!isCacheOpen() || filePos > imageSize || nBytes > (imageSize - filePos))
+      return false;
+    bool    retval = true;
+    cacheMutex.lock();
+    while (nBytes > 0) {
+      size_t  blockNum = filePos / blockSize;
+      size_t  offs = filePos % blockSize;
+      size_t  cnt = blockSize - offs;
+      cnt = (cnt < nBytes ? cnt : nBytes);
+      size_t  n = blockTable[blockNum];
+      if (n == invalidBlock) {
+        cacheMutex.unlock();
+        fileMutex.lock();
+        cacheMutex.lock();
+        n = loadBlock(blockNum);
+        fileMutex.unlock();
+        if (n == invalidBlock) {
+          retval = false;
+          break;
+        }
+      }
+      else {
+        slotLRU[n] = ++lruCounter;
+      }
+      std::memcpy(buf, getSlotData(n) + offs, cnt);
+      buf = buf + cnt;
+      filePos = filePos + cnt;
+      nBytes = nBytes - cnt;
+    }
+    cacheMutex.unlock();
+    return retval;
+  }
+
+  bool DiskImageCache::writeCached(const uint8_t *buf,
+                                   size_t filePos, size_t nBytes)
+  {
+    if (!isCacheOpen() || readOnlyFlag ||
+        filePos > imageSize || nBytes > (imageSize - filePos)) {
+      return false;
+    }
+    bool    retval = true;
+    bool    notifyFlag = false;
+    cacheMutex.lock();
+    while (nBytes > 0) {
+      size_t  blockNum = filePos / blockSize;
+      size_t  offs = filePos % blockSize;
+      size_t  cnt = blockSize - offs;
+      cnt = (cnt < nBytes ? cnt : nBytes);
+      size_t  n = blockTable[blockNum];
+      if (n == invalidBlock) {
+        cacheMutex.unlock();
+        fileMutex.lock();
+        cacheMutex.lock();
+        n = loadBlock(blockNum);
+        fileMutex.unlock();
+        if (n == invalidBlock) {
+          retval = false;
+          break;
+        }
+      }
+      else {
+        slotLRU[n] = ++lruCounter;
+      }
+      std::memcpy(getSlotData(n) + offs, buf, cnt);
+      if (!slotDirty[n]) {
+        slotDirty[n] = true;
+        notifyFlag = notifyFlag || (dirtyBlockCnt == 0);
+        dirtyBlockCnt++;
+      }
+      buf = buf + cnt;
+      filePos = filePos + cnt;
+      nBytes = nBytes - cnt;
+    }
+    cacheMutex.unlock();
+    if (notifyFlag)
+      flushThreadLock.notify();
+    return retval;
+  }
+
+  bool DiskImageCache::flushBlocks(bool isFlushThread)
+  {
+    fileMutex.lock();
+    cacheMutex.lock();
+    for (size_t i = 0; i < nSlots && dirtyBlockCnt > 0; i++) {
+      if (!slotDirty[i])
+        continue;
+      if (!isFlushThread) {
+        (void) writeSlot(i);
+        continue;
+      }
+      // copy the block, so that the emulation thread can continue to use
+      // the cache while it is being written; the file mutex prevents the
+      // block from being read back from the file before the write is done
+      size_t  blockNum = slotBlocks[i];
+      size_t  nBytes = getBlockBytes(blockNum);
+      std::memcpy(&(flushBuf.front()), getSlotData(i), nBytes);
+      slotDirty[i] = false;
+      dirtyBlockCnt--;
+      cacheMutex.unlock();
+      bool    errorFlag = !writeImageData(&(flushBuf.front()),
+                                          blockNum * blockSize, nBytes);
+      cacheMutex.lock();
+      if (errorFlag)
+        writeErrorFlag = true;
+    }
+    bool    retval = !writeErrorFlag;
+    if (!isFlushThread)
+      writeErrorFlag = false;
+    cacheMutex.unlock();
+    fileMutex.unlock();
+    return retval;
+  }
+
+  bool DiskImageCache::flushCache()
+  {
+    if (!isCacheOpen())
+      return true;
+    return flushBlocks(false);
+  }
+
+  void DiskImageCache::runFlushThread()
+  {
+    while (true) {
+      cacheMutex.lock();
+      bool    exitFlag = flushThreadExitFlag;
+      bool    haveDirtyBlocks = (dirtyBlockCnt > 0);
+      cacheMutex.unlock();
+      if (exitFlag)
+        break;
+      if (!haveDirtyBlocks) {
+        flushThreadLock.wait(1000);
+        continue;
+      }
+      // wait a short time for more writes to the same blocks
+      flushThreadLock.wait(200);
+      (void) flushBlocks(true);
+    }
+  }
+
+  void DiskImageCache::stopFlushThread()
+  {
+    if (!flushThread)
+      return;
+    cacheMutex.lock();
+    flushThreadExitFlag = true;
+    cacheMutex.unlock();
+    flushThreadLock.notify();
+    flushThread->join();
+    delete flushThread;
+    flushThread = (FlushThread *) 0;
+  }
+
+}       // namespace Ep128Emu
@@ -0,0 +1,123 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_DISKCACHE_HPP
+#define EP128EMU_DISKCACHE_HPP
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+
+#include <vector>
+
+namespace Ep128Emu {
+
+  // Cache of disk image data in fixed size blocks (typically one track).
+  // It can either hold the whole image, which is read at open time, or the
+  // least recently used 'maxBlocks' blocks. Modified blocks are written back
+  // to the image file by a background thread, so that the emulation thread
+  // does not wait for the file I/O; flush() writes all pending data
+  // synchronously, and should be called before the image file is closed or
+  // its state is saved. The actual file access is implemented by the derived
+  // class in readImageData() and writeImageData(), which may be called from
+  // either thread, but never concurrently.
+
+  class DiskImageCache {
+   private:
+    class FlushThread : public Thread {
+     private:
+      DiskImageCache& diskImageCache;
+     public:
+      FlushThread(DiskImageCache& diskImageCache_);
+      virtual ~FlushThread();
+     protected:
+      virtual void run();
+    };
+    // ----------------
+    static const size_t invalidBlock = ~(size_t(0));
+    size_t      imageSize;
+    size_t      blockSize;
+    size_t      nBlocks;                // total number of blocks in the image
+    size_t      nSlots;                 // number of blocks that can be cached
+    std::vector< size_t >   blockTable; // block number -> slot, or invalid
+    std::vector< size_t >   slotBlocks; // slot -> block number, or invalid
+    std::vector< uint32_t > slotLRU;
+    std::vector< bool >     slotDirty;
+    std::vector< uint8_t >  cacheBuf;
+    std::vector< uint8_t >  flushBuf;   // used by the flush thread
+    uint32_t    lruCounter;
+    size_t      dirtyBlockCnt;
+    bool        readOnlyFlag;
+    bool        writeErrorFlag;
+    bool        flushThreadExitFlag;
+    // 'fileMutex' is locked while accessing the image file, and before
+    // 'cacheMutex' if both are needed
+    Mutex       fileMutex;
+    Mutex       cacheMutex;
+    ThreadLock  flushThreadLock;        // notified when a block becomes dirty
+    FlushThread *flushThread;
+    // ----------------
+    inline uint8_t *getSlotData(size_t n)
+    {
+      return &(cacheBuf.front()) + (n * blockSize);
+    }
+    inline size_t getBlockBytes(size_t blockNum) const
+    {
+      size_t  offs = blockNum * blockSize;
+      return ((imageSize - offs) < blockSize ? (imageSize - offs) : blockSize);
+    }
+    // returns the slot of 'blockNum', loading it if it is not cached yet;
+    // on error, 'invalidBlock' is returned
+    size_t loadBlock(size_t blockNum);
+    bool writeSlot(size_t n);
+    bool flushBlocks(bool isFlushThread);
+    void runFlushThread();
+    void stopFlushThread();
+   protected:
+    // read or write 'nBytes' bytes at 'filePos' in the image file,
+    // should return false on error
+    virtual bool readImageData(uint8_t *buf, size_t filePos,
+                               size_t nBytes) = 0;
+    virtual bool writeImageData(const uint8_t *buf, size_t filePos,
+                                size_t nBytes) = 0;
+   public:
+    DiskImageCache();
+    virtual ~DiskImageCache();
+    // start caching an image file of 'imageSize_' bytes, using blocks of
+    // 'blockSize_' bytes; if 'maxBlocks' is zero, the whole image is read
+    // into memory; throws Ep128Emu::Exception on error
+    void openCache(size_t imageSize_, size_t blockSize_, size_t maxBlocks,
+                   bool isReadOnly);
+    // flush all changes and free the cache, returns false on write error
+    bool closeCache();
+    inline bool isCacheOpen() const
+    {
+      return (blockSize != 0);
+    }
+    // read or write 'nBytes' bytes at 'filePos' through the cache,
+    // returns false on error or if the range is not in the image
+    bool readCached(uint8_t *buf, size_t filePos, size_t nBytes);
+    bool writeCached(const uint8_t *buf, size_t filePos, size_t nBytes);
+    // write all modified blocks to the image file; returns false if writing
+    // any block failed since the last call
+    bool flushCache();
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_DISKCACHE_HPP
@@ -179,5 +179,41 @@ namespace Ep128Emu {
     (void) isEnabled;
   }
 
+  // --------------------------------------------------------------------------
+
+  NullDisplay::NullDisplay()
+    : VideoDisplay(),
+      frameCnt(0UL)
+  {
+  }
+
+  NullDisplay::~NullDisplay()
+  {
+  }
+
+  void NullDisplay::setDisplayParameters(const DisplayParameters& dp)
+  {
+    displayParameters = dp;
+  }
+
+  const VideoDisplay::DisplayParameters&
+      NullDisplay::getDisplayParameters() const
+  {
+    return displayParameters;
+  }
+
+  void NullDisplay::drawLine(const uint8_t *buf, size_t nBytes)
+  {
+    (void) buf;
+    (void) nBytes;
+  }
+
+  void NullDisplay::vsyncStateChange(bool newState, unsigned int currentSlot_)
+  {
+    (void) currentSlot_;
+    if (newState)
+      frameCnt++;
+  }
+
 }       // namespace Ep128Emu
 
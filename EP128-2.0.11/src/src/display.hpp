@@ -146,6 +146,31 @@ namespace Ep128Emu {
     virtual void limitFrameRate(bool isEnabled);
   };
 
+  /*!
+   * Video display that discards all output, for running the emulation
+   * without a window (e.g. in batch mode). Only the number of frames
+   * (VSYNC pulses) is counted.
+   */
+  class NullDisplay : public VideoDisplay {
+   protected:
+    DisplayParameters displayParameters;
+    uint64_t  frameCnt;
+   public:
+    NullDisplay();
+    virtual ~NullDisplay();
+    virtual void setDisplayParameters(const DisplayParameters& dp);
+    virtual const DisplayParameters& getDisplayParameters() const;
+    virtual void drawLine(const uint8_t *buf, size_t nBytes);
+    virtual void vsyncStateChange(bool newState, unsigned int currentSlot_);
+    /*!
+     * Returns the number of frames received since the display was created.
+     */
+    inline uint64_t getFrameCount() const
+    {
+      return frameCnt;
+    }
+  };
+
 }       // namespace Ep128Emu
 
 #endif  // EP128EMU_DISPLAY_HPP
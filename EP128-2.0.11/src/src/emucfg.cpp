@@ -121,9 +121,18 @@ namespace Ep128Emu {
     defineConfigurationVariable(*this, "vm.enableMemoryTimingEmulation",
                                 vm.enableMemoryTimingEmulation, true,
                                 vmConfigurationChanged);
+    defineConfigurationVariable(*this, "vm.enableFastCPUEmulation",
+                                vm.enableFastCPUEmulation, true,
+                                vmConfigurationChanged);
     defineConfigurationVariable(*this, "vm.enableFileIO",
                                 vm.enableFileIO, false,
                                 vmConfigurationChanged);
+    defineConfigurationVariable(*this, "vm.rewindInterval",
+                                vm.rewindInterval, 0U,
+                                vmConfigurationChanged, 0.0, 3000.0);
+    defineConfigurationVariable(*this, "vm.rewindBufferSize",
+                                vm.rewindBufferSize, 16U,
+                                vmConfigurationChanged, 1.0, 1024.0);
     // ----------------
     defineConfigurationVariable(*this, "memory.ram.size",
                                 memory.ram.size, 128,
@@ -343,6 +352,9 @@ namespace Ep128Emu {
                                   floppy_->sectorsPerTrack, int(-1),
                                   *floppyChanged_, -1.0, 240.0);
     }
+    defineConfigurationVariable(*this, "floppy.cacheTracks",
+                                floppy.cacheTracks, int(0),
+                                floppyCacheChanged, -1.0, 508.0);
     // ----------------
     defineConfigurationVariable(*this, "ide.imageFile0",
                                 ide.imageFile0, std::string(""),
@@ -356,6 +368,9 @@ namespace Ep128Emu {
     defineConfigurationVariable(*this, "ide.imageFile3",
                                 ide.imageFile3, std::string(""),
                                 ideDisk3Changed);
+    defineConfigurationVariable(*this, "ide.flushInterval",
+                                ide.flushInterval, int(1000),
+                                ideSettingsChanged, 0.0, 60000.0);
     // ----------------
 #ifdef ENABLE_SDEXT
     defineConfigurationVariable(*this, "sdext.imageFile",
@@ -396,6 +411,9 @@ namespace Ep128Emu {
     defineConfigurationVariable(*this, "tape.forceMotorOn",
                                 tape.forceMotorOn, false,
                                 tapeSettingsChanged);
+    defineConfigurationVariable(*this, "tape.fastLoading",
+                                tape.fastLoading, false,
+                                tapeSettingsChanged);
     // ----------------
     defineConfigurationVariable(*this, "fileio.workingDirectory",
                                 fileio.workingDirectory, std::string("."),
@@ -499,6 +517,7 @@ namespace Ep128Emu {
       vm_.setVideoFrequency(vm.videoClockFrequency);
       vm_.setSoundClockFrequency(vm.soundClockFrequency);
       vm_.setEnableMemoryTimingEmulation(vm.enableMemoryTimingEmulation);
+      vm_.setEnableFastCPUEmulation(vm.enableFastCPUEmulation);
       vm_.setEnableFileIO(vm.enableFileIO);
       vmConfigurationChanged = false;
     }
@@ -685,6 +704,11 @@ namespace Ep128Emu {
     }
     if (mouseSettingsChanged)
       mouseSettingsChanged = false;
+    if (floppyCacheChanged) {
+      // this needs to be set before opening the disk images
+      vm_.setFloppyCacheSize(floppy.cacheTracks);
+      floppyCacheChanged = false;
+    }
     for (int i = 0; i < 4; i++) {
       FloppyDriveSettings&  cfg = (i == 0 ? floppy.a :
                                    (i == 1 ? floppy.b :
@@ -706,6 +730,10 @@ namespace Ep128Emu {
         isChanged = false;
       }
     }
+    if (ideSettingsChanged) {
+      vm_.setIDEFlushInterval(ide.flushInterval);
+      ideSettingsChanged = false;
+    }
     for (int i = 0; i < 4; i++) {
       std::string&  imageFile = (i == 0 ? ide.imageFile0 :
                                  (i == 1 ? ide.imageFile1 :
@@ -741,6 +769,7 @@ namespace Ep128Emu {
     if (tapeSettingsChanged) {
       vm_.setDefaultTapeSampleRate(tape.defaultSampleRate);
       vm_.setForceTapeMotorOn(tape.forceMotorOn);
+      vm_.setEnableFastTapeLoading(tape.fastLoading);
       tapeSettingsChanged = false;
     }
     if (tapeFileChanged) {
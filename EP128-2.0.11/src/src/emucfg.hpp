@@ -52,7 +52,11 @@ namespace Ep128Emu {
       unsigned int  speedPercentage;    // NOTE: this uses soundSettingsChanged
       int           processPriority;    // uses vmProcessPriorityChanged
       bool          enableMemoryTimingEmulation;
+      bool          enableFastCPUEmulation;
       bool          enableFileIO;
+      // NOTE: the rewind settings are applied by the GUI to the VM thread
+      unsigned int  rewindInterval;     // in video frames, 0 = disabled
+      unsigned int  rewindBufferSize;   // in megabytes
     } vm;
     bool          vmConfigurationChanged;
     bool          vmProcessPriorityChanged;
@@ -172,20 +176,24 @@ namespace Ep128Emu {
       FloppyDriveSettings b;
       FloppyDriveSettings c;
       FloppyDriveSettings d;
+      int         cacheTracks;          // 0: disabled, -1: whole disk
     };
     FloppyConfiguration_  floppy;
     bool          floppyAChanged;
     bool          floppyBChanged;
     bool          floppyCChanged;
     bool          floppyDChanged;
+    bool          floppyCacheChanged;
     // --------
     struct IDEConfiguration_ {
       std::string imageFile0;
       std::string imageFile1;
       std::string imageFile2;
       std::string imageFile3;
+      int         flushInterval;        // in milliseconds
     };
     IDEConfiguration_     ide;
+    bool          ideSettingsChanged;
     bool          ideDisk0Changed;
     bool          ideDisk1Changed;
     bool          ideDisk2Changed;
@@ -206,6 +214,7 @@ namespace Ep128Emu {
       int         soundFileChannel;
       bool        enableSoundFileFilter;
       bool        forceMotorOn;
+      bool        fastLoading;
       double      soundFileFilterMinFreq;
       double      soundFileFilterMaxFreq;
     };
@@ -29,6 +29,8 @@
 #include "ep128vm.hpp"
 #include "debuglib.hpp"
 #include "videorec.hpp"
+#include "exectrace.hpp"
+#include "z80prof.hpp"
 #include "ide.hpp"
 #ifdef ENABLE_SDEXT
 #  include "sdext.hpp"
@@ -99,6 +101,8 @@ namespace Ep128 {
       vm.spectrumEmulatorIOPorts[3] = 0x1F;
       this->NMI_();
     }
+    if (vm.profilerEnabled)
+      vm.profiler->interrupt();
     Z80::executeInterrupt();
   }
 
@@ -148,6 +152,12 @@ namespace Ep128 {
     else {
       vm.cpuCyclesRemaining -= (int64_t(4) << 32);
     }
+    if (EP128EMU_UNLIKELY(int32_t(addr) == vm.exitAddress))
+      return vm.stopAtExitAddress();
+    if (EP128EMU_UNLIKELY(vm.executionTrace != (Ep128Emu::ExecutionTrace *) 0))
+      vm.writeExecutionTraceRecord(addr);
+    if (EP128EMU_UNLIKELY(vm.profilerEnabled))
+      vm.updateProfiler(addr);
     if (!vm.singleStepMode)
       return vm.memory.readOpcode(addr);
     // single step mode
@@ -572,6 +582,19 @@ namespace Ep128 {
     }
   }
 
+  static uint8_t readMemoryForBreakPointCondition(void *userData,
+                                                  uint16_t addr)
+  {
+    return reinterpret_cast< Ep128::Memory * >(userData)->readNoDebug(addr);
+  }
+
+  bool Ep128VM::Memory_::breakPointConditionCallback(
+      Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value)
+  {
+    return cond.evaluate(vm.z80.getReg(), &readMemoryForBreakPointCondition,
+                         (void *) &(vm.memory), addr, value);
+  }
+
   // --------------------------------------------------------------------------
 
   Ep128VM::IOPorts_::IOPorts_(Ep128VM& vm_)
@@ -593,6 +616,13 @@ namespace Ep128 {
     }
   }
 
+  bool Ep128VM::IOPorts_::breakPointConditionCallback(
+      Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value)
+  {
+    return cond.evaluate(vm.z80.getReg(), &readMemoryForBreakPointCondition,
+                         (void *) &(vm.memory), addr, value);
+  }
+
   // --------------------------------------------------------------------------
 
   Ep128VM::Dave_::Dave_(Ep128VM& vm_)
@@ -663,19 +693,33 @@ namespace Ep128 {
 
   void Ep128VM::Nick_::drawLine(const uint8_t *buf, size_t nBytes)
   {
-    if (vm.getIsDisplayEnabled())
+    Ep128Emu::PerfCounters::Sample  tmp;
+    if (vm.getIsDisplayEnabled()) {
+      vm.perfCounters.begin(tmp);
       vm.display.drawLine(buf, nBytes);
-    if (vm.videoCapture)
+      vm.perfCounters.end(Ep128Emu::PerfCounters::DISPLAY, tmp);
+    }
+    if (vm.videoCapture) {
+      vm.perfCounters.begin(tmp);
       vm.videoCapture->horizontalSync(buf, nBytes);
+      vm.perfCounters.end(Ep128Emu::PerfCounters::VIDEO_CAPTURE, tmp);
+    }
   }
 
   void Ep128VM::Nick_::vsyncStateChange(bool newState,
                                         unsigned int currentSlot_)
   {
-    if (vm.getIsDisplayEnabled())
+    Ep128Emu::PerfCounters::Sample  tmp;
+    if (vm.getIsDisplayEnabled()) {
+      vm.perfCounters.begin(tmp);
       vm.display.vsyncStateChange(newState, currentSlot_);
-    if (vm.videoCapture)
+      vm.perfCounters.end(Ep128Emu::PerfCounters::DISPLAY, tmp, 0U);
+    }
+    if (vm.videoCapture) {
+      vm.perfCounters.begin(tmp);
       vm.videoCapture->vsyncStateChange(newState, currentSlot_);
+      vm.perfCounters.end(Ep128Emu::PerfCounters::VIDEO_CAPTURE, tmp, 0U);
+    }
   }
 
   // --------------------------------------------------------------------------
@@ -684,7 +728,7 @@ namespace Ep128 {
   {
     if (isPlayingDemo) {
       isPlayingDemo = false;
-      setCallback(&demoPlayCallback, this, false);
+      setEvent(&demoPlayCallback, this, -1);
       demoTimeCnt = 0U;
       demoBuffer.clear();
       // clear keyboard state at end of playback
@@ -696,11 +740,10 @@ namespace Ep128 {
   void Ep128VM::stopDemoRecording(bool writeFile_)
   {
     isRecordingDemo = false;
-    setCallback(&demoRecordCallback, this, false);
     if (writeFile_ && demoFile != (Ep128Emu::File *) 0) {
       try {
         // put end of demo event
-        demoBuffer.writeUIntVLen(demoTimeCnt);
+        demoBuffer.writeUIntVLen(nickSlotCnt - demoTimeCnt);
         demoTimeCnt = 0U;
         demoBuffer.writeByte(0x00);
         demoBuffer.writeByte(0x00);
@@ -723,8 +766,17 @@ namespace Ep128 {
   {
     stopDemoPlayback();         // changing configuration implies stopping
     stopDemoRecording(false);   // any demo playback or recording
+    setTapeEvent(false);
+    uint64_t  traceCycles = uint64_t(executionTraceCycles)
+                            + (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle));
+    uint64_t  profCycles = uint64_t(profilerCycles)
+                           + (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle));
     cpuCyclesPerNickCycle =
         (int64_t(cpuFrequency) << 32) / int64_t(nickFrequency);
+    executionTraceCycles =
+        int64_t(traceCycles - (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle)));
+    profilerCycles =
+        int64_t(profCycles - (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle)));
     nickCyclesPerCPUCycleD2 =
         uint32_t((uint64_t(1) << 63) / uint64_t(cpuCyclesPerNickCycle));
     daveCyclesPerNickCycle =
@@ -736,6 +788,7 @@ namespace Ep128 {
     else {
       tapeSamplesPerNickCycle = 0L;
     }
+    setTapeEvent(tapeCallbackFlag);
     cpuCyclesRemaining = -1L;
     daveCyclesRemaining = -1L;
     waitCycleCnt = (waitCycleCnt > 0 ?
@@ -786,6 +839,34 @@ namespace Ep128 {
       memoryWaitCycles = int64_t(3) << 32;
       break;
     }
+    updateZ80MemoryAccess();
+  }
+
+  void Ep128VM::updateZ80MemoryAccess()
+  {
+    if (!fastCPUEmulationEnabled) {
+      z80.setFastMemoryAccess();
+    }
+    else if (singleStepMode != 0 ||
+             executionTrace != (Ep128Emu::ExecutionTrace *) 0) {
+      // Z80_::updateCycle() and updateCycles() can still be inlined
+      z80.setFastMemoryAccess(&cpuCyclesRemaining);
+    }
+    else if (memoryTimingEnabled) {
+      // the profiler is updated on the first opcode byte of each instruction
+      z80.setFastMemoryAccess(&cpuCyclesRemaining,
+                              memory.getDirectReadTable(),
+                              memory.getDirectWriteTable(),
+                              memoryWaitCycles_M1, memoryWaitCycles,
+                              !(profilerEnabled || exitAddress >= 0));
+    }
+    else {
+      z80.setFastMemoryAccess(&cpuCyclesRemaining,
+                              memory.getDirectReadTable(),
+                              memory.getDirectWriteTable(),
+                              int64_t(4) << 32, int64_t(3) << 32,
+                              !(profilerEnabled || exitAddress >= 0));
+    }
   }
 
   EP128EMU_REGPARM1 void Ep128VM::runDevices()
@@ -793,6 +874,8 @@ namespace Ep128 {
     do {
       nick.runOneSlot();
       nickCyclesRemainingH--;
+      if (EP128EMU_UNLIKELY(++nickSlotCnt >= nextEventTime))
+        runEvents();
       Ep128VMCallback   *p = firstCallback;
       while (p) {
         Ep128VMCallback *nxt = p->nxt;
@@ -813,7 +896,10 @@ namespace Ep128 {
 
   uint8_t Ep128VM::davePortReadCallback(void *userData, uint16_t addr)
   {
-    return (reinterpret_cast<Ep128VM *>(userData)->dave.readPort(addr));
+    Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
+    if (addr == 0x16)                   // B6H: tape input in bits 6 and 7
+      vm.tapeInputRead();
+    return vm.dave.readPort(addr);
   }
 
   void Ep128VM::davePortWriteCallback(void *userData,
@@ -851,6 +937,8 @@ namespace Ep128 {
     // floppy emulation is disabled while recording or playing demo
     if (vm.isRecordingDemo | vm.isPlayingDemo)
       return uint8_t((addr & 0x0008) ? 0x7D : 0x00);
+    Ep128Emu::PerfCounters::Section perfSection(
+        vm.perfCounters, Ep128Emu::PerfCounters::DISK_IO);
     switch (addr) {
     case 0x00:
       return vm.wd177x.readStatusRegister();
@@ -875,6 +963,8 @@ namespace Ep128 {
     // floppy emulation is disabled while recording or playing demo
     if (vm.isRecordingDemo | vm.isPlayingDemo)
       return;
+    Ep128Emu::PerfCounters::Section perfSection(
+        vm.perfCounters, Ep128Emu::PerfCounters::DISK_IO);
     if (addr & 0x0008) {
       if (!(value & 0x0F)) {
         vm.wd177x.setFloppyDrive((Ep128Emu::FloppyDrive *) 0);
@@ -1125,8 +1215,11 @@ namespace Ep128 {
   {
     Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
     // IDE emulation is disabled while recording or playing demo
-    if (!(vm.isRecordingDemo | vm.isPlayingDemo))
+    if (!(vm.isRecordingDemo | vm.isPlayingDemo)) {
+      Ep128Emu::PerfCounters::Section perfSection(
+          vm.perfCounters, Ep128Emu::PerfCounters::DISK_IO);
       return vm.ideInterface->readPort(addr);
+    }
     return 0xFF;
   }
 
@@ -1135,8 +1228,11 @@ namespace Ep128 {
   {
     Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
     // IDE emulation is disabled while recording or playing demo
-    if (!(vm.isRecordingDemo | vm.isPlayingDemo))
+    if (!(vm.isRecordingDemo | vm.isPlayingDemo)) {
+      Ep128Emu::PerfCounters::Section perfSection(
+          vm.perfCounters, Ep128Emu::PerfCounters::DISK_IO);
       vm.ideInterface->writePort(addr, value);
+    }
   }
 
   void Ep128VM::mouseRTSWriteCallback(void *userData,
@@ -1153,7 +1249,6 @@ namespace Ep128 {
           vm.mouseButtonState = 0x00;
           vm.mouseWheelDelta = 0x00;
         }
-        vm.setCallback(&mouseTimerCallback, userData, true);
         uint8_t   dx = uint8_t(vm.mouseDeltaX) & 0xFF;
         uint8_t   dy = uint8_t(vm.mouseDeltaY) & 0xFF;
         uint32_t  mouseData_ =
@@ -1177,6 +1272,7 @@ namespace Ep128 {
       vm.dave.setMouseInput(daveInput);
       // 1500 us
       vm.mouseTimer = (uint32_t(vm.nickFrequency) * 1573U + 0x00080000U) >> 20;
+      vm.setEvent(&mouseTimerCallback, userData, int64_t(vm.mouseTimer));
     }
     vm.prvB7PortState = value;
     vm.davePortWriteCallback(userData, addr, value);
@@ -1225,31 +1321,26 @@ namespace Ep128 {
   void Ep128VM::mouseTimerCallback(void *userData)
   {
     Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
-    if (EP128EMU_EXPECT(vm.mouseTimer > 1U)) {
-      vm.mouseTimer--;
-      return;
-    }
     vm.mouseTimer = 0U;
     vm.mouseData = 0ULL;
-    vm.setCallback(&mouseTimerCallback, userData, false);
     vm.dave.clearMouseInput();
   }
 
   void Ep128VM::tapeCallback(void *userData)
   {
     Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
-    vm.tapeSamplesRemaining += vm.tapeSamplesPerNickCycle;
-    if (vm.tapeSamplesRemaining > 0) {
-      // assume tape sample rate < nickFrequency
-      vm.tapeSamplesRemaining -= (int64_t(1) << 32);
-      int   daveTapeInput = vm.runTape(int(vm.soundOutputSignal & 0xFFFFU));
-      vm.dave.setTapeInput(daveTapeInput, daveTapeInput);
-    }
+    // called when tapeSamplesRemaining becomes positive
+    vm.tapeSamplesRemaining -= (int64_t(1) << 32);
+    int     daveTapeInput = vm.runTape(int(vm.soundOutputSignal & 0xFFFFU));
+    vm.dave.setTapeInput(daveTapeInput, daveTapeInput);
+    vm.setTapeEvent(true);
   }
 
   void Ep128VM::demoPlayCallback(void *userData)
   {
     Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
+    // the time of the next demo event has been reached
+    vm.demoTimeCnt = 0U;
     while (!vm.demoTimeCnt) {
       if (vm.haveTape() &&
           vm.getIsTapeMotorOn() && vm.getTapeButtonState() != 0) {
@@ -1292,13 +1383,7 @@ namespace Ep128 {
       }
     }
     if (vm.demoTimeCnt)
-      vm.demoTimeCnt--;
-  }
-
-  void Ep128VM::demoRecordCallback(void *userData)
-  {
-    Ep128VM&  vm = *(reinterpret_cast<Ep128VM *>(userData));
-    vm.demoTimeCnt++;
+      vm.setEvent(&demoPlayCallback, userData, int64_t(vm.demoTimeCnt));
   }
 
   void Ep128VM::videoCaptureCallback(void *userData)
@@ -1335,6 +1420,57 @@ namespace Ep128 {
 
 #endif
 
+  void Ep128VM::writeExecutionTraceRecord(uint16_t addr)
+  {
+    uint8_t *p = executionTrace->allocateRecord();
+    if (!p) {
+      // the maximum number of instructions has been reached
+      closeExecutionTrace();
+      return;
+    }
+    const Z80_REGISTERS&  r = z80.getReg();
+    Ep128Emu::ExecutionTrace::setUInt16(p, addr);
+    p[2] = pageTable[addr >> 14];
+    p[3] = 4;
+    for (int i = 0; i < 4; i++)
+      p[i + 4] = memory.readNoDebug(uint16_t((addr + i) & 0xFFFF));
+    // the cycle count includes the opcode fetch of this instruction
+    Ep128Emu::ExecutionTrace::setUInt64(
+        p + 8, (uint64_t(executionTraceCycles)
+                + (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle))
+                - uint64_t(cpuCyclesRemaining)) >> 32);
+    Ep128Emu::ExecutionTrace::setUInt16(p + 16, uint16_t(r.AF.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 18, uint16_t(r.BC.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 20, uint16_t(r.DE.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 22, uint16_t(r.HL.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 24, uint16_t(r.SP.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 26, uint16_t(r.IX.W));
+    Ep128Emu::ExecutionTrace::setUInt16(p + 28, uint16_t(r.IY.W));
+    p[30] = uint8_t(r.I);
+    p[31] = uint8_t((r.RBit7 & 0x80) | (r.R & 0x7F));
+  }
+
+  void Ep128VM::updateProfiler(uint16_t addr)
+  {
+    profiler->instructionStart(uint64_t(profilerCycles)
+                               + (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle))
+                               - uint64_t(cpuCyclesRemaining),
+                               pageTable[addr >> 14], addr,
+                               uint16_t(z80.getReg().SP.W),
+                               memory.readNoDebug(addr));
+  }
+
+  uint8_t Ep128VM::stopAtExitAddress()
+  {
+    exitAddressReached = true;
+    // the HALT opcode returned is not executed while the CPU is stopped
+    z80.setStopFlag(true);
+    // return from run() at the end of the current NICK slot
+    if (nickCyclesRemainingH > 1)
+      nickCyclesRemainingH = 1;
+    return 0x76;
+  }
+
   uint8_t Ep128VM::checkSingleStepModeBreak()
   {
     uint16_t  addr = z80.getReg().PC.W.l;
@@ -1537,6 +1673,104 @@ namespace Ep128 {
     }
   }
 
+  void Ep128VM::setEvent(void (*func)(void *userData), void *userData_,
+                         int64_t delay)
+  {
+    if (!func)
+      return;
+    const size_t  maxEvents = sizeof(events) / sizeof(Ep128VMEvent);
+    int     ndx = -1;
+    for (size_t i = 0; i < maxEvents; i++) {
+      if (events[i].func == func && events[i].userData == userData_) {
+        ndx = int(i);
+        break;
+      }
+    }
+    if (delay < 0L) {
+      if (ndx < 0)
+        return;
+      events[ndx].func = (void (*)(void *)) 0;
+      events[ndx].userData = (void *) 0;
+      events[ndx].eventTime = 0U;
+    }
+    else {
+      if (ndx < 0) {
+        for (size_t i = 0; i < maxEvents; i++) {
+          if (events[i].func == (void (*)(void *)) 0) {
+            ndx = int(i);
+            break;
+          }
+        }
+        if (ndx < 0)
+          throw Ep128Emu::Exception("Ep128VM: too many events");
+      }
+      events[ndx].func = func;
+      events[ndx].userData = userData_;
+      events[ndx].eventTime = nickSlotCnt + uint64_t(delay);
+    }
+    nextEventTime = ~(uint64_t(0));
+    for (size_t i = 0; i < maxEvents; i++) {
+      if (events[i].func && events[i].eventTime < nextEventTime)
+        nextEventTime = events[i].eventTime;
+    }
+  }
+
+  int64_t Ep128VM::getEventDelay(void (*func)(void *userData),
+                                 void *userData_) const
+  {
+    for (size_t i = 0; i < (sizeof(events) / sizeof(Ep128VMEvent)); i++) {
+      if (events[i].func == func && events[i].userData == userData_) {
+        if (events[i].eventTime <= nickSlotCnt)
+          return 0L;
+        return int64_t(events[i].eventTime - nickSlotCnt);
+      }
+    }
+    return -1L;
+  }
+
+  EP128EMU_REGPARM1 void Ep128VM::runEvents()
+  {
+    const size_t  maxEvents = sizeof(events) / sizeof(Ep128VMEvent);
+    for (size_t i = 0; i < maxEvents; i++) {
+      if (events[i].func && events[i].eventTime <= nickSlotCnt) {
+        // the event is removed before calling its function, which may
+        // schedule it again
+        void    (*func)(void *) = events[i].func;
+        void    *userData_ = events[i].userData;
+        events[i].func = (void (*)(void *)) 0;
+        events[i].userData = (void *) 0;
+        events[i].eventTime = 0U;
+        func(userData_);
+      }
+    }
+    nextEventTime = ~(uint64_t(0));
+    for (size_t i = 0; i < maxEvents; i++) {
+      if (events[i].func && events[i].eventTime < nextEventTime)
+        nextEventTime = events[i].eventTime;
+    }
+  }
+
+  void Ep128VM::setTapeEvent(bool isEnabled)
+  {
+    int64_t delay = getEventDelay(&tapeCallback, this);
+    if (delay >= 0L) {
+      // tapeSamplesRemaining has already been advanced to the time of the
+      // event, so subtract the part that has not been emulated yet
+      tapeSamplesRemaining -= (delay * tapeSamplesPerNickCycle);
+      setEvent(&tapeCallback, this, -1);
+    }
+    if (!(isEnabled && tapeSamplesPerNickCycle > 0L))
+      return;
+    // find the first NICK cycle at which tapeSamplesRemaining becomes
+    // positive (assuming tape sample rate < nickFrequency, this is at least
+    // once per tape sample)
+    delay = 1L;
+    if (tapeSamplesRemaining <= 0L)
+      delay = (-tapeSamplesRemaining) / tapeSamplesPerNickCycle + 1L;
+    tapeSamplesRemaining += (delay * tapeSamplesPerNickCycle);
+    setEvent(&tapeCallback, this, delay);
+  }
+
   // --------------------------------------------------------------------------
 
   Ep128VM::Ep128VM(Ep128Emu::VideoDisplay& display_,
@@ -1549,6 +1783,7 @@ namespace Ep128 {
       nick(*this),
       nickCyclesRemainingL(0U),
       nickCyclesRemainingH(0),
+      nickSlotCnt(0U),
       cpuCyclesPerNickCycle(0L),
       cpuCyclesRemaining(-1L),
       daveCyclesPerNickCycle(0L),
@@ -1557,6 +1792,7 @@ namespace Ep128 {
       memoryWaitCycles(0L),
       memoryWaitMode(1),
       memoryTimingEnabled(true),
+      fastCPUEmulationEnabled(true),
       singleStepMode(0),
       singleStepModeNextAddr(int32_t(-1)),
       tapeCallbackFlag(false),
@@ -1574,7 +1810,13 @@ namespace Ep128 {
       spectrumEmulatorEnabled(false),
       prvRTCTime(-1L),
       firstCallback((Ep128VMCallback *) 0),
+      nextEventTime(~(uint64_t(0))),
       videoCapture((Ep128Emu::VideoCapture *) 0),
+      executionTrace((Ep128Emu::ExecutionTrace *) 0),
+      executionTraceCycles(0),
+      profiler((Ep128Emu::Z80Profiler *) 0),
+      profilerCycles(0),
+      profilerEnabled(false),
       nickCyclesPerCPUCycleD2(0U),
       videoMemoryWaitMult(0U),
       videoMemoryWaitCycles(0U),
@@ -1622,6 +1864,11 @@ namespace Ep128 {
       callbacks[i].userData = (void *) 0;
       callbacks[i].nxt = (Ep128VMCallback *) 0;
     }
+    for (size_t i = 0; i < (sizeof(events) / sizeof(Ep128VMEvent)); i++) {
+      events[i].func = (void (*)(void *)) 0;
+      events[i].userData = (void *) 0;
+      events[i].eventTime = 0U;
+    }
     for (size_t i = 0; i < 4; i++) {
       pageTable[i] = 0x00;
       spectrumEmulatorIOPorts[i] = 0xFF;
@@ -1701,6 +1948,11 @@ namespace Ep128 {
 
   Ep128VM::~Ep128VM()
   {
+    closeExecutionTrace();
+    if (profiler) {
+      delete profiler;
+      profiler = (Ep128Emu::Z80Profiler *) 0;
+    }
     if (videoCapture) {
       delete videoCapture;
       videoCapture = (Ep128Emu::VideoCapture *) 0;
@@ -1717,6 +1969,7 @@ namespace Ep128 {
   void Ep128VM::run(size_t microseconds)
   {
     Ep128Emu::VirtualMachine::run(microseconds);
+    ideInterface->checkImageFlush();
     if (snapshotLoadFlag) {
       snapshotLoadFlag = false;
       // if just loaded a snapshot, and not playing a demo,
@@ -1732,7 +1985,7 @@ namespace Ep128 {
       tapeCallbackFlag = newTapeCallbackFlag;
       if (!tapeCallbackFlag)
         dave.setTapeInput(0, 0);
-      setCallback(&tapeCallback, this, tapeCallbackFlag);
+      setTapeEvent(tapeCallbackFlag);
     }
     {
       int64_t tmp =
@@ -1744,7 +1997,19 @@ namespace Ep128 {
     }
     if (EP128EMU_UNLIKELY(nickCyclesRemainingH < 1))
       return;
+    Ep128Emu::PerfCounters::Sample  perfCounterSample;
+    perfCounters.begin(perfCounterSample);
     do {
+#ifdef ENABLE_PERF_COUNTERS
+      if (EP128EMU_UNLIKELY(!(uint32_t(nickSlotCnt + 1U)
+                              & (Ep128Emu::PerfCounters::sampleInterval - 1U))))
+      {
+        runOneSlotSampled();
+        continue;
+      }
+#endif
+      if (EP128EMU_UNLIKELY(++nickSlotCnt >= nextEventTime))
+        runEvents();
       Ep128VMCallback   *p = firstCallback;
       while (p) {
         Ep128VMCallback *nxt = p->nxt;
@@ -1764,8 +2029,53 @@ namespace Ep128 {
         z80.executeInstruction();
       nick.runOneSlot();
     } while (EP128EMU_EXPECT(--nickCyclesRemainingH > 0));
+    perfCounters.endLoop(perfCounterSample);
   }
 
+#ifdef ENABLE_PERF_COUNTERS
+
+  // same as one iteration of the main loop in run(), but with performance
+  // counters updated
+  EP128EMU_REGPARM1 void Ep128VM::runOneSlotSampled()
+  {
+    Ep128Emu::PerfCounters::Sample  tmp;
+    perfCounters.begin(tmp);
+    if (EP128EMU_UNLIKELY(++nickSlotCnt >= nextEventTime))
+      runEvents();
+    Ep128VMCallback   *p = firstCallback;
+    while (p) {
+      Ep128VMCallback *nxt = p->nxt;
+      p->func(p->userData);
+      p = nxt;
+    }
+    perfCounters.endSampled(Ep128Emu::PerfCounters::DEVICES, tmp, 1U);
+    perfCounters.begin(tmp);
+    uint32_t  n = 0U;
+    daveCyclesRemaining += daveCyclesPerNickCycle;
+    if (daveCyclesRemaining >= 0L) {
+      do {
+        daveCyclesRemaining -= (int64_t(1) << 32);
+        soundOutputSignal = dave.runOneCycle();
+        sendAudioOutput(soundOutputSignal + externalDACOutput);
+        n++;
+      } while (EP128EMU_UNLIKELY(daveCyclesRemaining >= 0L));
+    }
+    perfCounters.endSampled(Ep128Emu::PerfCounters::DAVE, tmp, n);
+    perfCounters.begin(tmp);
+    cpuCyclesRemaining += cpuCyclesPerNickCycle;
+    int64_t   cpuCycles = cpuCyclesRemaining;
+    while (cpuCyclesRemaining >= 0L)
+      z80.executeInstruction();
+    cpuCycles = ((cpuCycles - cpuCyclesRemaining) + 0x80000000LL) >> 32;
+    perfCounters.endSampled(Ep128Emu::PerfCounters::Z80, tmp,
+                            uint64_t(cpuCycles));
+    perfCounters.begin(tmp);
+    nick.runOneSlot();
+    perfCounters.endSampled(Ep128Emu::PerfCounters::NICK, tmp, 1U);
+  }
+
+#endif
+
   void Ep128VM::reset(bool isColdReset)
   {
     stopDemoPlayback();         // TODO: should be recorded as an event ?
@@ -1800,6 +2110,7 @@ namespace Ep128 {
     mouseEmulationEnabled = false;
     prvB7PortState = 0x00;
     mouseTimer = 0U;
+    setEvent(&mouseTimerCallback, this, -1);
     mouseData = 0ULL;
     mouseDeltaX = 0;
     mouseDeltaY = 0;
@@ -1911,9 +2222,16 @@ namespace Ep128 {
       stopDemoPlayback();       // changing configuration implies stopping
       stopDemoRecording(false); // any demo playback or recording
       memoryTimingEnabled = isEnabled;
+      updateZ80MemoryAccess();
     }
   }
 
+  void Ep128VM::setEnableFastCPUEmulation(bool isEnabled)
+  {
+    fastCPUEmulationEnabled = isEnabled;
+    updateZ80MemoryAccess();
+  }
+
   void Ep128VM::setKeyboardState(int keyCode, bool isPressed)
   {
     if (!isPlayingDemo)
@@ -1923,8 +2241,8 @@ namespace Ep128 {
         stopDemoRecording(false);
         return;
       }
-      demoBuffer.writeUIntVLen(demoTimeCnt);
-      demoTimeCnt = 0U;
+      demoBuffer.writeUIntVLen(nickSlotCnt - demoTimeCnt);
+      demoTimeCnt = nickSlotCnt;
       demoBuffer.writeByte(isPressed ? 0x01 : 0x02);
       demoBuffer.writeByte(0x01);
       demoBuffer.writeByte(uint8_t(keyCode & 0x7F));
@@ -1942,8 +2260,8 @@ namespace Ep128 {
         stopDemoRecording(false);
       }
       else if (mouseEmulationEnabled) {
-        demoBuffer.writeUIntVLen(demoTimeCnt);
-        demoTimeCnt = 0U;
+        demoBuffer.writeUIntVLen(nickSlotCnt - demoTimeCnt);
+        demoTimeCnt = nickSlotCnt;
         demoBuffer.writeByte(0x03);     // event type (mouse)
         demoBuffer.writeByte(0x04);     // number of data bytes
         demoBuffer.writeByte(uint8_t(dX));
@@ -1985,10 +2303,35 @@ namespace Ep128 {
     n = n | sdext.getLEDState();
 #endif
     vmStatus_.floppyDriveLEDState = n | ideInterface->getLEDState();
+    for (int i = 0; i < 4; i++) {
+      ideInterface->getIOStatistics(i, vmStatus_.ideSectorsRead[i],
+                                    vmStatus_.ideSectorsWritten[i],
+                                    vmStatus_.ideFileIOCalls[i]);
+    }
+    if (videoCapture) {
+      size_t  blocksUsed = 0;
+      size_t  maxBlocksUsed = 0;
+      size_t  stallCnt = 0;
+      videoCapture->getQueueStatistics(blocksUsed, maxBlocksUsed, stallCnt,
+                                       vmStatus_.videoCaptureStallTime);
+      vmStatus_.videoCaptureQueueBlocks = uint32_t(blocksUsed);
+      vmStatus_.videoCaptureQueueMaxBlocks = uint32_t(maxBlocksUsed);
+      vmStatus_.videoCaptureStallCnt = uint32_t(stallCnt);
+    }
+    else {
+      vmStatus_.videoCaptureQueueBlocks = 0U;
+      vmStatus_.videoCaptureQueueMaxBlocks = 0U;
+      vmStatus_.videoCaptureStallCnt = 0U;
+      vmStatus_.videoCaptureStallTime = 0.0;
+    }
     vmStatus_.isPlayingDemo = isPlayingDemo;
     if (demoFile != (Ep128Emu::File *) 0 && !isRecordingDemo)
       stopDemoRecording(true);
     vmStatus_.isRecordingDemo = isRecordingDemo;
+    perfCounters.getStatus(vmStatus_.perfCounters);
+    getAudioOutput().getBufferStatistics(vmStatus_.audioBufferLevel,
+                                         vmStatus_.audioUnderrunCnt,
+                                         vmStatus_.audioOverrunCnt);
   }
 
   void Ep128VM::openVideoCapture(
@@ -2164,6 +2507,17 @@ namespace Ep128 {
     }
   }
 
+  void Ep128VM::setIDEFlushInterval(int msec)
+  {
+    ideInterface->setFlushInterval(msec);
+  }
+
+  void Ep128VM::setFloppyCacheSize(int nTracks)
+  {
+    for (int i = 0; i < 4; i++)
+      floppyDrives[i].setCacheSize(nTracks);
+  }
+
   uint32_t Ep128VM::getFloppyDriveLEDState()
   {
     uint32_t  n = 0U;
@@ -2180,12 +2534,14 @@ namespace Ep128 {
   void Ep128VM::setTapeFileName(const std::string& fileName)
   {
     Ep128Emu::VirtualMachine::setTapeFileName(fileName);
+    setTapeEvent(false);
     setTapeMotorState(bool(remoteControlState));
     if (haveTape()) {
       tapeSamplesPerNickCycle =
           (int64_t(getTapeSampleRate()) << 32) / int64_t(nickFrequency);
     }
     tapeSamplesRemaining = 0;
+    setTapeEvent(tapeCallbackFlag);
   }
 
   void Ep128VM::tapePlay()
@@ -2219,17 +2575,17 @@ namespace Ep128 {
     else {
       if (bp.isIO()) {
         ioPorts.setBreakPoint(bp.addr(), bp.priority(),
-                              bp.isRead(), bp.isWrite());
+                              bp.isRead(), bp.isWrite(), bp.condition());
       }
       else if (bp.haveSegment()) {
         memory.setBreakPoint(bp.segment(), bp.addr(), bp.priority(),
                              bp.isRead(), bp.isWrite(), bp.isExecute(),
-                             bp.isIgnore());
+                             bp.isIgnore(), bp.condition());
       }
       else {
         memory.setBreakPoint(bp.addr(), bp.priority(),
                              bp.isRead(), bp.isWrite(), bp.isExecute(),
-                             bp.isIgnore());
+                             bp.isIgnore(), bp.condition());
       }
     }
   }
@@ -2256,6 +2612,7 @@ namespace Ep128 {
       return;
     singleStepMode = uint8_t(mode_);
     singleStepModeNextAddr = int32_t(-1);
+    updateZ80MemoryAccess();
     {
       int     tmp = 4;
       if (mode_ == 0 || mode_ == 3)
@@ -2323,6 +2680,81 @@ namespace Ep128 {
     singleStepModeNextAddr = addr;
   }
 
+  void Ep128VM::setExitAddress(int32_t addr)
+  {
+    VirtualMachine::setExitAddress(addr);
+    z80.setStopFlag(false);
+    // the first opcode byte is read with readOpcodeFirstByte() if the exit
+    // address is set
+    updateZ80MemoryAccess();
+  }
+
+  void Ep128VM::openExecutionTrace(std::FILE *f, size_t maxInstructions,
+                                   bool ringMode)
+  {
+    closeExecutionTrace();
+    executionTrace =
+        new Ep128Emu::ExecutionTrace(f, maxInstructions, ringMode);
+    executionTraceCycles =
+        int64_t(uint64_t(cpuCyclesRemaining)
+                - (nickSlotCnt * uint64_t(cpuCyclesPerNickCycle)));
+    updateZ80MemoryAccess();
+  }
+
+  void Ep128VM::closeExecutionTrace()
+  {
+    if (executionTrace) {
+      Ep128Emu::ExecutionTrace  *tmp = executionTrace;
+      executionTrace = (Ep128Emu::ExecutionTrace *) 0;
+      delete tmp;
+      updateZ80MemoryAccess();
+    }
+  }
+
+  bool Ep128VM::getIsExecutionTraceOn() const
+  {
+    return (executionTrace != (Ep128Emu::ExecutionTrace *) 0);
+  }
+
+  void Ep128VM::startProfiler()
+  {
+    if (!profiler)
+      profiler = new Ep128Emu::Z80Profiler();
+    else
+      profiler->clear();
+    profilerEnabled = true;
+    updateZ80MemoryAccess();
+  }
+
+  void Ep128VM::stopProfiler()
+  {
+    if (profilerEnabled) {
+      profilerEnabled = false;
+      updateZ80MemoryAccess();
+    }
+  }
+
+  bool Ep128VM::getIsProfilerOn() const
+  {
+    return profilerEnabled;
+  }
+
+  void Ep128VM::writeProfilerReport(std::FILE *f, int format,
+                                    const char *symbolFileName)
+  {
+    if (!profiler)
+      throw Ep128Emu::Exception("no profiling data is available");
+    if (symbolFileName && symbolFileName[0] != '\0')
+      profiler->loadSymbols(symbolFileName);
+    else
+      profiler->clearSymbols();
+    // Sjasm symbols are only used for code in RAM
+    uint8_t symbolSegments[256];
+    for (int i = 0; i < 256; i++)
+      symbolSegments[i] = uint8_t(memory.isSegmentRAM(uint8_t(i)));
+    profiler->writeReport(f, format, &(symbolSegments[0]));
+  }
+
   uint8_t Ep128VM::getMemoryPage(int n) const
   {
     return memory.getPage(uint8_t(n & 3));
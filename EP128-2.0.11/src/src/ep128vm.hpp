@@ -43,6 +43,8 @@
 
 namespace Ep128Emu {
   class VideoCapture;
+  class ExecutionTrace;
+  class Z80Profiler;
 }
 
 namespace Ep128 {
@@ -93,6 +95,8 @@ namespace Ep128 {
      protected:
       virtual void breakPointCallback(bool isWrite,
                                       uint16_t addr, uint8_t value);
+      virtual bool breakPointConditionCallback(
+          Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value);
     };
     class IOPorts_ : public IOPorts {
      private:
@@ -103,6 +107,8 @@ namespace Ep128 {
      protected:
       virtual void breakPointCallback(bool isWrite,
                                       uint16_t addr, uint8_t value);
+      virtual bool breakPointConditionCallback(
+          Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value);
     };
     class Dave_ : public Dave {
      private:
@@ -138,6 +144,7 @@ namespace Ep128 {
     uint8_t   pageTable[4];
     uint32_t  nickCyclesRemainingL;     // in 2^-32 NICK cycle units
     int32_t   nickCyclesRemainingH;
+    uint64_t  nickSlotCnt;              // total number of NICK slots run
     int64_t   cpuCyclesPerNickCycle;    // in 2^-32 Z80 cycle units
     int64_t   cpuCyclesRemaining;       // in 2^-32 Z80 cycle units
     int64_t   daveCyclesPerNickCycle;   // in 2^-32 DAVE cycle units
@@ -146,6 +153,9 @@ namespace Ep128 {
     int64_t   memoryWaitCycles;         // in 2^-32 Z80 cycle units
     uint8_t   memoryWaitMode;           // set on write to port 0xBF
     bool      memoryTimingEnabled;
+    // if true, the Z80 accesses memory directly where possible
+    // (see Ep128::Z80::setFastMemoryAccess())
+    bool      fastCPUEmulationEnabled;
     // 0: normal mode, 1: single step, 2: step over, 3: trace
     uint8_t   singleStepMode;
     int32_t   singleStepModeNextAddr;
@@ -177,7 +187,8 @@ namespace Ep128 {
     // true after loading a snapshot; if not playing a demo as well, the
     // keyboard state will be cleared
     bool      snapshotLoadFlag;
-    // used for counting time between demo events (in NICK cycles)
+    // used for counting time between demo events (in NICK cycles); while
+    // recording, this is the value of nickSlotCnt at the last event
     uint64_t  demoTimeCnt;
     // floppy drives
     Ep128Emu::WD177x      wd177x;
@@ -195,7 +206,24 @@ namespace Ep128 {
     };
     Ep128VMCallback   callbacks[16];
     Ep128VMCallback   *firstCallback;
+    // devices that do not need to run at every NICK cycle are scheduled as
+    // events, and their function is called only when nickSlotCnt reaches
+    // eventTime
+    struct Ep128VMEvent {
+      void      (*func)(void *);
+      void      *userData;
+      uint64_t  eventTime;
+    };
+    Ep128VMEvent      events[8];
+    uint64_t          nextEventTime;    // earliest eventTime, or 2^64 - 1
     Ep128Emu::VideoCapture  *videoCapture;
+    Ep128Emu::ExecutionTrace  *executionTrace;
+    // in 2^-32 Z80 cycle units, minus nickSlotCnt * cpuCyclesPerNickCycle
+    int64_t   executionTraceCycles;
+    Ep128Emu::Z80Profiler *profiler;
+    // same as executionTraceCycles, for the profiler
+    int64_t   profilerCycles;
+    bool      profilerEnabled;
     uint8_t   externalDACIOPorts[4];
     uint32_t  nickCyclesPerCPUCycleD2;  // in 2^-31 NICK cycle units
     uint32_t  videoMemoryWaitMult;      // (Z80 freq / NICK freq) * 16384
@@ -214,7 +242,9 @@ namespace Ep128 {
     IDEInterface  *ideInterface;
     bool      mouseEmulationEnabled;    // cleared on reset, set on RTS toggle
     uint8_t   prvB7PortState;
-    uint32_t  mouseTimer;               // NICK slots, counts down from 1500 us
+    // non-zero while the 1500 us mouse timer is running; the remaining time
+    // is the delay of the mouseTimerCallback event
+    uint32_t  mouseTimer;
     uint64_t  mouseData;                // data buffer (b60..b63 = next nibble)
     int8_t    mouseDeltaX;
     int8_t    mouseDeltaY;
@@ -243,12 +273,21 @@ namespace Ep128 {
     // ----------------
     void updateTimingParameters();
     void setMemoryWaitTiming();
+    // select the memory access fast path of the Z80 depending on the
+    // configuration, memory timing, and debugging state
+    void updateZ80MemoryAccess();
     inline void updateCPUCycles(int cycles);
     EP128EMU_REGPARM1 void videoMemoryWait();
     EP128EMU_REGPARM1 void videoMemoryWait_M1();
     EP128EMU_REGPARM1 void videoMemoryWait_IO();
     // called from the Z80 emulation to synchronize NICK and DAVE with the CPU
     EP128EMU_REGPARM1 void runDevices();
+    // call the functions of all events that are due, and update nextEventTime
+    EP128EMU_REGPARM1 void runEvents();
+#ifdef ENABLE_PERF_COUNTERS
+    // run one NICK slot, and update the performance counters
+    EP128EMU_REGPARM1 void runOneSlotSampled();
+#endif
     static uint8_t davePortReadCallback(void *userData, uint16_t addr);
     static void davePortWriteCallback(void *userData,
                                       uint16_t addr, uint8_t value);
@@ -290,7 +329,6 @@ namespace Ep128 {
     static void mouseTimerCallback(void *userData);
     static void tapeCallback(void *userData);
     static void demoPlayCallback(void *userData);
-    static void demoRecordCallback(void *userData);
     static void videoCaptureCallback(void *userData);
 #ifdef ENABLE_RESID
     static void sidCallback(void *userData);
@@ -298,6 +336,10 @@ namespace Ep128 {
     void stopDemoPlayback();
     void stopDemoRecording(bool writeFile_);
     uint8_t checkSingleStepModeBreak();
+    // called on the first opcode byte read at the exit address
+    uint8_t stopAtExitAddress();
+    void writeExecutionTraceRecord(uint16_t addr);
+    void updateProfiler(uint16_t addr);
     void spectrumEmulatorNMI_AttrWrite(uint32_t addr, uint8_t value);
     void updateRTC();
     void resetCMOSMemory();
@@ -306,6 +348,19 @@ namespace Ep128 {
     // in the order of being registered; up to 16 callbacks can be set.
     void setCallback(void (*func)(void *userData), void *userData_,
                      bool isEnabled);
+    // Schedule function to be called once, 'delay' (>= 1) NICK cycles from
+    // now, replacing any previous event with the same function and user
+    // data. If 'delay' is negative, the event is removed. Up to 8 events can
+    // be scheduled.
+    void setEvent(void (*func)(void *userData), void *userData_,
+                  int64_t delay);
+    // Returns the number of NICK cycles until the event is due, or -1 if it
+    // is not scheduled.
+    int64_t getEventDelay(void (*func)(void *userData),
+                          void *userData_) const;
+    // enable or disable the tape event, and schedule it for the NICK cycle
+    // at which the next tape sample is due
+    void setTapeEvent(bool isEnabled);
    public:
     Ep128VM(Ep128Emu::VideoDisplay&, Ep128Emu::AudioOutput&);
     virtual ~Ep128VM();
@@ -362,6 +417,12 @@ namespace Ep128 {
      * Set if emulation of memory timing is enabled.
      */
     virtual void setEnableMemoryTimingEmulation(bool isEnabled);
+    /*!
+     * Set if the Z80 emulation may use faster code paths when debugging
+     * features (breakpoints, single step mode, execution trace) are not
+     * active. This does not change the emulated timing.
+     */
+    virtual void setEnableFastCPUEmulation(bool isEnabled);
     /*!
      * Set state of key 'keyCode' (0 to 127; see dave.hpp).
      */
@@ -440,6 +501,18 @@ namespace Ep128 {
     virtual void setDiskImageFile(int n, const std::string& fileName_,
                                   int nTracks_ = -1, int nSides_ = 2,
                                   int nSectorsPerTrack_ = 9);
+    /*!
+     * Set the maximum time in milliseconds to keep written sectors of
+     * memory mapped IDE disk images cached before flushing them to the file.
+     */
+    virtual void setIDEFlushInterval(int msec);
+    /*!
+     * Set the number of floppy disk tracks to be cached in memory; modified
+     * tracks are written back to the image file by a background thread.
+     * 0 disables the cache, and a negative value caches the whole disk image.
+     * The change takes effect when the next floppy disk image is opened.
+     */
+    virtual void setFloppyCacheSize(int nTracks);
     /*!
      * Returns the current state of the disk drive LEDs, which is the sum
      * of any of the following values:
@@ -516,6 +589,50 @@ namespace Ep128 {
      * of 2 or 4.
      */
     virtual void setSingleStepModeNextAddress(int32_t addr);
+    /*!
+     * Set an address where the emulated program is stopped
+     * (see VirtualMachine::setExitAddress()).
+     */
+    virtual void setExitAddress(int32_t addr);
+    /*!
+     * Start writing a binary execution trace (see exectrace.hpp) to 'f',
+     * which is closed by the virtual machine when the trace is stopped, or
+     * if this function fails. At most 'maxInstructions' instructions are
+     * written; if 'ringMode' is true, then only the last 'maxInstructions'
+     * instructions are kept, and are written to the file when the trace is
+     * stopped. Any previously opened trace is closed first.
+     */
+    virtual void openExecutionTrace(std::FILE *f, size_t maxInstructions,
+                                    bool ringMode = false);
+    /*!
+     * Stop execution trace, and write any buffered data to the file.
+     */
+    virtual void closeExecutionTrace();
+    /*!
+     * Returns true if an execution trace is being written.
+     */
+    virtual bool getIsExecutionTraceOn() const;
+    /*!
+     * Clear any previously collected profiling data, and start counting the
+     * CPU cycles spent on each instruction (see z80prof.hpp).
+     */
+    virtual void startProfiler();
+    /*!
+     * Stop the profiler; the data is kept until the next startProfiler().
+     */
+    virtual void stopProfiler();
+    /*!
+     * Returns true if the profiler is running.
+     */
+    virtual bool getIsProfilerOn() const;
+    /*!
+     * Write the profiling data to 'f' in the specified format
+     * (Z80Profiler::REPORT_TEXT or REPORT_COLLAPSED), using the symbols
+     * from the Sjasm symbol file 'symbolFileName' (may be NULL) for code
+     * in RAM segments.
+     */
+    virtual void writeProfilerReport(std::FILE *f, int format,
+                                     const char *symbolFileName = (char *) 0);
     /*!
      * Returns the segment at page 'n' (0 to 3).
      */
@@ -186,6 +186,37 @@ namespace Ep128Emu {
 
   // --------------------------------------------------------------------------
 
+  FloppyDrive::ImageCache::ImageCache(FloppyDrive& floppyDrive_)
+    : DiskImageCache(),
+      floppyDrive(floppyDrive_)
+  {
+  }
+
+  FloppyDrive::ImageCache::~ImageCache()
+  {
+    (void) closeCache();                // FIXME: errors are ignored here
+  }
+
+  bool FloppyDrive::ImageCache::readImageData(uint8_t *buf, size_t filePos,
+                                              size_t nBytes)
+  {
+    if (std::fseek(floppyDrive.imageFile, long(filePos), SEEK_SET) < 0)
+      return false;
+    return (std::fread(buf, sizeof(uint8_t), nBytes, floppyDrive.imageFile)
+            == nBytes);
+  }
+
+  bool FloppyDrive::ImageCache::writeImageData(const uint8_t *buf,
+                                               size_t filePos, size_t nBytes)
+  {
+    if (std::fseek(floppyDrive.imageFile, long(filePos), SEEK_SET) < 0)
+      return false;
+    return (std::fwrite(buf, sizeof(uint8_t), nBytes, floppyDrive.imageFile)
+            == nBytes);
+  }
+
+  // --------------------------------------------------------------------------
+
   FloppyDrive::FloppyDrive()
     : imageFileName(""),
       imageFile((std::FILE *) 0),
@@ -205,7 +236,9 @@ namespace Ep128Emu {
       flagsBuffer((uint8_t *) 0),
       tmpBuffer((uint8_t *) 0),
       bufPos(-1L),
-      trackDirtyFlag(false)
+      trackDirtyFlag(false),
+      cacheTracks(0),
+      imageCache(*this)
   {
     buf_.resize(0);
     this->reset();
@@ -240,6 +273,7 @@ namespace Ep128Emu {
     if (!imageFile)
       return;
     (void) flushTrack();                // FIXME: errors are ignored here
+    (void) imageCache.closeCache();     // FIXME: errors are ignored here
     std::fclose(imageFile);
     imageFile = (std::FILE *) 0;
     nTracks = 0;
@@ -278,10 +312,12 @@ namespace Ep128Emu {
                 (nSectorsPerTrack_ >= 1 && nSectorsPerTrack_ <= 240);
     bool    disableFATCheck =
         (nTracksValid && nSidesValid && nSectorsPerTrackValid);
+    bool    isFloppyDevice = false;
     {
       int     diskType = checkFloppyDisk(fileName_.c_str(),
                                          nTracks_, nSides_, nSectorsPerTrack_);
       if (diskType > 0) {
+        isFloppyDevice = true;
         writeProtectFlag = (diskType == 1);
         nTracksValid = true;
         nSidesValid = true;
@@ -391,6 +427,12 @@ namespace Ep128Emu {
                         "disk image size parameters");
       }
       std::fseek(imageFile, 0L, SEEK_SET);
+      if (cacheTracks != 0 && !isFloppyDevice) {
+        imageCache.openCache(size_t(fileSize),
+                             size_t(nSectorsPerTrack_) * 512,
+                             size_t(cacheTracks > 0 ? cacheTracks : 0),
+                             writeProtectFlag);
+      }
       imageFileName = fileName_;
       buf_.resize(size_t(nSectorsPerTrack_) * 257);
     }
@@ -498,7 +540,11 @@ namespace Ep128Emu {
       long    filePos = (long(currentTrack) * long(nSides) + long(currentSide))
                         * long(nSectorsPerTrack);
       filePos = (filePos * 512L) + long(offs);
-      if (std::fseek(imageFile, filePos, SEEK_SET) < 0) {
+      if (imageCache.isCacheOpen()) {
+        errorFlag = !(imageCache.readCached(&(tmpBuffer[offs]),
+                                            size_t(filePos), nBytes));
+      }
+      else if (std::fseek(imageFile, filePos, SEEK_SET) < 0) {
         errorFlag = true;
       }
       else {
@@ -547,7 +593,13 @@ namespace Ep128Emu {
           (long(bufferedTrack) * long(nSides) + long(bufferedSide))
           * (long(nSectorsPerTrack) * 512L)
           + long(offs);
-      if (std::fseek(imageFile, filePos, SEEK_SET) < 0) {
+      if (imageCache.isCacheOpen()) {
+        if (!imageCache.writeCached(&(trackBuffer[offs]),
+                                    size_t(filePos), nBytes)) {
+          errorFlag = true;
+        }
+      }
+      else if (std::fseek(imageFile, filePos, SEEK_SET) < 0) {
         errorFlag = true;
       }
       else {
@@ -591,9 +643,16 @@ namespace Ep128Emu {
     return 0x03;
   }
 
+  bool FloppyDrive::flushImage()
+  {
+    bool    retval = flushTrack();
+    return (imageCache.flushCache() && retval);
+  }
+
   void FloppyDrive::reset()
   {
     (void) flushTrack();                // FIXME: errors are ignored here
+    (void) imageCache.flushCache();     // FIXME: errors are ignored here
     currentTrack = 0;
     currentSide = 0;
     bufferedTrack = 0xFF;
@@ -21,6 +21,8 @@
 #define EP128EMU_EP_FDD_HPP
 
 #include "ep128emu.hpp"
+#include "diskcache.hpp"
+
 #include <vector>
 
 namespace Ep128Emu {
@@ -41,6 +43,19 @@ namespace Ep128Emu {
 
   class FloppyDrive {
    private:
+    class ImageCache : public DiskImageCache {
+     private:
+      FloppyDrive&  floppyDrive;
+     public:
+      ImageCache(FloppyDrive& floppyDrive_);
+      virtual ~ImageCache();
+     protected:
+      virtual bool readImageData(uint8_t *buf, size_t filePos,
+                                 size_t nBytes);
+      virtual bool writeImageData(const uint8_t *buf, size_t filePos,
+                                  size_t nBytes);
+    };
+    // ----------------
     static const uint32_t ledStateCount1 = 60U;         // 120 ms
     static const uint32_t ledStateCount2 = 500U;        // 1000 ms
     std::string imageFileName;
@@ -65,6 +80,8 @@ namespace Ep128Emu {
     uint8_t     *tmpBuffer;
     long        bufPos;                 // position in track buffer, -1: none
     bool        trackDirtyFlag;
+    int         cacheTracks;            // 0: no image cache, < 0: whole disk
+    ImageCache  imageCache;
     // ----------------
     void closeDiskImage();
     uint8_t getLEDState_();
@@ -75,6 +92,18 @@ namespace Ep128Emu {
                                   int nTracks_ = -1,
                                   int nSides_ = 2,
                                   int nSectorsPerTrack_ = 9);
+    // set the number of tracks to be cached in memory, with modified tracks
+    // written back to the image file in the background; 0 disables the
+    // cache, and a negative value caches the whole disk image; the change
+    // takes effect when the next image is opened, real floppy disks are
+    // never cached
+    inline void setCacheSize(int nTracks_)
+    {
+      cacheTracks = nTracks_;
+    }
+    // write the buffered track and any cached changes to the image file,
+    // returns false on error
+    bool flushImage();
     inline void setDiskChangeFlag(bool isChanged)
     {
       diskChangeFlag = isChanged;
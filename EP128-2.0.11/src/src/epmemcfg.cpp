@@ -23,6 +23,7 @@
 #  include "sdext.hpp"
 #endif
 #include "system.hpp"
+#include "romstore.hpp"
 
 #include <vector>
 
@@ -70,22 +71,18 @@ namespace Ep128 {
       }
       return;
     }
-    // load file into memory
-    std::vector<uint8_t>  buf;
-    buf.resize(0x4000, 0xFF);
-    std::FILE   *f = Ep128Emu::fileOpen(fileName, "rb");
-    if (!f)
-      throw Ep128Emu::Exception("cannot open ROM file");
-    std::fseek(f, 0L, SEEK_END);
-    if (std::ftell(f) < long(offs + 11)) {
-      std::fclose(f);
-      throw Ep128Emu::Exception("ROM file is shorter than expected");
+    // load file into the shared ROM store
+    const uint8_t *p = Ep128Emu::ROMStore::addFileSegment(fileName, offs);
+    if (!p) {
+      // less than 16K of data: pad with 0xFF bytes
+      std::vector<uint8_t>  buf;
+      buf.resize(0x4000, 0xFF);
+      if (readROMFile(&(buf.front()), fileName, offs, 0x4000) < 11L)
+        throw Ep128Emu::Exception("ROM file is shorter than expected");
+      p = Ep128Emu::ROMStore::addSegment(&(buf.front()));
     }
-    std::fseek(f, long(offs), SEEK_SET);
-    std::fread(&(buf.front()), 1, 0x4000, f);
-    std::fclose(f);
     if (memory.isSegmentRAM(n)) {
-      memory.loadSegment(n, true, &(buf.front()), 0x4000);
+      memory.loadSharedROMSegment(n, p);
       // if there was RAM at the specified segment, relocate it
       for (int i = 0xFF; i >= 0x08; i--) {
         if (!(memory.isSegmentROM(uint8_t(i)) ||
@@ -97,7 +94,7 @@ namespace Ep128 {
     }
     else {
       // otherwise just load new segment, or replace existing ROM
-      memory.loadSegment(n, true, &(buf.front()), 0x4000);
+      memory.loadSharedROMSegment(n, p);
     }
   }
 
@@ -0,0 +1,121 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "exectrace.hpp"
+
+static const char traceFileMagic[8] = {
+  'E', 'P', 'T', 'R', 'A', 'C', 'E', '\0'
+};
+
+namespace Ep128Emu {
+
+  ExecutionTrace::ExecutionTrace(std::FILE *f_, size_t maxRecords,
+                                 bool ringMode_)
+    : f(f_),
+      buf((uint8_t *) 0),
+      bufRecords(0),
+      bufPos(0),
+      recordsRemaining(maxRecords),
+      ringMode(ringMode_),
+      bufferWrapped(false),
+      writeError(false)
+  {
+    try {
+      if (!f)
+        throw Exception("invalid trace file");
+      if (maxRecords < 1)
+        throw Exception("invalid trace instruction count");
+      bufRecords = maxRecords;
+      if (!ringMode && bufRecords > 65536)
+        bufRecords = 65536;
+      buf = new uint8_t[bufRecords * recordSize];
+      uint8_t tmpBuf[headerSize];
+      for (size_t i = 0; i < 8; i++)
+        tmpBuf[i] = uint8_t(traceFileMagic[i]);
+      setUInt16(&(tmpBuf[8]), 1);
+      setUInt16(&(tmpBuf[10]), 0);
+      setUInt16(&(tmpBuf[12]), uint16_t(recordSize));
+      setUInt16(&(tmpBuf[14]), 0);
+      if (std::fwrite(&(tmpBuf[0]), sizeof(uint8_t), headerSize, f)
+          != headerSize) {
+        throw Exception("error writing trace file");
+      }
+    }
+    catch (...) {
+      if (buf)
+        delete[] buf;
+      if (f)
+        std::fclose(f);
+      throw;
+    }
+  }
+
+  ExecutionTrace::~ExecutionTrace()
+  {
+    if (ringMode) {
+      // write the oldest records first
+      if (bufferWrapped && !writeError) {
+        size_t  n = bufRecords - bufPos;
+        if (std::fwrite(buf + (bufPos * recordSize), recordSize, n, f) != n)
+          writeError = true;
+      }
+      if (!writeError) {
+        if (std::fwrite(buf, recordSize, bufPos, f) != bufPos)
+          writeError = true;
+      }
+      bufPos = 0;
+    }
+    else {
+      flushBuffer();
+    }
+    std::fclose(f);
+    delete[] buf;
+  }
+
+  void ExecutionTrace::flushBuffer()
+  {
+    if (bufPos > 0 && !writeError) {
+      if (std::fwrite(buf, recordSize, bufPos, f) != bufPos)
+        writeError = true;      // disk may be full
+    }
+    bufPos = 0;
+  }
+
+  void ExecutionTrace::readFileHeader(std::FILE *f_)
+  {
+    uint8_t tmpBuf[headerSize];
+    if (std::fread(&(tmpBuf[0]), sizeof(uint8_t), headerSize, f_)
+        != headerSize) {
+      throw Exception("error reading trace file header");
+    }
+    for (size_t i = 0; i < 8; i++) {
+      if (tmpBuf[i] != uint8_t(traceFileMagic[i]))
+        throw Exception("invalid trace file header");
+    }
+    if (getUInt16(&(tmpBuf[8])) != 1 || getUInt16(&(tmpBuf[10])) != 0)
+      throw Exception("unsupported trace file format version");
+    if (getUInt16(&(tmpBuf[12])) != recordSize ||
+        getUInt16(&(tmpBuf[14])) != 0) {
+      throw Exception("invalid trace file record size");
+    }
+  }
+
+}       // namespace Ep128Emu
+
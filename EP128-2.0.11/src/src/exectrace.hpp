@@ -0,0 +1,120 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_EXECTRACE_HPP
+#define EP128EMU_EXECTRACE_HPP
+
+#include "ep128emu.hpp"
+
+namespace Ep128Emu {
+
+  // Binary execution trace file writer. The file starts with a 16 byte
+  // header:
+  //   char[8]    "EPTRACE\0"
+  //   uint32_t   format version (1)
+  //   uint32_t   record size in bytes (32)
+  // followed by fixed size records, one per executed instruction, with all
+  // multi-byte values stored in little-endian byte order:
+  //   0:  uint16_t   PC
+  //   2:  uint8_t    memory segment of PC
+  //   3:  uint8_t    number of valid opcode bytes (always 4)
+  //   4:  uint8_t[4] opcode bytes at PC
+  //   8:  uint64_t   CPU cycle count at the opcode fetch, relative to the
+  //                  start of the trace
+  //   16: uint16_t   AF, BC, DE, HL, SP, IX, IY
+  //   30: uint8_t    I, R
+  // Records are collected in memory, and written to the file in large
+  // blocks, so that tracing does not slow down the emulation significantly.
+
+  class ExecutionTrace {
+   public:
+    static const size_t headerSize = 16;
+    static const size_t recordSize = 32;
+   protected:
+    std::FILE   *f;
+    uint8_t     *buf;
+    size_t      bufRecords;     // buffer size in records
+    size_t      bufPos;         // write position in records
+    uint64_t    recordsRemaining;
+    bool        ringMode;
+    bool        bufferWrapped;  // true if the ring buffer has been filled
+    bool        writeError;
+    // --------
+    void flushBuffer();
+   public:
+    // Create trace writer to 'f', which is closed by the destructor (also
+    // if the constructor throws an exception). At most 'maxRecords' records
+    // are written; if 'ringMode_' is true, the last 'maxRecords' records are
+    // kept in memory instead, and are written to the file when the trace is
+    // closed.
+    ExecutionTrace(std::FILE *f_, size_t maxRecords, bool ringMode_);
+    ~ExecutionTrace();
+    // Returns pointer to the next record to be filled by the caller,
+    // or NULL if the maximum number of records has already been written.
+    inline uint8_t *allocateRecord()
+    {
+      if (EP128EMU_UNLIKELY(bufPos >= bufRecords)) {
+        if (!ringMode) {
+          flushBuffer();
+          if (!recordsRemaining || writeError)
+            return (uint8_t *) 0;
+        }
+        bufferWrapped = true;
+        bufPos = 0;
+      }
+      else if (EP128EMU_UNLIKELY(!recordsRemaining)) {
+        return (uint8_t *) 0;
+      }
+      if (!ringMode)
+        recordsRemaining--;
+      return (buf + ((bufPos++) * recordSize));
+    }
+    // Store 16-bit value 'n' at 'p' in little-endian byte order.
+    static inline void setUInt16(uint8_t *p, uint16_t n)
+    {
+      p[0] = uint8_t(n & 0xFF);
+      p[1] = uint8_t(n >> 8);
+    }
+    static inline uint16_t getUInt16(const uint8_t *p)
+    {
+      return (uint16_t(p[0]) | (uint16_t(p[1]) << 8));
+    }
+    static inline void setUInt64(uint8_t *p, uint64_t n)
+    {
+      setUInt16(p, uint16_t(n & 0xFFFFU));
+      setUInt16(p + 2, uint16_t((n >> 16) & 0xFFFFU));
+      setUInt16(p + 4, uint16_t((n >> 32) & 0xFFFFU));
+      setUInt16(p + 6, uint16_t(n >> 48));
+    }
+    static inline uint64_t getUInt64(const uint8_t *p)
+    {
+      return (uint64_t(getUInt16(p)) | (uint64_t(getUInt16(p + 2)) << 16)
+              | (uint64_t(getUInt16(p + 4)) << 32)
+              | (uint64_t(getUInt16(p + 6)) << 48));
+    }
+    // Check the header of a trace file opened for reading, and leave the
+    // file position at the first record.
+    // Throws Ep128Emu::Exception if the file is not a valid trace file.
+    static void readFileHeader(std::FILE *f_);
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_EXECTRACE_HPP
+
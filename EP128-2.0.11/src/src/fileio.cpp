@@ -21,6 +21,7 @@
 #include "fileio.hpp"
 #include "system.hpp"
 #include "decompm2.hpp"
+#include "romstore.hpp"
 
 #include <cmath>
 #include <map>
@@ -206,6 +207,16 @@ namespace Ep128Emu {
     return std::string(reinterpret_cast<char *>(&buf[j]));
   }
 
+  void File::Buffer::readData(unsigned char *buf_, size_t nBytes)
+  {
+    if (nBytes > (dataSize - curPos))
+      throw Exception("unexpected end of data chunk");
+    if (nBytes > 0) {
+      std::memcpy(buf_, buf + curPos, nBytes);
+      curPos += nBytes;
+    }
+  }
+
   void File::Buffer::writeByte(unsigned char n)
   {
     if (curPos >= allocSize) {
@@ -361,8 +372,10 @@ namespace Ep128Emu {
       buf = newBuf;
       allocSize = newSize;
     }
-    for (size_t i = 0; i < nBytes; i++)
-      buf[curPos++] = buf_[i] & 0xFF;
+    if (nBytes > 0) {
+      std::memcpy(buf + curPos, buf_, nBytes);
+      curPos += nBytes;
+    }
     if (curPos > dataSize)
       dataSize = curPos;
   }
@@ -519,10 +532,16 @@ namespace Ep128Emu {
   }
 
   File::File()
+    : checkpointFlag(false),
+      deltaSnapshotFlag(false),
+      romReferenceFlag(false)
   {
   }
 
   File::File(const char *fileName, bool useHomeDirectory)
+    : checkpointFlag(false),
+      deltaSnapshotFlag(false),
+      romReferenceFlag(false)
   {
     bool    err = false;
 
@@ -585,6 +604,9 @@ namespace Ep128Emu {
     for (i = chunkTypeDB.begin(); i != chunkTypeDB.end(); i++)
       delete (*i).second;
     chunkTypeDB.clear();
+    for (size_t j = 0; j < romReferences.size(); j++)
+      ROMStore::releaseSegment(romReferences[j]);
+    romReferences.clear();
   }
 
   void File::addChunk(ChunkType type, const Buffer& buf_)
@@ -600,6 +622,16 @@ namespace Ep128Emu {
     buf.writeUInt32(hash_32(buf.getData() + startPos, buf_.getDataSize() + 8));
   }
 
+  void File::addEndOfFileChunk()
+  {
+    size_t  startPos = buf.getPosition();
+    buf.setPosition(startPos + 12);
+    buf.setPosition(startPos);
+    buf.writeUInt32(uint32_t(EP128EMU_CHUNKTYPE_END_OF_FILE));
+    buf.writeUInt32(0U);
+    buf.writeUInt32(hash_32(buf.getData() + startPos, 8));
+  }
+
   void File::processAllChunks()
   {
     if (buf.getDataSize() < 12)
@@ -698,6 +730,22 @@ namespace Ep128Emu {
       throw Exception("error opening or writing file");
   }
 
+  void File::setSnapshotMode(bool isCheckpoint, bool isDelta)
+  {
+    checkpointFlag = (isCheckpoint || isDelta);
+    deltaSnapshotFlag = isDelta;
+  }
+
+  void File::addROMReference(const uint8_t *p)
+  {
+    for (size_t i = 0; i < romReferences.size(); i++) {
+      if (romReferences[i] == p)
+        return;
+    }
+    romReferences.push_back(p);
+    ROMStore::addReference(p);
+  }
+
   // --------------------------------------------------------------------------
 
   File::ChunkTypeHandler::~ChunkTypeHandler()
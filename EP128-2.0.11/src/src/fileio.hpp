@@ -22,6 +22,7 @@
 
 #include "ep128emu.hpp"
 #include <map>
+#include <vector>
 
 namespace Ep128Emu {
 
@@ -43,6 +44,7 @@ namespace Ep128Emu {
       uint64_t readUIntVLen();
       double readFloat();
       std::string readString();
+      void readData(unsigned char *buf_, size_t nBytes);
       void writeByte(unsigned char n);
       void writeBoolean(bool n);
       void writeInt16(int16_t n);
@@ -93,6 +95,7 @@ namespace Ep128Emu {
       EP128EMU_CHUNKTYPE_PLUS4_DEMO =     0x4550800F,
       EP128EMU_CHUNKTYPE_PLUS4_PRG =      0x45508010,
       EP128EMU_CHUNKTYPE_SID_STATE =      0x45508011,
+      EP128EMU_CHUNKTYPE_MEMORY_DELTA =   0x45508012,
       EP128EMU_CHUNKTYPE_SDEXT_STATE =    0x45508018,
       EP128EMU_CHUNKTYPE_ZXMEM_STATE =    0x45508020,
       EP128EMU_CHUNKTYPE_ZXIO_STATE =     0x45508021,
@@ -130,14 +133,68 @@ namespace Ep128Emu {
    private:
     Buffer  buf;
     std::map< int, ChunkTypeHandler * > chunkTypeDB;
+    bool    checkpointFlag;
+    bool    deltaSnapshotFlag;
+    bool    romReferenceFlag;
+    // Ep128Emu::ROMStore segments referenced by hash in the file data
+    std::vector< const uint8_t * >  romReferences;
     void loadZXSnapshotFile(std::FILE *f, const char *fileName);
     void loadCompressedFile(std::FILE *f);
    public:
     void addChunk(ChunkType type, const Buffer& buf_);
+    /*!
+     * Append the 'end of file' chunk to the data in memory, so that it can
+     * be loaded with processAllChunks() without writing a file first.
+     * No more chunks should be added after calling this function.
+     */
+    void addEndOfFileChunk();
     void processAllChunks();
     void writeFile(const char *fileName, bool useHomeDirectory = false,
                    bool enableCompression = false);
     void registerChunkType(ChunkTypeHandler *);
+    /*!
+     * Set the snapshot mode used when saving machine state to this file.
+     * If 'isCheckpoint' is true, saving the state also resets change
+     * tracking of memory segments (currently implemented for the Enterprise
+     * only), so that a delta snapshot can be created later relative to this
+     * state. If 'isDelta' is true, then only the RAM segments that were
+     * written since the previous checkpoint are stored, and the snapshot
+     * can only be loaded on top of that checkpoint; this implies
+     * 'isCheckpoint'.
+     */
+    void setSnapshotMode(bool isCheckpoint, bool isDelta = false);
+    inline bool getIsCheckpoint() const
+    {
+      return checkpointFlag;
+    }
+    inline bool getIsDeltaSnapshot() const
+    {
+      return deltaSnapshotFlag;
+    }
+    /*!
+     * If 'isEnabled' is true, ROM segments that are in Ep128Emu::ROMStore
+     * are saved as a hash of their contents instead of the data (currently
+     * implemented for the Enterprise only). The segments are kept in the
+     * store while this object exists (see addROMReference()), so in-memory
+     * snapshots can always be loaded; a file written with writeFile() can
+     * only be loaded if the same ROM images are already loaded, or were
+     * loaded from files that are still available. Checkpoints always use
+     * this mode.
+     */
+    inline void setROMReferenceMode(bool isEnabled)
+    {
+      romReferenceFlag = isEnabled;
+    }
+    inline bool getIsROMReferenceMode() const
+    {
+      return (romReferenceFlag || checkpointFlag);
+    }
+    /*!
+     * Keep the Ep128Emu::ROMStore segment 'p', which is saved as a hash in
+     * the file data, in the store until this object is destroyed, so that
+     * the data can still be loaded after the ROM configuration is changed.
+     */
+    void addROMReference(const uint8_t *p);
     File();
     File(const char *fileName, bool useHomeDirectory = false);
     ~File();
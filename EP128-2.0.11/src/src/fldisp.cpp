@@ -209,50 +209,61 @@ namespace Ep128Emu {
 
   void FLTKDisplay_::deleteMessage(Message *m)
   {
-    messageQueueMutex.lock();
     m->nxt = freeMessageStack;
     freeMessageStack = m;
-    messageQueueMutex.unlock();
   }
 
-  void FLTKDisplay_::queueMessage(Message *m)
+  FLTKDisplay_::Message * FLTKDisplay_::receiveMessage()
   {
-    messageQueueMutex.lock();
-    if (exitFlag) {
-      messageQueueMutex.unlock();
-      std::free(m);
-      return;
+    if (EP128EMU_UNLIKELY(displayParametersChanged)) {
+      // allocateMessage() may throw, so it is called before locking
+      Message_SetParameters *m = allocateMessage<Message_SetParameters>();
+      displayParametersMutex.lock();
+      m->dp = newDisplayParameters.dp;
+      displayParametersChanged = false;
+      displayParametersMutex.unlock();
+      return m;
     }
-    m->nxt = (Message *) 0;
-    if (lastMessage)
-      lastMessage->nxt = m;
-    else
-      messageQueue = m;
-    lastMessage = m;
-    bool    isFrameDone = (m->msgType == Message::MsgType_FrameDone);
-    messageQueueMutex.unlock();
-    if (EP128EMU_UNLIKELY(isFrameDone)) {
-      if (!videoResampleEnabled) {
-        Fl::awake();
-        threadLock.wait(1);
-      }
+    if (ringReadPos == atomicLoadAcquire(ringWritePos))
+      return (Message *) 0;
+    return reinterpret_cast<Message *>(
+               &(ringBuffer[size_t(ringReadPos & (ringBufferSize - 1U))
+                            * messageSlotSize]));
+  }
+
+  void FLTKDisplay_::releaseMessage(Message *m)
+  {
+    if (EP128EMU_UNLIKELY(m->msgType == Message::MsgType_SetParameters)) {
+      deleteMessage(m);
+      return;
     }
+    if (m->msgType == Message::MsgType_FrameDone)
+      atomicStoreRelease(framesReceived, framesReceived + 1U);
+    atomicStoreRelease(ringReadPos, ringReadPos + 1U);
   }
 
   // --------------------------------------------------------------------------
 
   FLTKDisplay_::FLTKDisplay_()
     : VideoDisplay(),
-      messageQueue((Message *) 0),
-      lastMessage((Message *) 0),
+      ringBuffer((unsigned char *) 0),
+      ringWritePos(0U),
+      ringReadPos(0U),
+      framesQueued(0U),
+      framesReceived(0U),
       freeMessageStack((Message *) 0),
-      messageQueueMutex(),
+      displayParametersMutex(),
+      newDisplayParameters(),
+      displayParametersChanged(false),
+      ringBufferOverrun(false),
       lineBuffers((Message_LineData **) 0),
+      sentLineData((Message_LineData *) 0),
+      unchangedLineFirst(0),
+      unchangedLineCnt(0),
+      sentLastLineNum(-2),
       curLine(0),
       vsyncCnt(0),
-      framesPending(0),
       skippingFrame(false),
-      framesPendingFlag(false),
       vsyncState(false),
       oddFrame(false),
       videoResampleEnabled(false),
@@ -270,30 +281,26 @@ namespace Ep128Emu {
       lineBuffers = new Message_LineData*[578];
       for (size_t n = 0; n < 578; n++)
         lineBuffers[n] = (Message_LineData *) 0;
+      sentLineData = new Message_LineData[578];
+      ringBuffer = new unsigned char[size_t(ringBufferSize) * messageSlotSize];
     }
     catch (...) {
       if (lineBuffers)
         delete[] lineBuffers;
+      if (sentLineData)
+        delete[] sentLineData;
       throw;
     }
   }
 
   FLTKDisplay_::~FLTKDisplay_()
   {
-    messageQueueMutex.lock();
     exitFlag = true;
     while (freeMessageStack) {
       Message *m = freeMessageStack;
       freeMessageStack = m->nxt;
       std::free(m);
     }
-    while (messageQueue) {
-      Message *m = messageQueue;
-      messageQueue = m->nxt;
-      std::free(m);
-    }
-    lastMessage = (Message *) 0;
-    messageQueueMutex.unlock();
     for (size_t n = 0; n < 578; n++) {
       Message *m = lineBuffers[n];
       if (m) {
@@ -302,6 +309,8 @@ namespace Ep128Emu {
       }
     }
     delete[] lineBuffers;
+    delete[] sentLineData;
+    delete[] ringBuffer;
   }
 
   void FLTKDisplay_::draw()
@@ -315,10 +324,11 @@ namespace Ep128Emu {
 
   void FLTKDisplay_::setDisplayParameters(const DisplayParameters& dp)
   {
-    Message_SetParameters *m = allocateMessage<Message_SetParameters>();
-    m->dp = dp;
+    displayParametersMutex.lock();
+    newDisplayParameters.dp = dp;
     savedDisplayParameters = dp;
-    queueMessage(m);
+    displayParametersChanged = true;
+    displayParametersMutex.unlock();
   }
 
   const VideoDisplay::DisplayParameters&
@@ -331,10 +341,34 @@ namespace Ep128Emu {
   {
     if (!skippingFrame) {
       if (curLine >= 0 && curLine < 578) {
-        Message_LineData  *m = allocateMessage<Message_LineData>();
-        m->lineNum = curLine;
-        m->copyLine(buf, nBytes);
-        queueMessage(m);
+        // the receiver deletes the line in the other field in
+        // non-interlaced mode, so it needs to be sent again next time
+        sentLineData[curLine ^ 1].clear();
+        if (sentLineData[curLine].compareLine(buf, nBytes)) {
+          if (unchangedLineCnt > 0 &&
+              curLine == (unchangedLineFirst + (unchangedLineCnt << 1))) {
+            unchangedLineCnt++;
+          }
+          else {
+            flushUnchangedLines();
+            unchangedLineFirst = curLine;
+            unchangedLineCnt = 1;
+          }
+        }
+        else {
+          flushUnchangedLines();
+          Message_LineData  *m = writeMessage<Message_LineData>();
+          if (EP128EMU_EXPECT(m != (Message_LineData *) 0)) {
+            sentLineData[curLine].copyLine(buf, nBytes);
+            m->lineNum = curLine;
+            m->copyLine(buf, nBytes);
+            queueMessage(m);
+          }
+          else {
+            ringBufferOverrun = true;
+          }
+        }
+        sentLastLineNum = curLine;
       }
     }
     if (vsyncCnt != 0) {
@@ -366,11 +400,38 @@ namespace Ep128Emu {
 
   void FLTKDisplay_::frameDone()
   {
-    messageQueueMutex.lock();
     bool    skippedFrame = skippingFrame;
-    if (!skippedFrame)
-      framesPending++;
-    bool    overrunFlag = (framesPending > 3);  // should this be configurable ?
+    if (!skippedFrame) {
+      flushUnchangedLines();
+      // clear the same lines as the receiver does at the end of the frame
+      int     n = sentLastLineNum;
+      sentLastLineNum = (n & 1) - 2;
+      if (n < 576) {
+        n = n | 1;
+        do {
+          n++;
+          sentLineData[n].clear();
+        } while (n < 577);
+      }
+      // the last slot is reserved for this message, so it can only fail
+      // if the display is being destroyed
+      Message *m = writeMessage<Message_FrameDone>(0U);
+      if (EP128EMU_EXPECT(m != (Message *) 0)) {
+        queueMessage(m);
+        atomicStoreRelease(framesQueued, framesQueued + 1U);
+      }
+      else {
+        ringBufferOverrun = true;
+      }
+      if (EP128EMU_UNLIKELY(ringBufferOverrun)) {
+        // some lines were not sent, so the next frame is sent in full
+        ringBufferOverrun = false;
+        for (size_t i = 0; i < 578; i++)
+          sentLineData[i].clear();
+      }
+    }
+    uint32_t  framesPending = framesQueued - atomicLoadAcquire(framesReceived);
+    bool    overrunFlag = (framesPending > 3U); // should this be configurable ?
     skippingFrame = overrunFlag;
     if (limitFrameRateFlag) {
       if (limitFrameRateTimer.getRealTime() < 0.02)
@@ -378,16 +439,29 @@ namespace Ep128Emu {
       else
         limitFrameRateTimer.reset();
     }
-    messageQueueMutex.unlock();
     if (skippedFrame) {
-      if (overrunFlag || !limitFrameRateFlag) {
+      if (overrunFlag || !limitFrameRateFlag)
         Fl::awake();
-        threadLock.wait(1);
+    }
+    else if (!videoResampleEnabled) {
+      Fl::awake();
+    }
+  }
+
+  void FLTKDisplay_::flushUnchangedLines()
+  {
+    if (unchangedLineCnt > 0) {
+      Message_LinesUnchanged  *m = writeMessage<Message_LinesUnchanged>();
+      if (EP128EMU_EXPECT(m != (Message_LinesUnchanged *) 0)) {
+        m->firstLine = unchangedLineFirst;
+        m->nLines = unchangedLineCnt;
+        queueMessage(m);
       }
-      return;
+      else {
+        ringBufferOverrun = true;
+      }
+      unchangedLineCnt = 0;
     }
-    Message *m = allocateMessage<Message_FrameDone>();
-    queueMessage(m);
   }
 
   void FLTKDisplay_::setScreenshotCallback(void (*func)(void *,
@@ -875,20 +949,8 @@ namespace Ep128Emu {
 
   bool FLTKDisplay::checkEvents()
   {
-    threadLock.notify();
     while (true) {
-      messageQueueMutex.lock();
-      Message *m = messageQueue;
-      if (m) {
-        messageQueue = m->nxt;
-        if (messageQueue) {
-          if (!messageQueue->nxt)
-            lastMessage = messageQueue;
-        }
-        else
-          lastMessage = (Message *) 0;
-      }
-      messageQueueMutex.unlock();
+      Message *m = receiveMessage();
       if (!m)
         break;
       if (EP128EMU_EXPECT(m->msgType == Message::MsgType_LineData)) {
@@ -907,25 +969,39 @@ namespace Ep128Emu {
           // check if this line has changed
           if (lineBuffers[lineNum]) {
             if (*(lineBuffers[lineNum]) == *msg) {
-              deleteMessage(m);
+              releaseMessage(m);
               continue;
             }
           }
           linesChanged[lineNum >> 1] = true;
-          if (lineBuffers[lineNum])
-            deleteMessage(lineBuffers[lineNum]);
-          lineBuffers[lineNum] = msg;
+          if (!lineBuffers[lineNum])
+            lineBuffers[lineNum] = allocateMessage<Message_LineData>();
+          *(lineBuffers[lineNum]) = *msg;
+          releaseMessage(m);
           continue;
         }
       }
+      else if (m->msgType == Message::MsgType_LinesUnchanged) {
+        Message_LinesUnchanged  *msg;
+        msg = static_cast<Message_LinesUnchanged *>(m);
+        for (int i = 0; i < msg->nLines; i++) {
+          int     lineNum = msg->firstLine + (i << 1);
+          if (lineNum < 0 || lineNum >= 578)
+            break;
+          lastLineNum = lineNum;
+          if ((lineNum & 1) == int(prvFrameWasOdd) &&
+              lineBuffers[lineNum ^ 1] != (Message_LineData *) 0) {
+            // non-interlaced mode: clear any old lines in the other field
+            linesChanged[lineNum >> 1] = true;
+            deleteMessage(lineBuffers[lineNum ^ 1]);
+            lineBuffers[lineNum ^ 1] = (Message_LineData *) 0;
+          }
+        }
+      }
       else if (m->msgType == Message::MsgType_FrameDone) {
         // need to update display
-        messageQueueMutex.lock();
-        framesPending = (framesPending > 0 ? (framesPending - 1) : 0);
-        framesPendingFlag = (framesPending > 0);
-        messageQueueMutex.unlock();
         redrawFlag = true;
-        deleteMessage(m);
+        releaseMessage(m);
         int     n = lastLineNum;
         prvFrameWasOdd = bool(n & 1);
         lastLineNum = (n & 1) - 2;
@@ -956,7 +1032,7 @@ namespace Ep128Emu {
         for (size_t n = 0; n < 289; n++)
           linesChanged[n] = true;
       }
-      deleteMessage(m);
+      releaseMessage(m);
     }
     if (noInputTimer.getRealTime() > 0.5) {
       noInputTimer.reset(0.25);
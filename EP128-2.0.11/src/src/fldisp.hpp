@@ -36,7 +36,8 @@ namespace Ep128Emu {
         MsgType_None = 0,
         MsgType_LineData = 1,
         MsgType_FrameDone = 2,
-        MsgType_SetParameters = 3
+        MsgType_SetParameters = 3,
+        MsgType_LinesUnchanged = 4
       };
       Message   *nxt;
       intptr_t  msgType;
@@ -73,6 +74,18 @@ namespace Ep128Emu {
       }
       // copy a line (768 pixels in compressed format) to the buffer
       void copyLine(const uint8_t *buf, size_t nBytes);
+      // returns true if the buffer contains the same 'nBytes' bytes of
+      // data as 'buf'; an empty buffer never matches
+      inline bool compareLine(const uint8_t *buf, size_t nBytes) const
+      {
+        if (nBytes_ == 0U || size_t(nBytes_) != nBytes)
+          return false;
+        return (std::memcmp(&(buf_[0]), buf, nBytes) == 0);
+      }
+      inline void clear()
+      {
+        nBytes_ = 0U;
+      }
       inline void getLineData(const unsigned char*& buf, size_t& nBytes)
       {
         buf = reinterpret_cast<unsigned char *>(&(buf_[0]));
@@ -98,6 +111,19 @@ namespace Ep128Emu {
       {
       }
     };
+    // lines 'firstLine', 'firstLine' + 2, ... ('nLines' lines in total)
+    // are identical to the data sent for the same lines in the previous frame
+    class Message_LinesUnchanged : public Message {
+     public:
+      int       firstLine;
+      int       nLines;
+      Message_LinesUnchanged()
+        : Message(MsgType_LinesUnchanged),
+          firstLine(0),
+          nLines(0)
+      {
+      }
+    };
     class Message_SetParameters : public Message {
      public:
       DisplayParameters dp;
@@ -107,20 +133,53 @@ namespace Ep128Emu {
       {
       }
     };
+    // size of a message slot, enough for the largest message type
+    static const size_t messageSlotSize = (sizeof(Message_LineData) | 15) + 1;
+    // number of slots in the ring buffer (must be a power of two); this is
+    // enough for more than 4 complete frames, so the buffer does not
+    // overflow before frame skipping starts
+    static const uint32_t ringBufferSize = 2048U;
+    /*!
+     * Returns the next free slot of the ring buffer as a message of type T,
+     * or NULL if there are less than 'nReserved' + 1 free slots. Called by
+     * the emulation thread only; the message is sent with queueMessage().
+     */
+    template <typename T>
+    T * writeMessage(uint32_t nReserved = 1U)
+    {
+      uint32_t  nUsed = ringWritePos - atomicLoadAcquire(ringReadPos);
+      if (EP128EMU_UNLIKELY((nUsed + nReserved) >= ringBufferSize ||
+                            exitFlag)) {
+        return (T *) 0;
+      }
+      return new(&(ringBuffer[size_t(ringWritePos & (ringBufferSize - 1U))
+                              * messageSlotSize])) T();
+    }
+    EP128EMU_INLINE void queueMessage(Message *m)
+    {
+      (void) m;
+      atomicStoreRelease(ringWritePos, ringWritePos + 1U);
+    }
+    /*!
+     * Returns the next message sent by the emulation thread, or NULL if
+     * there are no messages. The message must be released with
+     * releaseMessage() after it has been processed; line data that is
+     * to be kept needs to be copied to a buffer from allocateMessage().
+     */
+    Message * receiveMessage();
+    void releaseMessage(Message *m);
+    // allocate and free line buffers used by the display thread
     template <typename T>
     T * allocateMessage()
     {
       void  *m_ = (void *) 0;
-      messageQueueMutex.lock();
       if (freeMessageStack) {
         Message *m = freeMessageStack;
         freeMessageStack = m->nxt;
         m_ = m;
       }
-      messageQueueMutex.unlock();
-      if (!m_) {
-        // allocate space that is enough for the largest message type
-        m_ = std::malloc((sizeof(Message_LineData) | 15) + 1);
+      else {
+        m_ = std::malloc(messageSlotSize);
         if (!m_)
           throw std::bad_alloc();
       }
@@ -135,23 +194,40 @@ namespace Ep128Emu {
       return m;
     }
     void deleteMessage(Message *m);
-    void queueMessage(Message *m);
     static void decodeLine(unsigned char *outBuf,
                            const unsigned char *inBuf, size_t nBytes);
     void frameDone();
+    void flushUnchangedLines();
     void checkScreenshotCallback();
     // ----------------
-    Message       *messageQueue;
-    Message       *lastMessage;
+    // ring buffer of 'ringBufferSize' message slots, written by the
+    // emulation thread and read by the display thread without locking
+    unsigned char *ringBuffer;
+    volatile uint32_t ringWritePos;
+    volatile uint32_t ringReadPos;
+    // number of frames sent and received
+    volatile uint32_t framesQueued;
+    volatile uint32_t framesReceived;
+    // line buffers no longer used by the display thread
     Message       *freeMessageStack;
-    Mutex         messageQueueMutex;
+    // display parameters are passed separately, since they may be set
+    // from either thread
+    Mutex         displayParametersMutex;
+    Message_SetParameters newDisplayParameters;
+    volatile bool displayParametersChanged;
+    // set if some messages were lost because the ring buffer was full
+    bool          ringBufferOverrun;
     // for 578 lines (576 + 2 border)
     Message_LineData  **lineBuffers;
+    // copy of the data last sent for each line, used by drawLine() to
+    // avoid queueing lines that have not changed since the previous frame
+    Message_LineData  *sentLineData;
+    int           unchangedLineFirst;
+    int           unchangedLineCnt;
+    int           sentLastLineNum;
     int           curLine;
     int           vsyncCnt;
-    int           framesPending;
     bool          skippingFrame;
-    bool          framesPendingFlag;
     bool          vsyncState;
     bool          oddFrame;
     volatile bool videoResampleEnabled;
@@ -160,7 +236,6 @@ namespace Ep128Emu {
     DisplayParameters   displayParameters;
     DisplayParameters   savedDisplayParameters;
     Timer         limitFrameRateTimer;
-    ThreadLock    threadLock;
     int           (*fltkEventCallback)(void *, int);
     void          *fltkEventCallbackUserData;
     void          (*screenshotCallback)(void *,
@@ -213,7 +288,8 @@ namespace Ep128Emu {
      */
     inline bool haveFramesPending() const
     {
-      return framesPendingFlag;
+      return (atomicLoadAcquire(framesQueued)
+              != atomicLoadAcquire(framesReceived));
     }
     /*!
      * Set function to be called once by checkEvents() after video data for
@@ -1239,20 +1239,8 @@ namespace Ep128Emu {
 
   bool OpenGLDisplay::checkEvents()
   {
-    threadLock.notify();
     while (true) {
-      messageQueueMutex.lock();
-      Message *m = messageQueue;
-      if (m) {
-        messageQueue = m->nxt;
-        if (messageQueue) {
-          if (!messageQueue->nxt)
-            lastMessage = messageQueue;
-        }
-        else
-          lastMessage = (Message *) 0;
-      }
-      messageQueueMutex.unlock();
+      Message *m = receiveMessage();
       if (!m)
         break;
       if (EP128EMU_EXPECT(m->msgType == Message::MsgType_LineData)) {
@@ -1274,7 +1262,7 @@ namespace Ep128Emu {
               if (lineBuffers[lineNum_] != (Message_LineData *) 0 &&
                   *(lineBuffers[lineNum_]) == *msg) {
                 if (lineNum == lineNum_) {
-                  deleteMessage(m);
+                  releaseMessage(m);
                   continue;
                 }
               }
@@ -1283,20 +1271,45 @@ namespace Ep128Emu {
               }
             }
           }
-          if (lineBuffers[lineNum])
-            deleteMessage(lineBuffers[lineNum]);
-          lineBuffers[lineNum] = msg;
+          if (!lineBuffers[lineNum])
+            lineBuffers[lineNum] = allocateMessage<Message_LineData>();
+          *(lineBuffers[lineNum]) = *msg;
+          releaseMessage(m);
           continue;
         }
       }
+      else if (m->msgType == Message::MsgType_LinesUnchanged) {
+        Message_LinesUnchanged  *msg;
+        msg = static_cast<Message_LinesUnchanged *>(m);
+        for (int i = 0; i < msg->nLines; i++) {
+          int     lineNum = msg->firstLine + (i << 1);
+          if (lineNum < 0 || lineNum >= 578)
+            break;
+          lastLineNum = lineNum;
+          if ((lineNum & 1) == int(prvFrameWasOdd) &&
+              lineBuffers[lineNum ^ 1] != (Message_LineData *) 0) {
+            // non-interlaced mode: clear any old lines in the other field
+            deleteMessage(lineBuffers[lineNum ^ 1]);
+            lineBuffers[lineNum ^ 1] = (Message_LineData *) 0;
+          }
+          if (displayParameters.displayQuality == 0 &&
+              !displayParameters.bufferingMode) {
+            // the line data is the same, but it may still differ from
+            // the line that was displayed in the previous frame
+            int     lineNum_ = (lineNum & (~(int(1)))) | int(prvFrameWasOdd);
+            if (lineNum_ != lineNum &&
+                !(lineBuffers[lineNum_] != (Message_LineData *) 0 &&
+                  lineBuffers[lineNum] != (Message_LineData *) 0 &&
+                  *(lineBuffers[lineNum_]) == *(lineBuffers[lineNum]))) {
+              linesChanged[lineNum >> 1] = true;
+            }
+          }
+        }
+      }
       else if (m->msgType == Message::MsgType_FrameDone) {
         // need to update display
-        messageQueueMutex.lock();
-        framesPending = (framesPending > 0 ? (framesPending - 1) : 0);
-        framesPendingFlag = (framesPending > 0);
-        messageQueueMutex.unlock();
         redrawFlag = true;
-        deleteMessage(m);
+        releaseMessage(m);
         int     yc = lastLineNum;
         prvFrameWasOdd = bool(yc & 1);
         lastLineNum = (yc & 1) - 2;
@@ -1407,7 +1420,7 @@ namespace Ep128Emu {
         for (size_t yc = 0; yc < 289; yc++)
           linesChanged[yc] = true;
       }
-      deleteMessage(m);
+      releaseMessage(m);
     }
     if (noInputTimer.getRealTime() > 0.5) {
       noInputTimer.reset(0.25);
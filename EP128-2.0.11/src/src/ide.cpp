@@ -21,6 +21,12 @@
 #include "ide.hpp"
 #include "system.hpp"
 
+#ifndef WIN32
+#  include <sys/types.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 namespace Ep128 {
 
   extern uint32_t checkVHDImage(std::FILE *imageFile, const char *fileName,
@@ -181,6 +187,99 @@ namespace Ep128 {
     return true;
   }
 
+  bool IDEInterface::IDEController::IDEDrive::mapImageFile()
+  {
+#ifndef WIN32
+    if (readOnlyMode || nSectors < 1U)
+      return false;
+    size_t  nBytes = size_t(nSectors) << 9;
+    dirtyPageShift = 16;
+    long    pageSize = sysconf(_SC_PAGESIZE);
+    while (pageSize > 0L && (1L << dirtyPageShift) < pageSize)
+      dirtyPageShift++;
+    size_t  nPages = ((nBytes - 1) >> dirtyPageShift) + 1;
+    try {
+      dirtyPageTable = new uint8_t[nPages];
+    }
+    catch (std::bad_alloc&) {
+      return false;
+    }
+    std::memset(dirtyPageTable, 0x00, nPages);
+    void    *p = mmap((void *) 0, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fileno(imageFile), 0);
+    if (p == MAP_FAILED) {
+      delete[] dirtyPageTable;
+      dirtyPageTable = (uint8_t *) 0;
+      return false;
+    }
+    imageData = reinterpret_cast< uint8_t * >(p);
+    dirtyPageCnt = 0;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void IDEInterface::IDEController::IDEDrive::unmapImageFile()
+  {
+#ifndef WIN32
+    if (imageData) {
+      flushImageData(true);
+      (void) munmap(imageData, size_t(nSectors) << 9);
+      imageData = (uint8_t *) 0;
+    }
+    if (dirtyPageTable) {
+      delete[] dirtyPageTable;
+      dirtyPageTable = (uint8_t *) 0;
+    }
+#endif
+    dirtyPageCnt = 0;
+  }
+
+  void IDEInterface::IDEController::IDEDrive::setPagesDirty(size_t offs,
+                                                             size_t nBytes)
+  {
+    size_t  endPage = (offs + nBytes - 1) >> dirtyPageShift;
+    for (size_t i = offs >> dirtyPageShift; i <= endPage; i++) {
+      if (!dirtyPageTable[i]) {
+        dirtyPageTable[i] = 1;
+        if (dirtyPageCnt++ == 0)
+          flushTimer.reset();
+      }
+    }
+  }
+
+  void IDEInterface::IDEController::IDEDrive::flushImageData(bool syncFlag)
+  {
+#ifndef WIN32
+    if (!dirtyPageCnt)
+      return;
+    size_t  nPages = (((size_t(nSectors) << 9) - 1) >> dirtyPageShift) + 1;
+    size_t  i = 0;
+    while (dirtyPageCnt > 0 && i < nPages) {
+      if (!dirtyPageTable[i]) {
+        i++;
+        continue;
+      }
+      // write back adjacent dirty pages with a single call
+      size_t  startPage = i;
+      do {
+        dirtyPageTable[i++] = 0;
+        dirtyPageCnt--;
+      } while (i < nPages && dirtyPageTable[i]);
+      size_t  offs = startPage << dirtyPageShift;
+      size_t  nBytes = (i << dirtyPageShift) - offs;
+      if ((offs + nBytes) > (size_t(nSectors) << 9))
+        nBytes = (size_t(nSectors) << 9) - offs;
+      (void) msync(imageData + offs, nBytes, (syncFlag ? MS_SYNC : MS_ASYNC));
+      fileIOCalls++;
+    }
+#else
+    (void) syncFlag;
+#endif
+    dirtyPageCnt = 0;
+  }
+
   void IDEInterface::IDEController::IDEDrive::readBlock()
   {
     if (sectorCnt < 1 || ideController.errorRegister != 0x00) {
@@ -205,7 +304,12 @@ namespace Ep128 {
       std::memset(buf + (tmp << 9), 0x00, (blockSize - tmp) << 9);
       blockSize = tmp;
     }
-    if (blockSize > 0) {
+    if (blockSize > 0 && imageData) {
+      bytesRead = blockSize << 9;
+      std::memcpy(buf, imageData + (size_t(currentSector) << 9), bytesRead);
+    }
+    else if (blockSize > 0) {
+      fileIOCalls += 2U;
       if (std::fseek(imageFile, long(currentSector << 9), SEEK_SET) < 0) {
         // error seeking disk image
         ideController.errorRegister |= uint8_t(0x10);
@@ -222,6 +326,7 @@ namespace Ep128 {
       std::memset(buf + bytesRead, 0x00, (blockSize << 9) - bytesRead);
     currentSector += uint32_t(bytesRead >> 9);
     sectorCnt -= uint16_t(bytesRead >> 9);
+    sectorsRead += uint32_t(bytesRead >> 9);
     if (sectorCnt < 1)
       currentSector--;
     // buffer is full, set interrupt and DRQ flag
@@ -244,7 +349,14 @@ namespace Ep128 {
       ideController.errorRegister |= uint8_t(0x10);     // IDNF
       blockSize = size_t(nSectors - currentSector);
     }
-    if (blockSize > 0) {
+    if (blockSize > 0 && imageData) {
+      // the mapped pages are the file data, so there is nothing to verify
+      bytesWritten = blockSize << 9;
+      std::memcpy(imageData + (size_t(currentSector) << 9), buf, bytesWritten);
+      setPagesDirty(size_t(currentSector) << 9, bytesWritten);
+    }
+    else if (blockSize > 0) {
+      fileIOCalls += 2U;
       if (std::fseek(imageFile, long(currentSector << 9), SEEK_SET) < 0) {
         // error seeking disk image
         ideController.errorRegister |= uint8_t(0x10);
@@ -257,6 +369,7 @@ namespace Ep128 {
           ideController.errorRegister |= uint8_t(0x40);
         }
         else if (ideController.commandRegister == 0x3C) {   // WRITE VERIFY
+          fileIOCalls++;
           if (std::fseek(imageFile, long(currentSector << 9), SEEK_SET) < 0) {
             // error seeking disk image
             ideController.errorRegister |= uint8_t(0x50);
@@ -264,6 +377,7 @@ namespace Ep128 {
           else {
             uint8_t tmpBuf[512];
             for (size_t i = 0; i < blockSize; i++) {
+              fileIOCalls++;
               if (std::fread(&(tmpBuf[0]), sizeof(uint8_t), 512, imageFile)
                   != 512) {
                 // read error
@@ -282,6 +396,7 @@ namespace Ep128 {
     }
     currentSector += uint32_t(bytesWritten >> 9);
     sectorCnt -= uint16_t(bytesWritten >> 9);
+    sectorsWritten += uint32_t(bytesWritten >> 9);
     if (sectorCnt < 1 || ideController.errorRegister != 0x00) {
       // command is complete, or there was an error in the previous block
       if (sectorCnt > 0)
@@ -584,7 +699,14 @@ namespace Ep128 {
       readOnlyMode(true),
       diskChangeFlag(false),
       bufPos(0),
-      vhdFormat(false)
+      vhdFormat(false),
+      imageData((uint8_t *) 0),
+      dirtyPageTable((uint8_t *) 0),
+      dirtyPageShift(16),
+      dirtyPageCnt(0),
+      sectorsRead(0U),
+      sectorsWritten(0U),
+      fileIOCalls(0U)
   {
     this->reset(3);
   }
@@ -616,6 +738,7 @@ namespace Ep128 {
   void IDEInterface::IDEController::IDEDrive::setImageFile(const char *fileName)
   {
     if (!fileName || fileName[0] == '\0') {
+      unmapImageFile();
       if (imageFile) {
         std::fclose(imageFile);
         imageFile = (std::FILE *) 0;
@@ -626,6 +749,9 @@ namespace Ep128 {
       defaultSectorsPerTrack = 0;
       readOnlyMode = true;
       vhdFormat = false;
+      sectorsRead = 0U;
+      sectorsWritten = 0U;
+      fileIOCalls = 0U;
       this->reset(3);
       return;
     }
@@ -648,6 +774,8 @@ namespace Ep128 {
       nCylinders = defaultCylinders;
       nHeads = defaultHeads;
       nSectorsPerTrack = defaultSectorsPerTrack;
+      // use stdio if the image is read-only, or cannot be mapped
+      (void) mapImageFile();
       this->reset(3);
     }
     catch (...) {
@@ -982,11 +1110,26 @@ namespace Ep128 {
     return retval;
   }
 
+  void IDEInterface::checkImageFlush_()
+  {
+    for (int i = 0; i < 4; i++) {
+      IDEController::IDEDrive&  ideDrive =
+          ((i & 2) == 0 ?
+           ((i & 1) == 0 ? idePort0.ideDrive0 : idePort0.ideDrive1)
+           : ((i & 1) == 0 ? idePort1.ideDrive0 : idePort1.ideDrive1));
+      if (ideDrive.haveDirtyPages() &&
+          ideDrive.getTimeSinceFirstWrite() >= flushInterval) {
+        ideDrive.flushImageData();
+      }
+    }
+  }
+
   IDEInterface::IDEInterface()
     : idePort0(),
       idePort1(),
       dataPort(0x0000),
-      ledFlashCnt(0x00)
+      ledFlashCnt(0x00),
+      flushInterval(1.0)
   {
   }
 
@@ -1009,6 +1152,25 @@ namespace Ep128 {
       idePort1.setImageFile(n, fileName);
   }
 
+  void IDEInterface::setFlushInterval(int msec)
+  {
+    msec = (msec > 0 ? (msec < 60000 ? msec : 60000) : 0);
+    flushInterval = double(msec) * 0.001;
+  }
+
+  void IDEInterface::getIOStatistics(int n, uint32_t& sectorsRead_,
+                                     uint32_t& sectorsWritten_,
+                                     uint32_t& fileIOCalls_)
+  {
+    IDEController::IDEDrive&  ideDrive =
+        ((n & 2) == 0 ?
+         ((n & 1) == 0 ? idePort0.ideDrive0 : idePort0.ideDrive1)
+         : ((n & 1) == 0 ? idePort1.ideDrive0 : idePort1.ideDrive1));
+    sectorsRead_ = ideDrive.getSectorsRead();
+    sectorsWritten_ = ideDrive.getSectorsWritten();
+    fileIOCalls_ = ideDrive.getFileIOCalls();
+  }
+
   uint8_t IDEInterface::readPort(uint16_t addr)
   {
     switch (addr & 3) {
@@ -21,6 +21,7 @@
 #define EP128EMU_IDE_HPP
 
 #include "ep128emu.hpp"
+#include "system.hpp"
 
 namespace Ep128 {
 
@@ -59,9 +60,26 @@ namespace Ep128 {
         bool      diskChangeFlag;
         uint16_t  bufPos;
         bool      vhdFormat;
+        // memory mapped image data (NULL if stdio is used for the file I/O)
+        uint8_t   *imageData;
+        // one byte per (1 << dirtyPageShift) bytes of image data, non-zero
+        // if the page has been written since the last flush
+        uint8_t   *dirtyPageTable;
+        size_t    dirtyPageShift;
+        Ep128Emu::Timer flushTimer; // time elapsed since the first dirty page
+        size_t    dirtyPageCnt;
+        // I/O statistics since the image file was opened
+        uint32_t  sectorsRead;
+        uint32_t  sectorsWritten;
+        uint32_t  fileIOCalls;  // host file system calls (seek/read/write/sync)
         // --------
         bool convertCHSToLBA(uint32_t& b, uint16_t c, uint16_t h, uint16_t s);
         bool convertLBAToCHS(uint16_t& c, uint16_t& h, uint16_t& s, uint32_t b);
+        // map the image file into memory if it is writable and the host
+        // supports it; returns false if stdio should be used instead
+        bool mapImageFile();
+        void unmapImageFile();
+        void setPagesDirty(size_t offs, size_t nBytes);
         void readBlock();
         void writeBlockDone();
         void ackMediaChangeCommand();
@@ -88,6 +106,29 @@ namespace Ep128 {
         void writeWord();
         void processCommand();
         void commandDone(uint8_t errorCode);
+        // write dirty pages of a memory mapped image back to the file;
+        // if 'syncFlag' is true, wait until the data is written
+        void flushImageData(bool syncFlag = false);
+        inline double getTimeSinceFirstWrite()
+        {
+          return flushTimer.getRealTime();
+        }
+        inline bool haveDirtyPages() const
+        {
+          return (dirtyPageCnt != 0);
+        }
+        inline uint32_t getSectorsRead() const
+        {
+          return sectorsRead;
+        }
+        inline uint32_t getSectorsWritten() const
+        {
+          return sectorsWritten;
+        }
+        inline uint32_t getFileIOCalls() const
+        {
+          return fileIOCalls;
+        }
         // set pointer to 64K I/O buffer
         inline void setBuffer(uint8_t *buf_)
         {
@@ -175,8 +216,10 @@ namespace Ep128 {
     IDEController idePort1;     // secondary controller at EEh
     uint16_t  dataPort;
     uint8_t   ledFlashCnt;
+    double    flushInterval;    // in seconds
     // --------
     uint32_t getLEDState_();
+    void checkImageFlush_();
    public:
     IDEInterface();
     virtual ~IDEInterface();
@@ -199,6 +242,32 @@ namespace Ep128 {
       }
       return 0U;
     }
+    /*!
+     * Set the maximum time in milliseconds that written sectors of memory
+     * mapped disk images may be kept in memory before flushing them to the
+     * image file. Zero flushes the data at the end of every time slice.
+     */
+    void setFlushInterval(int msec);
+    /*!
+     * Flush dirty pages of memory mapped disk images if the flush interval
+     * has elapsed. Should be called periodically (e.g. once per time slice).
+     */
+    inline void checkImageFlush()
+    {
+      if (idePort0.ideDrive0.haveDirtyPages() ||
+          idePort0.ideDrive1.haveDirtyPages() ||
+          idePort1.ideDrive0.haveDirtyPages() ||
+          idePort1.ideDrive1.haveDirtyPages()) {
+        checkImageFlush_();
+      }
+    }
+    /*!
+     * Returns the number of sectors read and written by IDE drive 'n'
+     * (0 to 3), and the number of host file I/O calls made, since the disk
+     * image was opened.
+     */
+    void getIOStatistics(int n, uint32_t& sectorsRead_,
+                         uint32_t& sectorsWritten_, uint32_t& fileIOCalls_);
   };
 
 }       // namespace Ep128
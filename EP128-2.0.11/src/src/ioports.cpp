@@ -108,7 +108,8 @@ namespace Ep128 {
     breakPointPriorityThreshold = 0;
   }
 
-  void IOPorts::setBreakPoint(uint16_t addr, int priority, bool r, bool w)
+  void IOPorts::setBreakPoint(uint16_t addr, int priority, bool r, bool w,
+                              const std::string& condition)
   {
     uint8_t mode = (r ? 1 : 0) + (w ? 2 : 0);
     if (mode) {
@@ -121,17 +122,21 @@ namespace Ep128 {
           breakPointTable[i] = 0;
       }
       uint8_t&  bp = breakPointTable[addr & 0xFF];
+      breakPointConditions.setCondition(addr & 0xFF, condition);
       if (!bp)
         breakPointCnt++;
-      if (bp > mode)
+      if ((bp & 15) > mode)
         mode = (bp & 12) + (mode & 3);
       mode |= (bp & 3);
+      if (!condition.empty())
+        mode |= 128;
       bp = mode;
     }
     else if (breakPointTable) {
       if (breakPointTable[addr & 0xFF]) {
         // remove a previously existing breakpoint
         breakPointTable[addr & 0xFF] = 0;
+        breakPointConditions.setCondition(addr & 0xFF, std::string());
         breakPointCnt--;
         if (!breakPointCnt) {
           delete[] breakPointTable;
@@ -145,6 +150,16 @@ namespace Ep128 {
   {
     for (unsigned int addr = 0; addr < 256; addr++)
       setBreakPoint((uint16_t) addr, 0, false, false);
+    breakPointConditions.clear();
+  }
+
+  bool IOPorts::checkBreakPointCondition(uint16_t addr, uint8_t value)
+  {
+    Ep128Emu::BreakPointCondition *p =
+        breakPointConditions.findCondition(addr & 0xFF);
+    if (!p)
+      return true;
+    return breakPointConditionCallback(*p, addr, value);
   }
 
   void IOPorts::breakPointCallback(bool isWrite, uint16_t addr, uint8_t value)
@@ -154,6 +169,15 @@ namespace Ep128 {
     (void) value;
   }
 
+  bool IOPorts::breakPointConditionCallback(
+      Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value)
+  {
+    (void) cond;
+    (void) addr;
+    (void) value;
+    return true;
+  }
+
   void IOPorts::setBreakPointPriorityThreshold(int n)
   {
     breakPointPriorityThreshold =
@@ -171,8 +195,12 @@ namespace Ep128 {
     if (breakPointTable) {
       for (size_t i = 0; i < 256; i++) {
         uint8_t bp = breakPointTable[i];
-        if (bp)
-          bplst.addIOBreakPoint(uint16_t(i), !!(bp & 1), !!(bp & 2), bp >> 2);
+        if (bp) {
+          bplst.addIOBreakPoint(uint16_t(i), !!(bp & 1), !!(bp & 2),
+                                (bp & 15) >> 2,
+                                breakPointConditions.getExpression(
+                                    uint32_t(i)));
+        }
       }
     }
     return bplst;
@@ -22,6 +22,7 @@
 
 #include "ep128emu.hpp"
 #include "bplist.hpp"
+#include "bpcond.hpp"
 
 namespace Ep128 {
 
@@ -44,10 +45,15 @@ namespace Ep128 {
     uint8_t *breakPointTable;
     size_t breakPointCnt;
     uint8_t breakPointPriorityThreshold;
+    // conditions of breakpoints that have bit 7 set in the breakpoint table
+    Ep128Emu::BreakPointConditionTable  breakPointConditions;
+    // ----------------
+    bool checkBreakPointCondition(uint16_t addr, uint8_t value);
    public:
     IOPorts();
     virtual ~IOPorts();
-    void setBreakPoint(uint16_t addr, int priority, bool r, bool w);
+    void setBreakPoint(uint16_t addr, int priority, bool r, bool w,
+                       const std::string& condition = std::string());
     void clearBreakPoints();
     void setBreakPointPriorityThreshold(int n);
     int getBreakPointPriorityThreshold();
@@ -73,6 +79,10 @@ namespace Ep128 {
     void registerChunkType(Ep128Emu::File&);
    protected:
     virtual void breakPointCallback(bool isWrite, uint16_t addr, uint8_t value);
+    // called on hitting a conditional breakpoint, before breakPointCallback()
+    // is called; should return true if the condition is met
+    virtual bool breakPointConditionCallback(
+        Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value);
   };
 
   // --------------------------------------------------------------------------
@@ -84,9 +94,11 @@ namespace Ep128 {
 
     value = cb.func(cb.userData_, cb.addr_);
     if (breakPointTable) {
-      if (breakPointTable[offs] >= breakPointPriorityThreshold &&
-          (breakPointTable[offs] & 1) != 0)
-        breakPointCallback(false, addr, value);
+      uint8_t bp = breakPointTable[offs];
+      if ((bp & 15) >= breakPointPriorityThreshold && (bp & 1) != 0) {
+        if (!(bp & 128) || checkBreakPointCondition(addr, value))
+          breakPointCallback(false, addr, value);
+      }
     }
     return value;
   }
@@ -97,9 +109,11 @@ namespace Ep128 {
     WriteCallback&  cb = writeCallbacks[offs];
 
     if (breakPointTable) {
-      if (breakPointTable[offs] >= breakPointPriorityThreshold &&
-          (breakPointTable[offs] & 2) != 0)
-        breakPointCallback(true, addr, value);
+      uint8_t bp = breakPointTable[offs];
+      if ((bp & 15) >= breakPointPriorityThreshold && (bp & 2) != 0) {
+        if (!(bp & 128) || checkBreakPointCondition(addr, value))
+          breakPointCallback(true, addr, value);
+      }
     }
     portValues[offs] = value;
     cb.func(cb.userData_, cb.addr_, value);
@@ -19,6 +19,10 @@
 
 #include "ep128emu.hpp"
 #include "memory.hpp"
+#include "system.hpp"
+#include "romstore.hpp"
+
+#include <vector>
 #ifdef ENABLE_SDEXT
 #  include "sdext.hpp"
 #endif
@@ -29,26 +33,66 @@ namespace Ep128 {
   {
     if (n >= 0xFC && isROM)
       throw Ep128Emu::Exception("video memory cannot be ROM");
-    if (segmentTable[n] == (uint8_t *) 0)
+    if (segmentTable[n] == (uint8_t *) 0) {
       segmentTable[n] = new uint8_t[16384];
+      segmentLayoutChanged = true;
+    }
+    else {
+      // the caller will write the segment, so it cannot be shared
+      if (segmentSharedTable[n])
+        unshareSegment(n);
+      if (segmentROMTable[n] != isROM)
+        segmentLayoutChanged = true;
+    }
     segmentROMTable[n] = isROM;
+    segmentDirtyTable[n] = 1;
+    for (uint8_t i = 0; i < 4; i++)
+      setPage(i, getPage(i));
+  }
+
+  void Memory::unshareSegment(uint8_t n)
+  {
+    uint8_t *p = new uint8_t[16384];
+    std::memcpy(p, segmentTable[n], 16384);
+    Ep128Emu::ROMStore::releaseSegment(segmentTable[n]);
+    segmentTable[n] = p;
+    segmentSharedTable[n] = false;
     for (uint8_t i = 0; i < 4; i++)
       setPage(i, getPage(i));
   }
 
+  void Memory::freeSegment(uint8_t n)
+  {
+    if (segmentTable[n]) {
+      if (segmentSharedTable[n])
+        Ep128Emu::ROMStore::releaseSegment(segmentTable[n]);
+      else
+        delete[] segmentTable[n];
+    }
+    segmentTable[n] = (uint8_t *) 0;
+    segmentSharedTable[n] = false;
+  }
+
   void Memory::checkExecuteBreakPoint(uint16_t addr, uint8_t page,
                                       uint8_t value)
   {
     const uint8_t *tbl = breakPointTable;
     if (tbl != (uint8_t *) 0 &&
-        tbl[addr] >= breakPointPriorityThreshold && (tbl[addr] & 36) == 4) {
+        (tbl[addr] & 63) >= breakPointPriorityThreshold &&
+        (tbl[addr] & 36) == 4 &&
+        (!(tbl[addr] & 64) || checkBreakPointCondition(addr, addr, value))) {
       breakPointCallback(false, addr, value);
     }
     else {
       uint16_t  offs = addr & 0x3FFF;
       tbl = segmentBreakPointTable[pageTable[page]];
       if (tbl != (uint8_t *) 0 &&
-          tbl[offs] >= breakPointPriorityThreshold && (tbl[offs] & 36) == 4) {
+          (tbl[offs] & 63) >= breakPointPriorityThreshold &&
+          (tbl[offs] & 36) == 4 &&
+          (!(tbl[offs] & 64) ||
+           checkBreakPointCondition(
+               0x01000000U | (uint32_t(pageTable[page]) << 14) | offs,
+               addr, value))) {
         breakPointCallback(false, addr, value);
       }
     }
@@ -58,14 +102,21 @@ namespace Ep128 {
   {
     const uint8_t *tbl = breakPointTable;
     if (tbl != (uint8_t *) 0 &&
-        tbl[addr] >= breakPointPriorityThreshold && (tbl[addr] & 1) != 0) {
+        (tbl[addr] & 63) >= breakPointPriorityThreshold &&
+        (tbl[addr] & 1) != 0 &&
+        (!(tbl[addr] & 64) || checkBreakPointCondition(addr, addr, value))) {
       breakPointCallback(false, addr, value);
     }
     else {
       uint16_t  offs = addr & 0x3FFF;
       tbl = segmentBreakPointTable[pageTable[page]];
       if (tbl != (uint8_t *) 0 &&
-          tbl[offs] >= breakPointPriorityThreshold && (tbl[offs] & 1) != 0) {
+          (tbl[offs] & 63) >= breakPointPriorityThreshold &&
+          (tbl[offs] & 1) != 0 &&
+          (!(tbl[offs] & 64) ||
+           checkBreakPointCondition(
+               0x01000000U | (uint32_t(pageTable[page]) << 14) | offs,
+               addr, value))) {
         breakPointCallback(false, addr, value);
       }
     }
@@ -75,22 +126,39 @@ namespace Ep128 {
   {
     const uint8_t *tbl = breakPointTable;
     if (tbl != (uint8_t *) 0 &&
-        tbl[addr] >= breakPointPriorityThreshold && (tbl[addr] & 2) != 0) {
+        (tbl[addr] & 63) >= breakPointPriorityThreshold &&
+        (tbl[addr] & 2) != 0 &&
+        (!(tbl[addr] & 64) || checkBreakPointCondition(addr, addr, value))) {
       breakPointCallback(true, addr, value);
     }
     else {
       uint16_t  offs = addr & 0x3FFF;
       tbl = segmentBreakPointTable[pageTable[page]];
       if (tbl != (uint8_t *) 0 &&
-          tbl[offs] >= breakPointPriorityThreshold && (tbl[offs] & 2) != 0) {
+          (tbl[offs] & 63) >= breakPointPriorityThreshold &&
+          (tbl[offs] & 2) != 0 &&
+          (!(tbl[offs] & 64) ||
+           checkBreakPointCondition(
+               0x01000000U | (uint32_t(pageTable[page]) << 14) | offs,
+               addr, value))) {
         breakPointCallback(true, addr, value);
       }
     }
   }
 
+  bool Memory::checkBreakPointCondition(uint32_t n,
+                                        uint16_t addr, uint8_t value)
+  {
+    Ep128Emu::BreakPointCondition *p = breakPointConditions.findCondition(n);
+    if (!p)
+      return true;
+    return breakPointConditionCallback(*p, addr, value);
+  }
+
   Memory::Memory()
     : segmentTable((uint8_t **) 0),
       segmentROMTable((bool *) 0),
+      segmentSharedTable((bool *) 0),
       breakPointTable((uint8_t *) 0),
       breakPointCnt(0),
       segmentBreakPointTable((uint8_t **) 0),
@@ -98,7 +166,10 @@ namespace Ep128 {
       haveBreakPoints(false),
       breakPointPriorityThreshold(0),
       videoMemory((uint8_t *) 0),
-      dummyMemory((uint8_t *) 0)
+      dummyMemory((uint8_t *) 0),
+      segmentDirtyTable((uint8_t *) 0),
+      checkpointID(0U),
+      segmentLayoutChanged(true)
 #ifdef ENABLE_SDEXT
       , sdext((SDExt *) 0)
 #endif
@@ -107,6 +178,8 @@ namespace Ep128 {
       pageTable[i] = 0;
       pageAddressTableR[i] = (uint8_t *) 0;
       pageAddressTableW[i] = (uint8_t *) 0;
+      directReadTable[i] = (uint8_t *) 0;
+      directWriteTable[i] = (uint8_t *) 0;
     }
     try {
       segmentTable = new uint8_t*[256];
@@ -115,12 +188,18 @@ namespace Ep128 {
       segmentROMTable = new bool[256];
       for (int i = 0; i < 256; i++)
         segmentROMTable[i] = true;
+      segmentSharedTable = new bool[256];
+      for (int i = 0; i < 256; i++)
+        segmentSharedTable[i] = false;
       segmentBreakPointTable = new uint8_t*[256];
       for (int i = 0; i < 256; i++)
         segmentBreakPointTable[i] = (uint8_t *) 0;
       segmentBreakPointCntTable = new size_t[256];
       for (int i = 0; i < 256; i++)
         segmentBreakPointCntTable[i] = 0;
+      segmentDirtyTable = new uint8_t[256];
+      for (int i = 0; i < 256; i++)
+        segmentDirtyTable[i] = 1;
       videoMemory = new uint8_t[65536];
       for (int i = 0; i < 65536; i++)
         videoMemory[i] = 0xFF;
@@ -143,6 +222,10 @@ namespace Ep128 {
         delete[] segmentROMTable;
         segmentROMTable = (bool *) 0;
       }
+      if (segmentSharedTable) {
+        delete[] segmentSharedTable;
+        segmentSharedTable = (bool *) 0;
+      }
       if (segmentBreakPointTable) {
         delete[] segmentBreakPointTable;
         segmentBreakPointTable = (uint8_t **) 0;
@@ -151,6 +234,10 @@ namespace Ep128 {
         delete[] segmentBreakPointCntTable;
         segmentBreakPointCntTable = (size_t *) 0;
       }
+      if (segmentDirtyTable) {
+        delete[] segmentDirtyTable;
+        segmentDirtyTable = (uint8_t *) 0;
+      }
       if (videoMemory) {
         delete[] videoMemory;
         videoMemory = (uint8_t *) 0;
@@ -165,14 +252,13 @@ namespace Ep128 {
 
   Memory::~Memory()
   {
-    for (int i = 0; i < 252; i++) {
-      if (segmentTable[i])
-        delete[] segmentTable[i];
-    }
+    for (int i = 0; i < 252; i++)
+      freeSegment(uint8_t(i));
     delete[] dummyMemory;
     delete[] videoMemory;
     delete[] segmentTable;
     delete[] segmentROMTable;
+    delete[] segmentSharedTable;
     if (breakPointTable)
       delete[] breakPointTable;
     for (int i = 0; i < 256; i++) {
@@ -181,11 +267,14 @@ namespace Ep128 {
     }
     delete[] segmentBreakPointTable;
     delete[] segmentBreakPointCntTable;
+    delete[] segmentDirtyTable;
   }
 
   void Memory::setBreakPoint(uint8_t segment, uint16_t addr, int priority,
-                             bool r, bool w, bool x, bool ignoreFlag)
+                             bool r, bool w, bool x, bool ignoreFlag,
+                             const std::string& condition)
   {
+    uint32_t  n = 0x01000000U | (uint32_t(segment) << 14) | (addr & 0x3FFF);
     uint8_t mode =
         (r ? 1 : 0) + (w ? 2 : 0) + (x ? 4 : 0) + (ignoreFlag ? 32 : 0);
     if (mode) {
@@ -196,18 +285,26 @@ namespace Ep128 {
         for (int i = 0; i < 16384; i++)
           segmentBreakPointTable[segment][i] = 0;
       }
-      haveBreakPoints = true;
+      if (!haveBreakPoints) {
+        haveBreakPoints = true;
+        updateDirectAccessTables();
+      }
       uint8_t&  bp = segmentBreakPointTable[segment][addr & 0x3FFF];
+      breakPointConditions.setCondition(n, condition);
       if (!bp)
         segmentBreakPointCntTable[segment]++;
-      if (bp > mode)
+      if ((bp & 63) > mode)
         mode = (bp & 56) + (mode & 7);
       mode |= (bp & 7);
+      if (!condition.empty())
+        mode |= 64;
       bp = mode;
     }
     else if (segmentBreakPointTable[segment]) {
       if (segmentBreakPointTable[segment][addr & 0x3FFF]) {
         // remove a previously existing breakpoint
+        segmentBreakPointTable[segment][addr & 0x3FFF] = 0;
+        breakPointConditions.setCondition(n, std::string());
         segmentBreakPointCntTable[segment]--;
         if (!segmentBreakPointCntTable[segment]) {
           delete[] segmentBreakPointTable[segment];
@@ -218,7 +315,8 @@ namespace Ep128 {
   }
 
   void Memory::setBreakPoint(uint16_t addr, int priority,
-                             bool r, bool w, bool x, bool ignoreFlag)
+                             bool r, bool w, bool x, bool ignoreFlag,
+                             const std::string& condition)
   {
     uint8_t mode =
         (r ? 1 : 0) + (w ? 2 : 0) + (x ? 4 : 0) + (ignoreFlag ? 32 : 0);
@@ -230,18 +328,26 @@ namespace Ep128 {
         for (int i = 0; i < 65536; i++)
           breakPointTable[i] = 0;
       }
-      haveBreakPoints = true;
+      if (!haveBreakPoints) {
+        haveBreakPoints = true;
+        updateDirectAccessTables();
+      }
       uint8_t&  bp = breakPointTable[addr];
+      breakPointConditions.setCondition(addr, condition);
       if (!bp)
         breakPointCnt++;
-      if (bp > mode)
+      if ((bp & 63) > mode)
         mode = (bp & 56) + (mode & 7);
       mode |= (bp & 7);
+      if (!condition.empty())
+        mode |= 64;
       bp = mode;
     }
     else if (breakPointTable) {
       if (breakPointTable[addr]) {
         // remove a previously existing breakpoint
+        breakPointTable[addr] = 0;
+        breakPointConditions.setCondition(addr, std::string());
         breakPointCnt--;
         if (!breakPointCnt) {
           delete[] breakPointTable;
@@ -268,7 +374,9 @@ namespace Ep128 {
     clearBreakPoints();
     for (unsigned int segment = 0; segment < 256; segment++)
       clearBreakPoints((uint8_t) segment);
+    breakPointConditions.clear();
     haveBreakPoints = false;
+    updateDirectAccessTables();
   }
 
   void Memory::breakPointCallback(bool isWrite, uint16_t addr, uint8_t value)
@@ -278,6 +386,15 @@ namespace Ep128 {
     (void) value;
   }
 
+  bool Memory::breakPointConditionCallback(Ep128Emu::BreakPointCondition& cond,
+                                           uint16_t addr, uint8_t value)
+  {
+    (void) cond;
+    (void) addr;
+    (void) value;
+    return true;
+  }
+
   void Memory::setBreakPointPriorityThreshold(int n)
   {
     breakPointPriorityThreshold = uint8_t((n > 0 ? (n < 4 ? n : 4) : 0) << 3);
@@ -298,6 +415,23 @@ namespace Ep128 {
       deleteSegment(segment);
       return;
     }
+    if (isROM) {
+      // ROM segments are stored in Ep128Emu::ROMStore, so that instances
+      // using the same ROM images share the memory
+      for (size_t i = 0; i < dataSize; i += 0x4000) {
+        uint8_t tmpBuf[16384];
+        size_t  nBytes = dataSize - i;
+        nBytes = (nBytes < 0x4000 ? nBytes : 0x4000);
+        std::memcpy(&(tmpBuf[0]), data + i, nBytes);
+        if (nBytes < 0x4000)
+          std::memset(&(tmpBuf[nBytes]), 0xFF, 0x4000 - nBytes);
+        if (segment >= 0xFC)
+          throw Ep128Emu::Exception("video memory cannot be ROM");
+        loadSharedROMSegment(segment, Ep128Emu::ROMStore::addSegment(tmpBuf));
+        segment = (segment + 1) & 0xFF;
+      }
+      return;
+    }
     // allocate memory for segment if necessary
     allocateSegment(segment, isROM);
     size_t  i = 0;
@@ -317,13 +451,34 @@ namespace Ep128 {
       segmentTable[segment][i & 0x3FFF] = 0xFF;
   }
 
+  void Memory::loadSharedROMSegment(uint8_t segment, const uint8_t *data)
+  {
+    if (!data) {
+      deleteSegment(segment);
+      return;
+    }
+    if (segment >= 0xFC) {
+      Ep128Emu::ROMStore::releaseSegment(data);
+      throw Ep128Emu::Exception("video memory cannot be ROM");
+    }
+    if (segmentTable[segment] == (uint8_t *) 0 || !segmentROMTable[segment])
+      segmentLayoutChanged = true;
+    freeSegment(segment);
+    segmentTable[segment] = const_cast< uint8_t * >(data);
+    segmentROMTable[segment] = true;
+    segmentSharedTable[segment] = true;
+    segmentDirtyTable[segment] = 1;
+    for (uint8_t i = 0; i < 4; i++)
+      setPage(i, getPage(i));
+  }
+
   void Memory::deleteSegment(uint8_t segment)
   {
     if (segment >= 0xFC)
       throw Ep128Emu::Exception("cannot delete video memory segments");
     if (segmentTable[segment])
-      delete[] segmentTable[segment];
-    segmentTable[segment] = (uint8_t*) 0;
+      segmentLayoutChanged = true;
+    freeSegment(segment);
     segmentROMTable[segment] = true;
     for (uint8_t i = 0; i < 4; i++)
       setPage(i, getPage(i));
@@ -342,8 +497,10 @@ namespace Ep128 {
     long    offs = -(long(page) << 14);
     if (segmentTable[segment] != (uint8_t *) 0) {
       pageAddressTableR[page] = segmentTable[segment] + offs;
-      if (!segmentROMTable[segment])
+      if (!segmentROMTable[segment]) {
         pageAddressTableW[page] = segmentTable[segment] + offs;
+        segmentDirtyTable[segment] = 1;
+      }
       else
         pageAddressTableW[page] = dummyMemory + (0x4000L + offs);
     }
@@ -351,6 +508,42 @@ namespace Ep128 {
       pageAddressTableR[page] = dummyMemory + offs;
       pageAddressTableW[page] = dummyMemory + (0x4000L + offs);
     }
+    updateDirectAccessTables(page);
+  }
+
+  void Memory::updateDirectAccessTables(uint8_t page)
+  {
+    uint8_t segment = pageTable[page];
+    // video memory has different wait states, and segment 07h may be
+    // mapped to the SDExt cartridge (which is not checked here, so that
+    // enabling or disabling it does not need to update the table)
+    if (haveBreakPoints || segment >= 0xFC || segment == 0x07) {
+      directReadTable[page] = (uint8_t *) 0;
+      directWriteTable[page] = (uint8_t *) 0;
+    }
+    else {
+      directReadTable[page] = pageAddressTableR[page];
+      directWriteTable[page] = pageAddressTableW[page];
+    }
+  }
+
+  void Memory::updateDirectAccessTables()
+  {
+    for (uint8_t i = 0; i < 4; i++)
+      updateDirectAccessTables(i);
+  }
+
+  void Memory::clearDirtySegments()
+  {
+    for (int i = 0; i < 256; i++)
+      segmentDirtyTable[i] = 0;
+    // segments that are currently mapped can be written without calling
+    // setPage() again
+    for (int i = 0; i < 4; i++) {
+      if (isSegmentRAM(pageTable[i]))
+        segmentDirtyTable[pageTable[i]] = 1;
+    }
+    segmentLayoutChanged = false;
   }
 
   bool Memory::checkIgnoreBreakPoint(uint16_t addr) const
@@ -375,20 +568,27 @@ namespace Ep128 {
     if (breakPointTable) {
       for (size_t i = 0; i < 65536; i++) {
         uint8_t bp = breakPointTable[i];
-        if (bp)
+        if (bp) {
           bplst.addMemoryBreakPoint(uint16_t(i),
                                     bool(bp & 1), bool(bp & 2), bool(bp & 4),
-                                    bool(bp & 32), bp >> 3);
+                                    bool(bp & 32), (bp & 63) >> 3,
+                                    breakPointConditions.getExpression(
+                                        uint32_t(i)));
+        }
       }
     }
     for (size_t j = 0; j < 256; j++) {
       if (segmentBreakPointTable[j]) {
         for (size_t i = 0; i < 16384; i++) {
           uint8_t bp = segmentBreakPointTable[j][i];
-          if (bp)
+          if (bp) {
             bplst.addMemoryBreakPoint(uint8_t(j), uint16_t(i),
                                       bool(bp & 1), bool(bp & 2), bool(bp & 4),
-                                      bool(bp & 32), bp >> 3);
+                                      bool(bp & 32), (bp & 63) >> 3,
+                                      breakPointConditions.getExpression(
+                                          0x01000000U | uint32_t(j << 14)
+                                          | uint32_t(i)));
+          }
         }
       }
     }
@@ -419,10 +619,51 @@ namespace Ep128 {
     }
   };
 
+  class ChunkType_MemoryDeltaSnapshot
+    : public Ep128Emu::File::ChunkTypeHandler {
+   private:
+    Memory& ref;
+   public:
+    ChunkType_MemoryDeltaSnapshot(Memory& ref_)
+      : Ep128Emu::File::ChunkTypeHandler(),
+        ref(ref_)
+    {
+    }
+    virtual ~ChunkType_MemoryDeltaSnapshot()
+    {
+    }
+    virtual Ep128Emu::File::ChunkType getChunkType() const
+    {
+      return Ep128Emu::File::EP128EMU_CHUNKTYPE_MEMORY_DELTA;
+    }
+    virtual void processChunk(Ep128Emu::File::Buffer& buf)
+    {
+      ref.loadStateDelta(buf);
+    }
+  };
+
   void Memory::saveState(Ep128Emu::File::Buffer& buf)
   {
+    this->saveState_(buf, (Ep128Emu::File *) 0);
+  }
+
+  void Memory::saveState_(Ep128Emu::File::Buffer& buf,
+                          Ep128Emu::File *romRefFile)
+  {
+    bool    romByReference = (romRefFile != (Ep128Emu::File *) 0);
     buf.setPosition(0);
-    buf.writeUInt32(0x01000000);        // version number
+    // version 0x01000001 is a checkpoint, and has an identifier;
+    // version 0x01000002 always has an identifier (0 if not a checkpoint),
+    // and may store shared ROM segments as a hash
+    if (romByReference) {
+      buf.writeUInt32(0x01000002);
+      buf.writeUInt32(checkpointID);
+    }
+    else {
+      buf.writeUInt32(checkpointID ? 0x01000001 : 0x01000000);
+      if (checkpointID)
+        buf.writeUInt32(checkpointID);
+    }
     buf.writeByte(pageTable[0]);
     buf.writeByte(pageTable[1]);
     buf.writeByte(pageTable[2]);
@@ -431,22 +672,175 @@ namespace Ep128 {
       for (size_t i = 0; i < 256; i++) {
         if (segmentTable[i] != (uint8_t *) 0) {
           buf.writeByte(uint8_t(i));
-          buf.writeBoolean(segmentROMTable[i]);
-          for (size_t j = 0; j < 16384; j++)
-            buf.writeByte(segmentTable[i][j]);
+          if (!romByReference) {
+            buf.writeBoolean(segmentROMTable[i]);
+            buf.writeData(segmentTable[i], 16384);
+            continue;
+          }
+          // segment type: 0 = RAM, 1 = ROM, 2 = shared ROM (hash only)
+          Ep128Emu::ROMStore::Hash  hash;
+          if (segmentSharedTable[i] &&
+              Ep128Emu::ROMStore::getSegmentHash(hash, segmentTable[i])) {
+            buf.writeByte(0x02);
+            buf.writeUInt32(uint32_t(hash.h1 >> 32));
+            buf.writeUInt32(uint32_t(hash.h1 & 0xFFFFFFFFUL));
+            buf.writeUInt32(uint32_t(hash.h2 >> 32));
+            buf.writeUInt32(uint32_t(hash.h2 & 0xFFFFFFFFUL));
+            romRefFile->addROMReference(segmentTable[i]);
+          }
+          else {
+            buf.writeByte(segmentROMTable[i] ? 0x01 : 0x00);
+            buf.writeData(segmentTable[i], 16384);
+          }
         }
       }
     }
   }
 
+  void Memory::saveStateDelta(Ep128Emu::File::Buffer& buf)
+  {
+    buf.setPosition(0);
+    buf.writeUInt32(0x01000000);        // version number
+    buf.writeUInt32(checkpointID);      // previous checkpoint
+    buf.writeUInt32(0U);                // new checkpoint (written later)
+    buf.writeByte(pageTable[0]);
+    buf.writeByte(pageTable[1]);
+    buf.writeByte(pageTable[2]);
+    buf.writeByte(pageTable[3]);
+    // segment layout as a bitmap of RAM segments
+    for (size_t i = 0; i < 256; i += 8) {
+      uint8_t tmp = 0;
+      for (size_t j = 0; j < 8; j++) {
+        if (isSegmentRAM(uint8_t(i + j)))
+          tmp = tmp | uint8_t(1 << j);
+      }
+      buf.writeByte(tmp);
+    }
+    for (size_t i = 0; i < 256; i++) {
+      if (segmentDirtyTable[i] && isSegmentRAM(uint8_t(i))) {
+        buf.writeByte(uint8_t(i));
+        buf.writeData(segmentTable[i], 16384);
+      }
+    }
+  }
+
   void Memory::saveState(Ep128Emu::File& f)
   {
     Ep128Emu::File::Buffer  buf;
-    this->saveState(buf);
-    f.addChunk(Ep128Emu::File::EP128EMU_CHUNKTYPE_MEMORY_STATE, buf);
+    if (!f.getIsCheckpoint()) {
+      // not a checkpoint: save full state, and leave change tracking alone
+      uint32_t  savedCheckpointID = checkpointID;
+      checkpointID = 0U;
+      this->saveState_(buf, (f.getIsROMReferenceMode() ?
+                             &f : (Ep128Emu::File *) 0));
+      checkpointID = savedCheckpointID;
+      f.addChunk(Ep128Emu::File::EP128EMU_CHUNKTYPE_MEMORY_STATE, buf);
+      return;
+    }
+    // generate identifier for the new checkpoint
+    uint32_t  newCheckpointID = checkpointID;
+    do {
+      newCheckpointID = (newCheckpointID * 0x9E3779B1U)
+                        ^ Ep128Emu::Timer::getRandomSeedFromTime();
+    } while (newCheckpointID == 0U || newCheckpointID == checkpointID);
+    if (f.getIsDeltaSnapshot() && checkpointID != 0U &&
+        !segmentLayoutChanged) {
+      this->saveStateDelta(buf);
+      buf.setPosition(8);
+      buf.writeUInt32(newCheckpointID);
+      f.addChunk(Ep128Emu::File::EP128EMU_CHUNKTYPE_MEMORY_DELTA, buf);
+    }
+    else {
+      // there is no usable previous checkpoint, save full state
+      checkpointID = newCheckpointID;
+      this->saveState_(buf, (f.getIsROMReferenceMode() ?
+                             &f : (Ep128Emu::File *) 0));
+      f.addChunk(Ep128Emu::File::EP128EMU_CHUNKTYPE_MEMORY_STATE, buf);
+    }
+    checkpointID = newCheckpointID;
+    clearDirtySegments();
   }
 
   void Memory::loadState(Ep128Emu::File::Buffer& buf)
+  {
+    buf.setPosition(0);
+    // check version number
+    unsigned int  version = buf.readUInt32();
+    if (!(version >= 0x01000000 && version <= 0x01000002)) {
+      buf.setPosition(buf.getDataSize());
+      throw Ep128Emu::Exception("incompatible memory snapshot format");
+    }
+    uint32_t  newCheckpointID = 0U;
+    if (version >= 0x01000001)
+      newCheckpointID = buf.readUInt32();
+    checkpointID = 0U;
+    // keep the current shared ROM segments in the store until the snapshot
+    // is loaded, since it may reference them
+    std::vector< const uint8_t * >  oldROMSegments;
+    oldROMSegments.reserve(252);
+    for (int i = 0; i < 252; i++) {
+      if (segmentSharedTable[i]) {
+        oldROMSegments.push_back(segmentTable[i]);
+        Ep128Emu::ROMStore::addReference(segmentTable[i]);
+      }
+    }
+    try {
+      // reset memory
+      deleteAllSegments();
+      setPage(0, 0x00);
+      setPage(1, 0x00);
+      setPage(2, 0x00);
+      setPage(3, 0x00);
+      // now load saved state
+      setPage(0, buf.readByte());
+      setPage(1, buf.readByte());
+      setPage(2, buf.readByte());
+      setPage(3, buf.readByte());
+      while (buf.getPosition() < buf.getDataSize()) {
+        uint8_t segment = buf.readByte();
+        bool    isROM = false;
+        if (version >= 0x01000002) {
+          uint8_t segmentType = buf.readByte();
+          if (segmentType == 0x02) {
+            Ep128Emu::ROMStore::Hash  hash;
+            hash.h1 = uint64_t(buf.readUInt32()) << 32;
+            hash.h1 = hash.h1 | uint64_t(buf.readUInt32());
+            hash.h2 = uint64_t(buf.readUInt32()) << 32;
+            hash.h2 = hash.h2 | uint64_t(buf.readUInt32());
+            const uint8_t *p = Ep128Emu::ROMStore::findSegment(hash);
+            if (!p) {
+              throw Ep128Emu::Exception("snapshot references a ROM segment "
+                                        "that is not loaded");
+            }
+            loadSharedROMSegment(segment, p);
+            continue;
+          }
+          if (segmentType > 0x01)
+            throw Ep128Emu::Exception("invalid memory snapshot data");
+          isROM = bool(segmentType);
+        }
+        else {
+          isROM = buf.readBoolean();
+        }
+        // allocate space
+        loadSegment(segment, false, (uint8_t *) 0, 0);
+        // set ROM flag and load data
+        allocateSegment(segment, isROM);
+        buf.readData(segmentTable[segment], 16384);
+      }
+    }
+    catch (...) {
+      for (size_t i = 0; i < oldROMSegments.size(); i++)
+        Ep128Emu::ROMStore::releaseSegment(oldROMSegments[i]);
+      throw;
+    }
+    for (size_t i = 0; i < oldROMSegments.size(); i++)
+      Ep128Emu::ROMStore::releaseSegment(oldROMSegments[i]);
+    checkpointID = newCheckpointID;
+    clearDirtySegments();
+  }
+
+  void Memory::loadStateDelta(Ep128Emu::File::Buffer& buf)
   {
     buf.setPosition(0);
     // check version number
@@ -455,26 +849,36 @@ namespace Ep128 {
       buf.setPosition(buf.getDataSize());
       throw Ep128Emu::Exception("incompatible memory snapshot format");
     }
-    // reset memory
-    deleteAllSegments();
-    setPage(0, 0x00);
-    setPage(1, 0x00);
-    setPage(2, 0x00);
-    setPage(3, 0x00);
-    // now load saved state
-    setPage(0, buf.readByte());
-    setPage(1, buf.readByte());
-    setPage(2, buf.readByte());
-    setPage(3, buf.readByte());
+    uint32_t  baseCheckpointID = buf.readUInt32();
+    uint32_t  newCheckpointID = buf.readUInt32();
+    bool      isValid = (baseCheckpointID != 0U &&
+                         baseCheckpointID == checkpointID);
+    uint8_t   p[4];
+    for (int i = 0; i < 4; i++)
+      p[i] = buf.readByte();
+    for (size_t i = 0; i < 256; i += 8) {
+      uint8_t tmp = buf.readByte();
+      for (size_t j = 0; j < 8; j++) {
+        if (isSegmentRAM(uint8_t(i + j)) != bool(tmp & (1 << j)))
+          isValid = false;
+      }
+    }
+    if (!isValid) {
+      buf.setPosition(buf.getDataSize());
+      throw Ep128Emu::Exception("delta snapshot does not match "
+                                "the current memory state");
+    }
+    checkpointID = 0U;
+    for (int i = 0; i < 4; i++)
+      setPage(uint8_t(i), p[i]);
     while (buf.getPosition() < buf.getDataSize()) {
       uint8_t segment = buf.readByte();
-      // allocate space
-      loadSegment(segment, false, (uint8_t *) 0, 0);
-      // set ROM flag and load data
-      allocateSegment(segment, buf.readBoolean());
-      for (size_t i = 0; i < 16384; i++)
-        segmentTable[segment][i] = buf.readByte();
+      if (!isSegmentRAM(segment))
+        throw Ep128Emu::Exception("invalid segment in delta snapshot");
+      buf.readData(segmentTable[segment], 16384);
     }
+    checkpointID = newCheckpointID;
+    clearDirtySegments();
   }
 
   void Memory::registerChunkType(Ep128Emu::File& f)
@@ -488,6 +892,15 @@ namespace Ep128 {
       delete p;
       throw;
     }
+    ChunkType_MemoryDeltaSnapshot *p2;
+    p2 = new ChunkType_MemoryDeltaSnapshot(*this);
+    try {
+      f.registerChunkType(p2);
+    }
+    catch (...) {
+      delete p2;
+      throw;
+    }
   }
 
 }       // namespace Ep128
@@ -22,6 +22,7 @@
 
 #include "ep128emu.hpp"
 #include "bplist.hpp"
+#include "bpcond.hpp"
 #ifdef ENABLE_SDEXT
 #  include "sdext.hpp"
 #endif
@@ -32,6 +33,9 @@ namespace Ep128 {
    private:
     uint8_t **segmentTable;
     bool    *segmentROMTable;
+    // true for ROM segments that are shared with other instances through
+    // Ep128Emu::ROMStore; these are copied on the first write
+    bool    *segmentSharedTable;
     uint8_t pageTable[4];
     uint8_t *breakPointTable;
     size_t  breakPointCnt;
@@ -39,24 +43,53 @@ namespace Ep128 {
     size_t  *segmentBreakPointCntTable;
     bool    haveBreakPoints;
     uint8_t breakPointPriorityThreshold;
+    // conditions of breakpoints that have bit 6 set in the breakpoint
+    // table, indexed by CPU address, or 0x01000000 + raw address for segments
+    Ep128Emu::BreakPointConditionTable  breakPointConditions;
     uint8_t *videoMemory;   // 64K for segments FC, FD, FE, and FF; always RAM
     uint8_t *dummyMemory;   // 2*16K dummy memory for invalid reads and writes
     uint8_t *pageAddressTableR[4];
     uint8_t *pageAddressTableW[4];
+    // same as pageAddressTableR and pageAddressTableW for pages that can
+    // be accessed directly without wait state or breakpoint checks (see
+    // getDirectReadTable()), NULL for all other pages
+    const uint8_t *directReadTable[4];
+    uint8_t *directWriteTable[4];
+    // non-zero for segments that may have been written since the last
+    // checkpoint; a RAM segment is marked when it is mapped to a page
+    uint8_t *segmentDirtyTable;
+    // identifies the state saved at the last checkpoint (0: none)
+    uint32_t checkpointID;
+    // true if segments were allocated or deleted since the last checkpoint
+    bool    segmentLayoutChanged;
 #ifdef ENABLE_SDEXT
     SDExt   *sdext;
 #endif
     void allocateSegment(uint8_t n, bool isROM);
+    void unshareSegment(uint8_t n);
+    void freeSegment(uint8_t n);
+    void clearDirtySegments();
+    void updateDirectAccessTables(uint8_t page);
+    void updateDirectAccessTables();
+    // if 'romRefFile' is not NULL, shared ROM segments are stored as a hash,
+    // and are kept in the ROM store while the file exists
+    void saveState_(Ep128Emu::File::Buffer&, Ep128Emu::File *romRefFile);
+    void saveStateDelta(Ep128Emu::File::Buffer&);
     void checkExecuteBreakPoint(uint16_t addr, uint8_t page, uint8_t value);
     void checkReadBreakPoint(uint16_t addr, uint8_t page, uint8_t value);
     void checkWriteBreakPoint(uint16_t addr, uint8_t page, uint8_t value);
+    bool checkBreakPointCondition(uint32_t n, uint16_t addr, uint8_t value);
    public:
     Memory();
     virtual ~Memory();
+    // if 'condition' is not empty, the breakpoint is only triggered if
+    // the expression evaluates to true (see bpcond.hpp)
     void setBreakPoint(uint8_t segment, uint16_t addr,
-                       int priority, bool r, bool w, bool x, bool ignoreFlag);
+                       int priority, bool r, bool w, bool x, bool ignoreFlag,
+                       const std::string& condition = std::string());
     void setBreakPoint(uint16_t addr,
-                       int priority, bool r, bool w, bool x, bool ignoreFlag);
+                       int priority, bool r, bool w, bool x, bool ignoreFlag,
+                       const std::string& condition = std::string());
     void clearBreakPoints(uint8_t segment);
     void clearBreakPoints();
     void clearAllBreakPoints();
@@ -64,6 +97,12 @@ namespace Ep128 {
     int getBreakPointPriorityThreshold();
     void loadSegment(uint8_t segment, bool isROM,
                      const uint8_t *data, size_t dataSize);
+    /*!
+     * Use the 16K segment 'data' returned by Ep128Emu::ROMStore as ROM
+     * at 'segment'; the reference to 'data' is owned by this object after
+     * the call.
+     */
+    void loadSharedROMSegment(uint8_t segment, const uint8_t *data);
     void deleteSegment(uint8_t segment);
     void deleteAllSegments();
     inline uint8_t read(uint16_t addr);
@@ -83,7 +122,34 @@ namespace Ep128 {
     void saveState(Ep128Emu::File::Buffer&);
     void saveState(Ep128Emu::File&);
     void loadState(Ep128Emu::File::Buffer&);
+    /*!
+     * Load delta snapshot created with Ep128Emu::File::setSnapshotMode().
+     * The current memory state must be the checkpoint that the delta was
+     * saved against.
+     */
+    void loadStateDelta(Ep128Emu::File::Buffer&);
     void registerChunkType(Ep128Emu::File&);
+    inline bool isSegmentDirty(uint8_t segment) const;
+    /*!
+     * Returns a table of 4 pointers that can be indexed with the CPU
+     * address to read memory or opcodes without calling read() or
+     * readOpcode(). An entry is NULL if the page is video memory or the
+     * SDExt segment, or if there are any breakpoints; read() and
+     * readOpcode() need to be used in this case.
+     * The table is updated by setPage() and the breakpoint functions.
+     */
+    inline const uint8_t * const * getDirectReadTable() const
+    {
+      return &(directReadTable[0]);
+    }
+    /*!
+     * Same as getDirectReadTable(), but for write(). Writes to ROM go to
+     * dummy memory.
+     */
+    inline uint8_t * const * getDirectWriteTable() const
+    {
+      return &(directWriteTable[0]);
+    }
 #ifdef ENABLE_SDEXT
     void setSDExtPtr(SDExt *p)
     {
@@ -92,6 +158,10 @@ namespace Ep128 {
 #endif
    protected:
     virtual void breakPointCallback(bool isWrite, uint16_t addr, uint8_t value);
+    // called on hitting a conditional breakpoint, before breakPointCallback()
+    // is called; should return true if the condition is met
+    virtual bool breakPointConditionCallback(
+        Ep128Emu::BreakPointCondition& cond, uint16_t addr, uint8_t value);
   };
 
   // --------------------------------------------------------------------------
@@ -170,8 +240,10 @@ namespace Ep128 {
     }
 #endif
     uint8_t segment = uint8_t(addr >> 14);
-    if (!segmentROMTable[segment])
+    if (!segmentROMTable[segment]) {
       segmentTable[segment][addr & 0x3FFF] = value;
+      segmentDirtyTable[segment] = 1;
+    }
   }
 
   inline void Memory::writeROM(uint32_t addr, uint8_t value)
@@ -183,8 +255,12 @@ namespace Ep128 {
     }
 #endif
     uint8_t segment = uint8_t(addr >> 14);
-    if (segmentTable[segment])
+    if (segmentTable[segment]) {
+      if (EP128EMU_UNLIKELY(segmentSharedTable[segment]))
+        unshareSegment(segment);
       segmentTable[segment][addr & 0x3FFF] = value;
+      segmentDirtyTable[segment] = 1;
+    }
   }
 
   inline uint8_t Memory::getPage(uint8_t page) const
@@ -209,6 +285,11 @@ namespace Ep128 {
             !segmentROMTable[segment]);
   }
 
+  inline bool Memory::isSegmentDirty(uint8_t segment) const
+  {
+    return bool(segmentDirtyTable[segment]);
+  }
+
 }       // namespace Ep128
 
 #endif  // EP128EMU_MEMORY_HPP
@@ -0,0 +1,212 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "perfcnt.hpp"
+
+#include <cstring>
+
+namespace Ep128Emu {
+
+  static const char *perfCounterNames[PerfCounters::nCounters] = {
+    "z80",
+    "nick",
+    "dave",
+    "devices",
+    "audioConverter",
+    "audioOutput",
+    "display",
+    "videoCapture",
+    "diskIO",
+    "tapeIO"
+  };
+
+  uint64_t PerfCounters::timeStampOverhead = 0U;
+
+  // the time stamp counter is calibrated against the real time elapsed
+  // since the program was started, so the result becomes more accurate
+  // over time
+  class PerfCounterCalibration {
+   public:
+    Timer     timer;
+    uint64_t  startTimeStamp;
+    PerfCounterCalibration()
+      : timer(),
+        startTimeStamp(PerfCounters::getTimeStamp())
+    {
+      // the shortest time measured between two reads of the time stamp
+      // counter is the overhead of an empty section
+      uint64_t  minTicks = 0U;
+      for (int i = 0; i < 1000; i++) {
+        uint64_t  t0 = PerfCounters::getTimeStamp();
+        uint64_t  t1 = PerfCounters::getTimeStamp();
+        if (i == 0 || (t1 - t0) < minTicks)
+          minTicks = t1 - t0;
+      }
+      PerfCounters::timeStampOverhead = minTicks;
+    }
+  };
+
+  static PerfCounterCalibration perfCounterCalibration;
+
+  // --------------------------------------------------------------------------
+
+  PerfCounters::Status::Status()
+    : elapsedTime(0.0)
+  {
+    for (int i = 0; i < nCounters; i++) {
+      time[i] = 0.0;
+      units[i] = 0U;
+    }
+  }
+
+  PerfCounters::PerfCounters()
+    : loopTicks(0U),
+      directTicks(0U),
+      resetTimeStamp(0U),
+      logFile((std::FILE *) 0),
+      logInterval(1.0),
+      logTime(0.0),
+      logNextTime(1.0),
+      logPrvStatus()
+  {
+    reset();
+  }
+
+  PerfCounters::~PerfCounters()
+  {
+    closeLog();
+  }
+
+  uint64_t PerfCounters::getTimeStamp_()
+  {
+    // fallback for platforms without a time stamp counter: nanoseconds
+    double  t = perfCounterCalibration.timer.getRealTime();
+    return uint64_t(t * 1000000000.0);
+  }
+
+  double PerfCounters::getSecondsPerTick()
+  {
+    uint64_t  n = getTimeStamp() - perfCounterCalibration.startTimeStamp;
+    double    t = perfCounterCalibration.timer.getRealTime();
+    if (int64_t(n) <= 0 || t < 0.001)
+      return 0.000000001;
+    return (t / double(int64_t(n)));
+  }
+
+  void PerfCounters::reset()
+  {
+    for (int i = 0; i < nCounters; i++) {
+      ticks[i] = 0U;
+      units[i] = 0U;
+      sampledTicks[i] = 0U;
+    }
+    loopTicks = 0U;
+    resetTimeStamp = getTimeStamp();
+    logPrvStatus = Status();
+  }
+
+  void PerfCounters::getStatus(Status& s) const
+  {
+    double  secondsPerTick = getSecondsPerTick();
+    double  sampledTotal = 0.0;
+    for (int i = 0; i < nCounters; i++)
+      sampledTotal += double(int64_t(sampledTicks[i]));
+    double  loopScale = 0.0;
+    if (sampledTotal > 0.0)
+      loopScale = double(int64_t(loopTicks)) * secondsPerTick / sampledTotal;
+    for (int i = 0; i < nCounters; i++) {
+      s.time[i] = double(int64_t(ticks[i])) * secondsPerTick
+                  + double(int64_t(sampledTicks[i])) * loopScale;
+      s.units[i] = units[i];
+    }
+#ifdef ENABLE_PERF_COUNTERS
+    s.elapsedTime =
+        double(int64_t(getTimeStamp() - resetTimeStamp)) * secondsPerTick;
+#else
+    s.elapsedTime = 0.0;
+#endif
+  }
+
+  const char * PerfCounters::getCounterName(int n)
+  {
+    if (n < 0 || n >= nCounters)
+      return (char *) 0;
+    return perfCounterNames[n];
+  }
+
+  int PerfCounters::findCounter(const char *name)
+  {
+    if (name) {
+      for (int i = 0; i < nCounters; i++) {
+        if (std::strcmp(name, perfCounterNames[i]) == 0)
+          return i;
+      }
+    }
+    return -1;
+  }
+
+  void PerfCounters::openLog(std::FILE *f, double interval)
+  {
+    closeLog();
+    if (!f)
+      return;
+    logFile = f;
+    logInterval = (interval > 0.001 ? interval : 0.001);
+    logTime = 0.0;
+    logNextTime = logInterval;
+    getStatus(logPrvStatus);
+    std::fprintf(logFile, "emulatedTime,realTime");
+    for (int i = 0; i < nCounters; i++) {
+      std::fprintf(logFile, ",%s_ms,%s_units",
+                   perfCounterNames[i], perfCounterNames[i]);
+    }
+    std::fprintf(logFile, "\n");
+  }
+
+  void PerfCounters::closeLog()
+  {
+    if (logFile) {
+      std::fclose(logFile);
+      logFile = (std::FILE *) 0;
+    }
+  }
+
+  void PerfCounters::writeLogLine(const Status& s)
+  {
+    std::fprintf(logFile, "%.3f,%.6f",
+                 logTime, s.elapsedTime - logPrvStatus.elapsedTime);
+    for (int i = 0; i < nCounters; i++) {
+      std::fprintf(logFile, ",%.3f,%lu",
+                   (s.time[i] - logPrvStatus.time[i]) * 1000.0,
+                   (unsigned long) (s.units[i] - logPrvStatus.units[i]));
+    }
+    if (std::fprintf(logFile, "\n") < 0) {
+      // stop logging on write errors (e.g. the disk is full)
+      closeLog();
+      return;
+    }
+    logPrvStatus = s;
+    while (logNextTime <= logTime)
+      logNextTime += logInterval;
+  }
+
+}       // namespace Ep128Emu
+
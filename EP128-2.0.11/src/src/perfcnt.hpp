@@ -0,0 +1,233 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_PERFCNT_HPP
+#define EP128EMU_PERFCNT_HPP
+
+#include "ep128emu.hpp"
+
+#include <cstdio>
+
+#if defined(ENABLE_PERF_COUNTERS) && defined(_MSC_VER) && \
+    (defined(_M_IX86) || defined(_M_X64))
+#  include <intrin.h>
+#endif
+
+namespace Ep128Emu {
+
+  // Host time spent in the subsystems of the emulated machine, measured
+  // with the time stamp counter of the CPU where available.
+  // The sections of the main emulation loop (Z80, NICK, DAVE, devices)
+  // are too short to be timed individually on every NICK slot, so only the
+  // total time of the loop is measured, and it is divided between the
+  // sections in proportion to their time on one slot out of every
+  // 'sampleInterval'. All other counters are timed directly on each call,
+  // at a granularity (block of audio samples, video line, I/O port access,
+  // tape sample) where reading the time stamp counter is cheap. Time spent
+  // in a directly timed subsystem is not included in the loop, or the
+  // section or other directly timed subsystem it was called from.
+  // If ENABLE_PERF_COUNTERS is not defined, all counters remain zero.
+
+  class PerfCounters {
+   public:
+    enum {
+      Z80 = 0,                  // Z80 emulation, including memory and I/O
+      NICK,                     // NICK emulation and video rendering
+      DAVE,                     // DAVE emulation
+      DEVICES,                  // events and per slot callbacks
+      AUDIO_CONVERTER,          // resampling and filtering of sound output
+      AUDIO_OUTPUT,             // queueing (or waiting) for audio output
+      DISPLAY,                  // queueing lines and frames for the display
+      VIDEO_CAPTURE,            // video capture (queueing to writer thread)
+      DISK_IO,                  // floppy and IDE drive I/O port accesses
+      TAPE_IO,                  // tape input and output
+      nCounters
+    };
+    // must be a power of two
+    static const uint32_t sampleInterval = 64U;
+    struct Sample {
+      uint64_t  t;
+      uint64_t  d;
+    };
+    struct Status {
+      // host time in seconds, and the number of units of work done (CPU or
+      // DAVE cycles, NICK slots, samples, lines, or I/O port accesses) for
+      // each subsystem since the counters were last reset
+      double    time[nCounters];
+      uint64_t  units[nCounters];
+      // real time in seconds elapsed since the counters were last reset
+      double    elapsedTime;
+      Status();
+    };
+   private:
+    friend class PerfCounterCalibration;
+    uint64_t  ticks[nCounters];
+    uint64_t  units[nCounters];
+    // time of the sampled sections, and of the whole loop
+    uint64_t  sampledTicks[nCounters];
+    uint64_t  loopTicks;
+    // total ticks of directly timed subsystems, used for excluding them
+    // from the sections they were called from
+    uint64_t  directTicks;
+    uint64_t  resetTimeStamp;
+    std::FILE *logFile;
+    double    logInterval;
+    double    logTime;
+    double    logNextTime;
+    Status    logPrvStatus;
+    // the cost of reading the time stamp counter, which is subtracted from
+    // each measurement
+    static uint64_t timeStampOverhead;
+    static uint64_t getTimeStamp_();
+    void writeLogLine(const Status& s);
+   public:
+    PerfCounters();
+    virtual ~PerfCounters();
+    // returns the current value of the time stamp counter
+    static EP128EMU_INLINE uint64_t getTimeStamp()
+    {
+#ifdef ENABLE_PERF_COUNTERS
+#  if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+      uint32_t  l, h;
+      __asm__ __volatile__ ("rdtsc" : "=a" (l), "=d" (h));
+      return (uint64_t(l) | (uint64_t(h) << 32));
+#  elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+      return uint64_t(__rdtsc());
+#  else
+      return getTimeStamp_();
+#  endif
+#else
+      return 0U;
+#endif
+    }
+    // returns the length of one time stamp counter tick in seconds
+    static double getSecondsPerTick();
+    // start timing a section
+    EP128EMU_INLINE void begin(Sample& s) const
+    {
+#ifdef ENABLE_PERF_COUNTERS
+      s.d = directTicks;
+      s.t = getTimeStamp();
+#else
+      (void) s;
+#endif
+    }
+    // add the time elapsed since begin(s) to counter 'n', excluding any
+    // directly timed subsystem called in the meantime
+    EP128EMU_INLINE void end(int n, const Sample& s, uint64_t units_ = 1U)
+    {
+#ifdef ENABLE_PERF_COUNTERS
+      uint64_t  t = (getTimeStamp() - s.t) - (directTicks - s.d);
+      if (int64_t(t) > int64_t(timeStampOverhead))
+        t -= timeStampOverhead;
+      else
+        t = 0U;
+      ticks[n] += t;
+      units[n] += units_;
+      directTicks += t;
+#else
+      (void) n;
+      (void) s;
+      (void) units_;
+#endif
+    }
+    // same as end(), but for sections timed on one NICK slot out of every
+    // 'sampleInterval'; 'units_' is scaled accordingly
+    EP128EMU_INLINE void endSampled(int n, const Sample& s, uint64_t units_)
+    {
+#ifdef ENABLE_PERF_COUNTERS
+      uint64_t  t = (getTimeStamp() - s.t) - (directTicks - s.d);
+      if (int64_t(t) > int64_t(timeStampOverhead))
+        t -= timeStampOverhead;
+      else
+        t = 0U;
+      sampledTicks[n] += t;
+      units[n] += (units_ * sampleInterval);
+#else
+      (void) n;
+      (void) s;
+      (void) units_;
+#endif
+    }
+    // times the scope it is declared in with begin() and end()
+    class Section {
+     private:
+      PerfCounters& perfCounters;
+      int     n;
+      Sample  s;
+     public:
+      EP128EMU_INLINE Section(PerfCounters& perfCounters_, int n_)
+        : perfCounters(perfCounters_),
+          n(n_)
+      {
+        perfCounters.begin(s);
+      }
+      EP128EMU_INLINE ~Section()
+      {
+        perfCounters.end(n, s);
+      }
+    };
+    // add the time elapsed since begin(s) to the total time of the main
+    // emulation loop that contains the sampled sections
+    EP128EMU_INLINE void endLoop(const Sample& s)
+    {
+#ifdef ENABLE_PERF_COUNTERS
+      loopTicks += ((getTimeStamp() - s.t) - (directTicks - s.d));
+#else
+      (void) s;
+#endif
+    }
+    // clear all counters
+    void reset();
+    void getStatus(Status& s) const;
+    // returns the name of counter 'n' (e.g. "z80", "nick", "diskIO"), or
+    // NULL if 'n' is out of range
+    static const char *getCounterName(int n);
+    // returns the index of the counter with the specified name, or -1
+    static int findCounter(const char *name);
+    // Write the counters to 'f' in CSV format every 'interval' seconds of
+    // emulated time. The first line contains the column names, then each
+    // line contains the emulated and real time, and the host time in
+    // milliseconds and the units of work of each counter in that interval.
+    // The file is closed by this object, either by closeLog(), or on
+    // destruction.
+    void openLog(std::FILE *f, double interval = 1.0);
+    void closeLog();
+    inline bool isLogOpen() const
+    {
+      return (logFile != (std::FILE *) 0);
+    }
+    // should be called after running 't' seconds of emulated time
+    inline void updateLog(double t)
+    {
+      if (logFile) {
+        logTime += t;
+        if (logTime >= logNextTime) {
+          Status  tmp;
+          getStatus(tmp);
+          writeLogLine(tmp);
+        }
+      }
+    }
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_PERFCNT_HPP
+
@@ -0,0 +1,136 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "fileio.hpp"
+#include "vm.hpp"
+#include "rewind.hpp"
+
+namespace Ep128Emu {
+
+  RewindBuffer::RewindBuffer(VirtualMachine& vm_,
+                             size_t memoryLimit_, int keyFrameInterval_)
+    : vm(vm_),
+      memoryUsed(0),
+      memoryLimit(memoryLimit_),
+      keyFrameInterval(keyFrameInterval_ > 1 ? keyFrameInterval_ : 1),
+      deltaCnt(0)
+  {
+  }
+
+  RewindBuffer::~RewindBuffer()
+  {
+    clear();
+  }
+
+  void RewindBuffer::removeOldestKeyFrame()
+  {
+    size_t  n = 1;
+    while (n < checkpoints.size() && !checkpoints[n].isKeyFrame)
+      n++;
+    for (size_t i = 0; i < n; i++) {
+      memoryUsed -= checkpoints[i].dataSize;
+      delete checkpoints[i].f;
+    }
+    checkpoints.erase(checkpoints.begin(), checkpoints.begin() + n);
+  }
+
+  void RewindBuffer::limitMemoryUsage()
+  {
+    while (memoryUsed > memoryLimit && checkpoints.size() > 0) {
+      size_t  i = 1;
+      while (i < checkpoints.size() && !checkpoints[i].isKeyFrame)
+        i++;
+      if (i >= checkpoints.size()) {
+        // the oldest key frame is the only one, and it cannot be removed
+        // until a new one is saved
+        deltaCnt = keyFrameInterval;
+        break;
+      }
+      removeOldestKeyFrame();
+    }
+  }
+
+  void RewindBuffer::checkpoint()
+  {
+    Checkpoint  c;
+    c.isKeyFrame = (checkpoints.size() < 1 || deltaCnt >= keyFrameInterval);
+    c.f = new File();
+    try {
+      c.f->setSnapshotMode(true, !c.isKeyFrame);
+      vm.saveState(*(c.f));
+      c.f->addEndOfFileChunk();
+      c.dataSize = c.f->getBufferDataSize();
+      checkpoints.push_back(c);
+    }
+    catch (...) {
+      delete c.f;
+      // the next checkpoint cannot be a delta
+      deltaCnt = keyFrameInterval;
+      throw;
+    }
+    memoryUsed += c.dataSize;
+    deltaCnt = (c.isKeyFrame ? 0 : (deltaCnt + 1));
+    limitMemoryUsage();
+  }
+
+  bool RewindBuffer::rewind(size_t n)
+  {
+    if (n >= checkpoints.size())
+      return false;
+    size_t  lastPos = checkpoints.size() - (n + 1);
+    size_t  firstPos = lastPos;
+    while (firstPos > 0 && !checkpoints[firstPos].isKeyFrame)
+      firstPos--;
+    try {
+      // load the key frame, and apply all deltas up to the selected one
+      for (size_t i = firstPos; i <= lastPos; i++) {
+        vm.registerChunkTypes(*(checkpoints[i].f));
+        checkpoints[i].f->processAllChunks();
+      }
+    }
+    catch (...) {
+      clear();
+      throw;
+    }
+    deltaCnt = int(lastPos - firstPos);
+    while (checkpoints.size() > (lastPos + 1)) {
+      memoryUsed -= checkpoints.back().dataSize;
+      delete checkpoints.back().f;
+      checkpoints.pop_back();
+    }
+    return true;
+  }
+
+  void RewindBuffer::clear()
+  {
+    for (size_t i = 0; i < checkpoints.size(); i++)
+      delete checkpoints[i].f;
+    checkpoints.clear();
+    memoryUsed = 0;
+    deltaCnt = 0;
+  }
+
+  void RewindBuffer::setMemoryLimit(size_t n)
+  {
+    memoryLimit = n;
+    limitMemoryUsage();
+  }
+
+}       // namespace Ep128Emu
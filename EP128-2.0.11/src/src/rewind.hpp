@@ -0,0 +1,90 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_REWIND_HPP
+#define EP128EMU_REWIND_HPP
+
+#include "ep128emu.hpp"
+#include "fileio.hpp"
+#include "vm.hpp"
+
+#include <vector>
+
+namespace Ep128Emu {
+
+  /*!
+   * In-memory ring of snapshots of the virtual machine state, for rewinding
+   * emulation. Every 'keyFrameInterval'th checkpoint is a full snapshot,
+   * the others are delta snapshots that only store the RAM segments which
+   * were written since the previous checkpoint. When the memory limit is
+   * exceeded, the oldest key frame is discarded together with the deltas
+   * that depend on it.
+   */
+  class RewindBuffer {
+   private:
+    struct Checkpoint {
+      File    *f;
+      size_t  dataSize;
+      bool    isKeyFrame;
+    };
+    VirtualMachine& vm;
+    std::vector< Checkpoint > checkpoints;      // oldest first
+    size_t  memoryUsed;
+    size_t  memoryLimit;
+    int     keyFrameInterval;
+    int     deltaCnt;           // number of checkpoints since last key frame
+    void removeOldestKeyFrame();
+    void limitMemoryUsage();
+   public:
+    RewindBuffer(VirtualMachine& vm_,
+                 size_t memoryLimit_ = 16777216, int keyFrameInterval_ = 16);
+    virtual ~RewindBuffer();
+    /*!
+     * Save the current state of the virtual machine as a new checkpoint.
+     */
+    void checkpoint();
+    /*!
+     * Restore the state saved 'n' checkpoints before the most recent one
+     * (n = 0 restores the last checkpoint). All checkpoints newer than the
+     * restored one are discarded. Returns false if there is no such
+     * checkpoint. On error, an exception is thrown, and the buffer is
+     * cleared.
+     */
+    bool rewind(size_t n = 0);
+    /*!
+     * Delete all checkpoints.
+     */
+    void clear();
+    /*!
+     * Set the maximum amount of memory (in bytes) used by the snapshot data.
+     */
+    void setMemoryLimit(size_t n);
+    inline size_t getCheckpointCount() const
+    {
+      return checkpoints.size();
+    }
+    inline size_t getMemoryUsage() const
+    {
+      return memoryUsed;
+    }
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_REWIND_HPP
@@ -0,0 +1,393 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "romstore.hpp"
+
+#include <map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef WIN32
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace Ep128Emu {
+
+  struct ROMStoreEntry {
+    ROMStore::Hash  hash;
+    uint8_t   *data;
+    long      refCnt;
+    bool      isMapped;         // true if 'data' is mapped with mmap()
+    bool      isInHashTable;    // false if there was a hash collision
+  };
+
+  // ROM image file segments loaded with addFileSegment(), which can be
+  // loaded again by findSegment() if the file has not changed
+  struct ROMStoreFileSource {
+    int64_t   fileSize;
+    int64_t   modTime;
+    ROMStore::Hash  hash;
+  };
+
+  static Mutex  romStoreMutex;
+  static std::map< ROMStore::Hash, ROMStoreEntry * >  romStoreHashTable;
+  static std::map< const uint8_t *, ROMStoreEntry * > romStoreAddrTable;
+  static std::map< std::pair< std::string, size_t >, ROMStoreFileSource >
+      romStoreFileSources;
+  static bool   romStoreMapEnabled = false;
+
+  static bool getROMFileInfo(const char *fileName,
+                             int64_t& fileSize, int64_t& modTime)
+  {
+#ifndef WIN32
+    struct stat   st;
+    std::memset(&st, 0, sizeof(struct stat));
+    if (stat(fileName, &st) != 0 || !S_ISREG(st.st_mode))
+      return false;
+#else
+    struct _stat  st;
+    std::memset(&st, 0, sizeof(struct _stat));
+    if (fileStat(fileName, &st) != 0 || !(st.st_mode & _S_IFREG))
+      return false;
+#endif
+    fileSize = int64_t(st.st_size);
+    modTime = int64_t(st.st_mtime);
+    return true;
+  }
+
+  static void freeROMStoreEntry(ROMStoreEntry *e)
+  {
+#ifndef WIN32
+    if (e->isMapped) {
+      (void) munmap(e->data, ROMStore::segmentSize);
+      delete e;
+      return;
+    }
+#endif
+    delete[] e->data;
+    delete e;
+  }
+
+  // add segment to the store, with the mutex already locked; if 'isMapped'
+  // is true, 'data' was mapped with mmap(), and is either stored, or unmapped
+  // if an identical segment already exists
+
+  static const uint8_t * addSegment_(uint8_t *data, bool isMapped)
+  {
+    ROMStore::Hash  hash = ROMStore::calculateHash(data);
+    ROMStoreEntry   *e = (ROMStoreEntry *) 0;
+    std::map< ROMStore::Hash, ROMStoreEntry * >::iterator i =
+        romStoreHashTable.find(hash);
+    if (i != romStoreHashTable.end()) {
+      if (std::memcmp((*i).second->data, data, ROMStore::segmentSize) == 0) {
+        e = (*i).second;
+        e->refCnt++;
+#ifndef WIN32
+        if (isMapped)
+          (void) munmap(data, ROMStore::segmentSize);
+#endif
+        return e->data;
+      }
+    }
+    try {
+      e = new ROMStoreEntry;
+      e->hash = hash;
+      e->data = (uint8_t *) 0;
+      e->refCnt = 1L;
+      e->isMapped = isMapped;
+      e->isInHashTable = (i == romStoreHashTable.end());
+      if (isMapped) {
+        e->data = data;
+      }
+      else {
+        e->data = new uint8_t[ROMStore::segmentSize];
+        std::memcpy(e->data, data, ROMStore::segmentSize);
+      }
+      romStoreAddrTable.insert(
+          std::pair< const uint8_t *, ROMStoreEntry * >(e->data, e));
+    }
+    catch (...) {
+      if (e) {
+        if (e->data)
+          freeROMStoreEntry(e);
+        else
+          delete e;
+      }
+#ifndef WIN32
+      else if (isMapped) {
+        (void) munmap(data, ROMStore::segmentSize);
+      }
+#endif
+      throw;
+    }
+    if (e->isInHashTable) {
+      try {
+        romStoreHashTable.insert(
+            std::pair< ROMStore::Hash, ROMStoreEntry * >(hash, e));
+      }
+      catch (...) {
+        e->isInHashTable = false;
+      }
+    }
+    return e->data;
+  }
+
+  static const uint8_t * addFileSegment_(const char *fileName, size_t offs,
+                                         int64_t fileSize, int64_t modTime)
+  {
+    std::FILE *f = fileOpen(fileName, "rb");
+    if (!f)
+      throw Exception("cannot open ROM file");
+    const uint8_t *p = (uint8_t *) 0;
+    try {
+#ifndef WIN32
+      long    pageSize = sysconf(_SC_PAGESIZE);
+      if (romStoreMapEnabled &&
+          pageSize > 0L && (offs % size_t(pageSize)) == 0) {
+        void    *mappedData =
+            mmap((void *) 0, ROMStore::segmentSize, PROT_READ, MAP_PRIVATE,
+                 fileno(f), off_t(offs));
+        if (mappedData != MAP_FAILED)
+          p = addSegment_(reinterpret_cast< uint8_t * >(mappedData), true);
+      }
+#endif
+      if (!p) {
+        uint8_t tmpBuf[ROMStore::segmentSize];
+        if (std::fseek(f, long(offs), SEEK_SET) != 0 ||
+            std::fread(&(tmpBuf[0]), sizeof(uint8_t), ROMStore::segmentSize,
+                       f) != ROMStore::segmentSize) {
+          throw Exception("error reading ROM file");
+        }
+        p = addSegment_(&(tmpBuf[0]), false);
+      }
+    }
+    catch (...) {
+      std::fclose(f);
+      throw;
+    }
+    std::fclose(f);
+    try {
+      std::pair< std::string, size_t >  key(fileName, offs);
+      ROMStoreFileSource& s = romStoreFileSources[key];
+      s.fileSize = fileSize;
+      s.modTime = modTime;
+      s.hash = romStoreAddrTable[p]->hash;
+    }
+    catch (...) {
+    }
+    return p;
+  }
+
+  // --------------------------------------------------------------------------
+
+  ROMStore::Hash ROMStore::calculateHash(const uint8_t *data)
+  {
+    // two independent 64-bit hashes: FNV-1a, and a multiplicative hash
+    const uint64_t  fnvPrime = (uint64_t(0x00000100UL) << 32) | 0x000001B3UL;
+    const uint64_t  goldenRatio =
+        (uint64_t(0x9E3779B9UL) << 32) | 0x7F4A7C15UL;
+    uint64_t  h1 = (uint64_t(0xCBF29CE4UL) << 32) | 0x84222325UL;
+    uint64_t  h2 = (uint64_t(0x6A09E667UL) << 32) | 0xF3BCC909UL;
+    for (size_t i = 0; i < segmentSize; i++) {
+      h1 = (h1 ^ uint64_t(data[i])) * fnvPrime;
+      h2 = (h2 + uint64_t(data[i]) + 1U) * goldenRatio;
+      h2 = h2 ^ (h2 >> 29);
+    }
+    Hash    hash;
+    hash.h1 = h1;
+    hash.h2 = h2;
+    return hash;
+  }
+
+  const uint8_t * ROMStore::addSegment(const uint8_t *data)
+  {
+    romStoreMutex.lock();
+    try {
+      const uint8_t *p = addSegment_(const_cast< uint8_t * >(data), false);
+      romStoreMutex.unlock();
+      return p;
+    }
+    catch (...) {
+      romStoreMutex.unlock();
+      throw;
+    }
+  }
+
+  const uint8_t * ROMStore::addFileSegment(const char *fileName, size_t offs)
+  {
+    if (fileName == (char *) 0 || fileName[0] == '\0')
+      throw Exception("cannot open ROM file");
+    int64_t fileSize = 0;
+    int64_t modTime = 0;
+    if (!getROMFileInfo(fileName, fileSize, modTime))
+      throw Exception("cannot open ROM file");
+    if (fileSize < int64_t(offs + segmentSize))
+      return (uint8_t *) 0;
+    romStoreMutex.lock();
+    try {
+      // if the same file segment was already loaded, and the file has not
+      // changed, there is no need to read it again
+      std::map< std::pair< std::string, size_t >, ROMStoreFileSource >::
+          iterator  i = romStoreFileSources.find(
+                            std::pair< std::string, size_t >(fileName, offs));
+      if (i != romStoreFileSources.end() &&
+          (*i).second.fileSize == fileSize && (*i).second.modTime == modTime) {
+        std::map< Hash, ROMStoreEntry * >::iterator j =
+            romStoreHashTable.find((*i).second.hash);
+        if (j != romStoreHashTable.end()) {
+          (*j).second->refCnt++;
+          romStoreMutex.unlock();
+          return (*j).second->data;
+        }
+      }
+      const uint8_t *p = addFileSegment_(fileName, offs, fileSize, modTime);
+      romStoreMutex.unlock();
+      return p;
+    }
+    catch (...) {
+      romStoreMutex.unlock();
+      throw;
+    }
+  }
+
+  const uint8_t * ROMStore::findSegment(const Hash& hash)
+  {
+    romStoreMutex.lock();
+    std::map< Hash, ROMStoreEntry * >::iterator i =
+        romStoreHashTable.find(hash);
+    if (i != romStoreHashTable.end()) {
+      (*i).second->refCnt++;
+      romStoreMutex.unlock();
+      return (*i).second->data;
+    }
+    // not in the store, try to load it from a file
+    std::map< std::pair< std::string, size_t >, ROMStoreFileSource >::
+        iterator  j;
+    for (j = romStoreFileSources.begin(); j != romStoreFileSources.end();
+         j++) {
+      if (!((*j).second.hash == hash))
+        continue;
+      const std::string&  fileName = (*j).first.first;
+      int64_t fileSize = 0;
+      int64_t modTime = 0;
+      if (!getROMFileInfo(fileName.c_str(), fileSize, modTime) ||
+          fileSize != (*j).second.fileSize || modTime != (*j).second.modTime) {
+        continue;
+      }
+      try {
+        const uint8_t *p = addFileSegment_(fileName.c_str(), (*j).first.second,
+                                           fileSize, modTime);
+        std::map< const uint8_t *, ROMStoreEntry * >::iterator  k =
+            romStoreAddrTable.find(p);
+        if ((*k).second->hash == hash) {
+          romStoreMutex.unlock();
+          return p;
+        }
+        if (--((*k).second->refCnt) <= 0L) {
+          if ((*k).second->isInHashTable)
+            romStoreHashTable.erase((*k).second->hash);
+          freeROMStoreEntry((*k).second);
+          romStoreAddrTable.erase(k);
+        }
+      }
+      catch (...) {
+      }
+      break;
+    }
+    romStoreMutex.unlock();
+    return (uint8_t *) 0;
+  }
+
+  void ROMStore::addReference(const uint8_t *p)
+  {
+    romStoreMutex.lock();
+    std::map< const uint8_t *, ROMStoreEntry * >::iterator  i =
+        romStoreAddrTable.find(p);
+    if (i != romStoreAddrTable.end())
+      (*i).second->refCnt++;
+    romStoreMutex.unlock();
+  }
+
+  void ROMStore::releaseSegment(const uint8_t *p)
+  {
+    romStoreMutex.lock();
+    std::map< const uint8_t *, ROMStoreEntry * >::iterator  i =
+        romStoreAddrTable.find(p);
+    if (i != romStoreAddrTable.end()) {
+      ROMStoreEntry *e = (*i).second;
+      if (--(e->refCnt) <= 0L) {
+        if (e->isInHashTable)
+          romStoreHashTable.erase(e->hash);
+        romStoreAddrTable.erase(i);
+        freeROMStoreEntry(e);
+      }
+    }
+    romStoreMutex.unlock();
+  }
+
+  bool ROMStore::getSegmentHash(Hash& hash, const uint8_t *p)
+  {
+    bool    retval = false;
+    romStoreMutex.lock();
+    std::map< const uint8_t *, ROMStoreEntry * >::iterator  i =
+        romStoreAddrTable.find(p);
+    if (i != romStoreAddrTable.end()) {
+      // segments with colliding hashes cannot be found by findSegment()
+      if ((*i).second->isInHashTable) {
+        hash = (*i).second->hash;
+        retval = true;
+      }
+    }
+    romStoreMutex.unlock();
+    return retval;
+  }
+
+  bool ROMStore::isSharedSegment(const uint8_t *p)
+  {
+    romStoreMutex.lock();
+    bool    retval = (romStoreAddrTable.find(p) != romStoreAddrTable.end());
+    romStoreMutex.unlock();
+    return retval;
+  }
+
+  void ROMStore::setMemoryMapEnabled(bool isEnabled)
+  {
+    romStoreMutex.lock();
+    romStoreMapEnabled = isEnabled;
+    romStoreMutex.unlock();
+  }
+
+  void ROMStore::getStatistics(size_t& nSegments, size_t& nBytesAllocated)
+  {
+    romStoreMutex.lock();
+    nSegments = romStoreAddrTable.size();
+    nBytesAllocated = 0;
+    std::map< const uint8_t *, ROMStoreEntry * >::iterator  i;
+    for (i = romStoreAddrTable.begin(); i != romStoreAddrTable.end(); i++) {
+      if (!(*i).second->isMapped)
+        nBytesAllocated += segmentSize;
+    }
+    romStoreMutex.unlock();
+  }
+
+}       // namespace Ep128Emu
+
@@ -0,0 +1,93 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_ROMSTORE_HPP
+#define EP128EMU_ROMSTORE_HPP
+
+#include "ep128emu.hpp"
+
+namespace Ep128Emu {
+
+  // Process-wide store of read-only 16K ROM segments. Segments with the same
+  // contents are stored only once, and are shared by all machines that use
+  // them; a segment is freed when its reference count drops to zero.
+  // Segments are identified by a 128-bit hash of their contents, which can
+  // be stored in snapshots instead of the data.
+  // All functions are thread-safe.
+
+  class ROMStore {
+   public:
+    static const size_t segmentSize = 16384;
+    struct Hash {
+      uint64_t  h1;
+      uint64_t  h2;
+      Hash()
+        : h1(0U),
+          h2(0U)
+      {
+      }
+      inline bool operator<(const Hash& r) const
+      {
+        return (h1 < r.h1 || (h1 == r.h1 && h2 < r.h2));
+      }
+      inline bool operator==(const Hash& r) const
+      {
+        return (h1 == r.h1 && h2 == r.h2);
+      }
+    };
+    static Hash calculateHash(const uint8_t *data);
+    // Returns a shared copy of the 16K segment at 'data', and increments
+    // its reference count.
+    static const uint8_t * addSegment(const uint8_t *data);
+    // Returns the 16K segment at offset 'offs' of ROM image file 'fileName',
+    // and increments its reference count. The segment is memory mapped from
+    // the file if this is enabled with setMemoryMapEnabled() and possible,
+    // otherwise it is read into memory. NULL is returned if the file is
+    // shorter than offs + 16K bytes, and Ep128Emu::Exception is thrown if the
+    // file cannot be opened or read.
+    static const uint8_t * addFileSegment(const char *fileName, size_t offs);
+    // Returns the segment identified by 'hash', and increments its reference
+    // count. If the segment is not in the store, but it was previously
+    // loaded from a file that has not changed since then, it is loaded
+    // again. Otherwise, NULL is returned.
+    static const uint8_t * findSegment(const Hash& hash);
+    // Increment the reference count of segment 'p' (returned by one of the
+    // functions above).
+    static void addReference(const uint8_t *p);
+    // Decrement the reference count of segment 'p', and free it if it is
+    // not used anymore.
+    static void releaseSegment(const uint8_t *p);
+    // Store the hash of segment 'p' in 'hash'; returns false if 'p' is not
+    // in the store.
+    static bool getSegmentHash(Hash& hash, const uint8_t *p);
+    // Returns true if 'p' is a segment in the store.
+    static bool isSharedSegment(const uint8_t *p);
+    // If enabled, addFileSegment() maps the file into memory with mmap()
+    // where supported, so that the data is shared with the page cache and
+    // other processes using the same ROM files. The default is disabled.
+    static void setMemoryMapEnabled(bool isEnabled);
+    // Returns the number of segments and total bytes of memory allocated
+    // (memory mapped segments are not included in the latter).
+    static void getStatistics(size_t& nSegments, size_t& nBytesAllocated);
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_ROMSTORE_HPP
+
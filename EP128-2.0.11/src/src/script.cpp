@@ -24,6 +24,8 @@
 #include "script.hpp"
 #include "debuglib.hpp"
 
+#include <cstring>
+
 #ifdef HAVE_LUA_H
 extern "C" {
 #  include "lua.h"
@@ -1483,6 +1485,50 @@ namespace Ep128Emu {
     return 0;
   }
 
+  int LuaScript::luaFunc_getPerfCounter(lua_State *lst)
+  {
+    LuaScript&  this_ =
+        *(reinterpret_cast<LuaScript *>(lua_touserdata(lst,
+                                                       lua_upvalueindex(1))));
+    if (lua_gettop(lst) != 1) {
+      this_.luaError("invalid number of arguments for getPerfCounter()");
+      return 0;
+    }
+    if (!lua_isstring(lst, 1)) {
+      this_.luaError("invalid argument type for getPerfCounter()");
+      return 0;
+    }
+    PerfCounters::Status  tmp;
+    this_.vm.getPerfCounters(tmp);
+    const char  *s = lua_tolstring(lst, 1, (size_t *) 0);
+    if (std::strcmp(s, "elapsed") == 0) {
+      lua_pushnumber(lst, lua_Number(tmp.elapsedTime));
+      lua_pushinteger(lst, lua_Integer(0));
+      return 2;
+    }
+    int     n = PerfCounters::findCounter(s);
+    if (n < 0) {
+      this_.luaError("invalid counter name for getPerfCounter()");
+      return 0;
+    }
+    lua_pushnumber(lst, lua_Number(tmp.time[n]));
+    lua_pushnumber(lst, lua_Number(double(int64_t(tmp.units[n]))));
+    return 2;
+  }
+
+  int LuaScript::luaFunc_resetPerfCounters(lua_State *lst)
+  {
+    LuaScript&  this_ =
+        *(reinterpret_cast<LuaScript *>(lua_touserdata(lst,
+                                                       lua_upvalueindex(1))));
+    if (lua_gettop(lst) != 0) {
+      this_.luaError("invalid number of arguments for resetPerfCounters()");
+      return 0;
+    }
+    this_.vm.resetPerfCounters();
+    return 0;
+  }
+
 #endif  // HAVE_LUA_H
 
   // --------------------------------------------------------------------------
@@ -1663,6 +1709,8 @@ namespace Ep128Emu {
     registerLuaFunction(&luaFunc_saveMemory, "saveMemory");
     registerLuaFunction(&luaFunc_loadROMSegment, "loadROMSegment");
     registerLuaFunction(&luaFunc_mprint, "mprint");
+    registerLuaFunction(&luaFunc_getPerfCounter, "getPerfCounter");
+    registerLuaFunction(&luaFunc_resetPerfCounters, "resetPerfCounters");
     err = lua_pcall(luaState, 0, 0, 0);
     if (err != 0) {
       messageCallback(lua_tolstring(luaState, -1, (size_t *) 0));
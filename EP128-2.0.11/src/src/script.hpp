@@ -122,6 +122,8 @@ namespace Ep128Emu {
     static int luaFunc_saveMemory(lua_State *lst);
     static int luaFunc_loadROMSegment(lua_State *lst);
     static int luaFunc_mprint(lua_State *lst);
+    static int luaFunc_getPerfCounter(lua_State *lst);
+    static int luaFunc_resetPerfCounters(lua_State *lst);
     void registerLuaFunction(lua_CFunction f, const char *name);
     bool runBreakPointCallback_(int type, uint16_t addr, uint8_t value);
     void luaError(const char *msg);
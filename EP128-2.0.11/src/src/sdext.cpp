@@ -103,6 +103,11 @@ namespace Ep128 {
       sdfno(-1),
       sd_card_size(0U),
       sd_card_pos(0U),
+      readCachePos(0U),
+      readCacheSize(0U),
+      nextReadPos(0xFFFFFFFFU),
+      writeCachePos(0U),
+      writeCacheSize(0U),
       romFileName(""),
       romFileWriteProtected(false),
       romDataChanged(false),
@@ -112,6 +117,8 @@ namespace Ep128 {
     sd_ram_ext.resize(0x00001C00, 0xFF);
     sd_rom_ext.resize(0x00010000, 0xFF);
     _buffer.resize(1024, 0x00);
+    readCache.resize(0x00010000, 0x00);
+    writeCache.resize(0x00010000, 0x00);
     this->reset(1);
   }
 
@@ -172,11 +179,17 @@ namespace Ep128 {
   {
     serialNum = 0U;
     writeProtectFlag = true;
-    if (sdf)
+    if (sdf) {
+      // FIXME: errors are ignored here
+      (void) flushWriteCache();
       std::fclose(sdf);
+    }
     sdf = NULL;
     sdfno = -1;
     sd_card_size = 0U;
+    readCacheSize = 0U;
+    nextReadPos = 0xFFFFFFFFU;
+    writeCacheSize = 0U;
     this->reset(1);
     if (!sdimg_path || sdimg_path[0] == '\0')
       return;
@@ -284,6 +297,84 @@ namespace Ep128 {
     return all;
   }
 
+  static bool safe_write(int fd, const uint8_t *buffer, int size)
+  {
+    while (size) {
+      int ret = write(fd, buffer, size);
+      if (ret <= 0)
+        return false;
+      size -= ret;
+      buffer += ret;
+    }
+    return true;
+  }
+
+  bool SDExt::readBlock(uint8_t *buf, uint32_t pos)
+  {
+    if (readCacheSize < 512U || pos < readCachePos ||
+        (pos - readCachePos) > (readCacheSize - 512U)) {
+      // cache miss: read 4K, or 64K if the access is sequential (e.g. CMD18,
+      // or CMD17 continuing after the previous block)
+      if (!flushWriteCache())
+        return false;
+      uint32_t  nBytes = (pos == nextReadPos ?
+                          uint32_t(readCache.size()) : 0x1000U);
+      nBytes = (nBytes < (sd_card_size - pos) ? nBytes : (sd_card_size - pos));
+      readCachePos = pos;
+      readCacheSize = 0U;
+      if (lseek(sdfno, off_t(pos), SEEK_SET) != off_t(pos))
+        return false;
+      int     n = safe_read(sdfno, &(readCache.front()), int(nBytes));
+      if (n < 512)
+        return false;
+      readCacheSize = uint32_t(n);
+    }
+    std::memcpy(buf, &(readCache[pos - readCachePos]), 512);
+    nextReadPos = pos + 512U;
+    return true;
+  }
+
+  bool SDExt::writeBlock(const uint8_t *buf, uint32_t pos)
+  {
+    if (writeCacheSize > 0U) {
+      if (pos != (writeCachePos + writeCacheSize) ||
+          writeCacheSize >= uint32_t(writeCache.size())) {
+        if (!flushWriteCache())
+          return false;
+      }
+    }
+    if (writeCacheSize == 0U)
+      writeCachePos = pos;
+    std::memcpy(&(writeCache[writeCacheSize]), buf, 512);
+    writeCacheSize = writeCacheSize + 512U;
+    // keep the read cache up to date
+    uint32_t  startPos = (pos > readCachePos ? pos : readCachePos);
+    uint32_t  endPos = readCachePos + readCacheSize;
+    endPos = ((pos + 512U) < endPos ? (pos + 512U) : endPos);
+    if (startPos < endPos) {
+      std::memcpy(&(readCache[startPos - readCachePos]),
+                  buf + (startPos - pos), endPos - startPos);
+    }
+    return true;
+  }
+
+  bool SDExt::flushWriteCache()
+  {
+    if (writeCacheSize < 1U)
+      return true;
+    uint32_t  nBytes = writeCacheSize;
+    writeCacheSize = 0U;
+    return (lseek(sdfno, off_t(writeCachePos), SEEK_SET)
+            == off_t(writeCachePos) &&
+            safe_write(sdfno, &(writeCache.front()), int(nBytes)));
+  }
+
+  void SDExt::flushImage()
+  {
+    if (!flushWriteCache())
+      throw Ep128Emu::Exception("error writing SD card image file");
+  }
+
   void SDExt::_block_read()
   {
     uint8_t *bufp = &(_buffer.front());
@@ -295,7 +386,7 @@ namespace Ep128 {
       ans_callback = false;
       return;
     }
-    if (safe_read(sdfno, bufp + 2, 512) != 512) {
+    if (!readBlock(bufp + 2, sd_card_pos)) {
       bufp[1] = 0x03;           // CC error
       ans_bytes_left = 2U;
       ans_callback = false;
@@ -346,8 +437,7 @@ namespace Ep128 {
         writePos = 0;                   // is written by host...
         if (sd_card_size > 0U && !writeProtectFlag &&
             sd_card_pos <= (sd_card_size - 512U) &&
-            lseek(sdfno, off_t(sd_card_pos), SEEK_SET) == off_t(sd_card_pos) &&
-            write(sdfno, &(_buffer.front()), 512) == 512) {
+            writeBlock(&(_buffer.front()), sd_card_pos)) {
           _read_b = 5;          // data accepted
           // if multiple blocks: write mode back to the token waiting phase
           writeState = uint8_t(cmd[0] == 25);
@@ -467,8 +557,7 @@ namespace Ep128 {
       case 18:                  // CMD18: read multiple blocks
         sd_card_pos = (uint32_t(cmd[1]) << 24) | (uint32_t(cmd[2]) << 16)
                       | (uint32_t(cmd[3]) << 8) | uint32_t(cmd[4]);
-        if (sd_card_size > 0U && sd_card_pos <= (sd_card_size - 512U) &&
-            lseek(sdfno, off_t(sd_card_pos), SEEK_SET) == off_t(sd_card_pos)) {
+        if (sd_card_size > 0U && sd_card_pos <= (sd_card_size - 512U)) {
           _block_read();
           // in case of CMD18, continue multiple sectors,
           // register callback for that!
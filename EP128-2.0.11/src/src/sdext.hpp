@@ -70,12 +70,27 @@ namespace Ep128 {
     std::vector< uint8_t >  _buffer;
     uint32_t  sd_card_size;
     uint32_t  sd_card_pos;
+    // read-ahead cache: 'readCacheSize' bytes of the image starting at
+    // 'readCachePos'; 'nextReadPos' is the end of the last block read, for
+    // detecting sequential access
+    std::vector< uint8_t >  readCache;
+    uint32_t  readCachePos;
+    uint32_t  readCacheSize;
+    uint32_t  nextReadPos;
+    // deferred writes: 'writeCacheSize' bytes to be written to the image
+    // at 'writeCachePos', consecutive blocks are coalesced
+    std::vector< uint8_t >  writeCache;
+    uint32_t  writeCachePos;
+    uint32_t  writeCacheSize;
     std::string romFileName;
     bool      romFileWriteProtected;
     bool      romDataChanged;
     bool      flashErased;      // true if sd_rom_ext is filled with 0xFF bytes
     uint8_t   flashCommand;     // the lower nibble is the bus cycle (0 to 5)
     // ----------------
+    bool readBlock(uint8_t *buf, uint32_t pos);
+    bool writeBlock(const uint8_t *buf, uint32_t pos);
+    bool flushWriteCache();
     void _block_read();
     void _spi_shifting_with_sd_card();
     uint8_t flashRead(uint32_t addr);
@@ -93,6 +108,9 @@ namespace Ep128 {
     // 2 = clear SRAM
     void reset(int reset_level);
     void openImage(const char *sdimg_path);
+    // write any deferred changes to the SD card image file,
+    // throws Ep128Emu::Exception on error
+    void flushImage();
     void openROMFile(const char *fileName);
     uint8_t readCartP3(uint32_t addr);
     void writeCartP3(uint32_t addr, uint8_t data);
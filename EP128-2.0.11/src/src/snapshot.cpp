@@ -37,6 +37,18 @@ namespace Ep128 {
 
   void Ep128VM::saveState(Ep128Emu::File& f)
   {
+    if (!f.getIsCheckpoint()) {
+      // the disk images are not included in the snapshot, but they should
+      // be up to date when the snapshot is loaded (rewind checkpoints do not
+      // restore disk images, so these are left to the background flushing)
+      for (int i = 0; i < 4; i++) {
+        if (!floppyDrives[i].flushImage())
+          throw Ep128Emu::Exception("error writing floppy disk image file");
+      }
+#ifdef ENABLE_SDEXT
+      sdext.flushImage();
+#endif
+    }
     ioPorts.saveState(f);
     memory.saveState(f);
     nick.saveState(f);
@@ -87,7 +99,10 @@ namespace Ep128 {
         buf.writeByte(cmosMemory[i]);
       buf.writeBoolean(mouseEmulationEnabled);
       buf.writeByte(prvB7PortState);
-      buf.writeUInt32(mouseTimer);
+      {
+        int64_t mouseTimer_ = getEventDelay(&mouseTimerCallback, this);
+        buf.writeUInt32(uint32_t(mouseTimer_ > 0L ? mouseTimer_ : 0L));
+      }
       buf.writeUInt64(mouseData);
 #ifdef ENABLE_RESID
       if (sidModel) {
@@ -144,8 +159,7 @@ namespace Ep128 {
     demoBuffer.writeUInt32(0x0002000B); // version 2.0.11
     demoFile = &f;
     isRecordingDemo = true;
-    setCallback(&demoRecordCallback, this, true);
-    demoTimeCnt = 0U;
+    demoTimeCnt = nickSlotCnt;
   }
 
   void Ep128VM::stopDemo()
@@ -281,16 +295,20 @@ namespace Ep128 {
         prvB7PortState = buf.readByte();
         mouseTimer = buf.readUInt32();
         mouseData = buf.readUInt64();
-        if (mouseTimer)
-          setCallback(&mouseTimerCallback, this, true);
-        else
+        if (mouseTimer) {
+          setEvent(&mouseTimerCallback, this, int64_t(mouseTimer));
+        }
+        else {
+          setEvent(&mouseTimerCallback, this, -1);
           dave.clearMouseInput();
+        }
       }
       else {
         // snapshot from old version without mouse emulation
         mouseEmulationEnabled = false;
         prvB7PortState = 0x00;
         mouseTimer = 0U;
+        setEvent(&mouseTimerCallback, this, -1);
         mouseData = 0ULL;
         dave.setMouseInput(0xFF);
       }
@@ -400,7 +418,7 @@ namespace Ep128 {
     // initialize time counter with first delta time
     demoTimeCnt = buf.readUIntVLen();
     isPlayingDemo = true;
-    setCallback(&demoPlayCallback, this, true);
+    setEvent(&demoPlayCallback, this, int64_t(demoTimeCnt) + 1L);
     // copy any remaining demo data to local buffer
     demoBuffer.clear();
     demoBuffer.writeData(buf.getData() + buf.getPosition(),
@@ -21,6 +21,16 @@
 #include "snd_conv.hpp"
 #include <cmath>
 
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__ICC) &&     \
+    ((defined(__GNUC__) && (__GNUC__ > 4 ||                             \
+                            (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || \
+     defined(__clang__))
+// SSE2 and AVX versions of the resampler are compiled with function
+// specific target attributes, and selected at run time
+#  define EP128EMU_SND_CONV_X86_SIMD    1
+#  include <immintrin.h>
+#endif
+
 namespace Ep128Emu {
 
   inline float AudioConverter::DCBlockFilter::process(float inputSignal)
@@ -178,7 +188,8 @@ namespace Ep128Emu {
       dcBlock1L(outputSampleRate_, dcBlockFreq1),
       dcBlock1R(outputSampleRate_, dcBlockFreq1),
       dcBlock2L(outputSampleRate_, dcBlockFreq2),
-      dcBlock2R(outputSampleRate_, dcBlockFreq2)
+      dcBlock2R(outputSampleRate_, dcBlockFreq2),
+      rateCorrection(1.0f)
   {
     setOutputVolume(ampScale_);
   }
@@ -197,6 +208,12 @@ namespace Ep128Emu {
     outputSampleRate = sampleRate_;
   }
 
+  void AudioConverter::setRateCorrection(float ratio)
+  {
+    rateCorrection =
+        (ratio > 0.995f ? (ratio < 1.005f ? ratio : 1.005f) : 0.995f);
+  }
+
   void AudioConverter::setDCBlockFilters(float frq1, float frq2)
   {
     dcBlock1L.setCutoffFrequency(frq1);
@@ -213,6 +230,13 @@ namespace Ep128Emu {
     eqR.setParameters(mode_, omega, level_, q_);
   }
 
+  void AudioConverter::sendInputSignalBlock(const uint32_t *buf,
+                                            size_t nSamples)
+  {
+    for (size_t i = 0; i < nSamples; i++)
+      this->sendInputSignal(buf[i]);
+  }
+
   void AudioConverter::setOutputVolume(float ampScale_)
   {
     if (ampScale_ > 0.01f && ampScale_ < 1.0f)
@@ -223,7 +247,7 @@ namespace Ep128Emu {
       ampScale = 0.0117f;
   }
 
-  void AudioConverterLowQuality::sendInputSignal(uint32_t audioInput)
+  inline void AudioConverterLowQuality::processInputSample(uint32_t audioInput)
   {
     float   left = float(int(audioInput & 0xFFFF));
     float   right = float(int(audioInput >> 16));
@@ -252,6 +276,18 @@ namespace Ep128Emu {
     prvInputR = right;
   }
 
+  void AudioConverterLowQuality::sendInputSignal(uint32_t audioInput)
+  {
+    processInputSample(audioInput);
+  }
+
+  void AudioConverterLowQuality::sendInputSignalBlock(const uint32_t *buf,
+                                                      size_t nSamples)
+  {
+    for (size_t i = 0; i < nSamples; i++)
+      processInputSample(buf[i]);
+  }
+
   void AudioConverterLowQuality::sendMonoInputSignal(int32_t audioInput)
   {
     float   left = float(audioInput);
@@ -297,115 +333,242 @@ namespace Ep128Emu {
   void AudioConverterLowQuality::setInputSampleRate(float sampleRate_)
   {
     inputSampleRate = sampleRate_;
-    downsampleRatio = inputSampleRate / outputSampleRate;
+    downsampleRatio = inputSampleRate / (outputSampleRate * rateCorrection);
   }
 
   void AudioConverterLowQuality::setOutputSampleRate(float sampleRate_)
   {
     outputSampleRate = sampleRate_;
-    downsampleRatio = inputSampleRate / outputSampleRate;
-  }
-
-  inline void AudioConverterHighQuality::ResampleWindow::processSample(
-      float inL, float inR, float *outBufL, float *outBufR,
-      int outBufSize, float bufPos)
-  {
-    int      writePos = int(bufPos);
-    float    posFrac = bufPos - writePos;
-    float    winPos = (1.0f - posFrac) * float(windowSize / 12);
-    int      winPosInt = int(winPos);
-    float    winPosFrac = winPos - winPosInt;
-    writePos -= 5;
-    while (writePos < 0)
-      writePos += outBufSize;
-    do {
-      float   w = windowTable[winPosInt]
-                  + ((windowTable[winPosInt + 1] - windowTable[winPosInt])
-                     * winPosFrac);
-      outBufL[writePos] += inL * w;
-      outBufR[writePos] += inR * w;
-      if (++writePos >= outBufSize)
-        writePos = 0;
-      winPosInt += (windowSize / 12);
-    } while (winPosInt < windowSize);
-  }
-
-  inline void AudioConverterHighQuality::ResampleWindow::processSample(
-      float inL, float *outBufL, int outBufSize, float bufPos)
-  {
-    int      writePos = int(bufPos);
-    float    posFrac = bufPos - writePos;
-    float    winPos = (1.0f - posFrac) * float(windowSize / 12);
-    int      winPosInt = int(winPos);
-    float    winPosFrac = winPos - winPosInt;
-    writePos -= 5;
-    while (writePos < 0)
-      writePos += outBufSize;
-    do {
-      float   w = windowTable[winPosInt]
-                  + ((windowTable[winPosInt + 1] - windowTable[winPosInt])
-                     * winPosFrac);
-      outBufL[writePos] += inL * w;
-      if (++writePos >= outBufSize)
-        writePos = 0;
-      winPosInt += (windowSize / 12);
-    } while (winPosInt < windowSize);
+    downsampleRatio = inputSampleRate / (outputSampleRate * rateCorrection);
+  }
+
+  void AudioConverterLowQuality::setRateCorrection(float ratio)
+  {
+    AudioConverter::setRateCorrection(ratio);
+    downsampleRatio = inputSampleRate / (outputSampleRate * rateCorrection);
+  }
+
+  // --------------------------------------------------------------------------
+
+  // portable version of the resampler inner loop, also used as a reference
+  // for the SIMD versions below
+
+  static size_t mixBlock_Scalar(const float *coeffTable,
+                                float *outBuf, float& bufPos,
+                                float resampleRatio,
+                                const uint32_t *buf, size_t nSamples)
+  {
+    float   pos = bufPos;
+    size_t  i = 0;
+    while (i < nSamples) {
+      float   winPos = (1.0f - pos) * 128.0f;
+      int     winPosInt = int(winPos);
+      float   f = winPos - float(winPosInt);
+      float   inL = float(int(buf[i] & 0xFFFFU));
+      float   inR = float(int(buf[i] >> 16));
+      const float *c = coeffTable + (winPosInt * 48);
+      for (int j = 0; j < 24; j += 2) {
+        outBuf[j] += (inL * (c[j] + (c[j + 24] * f)));
+        outBuf[j + 1] += (inR * (c[j + 1] + (c[j + 25] * f)));
+      }
+      i++;
+      pos += resampleRatio;
+      if (pos >= 1.0f)
+        break;
+    }
+    bufPos = pos;
+    return i;
   }
 
+#ifdef EP128EMU_SND_CONV_X86_SIMD
+
+  // 24 coefficients (12 taps * 2 channels) = 6 SSE registers
+
+  __attribute__ ((__target__ ("sse2")))
+  static size_t mixBlock_SSE2(const float *coeffTable,
+                              float *outBuf, float& bufPos,
+                              float resampleRatio,
+                              const uint32_t *buf, size_t nSamples)
+  {
+    float   pos = bufPos;
+    size_t  i = 0;
+    while (i < nSamples) {
+      float   winPos = (1.0f - pos) * 128.0f;
+      int     winPosInt = int(winPos);
+      __m128  f = _mm_set1_ps(winPos - float(winPosInt));
+      __m128  x = _mm_set_ps(float(int(buf[i] >> 16)),
+                             float(int(buf[i] & 0xFFFFU)),
+                             float(int(buf[i] >> 16)),
+                             float(int(buf[i] & 0xFFFFU)));
+      const float *c = coeffTable + (winPosInt * 48);
+      for (int j = 0; j < 24; j += 4) {
+        __m128  w = _mm_add_ps(_mm_loadu_ps(c + j),
+                               _mm_mul_ps(_mm_loadu_ps(c + (j + 24)), f));
+        _mm_storeu_ps(outBuf + j,
+                      _mm_add_ps(_mm_loadu_ps(outBuf + j), _mm_mul_ps(x, w)));
+      }
+      i++;
+      pos += resampleRatio;
+      if (pos >= 1.0f)
+        break;
+    }
+    bufPos = pos;
+    return i;
+  }
+
+  // 24 coefficients = 3 AVX registers; no FMA, so that the results are
+  // identical to the SSE2 version
+
+  __attribute__ ((__target__ ("avx")))
+  static size_t mixBlock_AVX(const float *coeffTable,
+                             float *outBuf, float& bufPos,
+                             float resampleRatio,
+                             const uint32_t *buf, size_t nSamples)
+  {
+    float   pos = bufPos;
+    size_t  i = 0;
+    while (i < nSamples) {
+      float   winPos = (1.0f - pos) * 128.0f;
+      int     winPosInt = int(winPos);
+      __m256  f = _mm256_set1_ps(winPos - float(winPosInt));
+      float   inL = float(int(buf[i] & 0xFFFFU));
+      float   inR = float(int(buf[i] >> 16));
+      __m256  x = _mm256_set_ps(inR, inL, inR, inL, inR, inL, inR, inL);
+      const float *c = coeffTable + (winPosInt * 48);
+      for (int j = 0; j < 24; j += 8) {
+        __m256  w = _mm256_add_ps(_mm256_loadu_ps(c + j),
+                                  _mm256_mul_ps(_mm256_loadu_ps(c + (j + 24)),
+                                                f));
+        _mm256_storeu_ps(outBuf + j,
+                         _mm256_add_ps(_mm256_loadu_ps(outBuf + j),
+                                       _mm256_mul_ps(x, w)));
+      }
+      i++;
+      pos += resampleRatio;
+      if (pos >= 1.0f)
+        break;
+    }
+    bufPos = pos;
+    return i;
+  }
+
+#endif  // EP128EMU_SND_CONV_X86_SIMD
+
   AudioConverterHighQuality::ResampleWindow::ResampleWindow()
   {
+    float   tmpTable[windowSize + nPhases + 2];
     double  pi = std::atan(1.0) * 4.0;
     double  phs = -(pi * 6.0);
     double  phsInc = 12.0 * pi / windowSize;
     for (int i = 0; i <= windowSize; i++) {
       if (i == (windowSize / 2))
-        windowTable[i] = 1.0f;
+        tmpTable[i] = 1.0f;
       else
-        windowTable[i] = float((std::cos(phs / 6.0) * 0.5 + 0.5)  // von Hann
-                               * (std::sin(phs) / phs));
+        tmpTable[i] = float((std::cos(phs / 6.0) * 0.5 + 0.5)   // von Hann
+                            * (std::sin(phs) / phs));
       phs += phsInc;
     }
+    for (int i = windowSize + 1; i < (windowSize + nPhases + 2); i++)
+      tmpTable[i] = 0.0f;
+    // convert to polyphase format
+    for (int i = 0; i <= nPhases; i++) {
+      float   *c = &(coeffTable[i * (nTaps * 4)]);
+      for (int j = 0; j < nTaps; j++) {
+        float   w0 = tmpTable[i + (j * nPhases)];
+        float   w1 = tmpTable[i + (j * nPhases) + 1];
+        c[j * 2] = w0;
+        c[j * 2 + 1] = w0;
+        c[j * 2 + (nTaps * 2)] = w1 - w0;
+        c[j * 2 + (nTaps * 2) + 1] = w1 - w0;
+      }
+    }
+    mixBlockFunc = (MixBlockFunc) 0;
+    setUseScalarMixing(false);
   }
 
   AudioConverterHighQuality::ResampleWindow AudioConverterHighQuality::window;
 
+  void AudioConverterHighQuality::setUseScalarMixing(bool isEnabled)
+  {
+    window.mixBlockFunc = &mixBlock_Scalar;
+#ifdef EP128EMU_SND_CONV_X86_SIMD
+    if (!isEnabled) {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx"))
+        window.mixBlockFunc = &mixBlock_AVX;
+      else if (__builtin_cpu_supports("sse2"))
+        window.mixBlockFunc = &mixBlock_SSE2;
+    }
+#else
+    (void) isEnabled;
+#endif
+  }
+
+  void AudioConverterHighQuality::sendOutputSample()
+  {
+    float   *p = &(outBuf[outBufReadPos * 2]);
+    float   left = p[0] * resampleRatio;
+    float   right = p[1] * resampleRatio;
+    p[0] = 0.0f;
+    p[1] = 0.0f;
+    if (++outBufReadPos >= bufSize) {
+      // move the samples still being mixed to the beginning of the buffer
+      for (int i = 0; i < (ResampleWindow::nTaps * 2); i++) {
+        outBuf[i] = outBuf[(bufSize * 2) + i];
+        outBuf[(bufSize * 2) + i] = 0.0f;
+      }
+      outBufReadPos = 0;
+    }
+    sendOutputSignal(
+        eqL.process(dcBlock2L.process(dcBlock1L.process(left))),
+        eqR.process(dcBlock2R.process(dcBlock1R.process(right))));
+  }
+
   void AudioConverterHighQuality::sendInputSignal(uint32_t audioInput)
   {
-    float   left = float(int(audioInput & 0xFFFF));
-    float   right = float(int(audioInput >> 16));
-    window.processSample(left, right, bufL, bufR, bufSize, bufPos);
-    bufPos += resampleRatio;
-    if (bufPos >= nxtPos) {
-      if (bufPos >= float(bufSize))
-        bufPos -= float(bufSize);
-      nxtPos = float(int(bufPos) + 1);
-      int     readPos = int(bufPos) - 6;
-      while (readPos < 0)
-        readPos += bufSize;
-      left = bufL[readPos] * resampleRatio;
-      bufL[readPos] = 0.0f;
-      right = bufR[readPos] * resampleRatio;
-      bufR[readPos] = 0.0f;
-      sendOutputSignal(
-          eqL.process(dcBlock2L.process(dcBlock1L.process(left))),
-          eqR.process(dcBlock2R.process(dcBlock1R.process(right))));
+    sendInputSignalBlock(&audioInput, 1);
+  }
+
+  void AudioConverterHighQuality::sendInputSignalBlock(const uint32_t *buf,
+                                                       size_t nSamples)
+  {
+    MixBlockFunc  mixBlockFunc = window.mixBlockFunc;
+    while (nSamples > 0) {
+      size_t  n = mixBlockFunc(&(window.coeffTable[0]),
+                               &(outBuf[outBufReadPos * 2]), bufPos,
+                               resampleRatio, buf, nSamples);
+      buf += n;
+      nSamples -= n;
+      while (bufPos >= 1.0f) {
+        bufPos -= 1.0f;
+        sendOutputSample();
+      }
     }
   }
 
   void AudioConverterHighQuality::sendMonoInputSignal(int32_t audioInput)
   {
-    float   left = float(audioInput);
-    window.processSample(left, bufL, bufSize, bufPos);
+    float   inL = float(audioInput);
+    float   phaseFrac;
+    const float *c = window.getCoefficients(bufPos, phaseFrac);
+    const float *d = c + (ResampleWindow::nTaps * 2);
+    float   *p = &(outBuf[outBufReadPos * 2]);
+    for (int j = 0; j < (ResampleWindow::nTaps * 2); j += 2)
+      p[j] += (inL * (c[j] + (d[j] * phaseFrac)));
     bufPos += resampleRatio;
-    if (bufPos >= nxtPos) {
-      if (bufPos >= float(bufSize))
-        bufPos -= float(bufSize);
-      nxtPos = float(int(bufPos) + 1);
-      int     readPos = int(bufPos) - 6;
-      while (readPos < 0)
-        readPos += bufSize;
-      left = bufL[readPos] * resampleRatio;
-      bufL[readPos] = 0.0f;
+    while (bufPos >= 1.0f) {
+      bufPos -= 1.0f;
+      p = &(outBuf[outBufReadPos * 2]);
+      float   left = p[0] * resampleRatio;
+      p[0] = 0.0f;
+      p[1] = 0.0f;
+      if (++outBufReadPos >= bufSize) {
+        for (int i = 0; i < (ResampleWindow::nTaps * 2); i++) {
+          outBuf[i] = outBuf[(bufSize * 2) + i];
+          outBuf[(bufSize * 2) + i] = 0.0f;
+        }
+        outBufReadPos = 0;
+      }
       float   tmp = eqL.process(dcBlock2L.process(dcBlock1L.process(left)));
       sendOutputSignal(tmp, tmp);
     }
@@ -419,12 +582,10 @@ namespace Ep128Emu {
     : AudioConverter(inputSampleRate_, outputSampleRate_,
                      dcBlockFreq1, dcBlockFreq2, ampScale_)
   {
-    for (int i = 0; i < bufSize; i++) {
-      bufL[i] = 0.0f;
-      bufR[i] = 0.0f;
-    }
+    for (int i = 0; i < ((bufSize + ResampleWindow::nTaps) * 2); i++)
+      outBuf[i] = 0.0f;
+    outBufReadPos = 0;
     bufPos = 0.0f;
-    nxtPos = 1.0f;
     resampleRatio = outputSampleRate_ / inputSampleRate_;
   }
 
@@ -435,13 +596,19 @@ namespace Ep128Emu {
   void AudioConverterHighQuality::setInputSampleRate(float sampleRate_)
   {
     inputSampleRate = sampleRate_;
-    resampleRatio = outputSampleRate / inputSampleRate;
+    resampleRatio = outputSampleRate * rateCorrection / inputSampleRate;
   }
 
   void AudioConverterHighQuality::setOutputSampleRate(float sampleRate_)
   {
     outputSampleRate = sampleRate_;
-    resampleRatio = outputSampleRate / inputSampleRate;
+    resampleRatio = outputSampleRate * rateCorrection / inputSampleRate;
+  }
+
+  void AudioConverterHighQuality::setRateCorrection(float ratio)
+  {
+    AudioConverter::setRateCorrection(ratio);
+    resampleRatio = outputSampleRate * rateCorrection / inputSampleRate;
   }
 
 }       // namespace Ep128Emu
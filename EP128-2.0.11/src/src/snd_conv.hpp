@@ -54,6 +54,7 @@ namespace Ep128Emu {
     ParametricEqualizer eqL;
     ParametricEqualizer eqR;
     float   ampScale;
+    float   rateCorrection;
    public:
     AudioConverter(float inputSampleRate_, float outputSampleRate_,
                    float dcBlockFreq1 = 10.0f, float dcBlockFreq2 = 10.0f,
@@ -61,8 +62,25 @@ namespace Ep128Emu {
     virtual ~AudioConverter();
     virtual void sendInputSignal(uint32_t audioInput) = 0;
     virtual void sendMonoInputSignal(int32_t audioInput) = 0;
+    /*!
+     * Convert a block of 'nSamples' stereo input samples, in the same
+     * format as the parameter of sendInputSignal(). The default
+     * implementation calls sendInputSignal() for each sample.
+     */
+    virtual void sendInputSignalBlock(const uint32_t *buf, size_t nSamples);
     virtual void setInputSampleRate(float sampleRate_);
     virtual void setOutputSampleRate(float sampleRate_);
+    /*!
+     * Multiply the output sample rate used for resampling by 'ratio'
+     * (limited to the range 0.995 to 1.005), without changing the filters.
+     * This is used for small corrections to keep the fill level of the
+     * audio output buffer stable.
+     */
+    virtual void setRateCorrection(float ratio);
+    inline float getRateCorrection() const
+    {
+      return rateCorrection;
+    }
     void setDCBlockFilters(float frq1, float frq2);
     void setEqualizerParameters(int mode_, float freq_, float level_, float q_);
     void setOutputVolume(float ampScale_);
@@ -77,6 +95,7 @@ namespace Ep128Emu {
     float   phs, nxtPhs;
     float   downsampleRatio;
     float   outLeft, outRight;
+    inline void processInputSample(uint32_t audioInput);
    public:
     AudioConverterLowQuality(float inputSampleRate_,
                              float outputSampleRate_,
@@ -86,31 +105,59 @@ namespace Ep128Emu {
     virtual ~AudioConverterLowQuality();
     virtual void sendInputSignal(uint32_t audioInput);
     virtual void sendMonoInputSignal(int32_t audioInput);
+    virtual void sendInputSignalBlock(const uint32_t *buf, size_t nSamples);
     virtual void setInputSampleRate(float sampleRate_);
     virtual void setOutputSampleRate(float sampleRate_);
+    virtual void setRateCorrection(float ratio);
   };
 
   class AudioConverterHighQuality : public AudioConverter {
+   public:
+    /*!
+     * Function type for mixing a block of input samples into the output
+     * buffer of the polyphase resampler. Stereo samples from 'buf' are
+     * filtered using 'coeffTable' (see ResampleWindow below), and added to
+     * 'outBuf' (interleaved L, R format). The position of the first sample
+     * is 'bufPos' (0.0 to 1.0) output samples after the beginning of the
+     * buffer, and it is incremented by 'resampleRatio' after each input
+     * sample. Processing stops early when 'bufPos' reaches 1.0 (an output
+     * sample is ready). Returns the number of input samples used.
+     */
+    typedef size_t (*MixBlockFunc)(const float *coeffTable,
+                                   float *outBuf, float& bufPos,
+                                   float resampleRatio,
+                                   const uint32_t *buf, size_t nSamples);
    private:
     class ResampleWindow {
-     private:
-      static const int windowSize = 12 * 128;
-      float   windowTable[12 * 128 + 1];
      public:
+      static const int windowSize = 12 * 128;
+      static const int nPhases = 128;
+      static const int nTaps = 12;
+      // for each phase (0 to 128), the 12 filter coefficients duplicated
+      // for stereo input (24 floats), followed by the difference to the
+      // next phase (24 floats) for linear interpolation
+      float   coeffTable[(nPhases + 1) * nTaps * 4];
+      MixBlockFunc  mixBlockFunc;
       ResampleWindow();
-      inline void processSample(float inL, float inR,
-                                float *outBufL, float *outBufR,
-                                int outBufSize, float bufPos);
-      inline void processSample(float inL, float *outBufL,
-                                int outBufSize, float bufPos);
+      inline const float *getCoefficients(float bufPos,
+                                          float& phaseFrac) const
+      {
+        float   winPos = (1.0f - bufPos) * float(nPhases);
+        int     winPosInt = int(winPos);
+        phaseFrac = winPos - float(winPosInt);
+        return &(coeffTable[winPosInt * (nTaps * 4)]);
+      }
     };
     static ResampleWindow window;
-    static const int bufSize = 16;
-    float   bufL[16];
-    float   bufR[16];
-    float   bufPos, nxtPos;
+    // the buffer can be used for 'bufSize' output samples before it needs
+    // to be shifted back to the beginning
+    static const int bufSize = 64;
+    float   outBuf[(64 + 12) * 2];
+    int     outBufReadPos;
+    float   bufPos;
     float   resampleRatio;
     // ----------------
+    void sendOutputSample();
    public:
     AudioConverterHighQuality(float inputSampleRate_,
                               float outputSampleRate_,
@@ -120,8 +167,16 @@ namespace Ep128Emu {
     virtual ~AudioConverterHighQuality();
     virtual void sendInputSignal(uint32_t audioInput);
     virtual void sendMonoInputSignal(int32_t audioInput);
+    virtual void sendInputSignalBlock(const uint32_t *buf, size_t nSamples);
     virtual void setInputSampleRate(float sampleRate_);
     virtual void setOutputSampleRate(float sampleRate_);
+    virtual void setRateCorrection(float ratio);
+    /*!
+     * Use the portable (non-SIMD) mixing code if 'isEnabled' is true,
+     * otherwise the fastest one supported by the CPU (default). This is
+     * mainly useful as a reference for testing the SIMD versions.
+     */
+    static void setUseScalarMixing(bool isEnabled);
   };
 
 }       // namespace Ep128Emu
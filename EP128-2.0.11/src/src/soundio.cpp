@@ -65,6 +65,10 @@ namespace Ep128Emu {
   AudioOutput::AudioOutput()
     : outputFileName(""),
       soundFile((SNDFILE *) 0),
+      bufferLevel(0.0f),
+      rateCorrection(1.0f),
+      underrunCnt(0U),
+      overrunCnt(0U),
       deviceNumber(-1),
       sampleRate(0.0f),
       totalLatency(0.0f),
@@ -194,6 +198,28 @@ namespace Ep128Emu {
     // NOTE: AudioOutput::closeDevice() should be called by derived classes
     // to reset internal data
     deviceNumber = -1;
+    bufferLevel = 0.0f;
+    rateCorrection = 1.0f;
+    underrunCnt = 0U;
+    overrunCnt = 0U;
+  }
+
+  void AudioOutput::updateBufferLevel(float fillLevel)
+  {
+    // first order low-pass filter with a time constant of 32 periods
+    bufferLevel = bufferLevel + ((fillLevel - bufferLevel) * 0.03125f);
+    // the target is half full, with the maximum correction of 0.5% (see
+    // AudioConverter::setRateCorrection()) when the buffer is empty or full
+    rateCorrection = 1.0f + ((0.5f - bufferLevel) * 0.01f);
+  }
+
+  void AudioOutput::getBufferStatistics(float& bufferLevel_,
+                                        uint32_t& underrunCnt_,
+                                        uint32_t& overrunCnt_) const
+  {
+    bufferLevel_ = bufferLevel;
+    underrunCnt_ = atomicLoadAcquire(underrunCnt);
+    overrunCnt_ = atomicLoadAcquire(overrunCnt);
   }
 
   std::vector< std::string > AudioOutput::getDeviceList()
@@ -218,6 +244,9 @@ namespace Ep128Emu {
       readBufIndex(0),
       paStream((PaStream *) 0),
       latencyFramesHW(4096L),
+      outputWasEmpty(true),
+      buffersWritten(0U),
+      buffersPlayed(0U),
       nextTime(0.0),
       closeDeviceLock(true)
   {
@@ -255,43 +284,9 @@ namespace Ep128Emu {
     if (paStream) {
 #ifndef USING_OLD_PORTAUDIO_API
       if (usingBlockingInterface) {
-        // reduce timing jitter
-        double  t = nextTime - timer_.getRealTime();
-        double  periodTime = double(long(nFrames)) / double(sampleRate);
-        long    framesToWrite = Pa_GetStreamWriteAvailable(paStream);
-        switch (int((framesToWrite << 3) / latencyFramesHW)) {
-        case 0:
-          periodTime = periodTime * 2.0;
-          break;
-        case 1:
-          periodTime = periodTime * 1.25;
-          break;
-        case 2:
-          periodTime = periodTime * 1.1;
-          break;
-        case 3:
-          periodTime = periodTime * 1.05;
-          break;
-        case 4:
-          periodTime = periodTime * 0.95;
-          break;
-        case 5:
-          periodTime = periodTime * 0.9;
-          break;
-        default:
-          timer_.reset();
-          nextTime = 0.0;
-          periodTime = 0.0;
-          break;
-        }
-        nextTime = nextTime + periodTime;
-        if (t > 0.00075) {
-          Timer::wait(t);
-        }
-        else if (t < -0.5) {
-          timer_.reset();
-          nextTime = 0.0;
-        }
+        // the audio device is the only clock: the fill level measured before
+        // each write is kept at about half of the buffer by waiting for the
+        // excess to be played, and by small sample rate corrections
         // ring buffer is not used for blocking I/O, so assume nPeriodsSW == 1
         for (size_t i = 0; i < nFrames; i++) {
           Buffer& buf_ = buffers[0];
@@ -299,8 +294,22 @@ namespace Ep128Emu {
           buf_.audioData[buf_.writePos++] = buf[(i << 1) + 1];
           if (buf_.writePos >= buf_.audioData.size()) {
             buf_.writePos = 0;
-            Pa_WriteStream(paStream,
-                           &(buf_.audioData[0]), buf_.audioData.size() >> 1);
+            long    framesFree = Pa_GetStreamWriteAvailable(paStream);
+            if (framesFree >= 0L) {
+              framesFree =
+                  (framesFree < latencyFramesHW ? framesFree : latencyFramesHW);
+              updateBufferLevel(float(latencyFramesHW - framesFree)
+                                / float(latencyFramesHW));
+              long    framesExcess = (latencyFramesHW >> 1) - framesFree;
+              if (framesExcess > 0L)
+                Timer::wait(double(framesExcess) / double(sampleRate));
+            }
+            PaError err = Pa_WriteStream(paStream, &(buf_.audioData[0]),
+                                         buf_.audioData.size() >> 1);
+            if (err == paOutputUnderflowed || framesFree >= latencyFramesHW)
+              bufferUnderrun();
+            else if (err != paNoError)
+              bufferOverrun();
           }
         }
       }
@@ -313,11 +322,31 @@ namespace Ep128Emu {
           buf_.audioData[buf_.writePos++] = buf[(i << 1) + 1];
           if (buf_.writePos >= buf_.audioData.size()) {
             buf_.writePos = 0;
+            buffersWritten++;
+            if (!disableRingBuffer) {
+              // keep the ring buffer about half full like with blocking I/O
+              // (without it, the period is handed over to the callback
+              // directly, so there is no level to correct)
+              float   n = float(long(buffersWritten
+                                     - atomicLoadAcquire(buffersPlayed)));
+              float   nBuffers = float(long(buffers.size()));
+              updateBufferLevel(n / nBuffers);
+              if (n > (nBuffers * 0.5f)) {
+                Timer::wait(double((n - (nBuffers * 0.5f))
+                                   * float(long(buf_.audioData.size() >> 1))
+                                   / sampleRate));
+              }
+            }
             buf_.paLock.notify();
             if (buf_.epLock.wait(1000)) {
               if (++writeBufIndex >= buffers.size())
                 writeBufIndex = 0;
             }
+            else {
+              // the buffer was not played in one second, it is overwritten
+              buffersWritten--;
+              bufferOverrun();
+            }
           }
         }
       }
@@ -433,7 +462,13 @@ namespace Ep128Emu {
     if (p->buffers[p->readBufIndex].paLock.wait(p->paLockTimeout)) {
       for ( ; i < nFrames; i++)
         buf[i] = p->buffers[p->readBufIndex].audioData[i];
+      atomicStoreRelease(p->buffersPlayed, p->buffersPlayed + 1U);
+    }
+    else if (!p->outputWasEmpty) {
+      // count only the first period of silence (e.g. not while paused)
+      p->bufferUnderrun();
     }
+    p->outputWasEmpty = (i == 0);
     p->buffers[p->readBufIndex].epLock.notify();
     if (++(p->readBufIndex) >= p->buffers.size())
       p->readBufIndex = 0;
@@ -451,6 +486,8 @@ namespace Ep128Emu {
   {
     writeBufIndex = 0;
     readBufIndex = 0;
+    buffersWritten = 0U;
+    buffersPlayed = 0U;
     paStream = (PaStream *) 0;
     // find audio device
 #ifndef USING_OLD_PORTAUDIO_API
@@ -517,7 +554,7 @@ namespace Ep128Emu {
     // calculate buffer size
     disableRingBuffer = (nPeriodsSW_ < 2);
     int     periodSize =
-        int(totalLatency * (usingBlockingInterface ? 1.4142f : 0.7071f)
+        int(totalLatency * (usingBlockingInterface ? 2.0f : 0.7071f)
             * sampleRate + 0.5f)
         / (nPeriodsHW_ + nPeriodsSW_ - 2);
     for (int i = 16; i < 16384; i <<= 1) {
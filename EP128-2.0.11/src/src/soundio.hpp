@@ -37,12 +37,34 @@ namespace Ep128Emu {
    private:
     std::string outputFileName;
     SNDFILE *soundFile;
+    float   bufferLevel;
+    float   rateCorrection;
+    // written by one thread only (the audio callback or the emulation)
+    volatile uint32_t underrunCnt;
+    volatile uint32_t overrunCnt;
    protected:
     int     deviceNumber;
     float   sampleRate;
     float   totalLatency;
     int     nPeriodsHW;
     int     nPeriodsSW;
+    /*!
+     * Derived classes should call this function before writing each period
+     * with the fill level of the output buffer (0.0: empty, 1.0: full).
+     * The smoothed difference from the half full level is used for
+     * calculating the sample rate correction returned by getRateCorrection().
+     */
+    void updateBufferLevel(float fillLevel);
+    // the audio device ran out of data
+    inline void bufferUnderrun()
+    {
+      atomicStoreRelease(underrunCnt, atomicLoadAcquire(underrunCnt) + 1U);
+    }
+    // audio data had to be discarded because the buffer was full
+    inline void bufferOverrun()
+    {
+      atomicStoreRelease(overrunCnt, atomicLoadAcquire(overrunCnt) + 1U);
+    }
    public:
     AudioOutput();
     virtual ~AudioOutput();
@@ -57,6 +79,23 @@ namespace Ep128Emu {
     {
       return this->sampleRate;
     }
+    /*!
+     * Returns the ratio (0.995 to 1.005) by which the output sample rate of
+     * the audio converter should be multiplied to keep the output buffer
+     * about half full. The audio device is the master clock, the emulation
+     * is not paced by the timer while a device is open.
+     */
+    inline float getRateCorrection() const
+    {
+      return this->rateCorrection;
+    }
+    /*!
+     * Returns the smoothed buffer fill level (0.0 to 1.0), and the number
+     * of buffer underruns and overruns since the audio device was opened.
+     */
+    void getBufferStatistics(float& bufferLevel_,
+                             uint32_t& underrunCnt_,
+                             uint32_t& overrunCnt_) const;
     /*!
      * Write sound output to the specified file name, closing any
      * previously opened file with a different name.
@@ -105,6 +144,12 @@ namespace Ep128Emu {
     size_t        readBufIndex;
     PaStream      *paStream;
     long          latencyFramesHW;
+    bool          outputWasEmpty;
+    // periods written to / played from the ring buffer (the latter is
+    // updated by the callback)
+    uint32_t      buffersWritten;
+    volatile uint32_t buffersPlayed;
+    // for synchronizing to real time when no audio device could be opened
     Timer         timer_;
     double        nextTime;
     ThreadLock    closeDeviceLock;
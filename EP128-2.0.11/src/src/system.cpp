@@ -31,6 +31,7 @@
 #  include <pthread.h>
 #  if defined(__linux) || defined(__linux__)
 #    include <sys/resource.h>
+#    include <sched.h>
 #  endif
 #endif
 
@@ -526,6 +527,41 @@ namespace Ep128Emu {
 #endif
   }
 
+  int getProcessorCount()
+  {
+    long    n = 1L;
+#if defined(WIN32)
+    SYSTEM_INFO   si;
+    GetSystemInfo(&si);
+    n = long(si.dwNumberOfProcessors);
+#elif defined(_SC_NPROCESSORS_ONLN)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return int(n > 1L ? (n < 256L ? n : 256L) : 1L);
+  }
+
+  bool setThreadAffinity(int n)
+  {
+    if (n < 0)
+      return false;
+#if defined(WIN32)
+    if (n >= int(sizeof(DWORD_PTR) * 8))
+      return false;
+    return (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << n)
+            != 0);
+#elif (defined(__linux) || defined(__linux__)) && defined(CPU_SET)
+    if (n >= CPU_SETSIZE)
+      return false;
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(n, &cpuSet);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet)
+            == 0);
+#else
+    return false;
+#endif
+  }
+
   void addFileNameExtension(std::string& fileName, const char *s)
   {
     if (s == (char *) 0 || s[0] == '\0')
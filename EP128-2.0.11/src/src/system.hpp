@@ -143,6 +143,43 @@ namespace Ep128Emu {
     }
   };
 
+  /*!
+   * Read a variable written by another thread (acquire semantics).
+   * Intended for indices shared between a single writer and a single
+   * reader thread.
+   */
+  EP128EMU_INLINE uint32_t atomicLoadAcquire(const volatile uint32_t& x)
+  {
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+    return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+    uint32_t  n = x;
+    __sync_synchronize();
+    return n;
+#else
+    // MSVC: volatile reads have acquire semantics
+    return x;
+#endif
+  }
+
+  /*!
+   * Write a variable read by another thread (release semantics).
+   */
+  EP128EMU_INLINE void atomicStoreRelease(volatile uint32_t& x, uint32_t n)
+  {
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+    __atomic_store_n(&x, n, __ATOMIC_RELEASE);
+#elif defined(__GNUC__)
+    __sync_synchronize();
+    x = n;
+#else
+    // MSVC: volatile writes have release semantics
+    x = n;
+#endif
+  }
+
   class Timer {
    private:
     uint64_t  startTime;
@@ -204,6 +241,18 @@ namespace Ep128Emu {
    */
   void setProcessPriority(int n);
 
+  /*!
+   * Returns the number of processors (cores) available to the process.
+   */
+  int getProcessorCount();
+
+  /*!
+   * Restrict the calling thread to run on processor 'n' only (0 is the first
+   * processor). Returns false if this is not supported on the platform, or
+   * fails.
+   */
+  bool setThreadAffinity(int n);
+
   /*!
    * If 'fileName' does not already have an extension (starting with a dot
    * character), append a dot character and 's' to the file name.
@@ -0,0 +1,221 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "thrpool.hpp"
+
+#include <stdexcept>
+
+namespace Ep128Emu {
+
+  ThreadPool::WorkerThread::WorkerThread(ThreadPool& pool_, int threadNum_)
+    : Thread(),
+      pool(pool_),
+      threadNum(threadNum_),
+      doneLock(false),
+      exitFlag(false)
+  {
+  }
+
+  ThreadPool::WorkerThread::~WorkerThread()
+  {
+    exitFlag = true;
+    this->join();
+  }
+
+  void ThreadPool::WorkerThread::run()
+  {
+    // the thread is started by ThreadPool::run() for each parallel loop
+    while (!exitFlag) {
+      pool.runLoop_(threadNum);
+      doneLock.notify();
+      this->wait();
+    }
+  }
+
+  // --------------------------------------------------------------------------
+
+  ThreadPool::ThreadPool()
+    : workerThreads((WorkerThread **) 0),
+      nWorkerThreads(0),
+      loopMutex(),
+      loopFunc((void (*)(void *, int, int)) 0),
+      loopUserData((void *) 0),
+      loopNext(0),
+      loopEnd(0),
+      loopDone(0),
+      errorType(0),
+      errorException(),
+      errorMessage("")
+  {
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    setNumberOfThreads(1);
+  }
+
+  void ThreadPool::setNumberOfThreads(int n)
+  {
+    n = (n > 1 ? (n < 64 ? n : 64) : 1);
+    if ((n - 1) == nWorkerThreads)
+      return;
+    if (workerThreads) {
+      for (int i = 0; i < nWorkerThreads; i++)
+        delete workerThreads[i];
+      delete[] workerThreads;
+      workerThreads = (WorkerThread **) 0;
+      nWorkerThreads = 0;
+    }
+    if (n < 2)
+      return;
+    workerThreads = new WorkerThread*[n - 1];
+    try {
+      for ( ; nWorkerThreads < (n - 1); nWorkerThreads++) {
+        workerThreads[nWorkerThreads] =
+            new WorkerThread(*this, nWorkerThreads + 1);
+      }
+    }
+    catch (...) {
+      // continue with fewer threads
+      if (!nWorkerThreads) {
+        delete[] workerThreads;
+        workerThreads = (WorkerThread **) 0;
+      }
+    }
+  }
+
+  void ThreadPool::runItem(int n, int threadNum)
+  {
+    int     err = 0;
+    const char  *msg = (char *) 0;
+    Exception   e_;
+    try {
+      loopFunc(loopUserData, n, threadNum);
+    }
+    catch (Exception& e) {
+      err = 1;
+      e_ = e;
+    }
+    catch (std::bad_alloc&) {
+      err = 2;
+    }
+    catch (std::exception& e) {
+      err = 3;
+      msg = e.what();
+    }
+    catch (...) {
+      err = 4;
+    }
+    loopMutex.lock();
+    loopDone++;
+    if (err) {
+      loopNext = loopEnd;
+      if (!errorType) {
+        errorType = err;
+        errorException = e_;
+        if (msg)
+          errorMessage = msg;
+      }
+    }
+    loopMutex.unlock();
+  }
+
+  void ThreadPool::runLoop_(int threadNum)
+  {
+    while (true) {
+      loopMutex.lock();
+      int     n = loopNext;
+      if (n >= loopEnd) {
+        loopMutex.unlock();
+        break;
+      }
+      loopNext = n + 1;
+      loopMutex.unlock();
+      runItem(n, threadNum);
+    }
+  }
+
+  bool ThreadPool::run(void (*func)(void *userData, int n, int threadNum),
+                       void *userData, int nItems,
+                       bool (*progressFunc)(void *userData, int nDone),
+                       void *progressUserData)
+  {
+    if (nWorkerThreads < 1 || nItems < 2) {
+      for (int n = 0; n < nItems; n++) {
+        if (progressFunc) {
+          if (!progressFunc(progressUserData, n))
+            return false;
+        }
+        func(userData, n, 0);
+      }
+      return true;
+    }
+    loopFunc = func;
+    loopUserData = userData;
+    loopNext = 0;
+    loopEnd = nItems;
+    loopDone = 0;
+    errorType = 0;
+    errorMessage.clear();
+    int     nThreads = (nWorkerThreads < (nItems - 1) ?
+                        nWorkerThreads : (nItems - 1));
+    for (int i = 0; i < nThreads; i++)
+      workerThreads[i]->start();
+    // the calling thread also processes items, and updates the progress
+    // display (which may not be thread-safe) between them
+    bool    stopFlag = false;
+    while (true) {
+      loopMutex.lock();
+      int     n = loopNext;
+      int     nDone = loopDone;
+      if (n < loopEnd)
+        loopNext = n + 1;
+      loopMutex.unlock();
+      if (n >= nItems)
+        break;
+      if (progressFunc) {
+        if (!progressFunc(progressUserData, nDone)) {
+          stopFlag = true;
+          loopMutex.lock();
+          loopDone++;
+          loopNext = loopEnd;
+          loopMutex.unlock();
+          continue;
+        }
+      }
+      runItem(n, 0);
+    }
+    for (int i = 0; i < nThreads; i++)
+      workerThreads[i]->waitDone();
+    switch (errorType) {
+    case 1:
+      throw errorException;
+    case 2:
+      throw std::bad_alloc();
+    case 3:
+      throw std::runtime_error(errorMessage);
+    case 4:
+      throw Exception("unknown error in worker thread");
+    }
+    return !stopFlag;
+  }
+
+}       // namespace Ep128Emu
@@ -0,0 +1,106 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_THRPOOL_HPP
+#define EP128EMU_THRPOOL_HPP
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+
+#include <string>
+
+namespace Ep128Emu {
+
+  // Pool of worker threads for running the iterations of a loop in
+  // parallel. The calling thread also processes items, so a pool of N
+  // threads has N - 1 worker threads.
+
+  class ThreadPool {
+   private:
+    class WorkerThread : public Thread {
+     private:
+      ThreadPool& pool;
+      int     threadNum;
+      ThreadLock  doneLock;
+      volatile bool exitFlag;
+     protected:
+      virtual void run();
+     public:
+      WorkerThread(ThreadPool& pool_, int threadNum_);
+      virtual ~WorkerThread();
+      // wait until the current parallel loop is finished
+      inline void waitDone()
+      {
+        doneLock.wait();
+      }
+    };
+    // --------
+    WorkerThread  **workerThreads;
+    int     nWorkerThreads;
+    Mutex   loopMutex;
+    void    (*loopFunc)(void *userData, int n, int threadNum);
+    void    *loopUserData;
+    int     loopNext;
+    int     loopEnd;
+    int     loopDone;
+    // error from the first item that has thrown an exception:
+    // 0: none, 1: Ep128Emu::Exception (errorException), 2: std::bad_alloc,
+    // 3: other std::exception (errorMessage), 4: unknown
+    int     errorType;
+    Exception   errorException;
+    std::string errorMessage;
+    // ----------------
+    void runItem(int n, int threadNum);
+    // process items of the current parallel loop until there are none left
+    void runLoop_(int threadNum);
+   public:
+    ThreadPool();
+    virtual ~ThreadPool();
+    /*!
+     * Set the number of threads (1 to 64), including the calling thread.
+     */
+    void setNumberOfThreads(int n);
+    inline int getNumberOfThreads() const
+    {
+      return (nWorkerThreads + 1);
+    }
+    /*!
+     * Call func(userData, n, threadNum) for all values of 'n' from 0 to
+     * nItems - 1, distributing the calls among the threads. 'threadNum' is
+     * in the range 0 to getNumberOfThreads() - 1 (0 is the calling thread),
+     * and can be used to select per-thread data.
+     * If 'progressFunc' is not NULL, it is called by the calling thread
+     * before each item it processes, with the number of items already
+     * finished; if it returns false, no more items are started, and the
+     * return value is false.
+     * If 'func' throws an exception, the remaining items are skipped, and
+     * the exception is rethrown when all threads have finished; exceptions
+     * that are not Ep128Emu::Exception or std::bad_alloc are rethrown as
+     * std::runtime_error with the original message.
+     */
+    bool run(void (*func)(void *userData, int n, int threadNum),
+             void *userData, int nItems,
+             bool (*progressFunc)(void *userData, int nDone) =
+                 (bool (*)(void *, int)) 0,
+             void *progressUserData = (void *) 0);
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_THRPOOL_HPP
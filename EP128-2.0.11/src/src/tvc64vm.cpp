@@ -230,6 +230,10 @@ namespace TVC64 {
   {
     uint16_t  addr = uint16_t(R.PC.W.l);
     vm.memoryWaitM1(addr);
+    if (EP128EMU_UNLIKELY(int32_t(addr) == vm.exitAddress)) {
+      vm.updateCPUHalfCycles(4);
+      return vm.stopAtExitAddress();
+    }
     if (!vm.singleStepMode) {
       uint8_t   retval = vm.memory.readOpcode(addr);
       vm.updateCPUHalfCycles(4);
@@ -753,6 +757,7 @@ namespace TVC64 {
     case 0x5D:
       // bit 7: printer ready (unimplemented)
       // bit 6: color output enabled (1 = yes)
+      vm.tapeInputRead();
       retval = (~vm.irqState & 0x1F) | ((vm.tapeInputSignal & 1) << 5) | 0xC0;
       break;
     case 0x5A:                          // extension card ID byte
@@ -1118,6 +1123,17 @@ namespace TVC64 {
     vm.videoCapture->runOneCycle(vm.soundOutputSignal);
   }
 
+  uint8_t TVC64VM::stopAtExitAddress()
+  {
+    exitAddressReached = true;
+    // the HALT opcode returned is not executed while the CPU is stopped
+    z80.setStopFlag(true);
+    // return from run() after the current instruction
+    if (crtcCyclesRemainingH > 0)
+      crtcCyclesRemainingH = 0;
+    return 0x76;
+  }
+
   uint8_t TVC64VM::checkSingleStepModeBreak()
   {
     runDevices();
@@ -1473,22 +1489,12 @@ namespace TVC64 {
     // load file into memory
     std::vector<uint8_t>  buf;
     buf.resize(0x4000, 0xFF);
-    std::FILE *f = Ep128Emu::fileOpen(fileName, "rb");
-    if (!f)
-      throw Ep128Emu::Exception("cannot open ROM file");
-    std::fseek(f, 0L, SEEK_END);
-    long    dataSize = std::ftell(f) - long(offs);
-    if (dataSize < 0x0400L) {
-      std::fclose(f);
+    long    maxSize = ((n == 0x02 || n == 0x04) ? 0x2000L : 0x4000L);
+    long    dataSize =
+        readROMFile(&(buf.front()), fileName, offs, size_t(maxSize));
+    if (dataSize < 0x0400L)
       throw Ep128Emu::Exception("ROM file is shorter than expected");
-    }
-    if (n == 0x02 || n == 0x04)
-      dataSize = (dataSize < 0x2000L ? dataSize : 0x2000L);
-    else
-      dataSize = (dataSize < 0x4000L ? dataSize : 0x4000L);
-    std::fseek(f, long(offs), SEEK_SET);
-    std::fread(&(buf.front()), sizeof(uint8_t), size_t(dataSize), f);
-    std::fclose(f);
+    dataSize = (dataSize < maxSize ? dataSize : maxSize);
     // load new segment, or replace existing ROM
     memory.loadROMSegment(n, &(buf.front()), size_t(dataSize));
   }
@@ -1569,6 +1575,10 @@ namespace TVC64 {
     if (demoFile != (Ep128Emu::File *) 0 && !isRecordingDemo)
       stopDemoRecording(true);
     vmStatus_.isRecordingDemo = isRecordingDemo;
+    perfCounters.getStatus(vmStatus_.perfCounters);
+    getAudioOutput().getBufferStatistics(vmStatus_.audioBufferLevel,
+                                         vmStatus_.audioUnderrunCnt,
+                                         vmStatus_.audioOverrunCnt);
   }
 
   void TVC64VM::openVideoCapture(
@@ -1639,6 +1649,12 @@ namespace TVC64 {
 #endif
   }
 
+  void TVC64VM::setFloppyCacheSize(int nTracks)
+  {
+    for (int i = 0; i < 4; i++)
+      floppyDrives[i].setCacheSize(nTracks);
+  }
+
   uint32_t TVC64VM::getFloppyDriveLEDState()
   {
     uint32_t  n = 0U;
@@ -1807,6 +1823,12 @@ namespace TVC64 {
     singleStepModeNextAddr = addr;
   }
 
+  void TVC64VM::setExitAddress(int32_t addr)
+  {
+    VirtualMachine::setExitAddress(addr);
+    z80.setStopFlag(false);
+  }
+
   uint8_t TVC64VM::getMemoryPage(int n) const
   {
     return memory.getPage(uint8_t(n & 3));
@@ -207,6 +207,8 @@ namespace TVC64 {
     void stopDemoPlayback();
     void stopDemoRecording(bool writeFile_);
     uint8_t checkSingleStepModeBreak();
+    // called on the first opcode byte read at the exit address
+    uint8_t stopAtExitAddress();
     void convertKeyboardState();
     void resetKeyboard();
     void resetFloppyDrives(bool isColdReset);
@@ -289,6 +291,13 @@ namespace TVC64 {
     virtual void setDiskImageFile(int n, const std::string& fileName_,
                                   int nTracks_ = -1, int nSides_ = 2,
                                   int nSectorsPerTrack_ = 9);
+    /*!
+     * Set the number of floppy disk tracks to be cached in memory; modified
+     * tracks are written back to the image file by a background thread.
+     * 0 disables the cache, and a negative value caches the whole disk image.
+     * The change takes effect when the next floppy disk image is opened.
+     */
+    virtual void setFloppyCacheSize(int nTracks);
     /*!
      * Returns the current state of the disk drive LEDs, which is the sum
      * of any of the following values:
@@ -373,6 +382,11 @@ namespace TVC64 {
      * of 2 or 4.
      */
     virtual void setSingleStepModeNextAddress(int32_t addr);
+    /*!
+     * Set an address where the emulated program is stopped
+     * (see VirtualMachine::setExitAddress()).
+     */
+    virtual void setExitAddress(int32_t addr);
     /*!
      * Returns the segment at page 'n' (0 to 3).
      */
@@ -27,6 +27,18 @@ namespace TVC64 {
 
   void TVC64VM::saveState(Ep128Emu::File& f)
   {
+    if (!f.getIsCheckpoint()) {
+      // the disk images are not included in the snapshot, but they should
+      // be up to date when the snapshot is loaded (rewind checkpoints do not
+      // restore disk images, so these are left to the background flushing)
+      for (int i = 0; i < 4; i++) {
+        if (!floppyDrives[i].flushImage())
+          throw Ep128Emu::Exception("error writing floppy disk image file");
+      }
+#ifdef ENABLE_SDEXT
+      sdext.flushImage();
+#endif
+    }
     memory.saveState(f);
     ioPorts.saveState(f);
     crtc.saveState(f);
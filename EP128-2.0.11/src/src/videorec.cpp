@@ -104,6 +104,23 @@ namespace Ep128Emu {
     fileName.clear();
   }
 
+  VideoCapture::WriterThread::WriterThread(VideoCapture& videoCapture_)
+    : Thread(),
+      videoCapture(videoCapture_)
+  {
+  }
+
+  VideoCapture::WriterThread::~WriterThread()
+  {
+  }
+
+  void VideoCapture::WriterThread::run()
+  {
+    videoCapture.processQueue();
+  }
+
+  // --------------------------------------------------------------------------
+
   VideoCapture::VideoCapture(int frameRate_)
     : aviFile((std::FILE *) 0),
       audioBuf((int16_t *) 0),
@@ -123,11 +140,26 @@ namespace Ep128Emu {
       duplicateFrames(0),
       fileSize(0),
       audioConverter((AudioConverter *) 0),
+      audioInputBufPos(0),
       aviHeaderSize(0),
       errorCallback(&defaultErrorCallback),
       errorCallbackUserData((void *) this),
       fileNameCallback(&defaultFileNameCallback),
-      fileNameCallbackUserData((void *) this)
+      fileNameCallbackUserData((void *) this),
+      queueBuf((uint32_t *) 0),
+      curQueueBlock((uint32_t *) 0),
+      queueBlockPos(0),
+      audioRunHeader((uint32_t *) 0),
+      queueWriteIndex(0),
+      queueReadIndex(0),
+      queueBlocksUsed(0),
+      queueMaxBlocksUsed(0),
+      queueStallCnt(0),
+      queueStallTime(0.0),
+      writerRequestFlag(false),
+      writerFileNameRequested(false),
+      writerExitFlag(false),
+      writerThread((WriterThread *) 0)
   {
     try {
       frameRate = (frameRate > 24 ? (frameRate < 60 ? frameRate : 60) : 24);
@@ -139,23 +171,41 @@ namespace Ep128Emu {
         audioBuf[i] = int16_t(0);
       audioConverter =
           new AudioConverter_(*this, 222656.25f, float(sampleRate));
+      queueBuf = new uint32_t[queueBlocks * queueBlockSize];
+      curQueueBlock = queueBuf;
+      for (size_t i = 0; i < queueBlocks; i++)
+        queueBlockWords[i] = 0;
+      writerThread = new WriterThread(*this);
+      writerThread->start();
     }
     catch (...) {
       if (audioBuf)
         delete[] audioBuf;
       if (audioConverter)
         delete audioConverter;
+      if (queueBuf)
+        delete[] queueBuf;
       throw;
     }
   }
 
   VideoCapture::~VideoCapture()
   {
+    stopWriterThread();
     delete[] audioBuf;
     delete audioConverter;
+    delete[] queueBuf;
   }
 
   void VideoCapture::vsyncStateChange(bool newState, unsigned int currentSlot_)
+  {
+    uint32_t  *p = allocateQueueData(1);
+    p[0] = queueRecordVSync | (uint32_t(newState) << 8)
+           | uint32_t(currentSlot_ & 0xFFU);
+  }
+
+  void VideoCapture::vsyncStateChange_(bool newState,
+                                       unsigned int currentSlot_)
   {
     vsyncState = newState;
     if (newState &&
@@ -165,7 +215,33 @@ namespace Ep128Emu {
     }
   }
 
+  void VideoCapture::setClockFrequency(size_t freq_)
+  {
+    uint32_t  *p = allocateQueueData(2);
+    p[0] = queueRecordClockFreq;
+    p[1] = uint32_t(freq_);
+  }
+
+  void VideoCapture::horizontalSync(const uint8_t *buf, size_t nBytes)
+  {
+    uint32_t  *p = allocateQueueData(((nBytes + 3) >> 2) + 1);
+    p[0] = queueRecordLine | uint32_t(nBytes);
+    std::memcpy(&(p[1]), buf, nBytes);
+  }
+
   void VideoCapture::openFile(const char *fileName)
+  {
+    flushQueue();
+    queueMutex.lock();
+    queueMaxBlocksUsed = 0;
+    queueStallCnt = 0;
+    queueStallTime = 0.0;
+    queueMutex.unlock();
+    // the writer thread is now idle, so it is safe to access the file
+    openFile_(fileName);
+  }
+
+  void VideoCapture::openFile_(const char *fileName)
   {
     closeFile();
     if (fileName == (char *) 0 || fileName[0] == '\0')
@@ -205,6 +281,220 @@ namespace Ep128Emu {
     errorCallback(errorCallbackUserData, msg);
   }
 
+  void VideoCapture::writerError(const char *msg)
+  {
+    if (msg == (char *) 0 || msg[0] == '\0')
+      msg = "unknown video capture error";
+    queueMutex.lock();
+    if (writerErrorMessage.length() < 1)
+      writerErrorMessage = msg;
+    writerRequestFlag = true;
+    queueMutex.unlock();
+  }
+
+  bool VideoCapture::requestNewFileName(std::string& fileName,
+                                        const char *msg)
+  {
+    queueMutex.lock();
+    if (writerErrorMessage.length() < 1)
+      writerErrorMessage = msg;
+    writerNewFileName.clear();
+    writerFileNameRequested = true;
+    writerRequestFlag = true;
+    while (writerFileNameRequested && !writerExitFlag) {
+      queueMutex.unlock();
+      writerThreadLock.wait(100);
+      queueMutex.lock();
+    }
+    fileName = writerNewFileName;
+    bool    retval = !writerFileNameRequested;
+    writerFileNameRequested = false;
+    queueMutex.unlock();
+    return (retval && fileName.length() > 0);
+  }
+
+  void VideoCapture::processQueue()
+  {
+    queueMutex.lock();
+    while (true) {
+      if (queueBlocksUsed < 1) {
+        if (writerExitFlag)
+          break;
+        queueMutex.unlock();
+        writerThreadLock.wait(100);
+        queueMutex.lock();
+        continue;
+      }
+      const uint32_t  *buf = queueBuf + (queueReadIndex * queueBlockSize);
+      size_t  nWords = queueBlockWords[queueReadIndex];
+      queueMutex.unlock();
+      processQueueBlock(buf, nWords);
+      queueMutex.lock();
+      queueReadIndex = (queueReadIndex + 1) % queueBlocks;
+      queueBlocksUsed--;
+      freeBlockLock.notify();
+    }
+    queueMutex.unlock();
+  }
+
+  void VideoCapture::processQueueBlock(const uint32_t *buf, size_t nWords)
+  {
+    size_t  i = 0;
+    while (i < nWords) {
+      uint32_t  n = buf[i] & 0x0FFFFFFFU;
+      switch (buf[i++] & 0xF0000000U) {
+      case queueRecordAudio:
+        for ( ; n > 0U; n--)
+          runOneCycle_(buf[i++]);
+        break;
+      case queueRecordLine:
+        horizontalSync_(reinterpret_cast<const uint8_t *>(&(buf[i])),
+                        size_t(n));
+        i = i + ((size_t(n) + 3) >> 2);
+        break;
+      case queueRecordVSync:
+        vsyncStateChange_(bool(n & 0x0100U), (unsigned int) (n & 0xFFU));
+        break;
+      case queueRecordClockFreq:
+        setClockFrequency_(size_t(buf[i++]));
+        break;
+      default:
+        return;
+      }
+    }
+  }
+
+  uint32_t * VideoCapture::allocateQueueData(size_t nWords)
+  {
+    audioRunHeader = (uint32_t *) 0;
+    if ((queueBlockPos + nWords) > queueBlockSize)
+      submitQueueBlock();
+    uint32_t  *p = curQueueBlock + queueBlockPos;
+    queueBlockPos = queueBlockPos + nWords;
+    return p;
+  }
+
+  void VideoCapture::beginAudioRecord()
+  {
+    if ((queueBlockPos + 2) > queueBlockSize)
+      submitQueueBlock();
+    audioRunHeader = curQueueBlock + queueBlockPos;
+    *audioRunHeader = queueRecordAudio;
+    queueBlockPos++;
+  }
+
+  void VideoCapture::submitQueueBlock()
+  {
+    audioRunHeader = (uint32_t *) 0;
+    queueMutex.lock();
+    if (queueBlocksUsed >= (queueBlocks - 1)) {
+      // the queue is full, need to wait for the writer thread
+      Timer   stallTimer;
+      do {
+        bool    requestFlag = writerRequestFlag;
+        queueMutex.unlock();
+        if (requestFlag)
+          processWriterRequests();
+        freeBlockLock.wait(10);
+        queueMutex.lock();
+      } while (queueBlocksUsed >= (queueBlocks - 1));
+      queueStallCnt++;
+      queueStallTime += stallTimer.getRealTime();
+    }
+    queueBlockWords[queueWriteIndex] = queueBlockPos;
+    queueWriteIndex = (queueWriteIndex + 1) % queueBlocks;
+    queueBlocksUsed++;
+    if (queueBlocksUsed > queueMaxBlocksUsed)
+      queueMaxBlocksUsed = queueBlocksUsed;
+    bool    requestFlag = writerRequestFlag;
+    queueMutex.unlock();
+    writerThreadLock.notify();
+    curQueueBlock = queueBuf + (queueWriteIndex * queueBlockSize);
+    queueBlockPos = 0;
+    if (requestFlag)
+      processWriterRequests();
+  }
+
+  void VideoCapture::processWriterRequests()
+  {
+    queueMutex.lock();
+    std::string msg(writerErrorMessage);
+    writerErrorMessage.clear();
+    bool    fileNameRequested = writerFileNameRequested;
+    writerRequestFlag = false;
+    queueMutex.unlock();
+    if (fileNameRequested) {
+      try {
+        if (msg.length() > 0)
+          errorMessage(msg.c_str());
+      }
+      catch (...) {
+      }
+      std::string fileName = "";
+      try {
+        fileNameCallback(fileNameCallbackUserData, fileName);
+      }
+      catch (...) {
+        fileName.clear();
+      }
+      queueMutex.lock();
+      writerNewFileName = fileName;
+      writerFileNameRequested = false;
+      queueMutex.unlock();
+      writerThreadLock.notify();
+    }
+    else if (msg.length() > 0) {
+      errorMessage(msg.c_str());
+    }
+  }
+
+  void VideoCapture::flushQueue()
+  {
+    if (queueBlockPos > 0)
+      submitQueueBlock();
+    queueMutex.lock();
+    while (queueBlocksUsed > 0 || writerRequestFlag) {
+      bool    requestFlag = writerRequestFlag;
+      queueMutex.unlock();
+      if (requestFlag)
+        processWriterRequests();
+      else
+        freeBlockLock.wait(10);
+      queueMutex.lock();
+    }
+    queueMutex.unlock();
+  }
+
+  void VideoCapture::stopWriterThread()
+  {
+    if (!writerThread)
+      return;
+    try {
+      flushQueue();
+    }
+    catch (...) {
+    }
+    queueMutex.lock();
+    writerExitFlag = true;
+    queueMutex.unlock();
+    writerThreadLock.notify();
+    writerThread->join();
+    delete writerThread;
+    writerThread = (WriterThread *) 0;
+  }
+
+  void VideoCapture::getQueueStatistics(size_t& blocksUsed,
+                                        size_t& maxBlocksUsed,
+                                        size_t& stallCnt, double& stallTime)
+  {
+    queueMutex.lock();
+    blocksUsed = queueBlocksUsed;
+    maxBlocksUsed = queueMaxBlocksUsed;
+    stallCnt = queueStallCnt;
+    stallTime = queueStallTime;
+    queueMutex.unlock();
+  }
+
   void VideoCapture::setErrorCallback(void (*func)(void *userData,
                                                    const char *msg),
                                       void *userData_)
@@ -351,17 +641,18 @@ namespace Ep128Emu {
         delete[] colormap;
       throw;
     }
-    setClockFrequency(890625);
+    setClockFrequency_(890625);
   }
 
   VideoCapture_RLE8::~VideoCapture_RLE8()
   {
+    stopWriterThread();
     closeFile();
     delete[] frameSizes;
     delete[] colormap;
   }
 
-  void VideoCapture_RLE8::runOneCycle(uint32_t audioInput)
+  void VideoCapture_RLE8::runOneCycle_(uint32_t audioInput)
   {
     soundOutputAccumulatorL += uint32_t(audioInput & 0xFFFFU);
     soundOutputAccumulatorR += uint32_t(audioInput >> 16);
@@ -371,19 +662,20 @@ namespace Ep128Emu {
       uint32_t  tmpR = (soundOutputAccumulatorR + 1U) >> 1;
       soundOutputAccumulatorL = 0U;
       soundOutputAccumulatorR = 0U;
-      audioConverter->sendInputSignal(tmpL | (tmpR << 16));
+      sendAudioInput(tmpL | (tmpR << 16));
     }
   }
 
-  void VideoCapture_RLE8::setClockFrequency(size_t freq_)
+  void VideoCapture_RLE8::setClockFrequency_(size_t freq_)
   {
     if (freq_ == clockFrequency)
       return;
     clockFrequency = freq_;
+    flushAudioInput();
     audioConverter->setInputSampleRate(float(long(freq_)) * 0.5f);
   }
 
-  void VideoCapture_RLE8::horizontalSync(const uint8_t *buf, size_t nBytes)
+  void VideoCapture_RLE8::horizontalSync_(const uint8_t *buf, size_t nBytes)
   {
     if (curLine >= 0 && curLine < videoHeight) {
       uint8_t *p = &(tmpFrameBuf[curLine][0]);
@@ -421,6 +713,7 @@ namespace Ep128Emu {
 
   void VideoCapture_RLE8::frameDone()
   {
+    flushAudioInput();
     if (audioBufSamples >= (audioBufSize * 2)) {
       bool    frameChanged = false;
       for (int i = 0; i < videoHeight; i++) {
@@ -625,16 +918,12 @@ namespace Ep128Emu {
     try {
       if (fileSize >= 0x7F800000) {
         closeFile();
-        try {
-          errorMessage("AVI file is too large, starting new output file");
-        }
-        catch (...) {
-        }
         std::string fileName = "";
-        fileNameCallback(fileNameCallbackUserData, fileName);
-        if (fileName.length() < 1)
+        if (!requestNewFileName(fileName, "AVI file is too large, "
+                                          "starting new output file")) {
           return;
-        openFile(fileName.c_str());
+        }
+        openFile_(fileName.c_str());
       }
       if (std::fseek(aviFile, 0L, SEEK_END) < 0)
         throw Exception("error seeking AVI file");
@@ -698,7 +987,7 @@ namespace Ep128Emu {
     }
     catch (std::exception& e) {
       closeFile();
-      errorMessage(e.what());
+      writerError(e.what());
       return;
     }
     framesWritten++;
@@ -707,7 +996,7 @@ namespace Ep128Emu {
         writeAVIHeader();
       }
       catch (std::exception& e) {
-        errorMessage(e.what());
+        writerError(e.what());
       }
     }
   }
@@ -1069,18 +1358,19 @@ namespace Ep128Emu {
         delete[] colormap;
       throw;
     }
-    setClockFrequency(890625);
+    setClockFrequency_(890625);
   }
 
   VideoCapture_YV12::~VideoCapture_YV12()
   {
+    stopWriterThread();
     closeFile();
     delete[] reinterpret_cast<uint32_t *>(lineBuf);
     delete[] duplicateFrameBitmap;
     delete[] colormap;
   }
 
-  void VideoCapture_YV12::runOneCycle(uint32_t audioInput)
+  void VideoCapture_YV12::runOneCycle_(uint32_t audioInput)
   {
     soundOutputAccumulatorL += uint32_t(audioInput & 0xFFFFU);
     soundOutputAccumulatorR += uint32_t(audioInput >> 16);
@@ -1090,21 +1380,22 @@ namespace Ep128Emu {
       uint32_t  tmpR = (soundOutputAccumulatorR + 1U) >> 1;
       soundOutputAccumulatorL = 0U;
       soundOutputAccumulatorR = 0U;
-      audioConverter->sendInputSignal(tmpL | (tmpR << 16));
+      sendAudioInput(tmpL | (tmpR << 16));
     }
     curTime += timesliceLength;
   }
 
-  void VideoCapture_YV12::setClockFrequency(size_t freq_)
+  void VideoCapture_YV12::setClockFrequency_(size_t freq_)
   {
     if (freq_ == clockFrequency)
       return;
     clockFrequency = freq_;
     timesliceLength = (int64_t(1000000) << 32) / int64_t(freq_);
+    flushAudioInput();
     audioConverter->setInputSampleRate(float(long(freq_)) * 0.5f);
   }
 
-  void VideoCapture_YV12::horizontalSync(const uint8_t *buf, size_t nBytes)
+  void VideoCapture_YV12::horizontalSync_(const uint8_t *buf, size_t nBytes)
   {
     if (curLine >= 0 && curLine < (videoHeight * 2)) {
       uint8_t *p = lineBuf;
@@ -1629,6 +1920,7 @@ namespace Ep128Emu {
 
   void VideoCapture_YV12::frameDone()
   {
+    flushAudioInput();
     resampleFrame();
     while (audioBufSamples >= (audioBufSize * 2)) {
       audioBufSamples -= (audioBufSize * 2);
@@ -1738,16 +2030,12 @@ namespace Ep128Emu {
     try {
       if (fileSize >= 0x7F800000) {
         closeFile();
-        try {
-          errorMessage("AVI file is too large, starting new output file");
-        }
-        catch (...) {
-        }
         std::string fileName = "";
-        fileNameCallback(fileNameCallbackUserData, fileName);
-        if (fileName.length() < 1)
+        if (!requestNewFileName(fileName, "AVI file is too large, "
+                                          "starting new output file")) {
           return;
-        openFile(fileName.c_str());
+        }
+        openFile_(fileName.c_str());
       }
       if (std::fseek(aviFile, 0L, SEEK_END) < 0)
         throw Exception("error seeking AVI file");
@@ -1788,7 +2076,7 @@ namespace Ep128Emu {
     }
     catch (std::exception& e) {
       closeFile();
-      errorMessage(e.what());
+      writerError(e.what());
       return;
     }
     framesWritten++;
@@ -1797,7 +2085,7 @@ namespace Ep128Emu {
         writeAVIHeader();
       }
       catch (std::exception& e) {
-        errorMessage(e.what());
+        writerError(e.what());
       }
     }
   }
@@ -23,6 +23,7 @@
 #include "ep128emu.hpp"
 #include "display.hpp"
 #include "snd_conv.hpp"
+#include "system.hpp"
 
 namespace Ep128Emu {
 
@@ -30,6 +31,10 @@ namespace Ep128Emu {
    public:
     static const int  sampleRate = 48000;
     static const int  audioBuffers = 8;
+    // the input signals are sent to the writer thread in blocks of
+    // 'queueBlockSize' 32-bit words, up to 'queueBlocks' blocks are buffered
+    static const size_t queueBlockSize = 16384;
+    static const size_t queueBlocks = 256;
    protected:
     class AudioConverter_ : public AudioConverterHighQuality {
      private:
@@ -43,6 +48,20 @@ namespace Ep128Emu {
      protected:
       virtual void audioOutput(int16_t left, int16_t right);
     };
+    class WriterThread : public Thread {
+     private:
+      VideoCapture& videoCapture;
+     public:
+      WriterThread(VideoCapture& videoCapture_);
+      virtual ~WriterThread();
+     protected:
+      virtual void run();
+    };
+    // queue record header: type in bits 28 to 31, and a 28-bit parameter
+    static const uint32_t queueRecordAudio = 0x00000000U;   // N samples
+    static const uint32_t queueRecordLine = 0x10000000U;    // N bytes
+    static const uint32_t queueRecordVSync = 0x20000000U;   // state, slot
+    static const uint32_t queueRecordClockFreq = 0x30000000U;   // 1 word
     // --------
     std::FILE   *aviFile;
     int16_t     *audioBuf;              // 8 * (sampleRate / frameRate) frames
@@ -62,11 +81,37 @@ namespace Ep128Emu {
     size_t      duplicateFrames;
     size_t      fileSize;
     AudioConverter  *audioConverter;
+    // resampler input is buffered, and sent in blocks of up to 64 samples
+    uint32_t    audioInputBuf[64];
+    size_t      audioInputBufPos;
     size_t      aviHeaderSize;
     void        (*errorCallback)(void *userData, const char *msg);
     void        *errorCallbackUserData;
     void        (*fileNameCallback)(void *userData, std::string& fileName);
     void        *fileNameCallbackUserData;
+    // ---- queue of input data, written by the emulation thread ----
+    uint32_t    *queueBuf;              // queueBlocks * queueBlockSize words
+    uint32_t    *curQueueBlock;         // block being filled
+    size_t      queueBlockPos;          // write position in curQueueBlock
+    uint32_t    *audioRunHeader;        // header of current audio record
+    size_t      queueBlockWords[queueBlocks];
+    size_t      queueWriteIndex;        // index of curQueueBlock
+    size_t      queueReadIndex;         // block processed by writer thread
+    size_t      queueBlocksUsed;        // number of blocks waiting
+    size_t      queueMaxBlocksUsed;
+    size_t      queueStallCnt;
+    double      queueStallTime;
+    Mutex       queueMutex;
+    ThreadLock  writerThreadLock;       // notified when a block is queued
+    ThreadLock  freeBlockLock;          // notified when a block is written
+    // requests from the writer thread that are handled by the emulation
+    // thread, because the callbacks may not be thread safe
+    bool        writerRequestFlag;
+    bool        writerFileNameRequested;
+    bool        writerExitFlag;
+    std::string writerErrorMessage;
+    std::string writerNewFileName;
+    WriterThread  *writerThread;
     // ----------------
     static void aviHeader_writeFourCC(uint8_t*& bufp, const char *s);
     static void aviHeader_writeUInt16(uint8_t*& bufp, uint16_t n);
@@ -75,13 +120,58 @@ namespace Ep128Emu {
     static void defaultFileNameCallback(void *userData, std::string& fileName);
     virtual void writeAVIHeader() = 0;
     virtual void writeAVIIndex() = 0;
+    // these functions do the actual processing of the input signals,
+    // and are called from the writer thread
+    virtual void runOneCycle_(uint32_t audioInput) = 0;
+    virtual void setClockFrequency_(size_t freq_) = 0;
+    virtual void horizontalSync_(const uint8_t *buf, size_t nBytes) = 0;
+    void vsyncStateChange_(bool newState, unsigned int currentSlot_);
+    void openFile_(const char *fileName);
     void closeFile();
     void errorMessage(const char *msg);
+    // called from the writer thread
+    void writerError(const char *msg);
+    // print 'msg', and ask for the name of a new output file to continue
+    // writing; returns false if no file name is given
+    bool requestNewFileName(std::string& fileName, const char *msg);
+    void processQueue();
+    void processQueueBlock(const uint32_t *buf, size_t nWords);
+    // called from the emulation thread
+    uint32_t *allocateQueueData(size_t nWords);
+    void beginAudioRecord();
+    void submitQueueBlock();
+    void processWriterRequests();
+    void flushQueue();
+    // flushes the queue and stops the writer thread; this needs to be
+    // called by the destructor of derived classes
+    void stopWriterThread();
+    inline void sendAudioInput(uint32_t audioData)
+    {
+      audioInputBuf[audioInputBufPos] = audioData;
+      if (++audioInputBufPos >= 64)
+        flushAudioInput();
+    }
+    inline void flushAudioInput()
+    {
+      if (audioInputBufPos) {
+        audioConverter->sendInputSignalBlock(&(audioInputBuf[0]),
+                                             audioInputBufPos);
+        audioInputBufPos = 0;
+      }
+    }
    public:
     VideoCapture(int frameRate_ = 50);
     virtual ~VideoCapture();
-    virtual void runOneCycle(uint32_t audioInput) = 0;
-    virtual void setClockFrequency(size_t freq_) = 0;
+    inline void runOneCycle(uint32_t audioInput)
+    {
+      if (EP128EMU_UNLIKELY(!audioRunHeader ||
+                            queueBlockPos >= queueBlockSize)) {
+        beginAudioRecord();
+      }
+      curQueueBlock[queueBlockPos++] = audioInput;
+      (*audioRunHeader)++;
+    }
+    void setClockFrequency(size_t freq_);
     /*!
      * horizontalSync() should be called after rendering each line.
      * 'buf' defines a line of 768 pixels, as 48 groups of 16 pixels each,
@@ -100,20 +190,35 @@ namespace Ep128Emu {
      *         is 1
      *   0x08: eight 8-bit color indices (pixel width = 2)
      * The buffer contains 'nBytes' (in the range of 96 to 432) bytes of data.
+     * The data is only copied to the queue of the writer thread, where the
+     * encoding and file I/O is done.
      */
-    virtual void horizontalSync(const uint8_t *buf, size_t nBytes) = 0;
+    void horizontalSync(const uint8_t *buf, size_t nBytes);
     /*!
      * Called at the beginning (newState = true) and end (newState = false)
      * of VSYNC. 'currentSlot_' is the position within the current line
      * (0 to 56).
      */
     void vsyncStateChange(bool newState, unsigned int currentSlot_);
+    /*!
+     * Wait until all queued data is written, and then close the current
+     * output file and open 'fileName' (no file is written if the name is
+     * empty).
+     */
     void openFile(const char *fileName);
     void setErrorCallback(void (*func)(void *userData, const char *msg),
                           void *userData_);
     void setFileNameCallback(void (*func)(void *userData,
                                           std::string& fileName),
                              void *userData_);
+    /*!
+     * Returns the number of queue blocks not written yet, the highest number
+     * since the output file was opened, and the number of times and total
+     * time in seconds the emulation thread had to wait for the writer thread
+     * because the queue was full.
+     */
+    void getQueueStatistics(size_t& blocksUsed, size_t& maxBlocksUsed,
+                            size_t& stallCnt, double& stallTime);
   };
 
   // --------------------------------------------------------------------------
@@ -169,15 +274,15 @@ namespace Ep128Emu {
     void writeFrame(bool frameChanged);
     virtual void writeAVIHeader();
     virtual void writeAVIIndex();
+    virtual void runOneCycle_(uint32_t audioInput);
+    virtual void setClockFrequency_(size_t freq_);
+    virtual void horizontalSync_(const uint8_t *buf, size_t nBytes);
    public:
     VideoCapture_RLE8(void indexToRGBFunc(uint8_t color,
                                           float& r, float& g, float& b) =
                           (void (*)(uint8_t, float&, float&, float&)) 0,
                       int frameRate_ = 50);
     virtual ~VideoCapture_RLE8();
-    virtual void runOneCycle(uint32_t audioInput);
-    virtual void setClockFrequency(size_t freq_);
-    virtual void horizontalSync(const uint8_t *buf, size_t nBytes);
   };
 
   // --------------------------------------------------------------------------
@@ -216,15 +321,15 @@ namespace Ep128Emu {
     void writeFrame(bool frameChanged);
     virtual void writeAVIHeader();
     virtual void writeAVIIndex();
+    virtual void runOneCycle_(uint32_t audioInput);
+    virtual void setClockFrequency_(size_t freq_);
+    virtual void horizontalSync_(const uint8_t *buf, size_t nBytes);
    public:
     VideoCapture_YV12(void indexToRGBFunc(uint8_t color,
                                           float& r, float& g, float& b) =
                           (void (*)(uint8_t, float&, float&, float&)) 0,
                       int frameRate_ = 30);
     virtual ~VideoCapture_YV12();
-    virtual void runOneCycle(uint32_t audioInput);
-    virtual void setClockFrequency(size_t freq_);
-    virtual void horizontalSync(const uint8_t *buf, size_t nBytes);
   };
 
 }       // namespace Ep128Emu
@@ -27,6 +27,7 @@
 #include "vm.hpp"
 #include "debuglib.hpp"
 
+#include <map>
 #include <typeinfo>
 
 #include <sys/types.h>
@@ -46,6 +47,17 @@ static const char *fileOpenErrorMessages[7] = {
   "File already exists"
 };
 
+// ROM image files shared by all VirtualMachine instances; files larger
+// than romFileCacheMaxSize bytes are read directly without caching
+struct ROMFileCacheEntry {
+  std::vector< uint8_t >  data;
+  int64_t   modTime;
+};
+
+static const size_t romFileCacheMaxSize = 0x00100000;
+static Ep128Emu::Mutex  romFileCacheMutex;
+static std::map< std::string, ROMFileCacheEntry > romFileCache;
+
 static void defaultBreakPointCallback(void *userData,
                                       int type, uint16_t addr, uint8_t value)
 {
@@ -83,10 +95,12 @@ namespace Ep128Emu {
   class AudioConverter_ : public T {
    private:
     AudioOutput&  audioOutput_;
+    PerfCounters& perfCounters;
     int16_t       buf[32];
     size_t        bufPos;
    public:
     AudioConverter_(AudioOutput& audioOutput__,
+                    PerfCounters& perfCounters_,
                     float inputSampleRate_,
                     float outputSampleRate_,
                     float dcBlockFreq1 = 10.0f,
@@ -95,6 +109,7 @@ namespace Ep128Emu {
       : T(inputSampleRate_, outputSampleRate_,
           dcBlockFreq1, dcBlockFreq2, ampScale_),
         audioOutput_(audioOutput__),
+        perfCounters(perfCounters_),
         bufPos(0)
     {
     }
@@ -107,7 +122,10 @@ namespace Ep128Emu {
       buf[bufPos++] = right;
       if (bufPos >= 32) {
         bufPos = 0;
+        PerfCounters::Sample  tmp;
+        perfCounters.begin(tmp);
         audioOutput_.sendAudioData(&(buf[0]), 16);
+        perfCounters.end(PerfCounters::AUDIO_OUTPUT, tmp, 16U);
       }
     }
   };
@@ -117,6 +135,7 @@ namespace Ep128Emu {
     : display(display_),
       audioOutput(audioOutput_),
       audioConverter((AudioConverter *) 0),
+      audioInputBufferPos(0),
       writingAudioOutput(false),
       audioOutputEnabled(true),
       audioOutputHighQuality(false),
@@ -140,17 +159,27 @@ namespace Ep128Emu {
       tapeEnableSoundFileFilter(false),
       tapeSoundFileFilterMinFreq(500.0f),
       tapeSoundFileFilterMaxFreq(5000.0f),
+      fastTapeLoadingEnabled(false),
+      tapeInputReadCnt(0U),
+      tapeInputReadThreshold(1U),
       breakPointCallback(&defaultBreakPointCallback),
       breakPointCallbackUserData((void *) 0),
       fileIOEnabled(false),
+      exitAddress(-1),
+      exitAddressReached(false),
 #ifndef WIN32
       fileIOWorkingDirectory("./"),
 #else
       fileIOWorkingDirectory(".\\"),
 #endif
       fileNameCallback(&defaultFileNameCallback),
-      fileNameCallbackUserData((void *) 0)
+      fileNameCallbackUserData((void *) 0),
+      userBreakPointCallback(&defaultBreakPointCallback),
+      userBreakPointCallbackUserData((void *) 0),
+      breakPointFlag(false)
   {
+    breakPointCallback = &breakPointCallbackWrapper;
+    breakPointCallbackUserData = (void *) this;
   }
 
   VirtualMachine::~VirtualMachine()
@@ -165,9 +194,25 @@ namespace Ep128Emu {
     }
   }
 
+  void VirtualMachine::flushAudioOutput_()
+  {
+    if (writingAudioOutput) {
+      PerfCounters::Sample  tmp;
+      perfCounters.begin(tmp);
+      audioConverter->sendInputSignalBlock(&(audioInputBuffer[0]),
+                                           audioInputBufferPos);
+      perfCounters.end(PerfCounters::AUDIO_CONVERTER, tmp,
+                       audioInputBufferPos);
+    }
+    audioInputBufferPos = 0;
+  }
+
   void VirtualMachine::run(size_t microseconds)
   {
-    (void) microseconds;
+    breakPointFlag = false;
+    perfCounters.updateLog(double(long(microseconds)) * 0.000001);
+    // send any samples left over from the previous call
+    flushAudioOutput();
     if (audioConverter == (AudioConverter *) 0) {
       if (audioOutputEnabled) {
         // open audio converter if needed
@@ -175,13 +220,13 @@ namespace Ep128Emu {
         if (audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
           if (audioOutputHighQuality)
             audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-                audioOutput,
+                audioOutput, perfCounters,
                 audioConverterSampleRate, audioOutputSampleRate,
                 audioOutputFilter1Freq, audioOutputFilter2Freq,
                 audioOutputVolume);
           else
             audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-                audioOutput,
+                audioOutput, perfCounters,
                 audioConverterSampleRate, audioOutputSampleRate,
                 audioOutputFilter1Freq, audioOutputFilter2Freq,
                 audioOutputVolume);
@@ -196,10 +241,19 @@ namespace Ep128Emu {
       audioOutputSampleRate = audioOutput.getSampleRate();
       audioConverter->setOutputSampleRate(audioOutputSampleRate);
     }
+    if (audioConverter) {
+      // follow the audio clock by resampling, based on the buffer level
+      float   rateCorrection = audioOutput.getRateCorrection();
+      if (rateCorrection != audioConverter->getRateCorrection())
+        audioConverter->setRateCorrection(rateCorrection);
+    }
     writingAudioOutput =
         (audioConverter != (AudioConverter *) 0 && audioOutputEnabled);
     if (haveTape() && getIsTapeMotorOn() && getTapeButtonState() != 0)
       stopDemo();
+    // the tape input needs to be read at least 16 times per millisecond
+    tapeInputReadCnt = 0U;
+    tapeInputReadThreshold = uint32_t(microseconds >> 6) + 1U;
   }
 
   void VirtualMachine::reset(bool isColdReset)
@@ -250,6 +304,7 @@ namespace Ep128Emu {
     if (useHighQualityResample != audioOutputHighQuality) {
       audioOutputHighQuality = useHighQualityResample;
       if (audioConverter) {
+        flushAudioOutput();
         delete audioConverter;
         audioConverter = (AudioConverter *) 0;
       }
@@ -258,13 +313,13 @@ namespace Ep128Emu {
           audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
         if (audioOutputHighQuality)
           audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-              audioOutput,
+              audioOutput, perfCounters,
               audioConverterSampleRate, audioOutputSampleRate,
               audioOutputFilter1Freq, audioOutputFilter2Freq,
               audioOutputVolume);
         else
           audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-              audioOutput,
+              audioOutput, perfCounters,
               audioConverterSampleRate, audioOutputSampleRate,
               audioOutputFilter1Freq, audioOutputFilter2Freq,
               audioOutputVolume);
@@ -326,6 +381,8 @@ namespace Ep128Emu {
 
   void VirtualMachine::setEnableAudioOutput(bool isEnabled)
   {
+    if (!isEnabled)
+      flushAudioOutput();
     audioOutputEnabled = isEnabled;
     writingAudioOutput =
         (audioConverter != (AudioConverter *) 0 && audioOutputEnabled);
@@ -356,6 +413,11 @@ namespace Ep128Emu {
     (void) isEnabled;
   }
 
+  void VirtualMachine::setEnableFastCPUEmulation(bool isEnabled)
+  {
+    (void) isEnabled;
+  }
+
   void VirtualMachine::setKeyboardState(int keyCode, bool isPressed)
   {
     (void) keyCode;
@@ -379,8 +441,41 @@ namespace Ep128Emu {
     vmStatus_.tapeSampleRate = getTapeSampleRate();
     vmStatus_.tapeSampleSize = getTapeSampleSize();
     vmStatus_.floppyDriveLEDState = getFloppyDriveLEDState();
+    for (int i = 0; i < 4; i++) {
+      vmStatus_.ideSectorsRead[i] = 0U;
+      vmStatus_.ideSectorsWritten[i] = 0U;
+      vmStatus_.ideFileIOCalls[i] = 0U;
+    }
+    vmStatus_.videoCaptureQueueBlocks = 0U;
+    vmStatus_.videoCaptureQueueMaxBlocks = 0U;
+    vmStatus_.videoCaptureStallCnt = 0U;
+    vmStatus_.videoCaptureStallTime = 0.0;
     vmStatus_.isPlayingDemo = getIsPlayingDemo();
     vmStatus_.isRecordingDemo = getIsRecordingDemo();
+    perfCounters.getStatus(vmStatus_.perfCounters);
+    getAudioOutput().getBufferStatistics(vmStatus_.audioBufferLevel,
+                                         vmStatus_.audioUnderrunCnt,
+                                         vmStatus_.audioOverrunCnt);
+  }
+
+  void VirtualMachine::resetPerfCounters()
+  {
+    perfCounters.reset();
+  }
+
+  void VirtualMachine::openPerfCounterLog(std::FILE *f, double interval)
+  {
+    perfCounters.openLog(f, interval);
+  }
+
+  void VirtualMachine::closePerfCounterLog()
+  {
+    perfCounters.closeLog();
+  }
+
+  bool VirtualMachine::getIsPerfCounterLogOpen() const
+  {
+    return perfCounters.isLogOpen();
   }
 
   void VirtualMachine::openVideoCapture(
@@ -434,6 +529,16 @@ namespace Ep128Emu {
     (void) nSectorsPerTrack_;
   }
 
+  void VirtualMachine::setIDEFlushInterval(int msec)
+  {
+    (void) msec;
+  }
+
+  void VirtualMachine::setFloppyCacheSize(int nTracks)
+  {
+    (void) nTracks;
+  }
+
   uint32_t VirtualMachine::getFloppyDriveLEDState()
   {
     return 0U;
@@ -626,6 +731,36 @@ namespace Ep128Emu {
       tape->setIsMotorOn(tapeMotorOn);
   }
 
+  void VirtualMachine::setEnableFastTapeLoading(bool isEnabled)
+  {
+    fastTapeLoadingEnabled = isEnabled;
+  }
+
+  bool VirtualMachine::getIsFastTapeLoading() const
+  {
+    return (fastTapeLoadingEnabled && tape != (Tape *) 0 &&
+            tapeMotorOn && tapePlaybackOn && !tapeRecordOn &&
+            tapeInputReadCnt >= tapeInputReadThreshold);
+  }
+
+  void VirtualMachine::runWithoutOutput(size_t microseconds)
+  {
+    bool    savedAudioOutputEnabled = audioOutputEnabled;
+    bool    savedDisplayEnabled = displayEnabled;
+    setEnableAudioOutput(false);
+    setEnableDisplay(false);
+    try {
+      run(microseconds);
+    }
+    catch (...) {
+      setEnableAudioOutput(savedAudioOutputEnabled);
+      setEnableDisplay(savedDisplayEnabled);
+      throw;
+    }
+    setEnableAudioOutput(savedAudioOutputEnabled);
+    setEnableDisplay(savedDisplayEnabled);
+  }
+
   void VirtualMachine::setBreakPoints(const BreakPointList& bpList)
   {
     for (size_t i = 0; i < bpList.getBreakPointCnt(); i++)
@@ -657,16 +792,75 @@ namespace Ep128Emu {
     (void) addr;
   }
 
+  void VirtualMachine::setExitAddress(int32_t addr)
+  {
+    exitAddress = (addr >= 0 ? (addr & 0xFFFF) : -1);
+    exitAddressReached = false;
+  }
+
+  void VirtualMachine::openExecutionTrace(std::FILE *f,
+                                          size_t maxInstructions,
+                                          bool ringMode)
+  {
+    (void) maxInstructions;
+    (void) ringMode;
+    if (f)
+      std::fclose(f);
+    throw Exception("execution trace is not supported "
+                    "by this virtual machine");
+  }
+
+  void VirtualMachine::closeExecutionTrace()
+  {
+  }
+
+  bool VirtualMachine::getIsExecutionTraceOn() const
+  {
+    return false;
+  }
+
+  void VirtualMachine::startProfiler()
+  {
+    throw Exception("the profiler is not supported by this virtual machine");
+  }
+
+  void VirtualMachine::stopProfiler()
+  {
+  }
+
+  bool VirtualMachine::getIsProfilerOn() const
+  {
+    return false;
+  }
+
+  void VirtualMachine::writeProfilerReport(std::FILE *f, int format,
+                                           const char *symbolFileName)
+  {
+    (void) f;
+    (void) format;
+    (void) symbolFileName;
+    throw Exception("no profiling data is available");
+  }
+
   void VirtualMachine::setBreakPointCallback(void (*breakPointCallback_)(
                                                  void *userData, int type,
                                                  uint16_t addr, uint8_t value),
                                              void *userData_)
   {
     if (breakPointCallback_)
-      breakPointCallback = breakPointCallback_;
+      userBreakPointCallback = breakPointCallback_;
     else
-      breakPointCallback = &defaultBreakPointCallback;
-    breakPointCallbackUserData = userData_;
+      userBreakPointCallback = &defaultBreakPointCallback;
+    userBreakPointCallbackUserData = userData_;
+  }
+
+  void VirtualMachine::breakPointCallbackWrapper(void *userData, int type,
+                                                 uint16_t addr, uint8_t value)
+  {
+    VirtualMachine& vm = *(reinterpret_cast<VirtualMachine *>(userData));
+    vm.breakPointFlag = true;
+    vm.userBreakPointCallback(vm.userBreakPointCallbackUserData,
+                              type, addr, value);
   }
 
   uint8_t VirtualMachine::getMemoryPage(int n) const
@@ -857,6 +1051,7 @@ namespace Ep128Emu {
     if (sampleRate_ != audioConverterSampleRate) {
       audioConverterSampleRate = sampleRate_;
       if (audioConverter) {
+        flushAudioOutput();
         audioConverter->setInputSampleRate(audioConverterSampleRate);
         return;
       }
@@ -865,13 +1060,13 @@ namespace Ep128Emu {
           audioConverterSampleRate > 0.0f && audioOutputSampleRate > 0.0f) {
         if (audioOutputHighQuality)
           audioConverter = new AudioConverter_<AudioConverterHighQuality>(
-              audioOutput,
+              audioOutput, perfCounters,
               audioConverterSampleRate, audioOutputSampleRate,
               audioOutputFilter1Freq, audioOutputFilter2Freq,
               audioOutputVolume);
         else
           audioConverter = new AudioConverter_<AudioConverterLowQuality>(
-              audioOutput,
+              audioOutput, perfCounters,
               audioConverterSampleRate, audioOutputSampleRate,
               audioOutputFilter1Freq, audioOutputFilter2Freq,
               audioOutputVolume);
@@ -996,6 +1191,100 @@ namespace Ep128Emu {
     return fileOpenErrorMessages[1];
   }
 
+  long VirtualMachine::readROMFile(uint8_t *buf, const char *fileName,
+                                   size_t offs, size_t nBytes)
+  {
+    if (fileName == (char *) 0 || fileName[0] == '\0')
+      throw Exception("cannot open ROM file");
+    // the size and modification time are checked on every call, so that
+    // changes to the file are not missed
+    int64_t fileSize = -1;
+    int64_t modTime = 0;
+    {
+#ifndef WIN32
+      struct stat   st;
+      std::memset(&st, 0, sizeof(struct stat));
+      int   err = stat(fileName, &st);
+      bool  isRegularFile = bool(S_ISREG(st.st_mode));
+#else
+      struct _stat  st;
+      std::memset(&st, 0, sizeof(struct _stat));
+      int   err = fileStat(fileName, &st);
+      bool  isRegularFile = bool(st.st_mode & _S_IFREG);
+#endif
+      if (err == 0 && isRegularFile) {
+        fileSize = int64_t(st.st_size);
+        modTime = int64_t(st.st_mtime);
+      }
+    }
+    if (fileSize < 0)
+      throw Exception("cannot open ROM file");
+    long    nBytesAvail = long(fileSize) - long(offs);
+    size_t  nBytesCopied = 0;
+    if (nBytesAvail > 0)
+      nBytesCopied = (size_t(nBytesAvail) < nBytes ?
+                      size_t(nBytesAvail) : nBytes);
+    if (size_t(fileSize) > romFileCacheMaxSize) {
+      if (nBytesCopied > 0) {
+        std::FILE *f = fileOpen(fileName, "rb");
+        if (!f)
+          throw Exception("cannot open ROM file");
+        bool    errorFlag = (std::fseek(f, long(offs), SEEK_SET) != 0);
+        if (!errorFlag)
+          errorFlag = (std::fread(buf, sizeof(uint8_t), nBytesCopied, f)
+                       != nBytesCopied);
+        std::fclose(f);
+        if (errorFlag)
+          throw Exception("error reading ROM file");
+      }
+      return nBytesAvail;
+    }
+    romFileCacheMutex.lock();
+    try {
+      std::map< std::string, ROMFileCacheEntry >::iterator  i =
+          romFileCache.find(fileName);
+      if (i != romFileCache.end()) {
+        if ((*i).second.data.size() != size_t(fileSize) ||
+            (*i).second.modTime != modTime) {
+          romFileCache.erase(i);
+          i = romFileCache.end();
+        }
+      }
+      if (i == romFileCache.end()) {
+        ROMFileCacheEntry tmp;
+        tmp.data.resize(size_t(fileSize));
+        tmp.modTime = modTime;
+        std::FILE *f = fileOpen(fileName, "rb");
+        if (!f)
+          throw Exception("cannot open ROM file");
+        size_t  n = 0;
+        if (fileSize > 0)
+          n = std::fread(&(tmp.data.front()), sizeof(uint8_t), tmp.data.size(),
+                         f);
+        std::fclose(f);
+        if (n != tmp.data.size())
+          throw Exception("error reading ROM file");
+        i = romFileCache.insert(std::pair< std::string, ROMFileCacheEntry >(
+                                    fileName, tmp)).first;
+      }
+      if (nBytesCopied > 0)
+        std::memcpy(buf, &((*i).second.data[offs]), nBytesCopied);
+    }
+    catch (...) {
+      romFileCacheMutex.unlock();
+      throw;
+    }
+    romFileCacheMutex.unlock();
+    return nBytesAvail;
+  }
+
+  void VirtualMachine::clearROMFileCache()
+  {
+    romFileCacheMutex.lock();
+    romFileCache.clear();
+    romFileCacheMutex.unlock();
+  }
+
   size_t VirtualMachine::loadMemory(const char *fileName, bool verifyMode,
                                     bool asciiMode, bool cpuAddressMode,
                                     uint32_t startAddr, uint32_t endAddr)
@@ -27,6 +27,7 @@
 #include "snd_conv.hpp"
 #include "soundio.hpp"
 #include "tape.hpp"
+#include "perfcnt.hpp"
 
 namespace Ep128 {
   struct Z80_REGISTERS;
@@ -38,8 +39,12 @@ namespace Ep128Emu {
    protected:
     VideoDisplay&   display;
    private:
+    static const size_t audioInputBufferSize = 256;
     AudioOutput&    audioOutput;
     AudioConverter  *audioConverter;
+    // input samples are sent to the audio converter in blocks
+    uint32_t        audioInputBuffer[audioInputBufferSize];
+    size_t          audioInputBufferPos;
     bool            writingAudioOutput;
     bool            audioOutputEnabled;
     bool            audioOutputHighQuality;
@@ -66,15 +71,35 @@ namespace Ep128Emu {
     bool            tapeEnableSoundFileFilter;
     float           tapeSoundFileFilterMinFreq;
     float           tapeSoundFileFilterMaxFreq;
+    bool            fastTapeLoadingEnabled;
+    // number of times the emulated program has read the tape input during
+    // the last call of run() (see tapeInputRead())
+    uint32_t        tapeInputReadCnt;
+    // minimum value of tapeInputReadCnt for detecting tape loading
+    uint32_t        tapeInputReadThreshold;
    protected:
+    PerfCounters    perfCounters;
     void            (*breakPointCallback)(void *userData, int type,
                                           uint16_t addr, uint8_t value);
     void            *breakPointCallbackUserData;
     bool            fileIOEnabled;
+    // CPU address where the emulated program is stopped, or -1
+    int32_t         exitAddress;
+    bool            exitAddressReached;
    private:
     std::string     fileIOWorkingDirectory;
     void            (*fileNameCallback)(void *userData, std::string& fileName);
     void            *fileNameCallbackUserData;
+    // breakPointCallback always points to breakPointCallbackWrapper(), which
+    // sets breakPointFlag, and calls the function set with
+    // setBreakPointCallback()
+    void            (*userBreakPointCallback)(void *userData, int type,
+                                              uint16_t addr, uint8_t value);
+    void            *userBreakPointCallbackUserData;
+    // true if a breakpoint was triggered during the last call of run()
+    bool            breakPointFlag;
+    static void breakPointCallbackWrapper(void *userData, int type,
+                                          uint16_t addr, uint8_t value);
    public:
     struct VMStatus {
       bool      isRecordingDemo;
@@ -102,6 +127,26 @@ namespace Ep128Emu {
       //   0x04000000: IDE drive 3 red LED is on (low priority)
       //   0x0C000000: IDE drive 3 red LED is on (high priority)
       uint32_t  floppyDriveLEDState;
+      // IDE drive I/O statistics since the disk image was opened: the number
+      // of sectors read and written, and host file I/O calls made
+      uint32_t  ideSectorsRead[4];
+      uint32_t  ideSectorsWritten[4];
+      uint32_t  ideFileIOCalls[4];
+      // video capture writer thread: the number of queue blocks not written
+      // yet, the highest number since the AVI file was opened, and the
+      // number of times and total time in seconds the emulation had to wait
+      // because the queue was full
+      uint32_t  videoCaptureQueueBlocks;
+      uint32_t  videoCaptureQueueMaxBlocks;
+      uint32_t  videoCaptureStallCnt;
+      double    videoCaptureStallTime;
+      // audio output: the smoothed buffer fill level (0.0 to 1.0), and the
+      // number of buffer underruns and overruns since the device was opened
+      float     audioBufferLevel;
+      uint32_t  audioUnderrunCnt;
+      uint32_t  audioOverrunCnt;
+      // host time spent in each subsystem (see perfcnt.hpp)
+      PerfCounters::Status  perfCounters;
     };
     // --------
     VirtualMachine(VideoDisplay& display_, AudioOutput& audioOutput_);
@@ -203,6 +248,12 @@ namespace Ep128Emu {
      * Set if emulation of memory timing is enabled.
      */
     virtual void setEnableMemoryTimingEmulation(bool isEnabled);
+    /*!
+     * Set if the CPU emulation may use faster code paths that are not
+     * compatible with the debugger; these are disabled automatically while
+     * debugging. The emulated timing is not changed.
+     */
+    virtual void setEnableFastCPUEmulation(bool isEnabled);
     /*!
      * Set state of key 'keyCode' (0 to 127).
      */
@@ -232,6 +283,23 @@ namespace Ep128Emu {
      * individual status values).
      */
     virtual void getVMStatus(VMStatus& vmStatus_);
+    /*!
+     * Clear the performance counters returned in VMStatus::perfCounters.
+     */
+    void resetPerfCounters();
+    inline void getPerfCounters(PerfCounters::Status& s) const
+    {
+      perfCounters.getStatus(s);
+    }
+    /*!
+     * Write the performance counters to 'f' in CSV format every 'interval'
+     * seconds of emulated time (see PerfCounters::openLog()). The file is
+     * closed by closePerfCounterLog(), or when the virtual machine is
+     * destroyed.
+     */
+    void openPerfCounterLog(std::FILE *f, double interval = 1.0);
+    void closePerfCounterLog();
+    bool getIsPerfCounterLogOpen() const;
     /*!
      * Create video capture object with the specified frame rate (24 to 60)
      * and format (768x576 RLE8 or 384x288 YV12) if it does not exist yet,
@@ -281,6 +349,18 @@ namespace Ep128Emu {
     virtual void setDiskImageFile(int n, const std::string& fileName_,
                                   int nTracks_ = -1, int nSides_ = 2,
                                   int nSectorsPerTrack_ = 9);
+    /*!
+     * Set the maximum time in milliseconds to keep written sectors of
+     * memory mapped IDE disk images cached before flushing them to the file.
+     */
+    virtual void setIDEFlushInterval(int msec);
+    /*!
+     * Set the number of floppy disk tracks to be cached in memory; modified
+     * tracks are written back to the image file by a background thread.
+     * 0 disables the cache, and a negative value caches the whole disk image.
+     * The change takes effect when the next floppy disk image is opened.
+     */
+    virtual void setFloppyCacheSize(int nTracks);
     /*!
      * Returns the current state of the disk drive LEDs, which is the sum
      * of any of the following values:
@@ -411,6 +491,24 @@ namespace Ep128Emu {
      * control from the emulated machine.
      */
     virtual void setForceTapeMotorOn(bool isEnabled);
+    /*!
+     * If enabled, the emulation thread (see vmthread.hpp) runs without
+     * speed limit, and with audio and video output disabled, while the
+     * emulated program is loading from tape (see getIsFastTapeLoading()).
+     * This only changes the speed of the emulation relative to real time,
+     * the emulated machine runs exactly the same way.
+     */
+    virtual void setEnableFastTapeLoading(bool isEnabled);
+    /*!
+     * Returns true if fast tape loading is enabled, the tape is playing
+     * with the motor on, and the emulated program has been reading the tape
+     * input in a loop during the last call of run().
+     */
+    bool getIsFastTapeLoading() const;
+    /*!
+     * Run emulation like run(), but with audio and video output disabled.
+     */
+    void runWithoutOutput(size_t microseconds);
     // ------------------------------ DEBUGGING -------------------------------
     /*!
      * Add breakpoints from the specified breakpoint list (see also
@@ -449,6 +547,75 @@ namespace Ep128Emu {
      * of 2 or 4.
      */
     virtual void setSingleStepModeNextAddress(int32_t addr);
+    /*!
+     * Set an address where the emulated program is stopped; unlike a
+     * breakpoint, this is checked only when reading the first opcode byte,
+     * and does not disable the fast memory access paths. When the CPU is
+     * about to execute the instruction at 'addr', it is stopped with the PC
+     * still at 'addr', run() returns after at most a few cycles, and
+     * getIsExitAddressReached() returns true. The CPU remains stopped until
+     * this function is called again. A negative 'addr' disables the exit
+     * address.
+     */
+    virtual void setExitAddress(int32_t addr);
+    inline bool getIsExitAddressReached() const
+    {
+      return exitAddressReached;
+    }
+    /*!
+     * Returns true if the breakpoint callback was called during the last
+     * call of run(), or the exit address has been reached (see
+     * setExitAddress()). This can be used to stop running more time slices
+     * without returning to the main loop.
+     */
+    inline bool getIsBreakPointTriggered() const
+    {
+      return (breakPointFlag || exitAddressReached);
+    }
+    /*!
+     * Start writing a binary execution trace (see exectrace.hpp) to 'f',
+     * which is closed by the virtual machine when the trace is stopped, or
+     * if this function fails. At most 'maxInstructions' instructions are
+     * written; if 'ringMode' is true, then only the last 'maxInstructions'
+     * instructions are kept, and are written to the file when the trace is
+     * stopped. Any previously opened trace is closed first.
+     * Throws Ep128Emu::Exception on error, or if execution tracing is not
+     * supported by the virtual machine.
+     */
+    virtual void openExecutionTrace(std::FILE *f, size_t maxInstructions,
+                                    bool ringMode = false);
+    /*!
+     * Stop execution trace, and write any buffered data to the file.
+     */
+    virtual void closeExecutionTrace();
+    /*!
+     * Returns true if an execution trace is being written.
+     */
+    virtual bool getIsExecutionTraceOn() const;
+    /*!
+     * Clear any previously collected profiling data, and start counting the
+     * CPU cycles spent on each instruction of the emulated program (see
+     * z80prof.hpp). Throws Ep128Emu::Exception if the profiler is not
+     * supported by the virtual machine.
+     */
+    virtual void startProfiler();
+    /*!
+     * Stop the profiler; the data is kept until the next startProfiler().
+     */
+    virtual void stopProfiler();
+    /*!
+     * Returns true if the profiler is running.
+     */
+    virtual bool getIsProfilerOn() const;
+    /*!
+     * Write the profiling data to 'f' (which is not closed) in the specified
+     * format (0: flat profile, hot spots, and call graph as text, 1: collapsed
+     * stacks for flame graph tools). If 'symbolFileName' is not NULL or
+     * empty, symbol names are read from this Sjasm symbol file.
+     * Throws Ep128Emu::Exception on error, or if there is no profiling data.
+     */
+    virtual void writeProfilerReport(std::FILE *f, int format,
+                                     const char *symbolFileName = (char *) 0);
     /*!
      * Set function to be called when a breakpoint is triggered.
      * 'type' can be one of the following values:
@@ -628,22 +795,38 @@ namespace Ep128Emu {
     virtual void loadState(File::Buffer& buf);
     virtual void loadMachineConfiguration(File::Buffer& buf);
     virtual void loadDemo(File::Buffer& buf);
+   private:
+    void flushAudioOutput_();
    protected:
     inline void sendAudioOutput(uint32_t audioData)
     {
-      if (this->writingAudioOutput)
-        this->audioConverter->sendInputSignal(audioData);
+      if (this->writingAudioOutput) {
+        this->audioInputBuffer[this->audioInputBufferPos] = audioData;
+        if (EP128EMU_UNLIKELY(++(this->audioInputBufferPos)
+                              >= audioInputBufferSize)) {
+          this->flushAudioOutput_();
+        }
+      }
     }
     inline void sendAudioOutput(uint16_t left, uint16_t right)
     {
-      if (this->writingAudioOutput)
-        this->audioConverter->sendInputSignal(uint32_t(left)
-                                              | (uint32_t(right) << 16));
+      this->sendAudioOutput(uint32_t(left) | (uint32_t(right) << 16));
     }
     inline void sendMonoAudioOutput(int32_t audioData)
     {
-      if (this->writingAudioOutput)
+      if (this->writingAudioOutput) {
+        if (this->audioInputBufferPos)
+          this->flushAudioOutput_();
         this->audioConverter->sendMonoInputSignal(audioData);
+      }
+    }
+    /*!
+     * Send any buffered audio input samples to the audio converter.
+     */
+    inline void flushAudioOutput()
+    {
+      if (this->audioInputBufferPos)
+        this->flushAudioOutput_();
     }
     /*!
      * This function is similar to the public setTapeFileName(), but allows
@@ -682,12 +865,18 @@ namespace Ep128Emu {
       if (this->tape != (Tape *) 0 &&
           this->tapeMotorOn && this->tapePlaybackOn) {
         if (this->tapeRecordOn) {
+          PerfCounters::Sample  tmp;
+          this->perfCounters.begin(tmp);
           this->tape->setInputSignal(tapeInput);
           this->tape->runOneSample();
+          this->perfCounters.end(PerfCounters::TAPE_IO, tmp);
           return 0;
         }
         else {
+          PerfCounters::Sample  tmp;
+          this->perfCounters.begin(tmp);
           this->tape->runOneSample();
+          this->perfCounters.end(PerfCounters::TAPE_IO, tmp);
           return (this->tape->getOutputSignal());
         }
       }
@@ -697,8 +886,31 @@ namespace Ep128Emu {
     {
       return this->displayEnabled;
     }
+    /*!
+     * Should be called by derived classes when the emulated CPU reads the
+     * I/O port that has the tape input bit, for detecting tape loading.
+     */
+    inline void tapeInputRead()
+    {
+      this->tapeInputReadCnt++;
+    }
     void setAudioConverterSampleRate(float sampleRate_);
+    /*!
+     * Copy at most 'nBytes' bytes of ROM image file 'fileName', starting
+     * from offset 'offs', to 'buf'. Returns the number of bytes available
+     * in the file after 'offs' (this may be less than 'nBytes', or negative),
+     * or throws Ep128Emu::Exception if the file cannot be opened or read.
+     * ROM files are cached in memory, and the cache is shared by all
+     * virtual machine instances in the process, so running multiple
+     * machines in parallel threads does not read the same files repeatedly.
+     */
+    static long readROMFile(uint8_t *buf, const char *fileName,
+                            size_t offs, size_t nBytes);
    public:
+    /*!
+     * Free all ROM files cached by readROMFile().
+     */
+    static void clearROMFileCache();
     /*!
      * Open a file in the user specified working directory. 'fileName_' is the
      * file name without any leading directory components; it is converted to
@@ -0,0 +1,349 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "fileio.hpp"
+#include "display.hpp"
+#include "soundio.hpp"
+#include "vm.hpp"
+#include "emucfg.hpp"
+#include "vmpool.hpp"
+
+namespace Ep128Emu {
+
+  static void vmPoolConfigErrorCallback(void *userData, const char *msg)
+  {
+    // configuration errors are not fatal, but the first one is reported
+    // if the job fails later
+    std::string&  s = *(reinterpret_cast<std::string *>(userData));
+    if (s.empty())
+      s = msg;
+  }
+
+  // --------------------------------------------------------------------------
+
+  VMPool::Job::Job()
+    : machineType(0),
+      maxTime(-1.0),
+      maxCycles(-1.0),
+      exitAddress(-1),
+      timesliceCallback((bool (*)(void *, VirtualMachine&)) 0),
+      userData((void *) 0),
+      exitReason(0),
+      exitPC(0),
+      emulatedTime(0.0),
+      realTime(0.0),
+      frameCount(0U)
+  {
+  }
+
+  // --------------------------------------------------------------------------
+
+  VMPool::WorkerThread::WorkerThread(VMPool& pool_, int threadNum_)
+    : Thread(),
+      pool(pool_),
+      threadNum(threadNum_)
+  {
+  }
+
+  VMPool::WorkerThread::~WorkerThread()
+  {
+  }
+
+  void VMPool::WorkerThread::run()
+  {
+    pool.workerThreadLoop(threadNum);
+  }
+
+  // --------------------------------------------------------------------------
+
+  VMPool::VMPool(VMFactoryFunc factoryFunc_, int nThreads, bool pinThreads_)
+    : factoryFunc(factoryFunc_),
+      nextJob(0),
+      pinThreads(pinThreads_),
+      exitFlag(false)
+  {
+    if (!factoryFunc)
+      throw Exception("VMPool: invalid factory function");
+    if (nThreads < 1)
+      nThreads = getProcessorCount();
+    nThreads = (nThreads < 256 ? nThreads : 256);
+    try {
+      for (int i = 0; i < nThreads; i++) {
+        workerThreads.push_back((WorkerThread *) 0);
+        workerThreads[i] = new WorkerThread(*this, i);
+      }
+    }
+    catch (...) {
+      exitFlag = true;
+      for (size_t i = 0; i < workerThreads.size(); i++) {
+        if (workerThreads[i]) {
+          workerThreads[i]->start();
+          jobQueueLock.notify();
+          delete workerThreads[i];
+        }
+      }
+      throw;
+    }
+    for (size_t i = 0; i < workerThreads.size(); i++)
+      workerThreads[i]->start();
+  }
+
+  VMPool::~VMPool()
+  {
+    waitAll();
+    mutex_.lock();
+    exitFlag = true;
+    mutex_.unlock();
+    jobQueueLock.notify();
+    for (size_t i = 0; i < workerThreads.size(); i++)
+      delete workerThreads[i];          // the destructor calls join()
+    workerThreads.clear();
+    for (size_t i = 0; i < jobs.size(); i++)
+      delete jobs[i];
+    jobs.clear();
+  }
+
+  int VMPool::addJob(const Job& job)
+  {
+    Job     *p = new Job(job);
+    p->exitReason = 0;
+    p->exitPC = 0;
+    p->emulatedTime = 0.0;
+    p->realTime = 0.0;
+    p->frameCount = 0U;
+    p->errorMessage.clear();
+    mutex_.lock();
+    int     n = int(jobs.size());
+    try {
+      jobs.push_back(p);
+      jobStatus.push_back(0);
+    }
+    catch (...) {
+      if (jobs.size() > jobStatus.size())
+        jobs.pop_back();
+      mutex_.unlock();
+      delete p;
+      throw;
+    }
+    mutex_.unlock();
+    jobQueueLock.notify();
+    return n;
+  }
+
+  bool VMPool::getJobResult(Job& job, int n, bool waitFlag)
+  {
+    while (true) {
+      mutex_.lock();
+      if (n < 0 || size_t(n) >= jobs.size()) {
+        mutex_.unlock();
+        throw Exception("VMPool: invalid job number");
+      }
+      if (jobStatus[n] == 2) {
+        // finished jobs are not modified by the worker threads anymore
+        Job   *p = jobs[n];
+        mutex_.unlock();
+        job = *p;
+        return true;
+      }
+      mutex_.unlock();
+      if (!waitFlag)
+        return false;
+      // there may be more than one waiting thread, so poll with a timeout
+      jobDoneLock.wait(10);
+    }
+  }
+
+  void VMPool::waitAll()
+  {
+    while (true) {
+      mutex_.lock();
+      bool    doneFlag = true;
+      for (size_t i = 0; i < jobStatus.size(); i++) {
+        if (jobStatus[i] != 2) {
+          doneFlag = false;
+          break;
+        }
+      }
+      mutex_.unlock();
+      if (doneFlag)
+        break;
+      jobDoneLock.wait(10);
+    }
+  }
+
+  void VMPool::workerThreadLoop(int threadNum)
+  {
+    if (pinThreads) {
+      // not an error if this fails
+      (void) setThreadAffinity(threadNum % getProcessorCount());
+    }
+    while (true) {
+      mutex_.lock();
+      if (nextJob >= jobs.size()) {
+        bool    exitFlag_ = exitFlag;
+        mutex_.unlock();
+        if (exitFlag_) {
+          // wake up the next thread, so that all of them can exit
+          jobQueueLock.notify();
+          return;
+        }
+        jobQueueLock.wait(100);
+        continue;
+      }
+      size_t  n = nextJob++;
+      Job&    job = *(jobs[n]);
+      jobStatus[n] = 1;
+      bool    moreJobs = (nextJob < jobs.size());
+      mutex_.unlock();
+      if (moreJobs)
+        jobQueueLock.notify();
+      runJob(job);
+      mutex_.lock();
+      jobStatus[n] = 2;
+      mutex_.unlock();
+      jobDoneLock.notify();
+    }
+  }
+
+  void VMPool::runJob(Job& job)
+  {
+    NullDisplay     *display = (NullDisplay *) 0;
+    AudioOutput     *audioOutput = (AudioOutput *) 0;
+    VirtualMachine  *vm = (VirtualMachine *) 0;
+#ifdef ENABLE_MIDI_PORT
+    MIDIPort        *midiPort = (MIDIPort *) 0;
+#endif
+    EmulatorConfiguration *config = (EmulatorConfiguration *) 0;
+    int         exitReason = 0;
+    uint16_t    exitPC = 0;
+    std::string cfgErrorMessage;
+    Timer       realTime;
+    try {
+      display = new NullDisplay();
+      // the base class does not open any audio device
+      audioOutput = new AudioOutput();
+      vm = factoryFunc(job.machineType, *display, *audioOutput);
+      if (!vm)
+        throw Exception("VMPool: unsupported machine type");
+#ifdef ENABLE_MIDI_PORT
+      midiPort = new MIDIPort(*vm);
+#endif
+      config = new EmulatorConfiguration(*vm, *display, *audioOutput
+#ifdef ENABLE_MIDI_PORT
+                                         , *midiPort
+#endif
+                                         );
+      config->setErrorCallback(&vmPoolConfigErrorCallback,
+                               (void *) &cfgErrorMessage);
+      if (!job.baseConfigFile.empty()) {
+        try {
+          File    f(job.baseConfigFile.c_str(), true);
+          config->registerChunkType(f);
+          f.processAllChunks();
+        }
+        catch (...) {
+        }
+      }
+      for (size_t i = 0; i < job.configFiles.size(); i++)
+        config->loadState(job.configFiles[i].c_str(), false);
+      for (size_t i = 0; i < job.configSettings.size(); i++) {
+        const std::string&  s = job.configSettings[i];
+        size_t  n = s.find('=');
+        if (n == std::string::npos)
+          (*config)[s] = bool(true);
+        else
+          (*config)[s.substr(0, n)] = s.c_str() + (n + 1);
+      }
+      // no audio output, and the display only counts frames
+      config->sound.enabled = false;
+      config->display.enabled = true;
+      config->vm.speedPercentage = 0U;
+      config->soundSettingsChanged = true;
+      config->displaySettingsChanged = true;
+      config->applySettings();
+      if (!job.snapshotFile.empty()) {
+        File    f(job.snapshotFile.c_str(), false);
+        vm->registerChunkTypes(f);
+        f.processAllChunks();
+      }
+      // the exit address is checked on opcode reads without using a
+      // breakpoint, and stops the time slice before the instruction
+      vm->setExitAddress(job.exitAddress);
+      double  maxTime = job.maxTime;
+      if (job.maxCycles > 0.0) {
+        double  tmp =
+            job.maxCycles / double(int(config->vm.cpuClockFrequency));
+        maxTime = ((maxTime > 0.0 && maxTime < tmp) ? maxTime : tmp);
+      }
+      // emulation is run in 2 ms time slices, like in VMThread
+      realTime.reset();
+      while (exitReason == 0) {
+        if (maxTime > 0.0 && job.emulatedTime >= (maxTime - 0.0000005))
+          break;
+        vm->run(2000);
+        job.emulatedTime += 0.002;
+        if (vm->getIsExitAddressReached()) {
+          exitReason = 1;
+          exitPC = uint16_t(job.exitAddress);
+        }
+        else if (job.timesliceCallback) {
+          if (job.timesliceCallback(job.userData, *vm)) {
+            exitReason = 2;
+            exitPC = vm->getProgramCounter();
+          }
+        }
+      }
+      job.realTime = realTime.getRealTime();
+      job.exitReason = exitReason;
+      job.exitPC = (exitReason > 0 ? exitPC : vm->getProgramCounter());
+      job.frameCount = display->getFrameCount();
+      if (!job.saveFile.empty()) {
+        File    f;
+        vm->saveState(f);
+        f.writeFile(job.saveFile.c_str());
+      }
+    }
+    catch (std::exception& e) {
+      job.realTime = realTime.getRealTime();
+      job.exitReason = -1;
+      job.errorMessage = e.what();
+      if (!cfgErrorMessage.empty()) {
+        job.errorMessage += " (";
+        job.errorMessage += cfgErrorMessage;
+        job.errorMessage += ")";
+      }
+    }
+    if (config)
+      delete config;
+#ifdef ENABLE_MIDI_PORT
+    if (midiPort)
+      delete midiPort;
+#endif
+    if (vm)
+      delete vm;
+    if (display)
+      delete display;
+    if (audioOutput)
+      delete audioOutput;
+  }
+
+}       // namespace Ep128Emu
+
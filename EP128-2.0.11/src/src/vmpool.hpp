@@ -0,0 +1,149 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_VMPOOL_HPP
+#define EP128EMU_VMPOOL_HPP
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "display.hpp"
+#include "soundio.hpp"
+#include "vm.hpp"
+
+#include <vector>
+
+namespace Ep128Emu {
+
+  // Runs independent emulation jobs on a pool of worker threads. Each job
+  // creates its own virtual machine, display, audio output and
+  // configuration database on the worker thread, runs the emulation at
+  // unlimited speed until an exit condition is met, and then destroys the
+  // machine. ROM image files are read only once per process (see
+  // VirtualMachine::readROMFile()), and Enterprise ROM segments are shared
+  // by all machines through ROMStore.
+  // Virtual machines are created by a factory function supplied by the
+  // application, since this library does not depend on the machine
+  // specific ones.
+
+  class VMPool {
+   public:
+    // create a virtual machine of type 'machineType' (0: Enterprise,
+    // 1: Spectrum, 2: CPC, 3: TVC), or throw an exception if the type is
+    // not supported
+    typedef VirtualMachine * (*VMFactoryFunc)(int machineType,
+                                              VideoDisplay& display_,
+                                              AudioOutput& audioOutput_);
+    struct Job {
+      int       machineType;
+      // binary format configuration file to load first, (e.g.
+      // "ep128cfg.dat"); it is ignored if it cannot be opened
+      std::string baseConfigFile;
+      // ASCII format configuration files to load, in this order
+      std::vector< std::string >  configFiles;
+      // additional configuration variables in "NAME=VALUE" format, or
+      // "NAME" to set a boolean variable to true
+      std::vector< std::string >  configSettings;
+      // snapshot to load after applying the configuration (optional)
+      std::string snapshotFile;
+      // snapshot to save on exit, unless there was an error (optional)
+      std::string saveFile;
+      // maximum emulated time in seconds (<= 0: unlimited)
+      double    maxTime;
+      // maximum number of CPU cycles at the configured clock frequency
+      // (<= 0: unlimited)
+      double    maxCycles;
+      // stop when the CPU executes this address (-1: not used)
+      int32_t   exitAddress;
+      // if not NULL, called on the worker thread after each 2 ms time slice;
+      // if it returns true, the job is stopped with exitReason = 2
+      bool      (*timesliceCallback)(void *userData, VirtualMachine& vm_);
+      void      *userData;
+      // ---- results, valid when the job is finished ----
+      // 0: time limit reached, 1: exit address reached, 2: stopped by the
+      // callback, -1: error (see errorMessage)
+      int       exitReason;
+      uint16_t  exitPC;
+      double    emulatedTime;
+      double    realTime;
+      uint64_t  frameCount;
+      std::string errorMessage;
+      // --------
+      Job();
+    };
+   protected:
+    class WorkerThread : public Thread {
+     private:
+      VMPool&   pool;
+      int       threadNum;
+     public:
+      WorkerThread(VMPool& pool_, int threadNum_);
+      virtual ~WorkerThread();
+     protected:
+      virtual void run();
+    };
+    // --------
+    VMFactoryFunc factoryFunc;
+    std::vector< WorkerThread * > workerThreads;
+    std::vector< Job * >  jobs;
+    // 0: queued, 1: running, 2: finished
+    std::vector< uint8_t >  jobStatus;
+    size_t    nextJob;
+    bool      pinThreads;
+    bool      exitFlag;
+    Mutex     mutex_;
+    ThreadLock  jobQueueLock;   // signaled when a job is added
+    ThreadLock  jobDoneLock;    // signaled when a job is finished
+    // --------
+    void workerThreadLoop(int threadNum);
+    void runJob(Job& job);
+   public:
+    // Create a pool of 'nThreads' worker threads (0: one per processor).
+    // If 'pinThreads_' is true, each thread is restricted to a different
+    // processor where supported.
+    VMPool(VMFactoryFunc factoryFunc_, int nThreads = 0,
+           bool pinThreads_ = true);
+    // waits for all queued jobs to finish
+    virtual ~VMPool();
+    inline int getThreadCount() const
+    {
+      return int(workerThreads.size());
+    }
+    // Queue a copy of 'job'; it is started as soon as a worker thread is
+    // available. Returns the index of the job, which can be passed to
+    // getJobResult().
+    int addJob(const Job& job);
+    // Wait until job 'n' is finished, and copy it to 'job' (including the
+    // results). If 'waitFlag' is false, false is returned without waiting
+    // if the job is not finished yet.
+    bool getJobResult(Job& job, int n, bool waitFlag = true);
+    // Wait until all queued jobs are finished.
+    void waitAll();
+    inline int getJobCount()
+    {
+      mutex_.lock();
+      int     n = int(jobs.size());
+      mutex_.unlock();
+      return n;
+    }
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_VMPOOL_HPP
+
@@ -21,6 +21,7 @@
 #include "system.hpp"
 #include "vm.hpp"
 #include "vmthread.hpp"
+#include "rewind.hpp"
 
 static void defaultErrorCallback(void *userData_, const char *msg)
 {
@@ -53,6 +54,11 @@ namespace Ep128Emu {
       avgTimesliceLength(0.002f),
       prvTime(0.0),
       nxtTime(0.0),
+      rewindBuffer((RewindBuffer *) 0),
+      rewindInterval(0),
+      rewindTimeCnt(0),
+      rewindMemoryLimit(0),
+      rewindConfigChanged(false),
       userData(userData_),
       errorCallback(&defaultErrorCallback),
       processCallback((void (*)(void *)) 0)
@@ -65,6 +71,18 @@ namespace Ep128Emu {
     vmStatus.tapeSampleRate = 0L;
     vmStatus.tapeSampleSize = 0;
     vmStatus.floppyDriveLEDState = 0U;
+    for (int i = 0; i < 4; i++) {
+      vmStatus.ideSectorsRead[i] = 0U;
+      vmStatus.ideSectorsWritten[i] = 0U;
+      vmStatus.ideFileIOCalls[i] = 0U;
+    }
+    vmStatus.videoCaptureQueueBlocks = 0U;
+    vmStatus.videoCaptureQueueMaxBlocks = 0U;
+    vmStatus.videoCaptureStallCnt = 0U;
+    vmStatus.videoCaptureStallTime = 0.0;
+    vmStatus.audioBufferLevel = 0.0f;
+    vmStatus.audioUnderrunCnt = 0U;
+    vmStatus.audioOverrunCnt = 0U;
     for (int i = 0; i < 128; i++)
       keyboardState[i] = false;
     this->start();
@@ -73,6 +91,8 @@ namespace Ep128Emu {
   VMThread::~VMThread()
   {
     this->quit(true);
+    if (rewindBuffer)
+      delete rewindBuffer;
   }
 
   void VMThread::cleanup()
@@ -117,8 +137,12 @@ namespace Ep128Emu {
     mutex_.unlock();
   }
 
-  bool VMThread::process()
+  bool VMThread::process(size_t *emulatedTime)
   {
+    size_t  tmpEmulatedTime = 0;
+    if (!emulatedTime)
+      emulatedTime = &tmpEmulatedTime;
+    (*emulatedTime) = 0;
     // check and process any pending messages
     mutex_.lock();
     while (true) {
@@ -156,6 +180,29 @@ namespace Ep128Emu {
       freeMessageStack = m;
     }
     nxtTime += double(timesliceLength);
+    if (rewindConfigChanged) {
+      rewindConfigChanged = false;
+      try {
+        if (rewindInterval <= 0) {
+          if (rewindBuffer) {
+            delete rewindBuffer;
+            rewindBuffer = (RewindBuffer *) 0;
+          }
+        }
+        else if (!rewindBuffer) {
+          rewindBuffer = new RewindBuffer(vm, rewindMemoryLimit);
+          rewindTimeCnt = 0;
+        }
+        else {
+          rewindBuffer->setMemoryLimit(rewindMemoryLimit);
+        }
+      }
+      catch (std::exception& e) {
+        mutex_.unlock();
+        errorCallback(userData, e.what());
+        mutex_.lock();
+      }
+    }
     mutex_.unlock();
     // run emulation, or wait if paused
     double  curTime = prvTime;
@@ -164,11 +211,44 @@ namespace Ep128Emu {
         processCallback(userData);
       if (!pauseFlag) {
         vm.run(2000);
+        (*emulatedTime) += 2000;
+        if (vm.getIsFastTapeLoading() && !vm.getIsBreakPointTriggered()) {
+          // the emulated program is loading from tape: instead of waiting
+          // for the end of the timeslice, run more emulation without audio
+          // and video output (if the speed is not limited by the timer,
+          // then the audio output would block, so run for 1.5 ms);
+          // stop if a breakpoint is triggered, so that the callback can
+          // pause or stop emulation before the next time slice
+          double  endTime = nxtTime;
+          if (timesliceLength <= 0.0f)
+            endTime = speedTimer.getRealTime() + 0.0015;
+          do {
+            vm.runWithoutOutput(2000);
+            (*emulatedTime) += 2000;
+            if (rewindBuffer)
+              rewindTimeCnt += 2000;
+          } while (vm.getIsFastTapeLoading() &&
+                   !vm.getIsBreakPointTriggered() &&
+                   speedTimer.getRealTime() < endTime);
+        }
+        if (rewindBuffer) {
+          rewindTimeCnt += 2000;
+          if (rewindTimeCnt >= rewindInterval) {
+            rewindTimeCnt = 0;
+            rewindBuffer->checkpoint();
+          }
+        }
         curTime = speedTimer.getRealTime();
-        if (curTime < nxtTime)
+        if (timesliceLength <= 0.0f) {
+          // unlimited speed: no pacing at all
+          nxtTime = curTime;
+        }
+        else if (curTime < nxtTime) {
           Timer::wait(nxtTime - curTime);
-        else if (curTime > (nxtTime + 0.25))
+        }
+        else if (curTime > (nxtTime + 0.25)) {
           nxtTime = curTime;
+        }
       }
       else {
         Timer::wait(0.01);
@@ -242,6 +322,20 @@ namespace Ep128Emu {
     tapeSampleRate = vmThread_.vmStatus.tapeSampleRate;
     tapeSampleSize = vmThread_.vmStatus.tapeSampleSize;
     floppyDriveLEDState = vmThread_.vmStatus.floppyDriveLEDState;
+    for (int i = 0; i < 4; i++) {
+      ideSectorsRead[i] = vmThread_.vmStatus.ideSectorsRead[i];
+      ideSectorsWritten[i] = vmThread_.vmStatus.ideSectorsWritten[i];
+      ideFileIOCalls[i] = vmThread_.vmStatus.ideFileIOCalls[i];
+    }
+    videoCaptureQueueBlocks = vmThread_.vmStatus.videoCaptureQueueBlocks;
+    videoCaptureQueueMaxBlocks =
+        vmThread_.vmStatus.videoCaptureQueueMaxBlocks;
+    videoCaptureStallCnt = vmThread_.vmStatus.videoCaptureStallCnt;
+    videoCaptureStallTime = vmThread_.vmStatus.videoCaptureStallTime;
+    audioBufferLevel = vmThread_.vmStatus.audioBufferLevel;
+    audioUnderrunCnt = vmThread_.vmStatus.audioUnderrunCnt;
+    audioOverrunCnt = vmThread_.vmStatus.audioOverrunCnt;
+    perfCounters = vmThread_.vmStatus.perfCounters;
     if (vmThread_.exitFlag)
       threadStatus = (vmThread_.errorFlag ? -1 : 1);
     vmThread_.mutex_.unlock();
@@ -402,6 +496,21 @@ namespace Ep128Emu {
     mutex_.unlock();
   }
 
+  void VMThread::setRewindParameters(int nFrames, size_t memoryLimit)
+  {
+    mutex_.lock();
+    rewindInterval = (nFrames > 0 ? (nFrames < 3000 ? nFrames : 3000) : 0)
+                     * 20000;
+    rewindMemoryLimit = memoryLimit;
+    rewindConfigChanged = true;
+    mutex_.unlock();
+  }
+
+  void VMThread::rewind()
+  {
+    queueMessage(allocateMessage<Message_Rewind>());
+  }
+
   VMThread::Message * VMThread::allocateMessage_()
   {
     mutex_.lock();
@@ -563,6 +672,24 @@ namespace Ep128Emu {
     vmThread.vm.stopDemo();
   }
 
+  VMThread::Message_Rewind::~Message_Rewind()
+  {
+  }
+
+  void VMThread::Message_Rewind::process()
+  {
+    RewindBuffer  *p = vmThread.rewindBuffer;
+    if (!p)
+      return;
+    // go back one more checkpoint if the last one is too recent, so that
+    // repeated rewinding is possible
+    size_t  n = ((vmThread.rewindTimeCnt * 2) < vmThread.rewindInterval ?
+                 1 : 0);
+    if (!p->rewind(n))
+      p->rewind(0);
+    vmThread.rewindTimeCnt = 0;
+  }
+
   VMThread::Message_Dummy::~Message_Dummy()
   {
   }
@@ -26,6 +26,8 @@
 
 namespace Ep128Emu {
 
+  class RewindBuffer;
+
   class VMThread : private Thread {
    public:
     VirtualMachine& vm;
@@ -59,6 +61,11 @@ namespace Ep128Emu {
     double          prvTime;
     double          nxtTime;
     VirtualMachine::VMStatus  vmStatus;
+    RewindBuffer    *rewindBuffer;
+    int             rewindInterval;         // in microseconds, 0: disabled
+    int             rewindTimeCnt;
+    size_t          rewindMemoryLimit;
+    bool            rewindConfigChanged;
     void            *userData;
     void            (*errorCallback)(void *userData_, const char *msg);
     void            (*processCallback)(void *userData_);
@@ -83,9 +90,12 @@ namespace Ep128Emu {
      * Run emulation (or just wait if paused) for a short period of time,
      * and update status information. This can be called by the main thread
      * after lock() in a loop for single-threaded emulation.
+     * If 'emulatedTime' is not NULL, the emulated time actually run (in
+     * microseconds) is stored in it; this is more than one time slice while
+     * fast tape loading is active, and zero if paused.
      * Returns false after quit() was called or a fatal error occured.
      */
-    bool process();
+    bool process(size_t *emulatedTime = (size_t *) 0);
     /*!
      * Pause emulation if 'n' is true, or continue if 'n' is false.
      * NOTE: the initial state is pause=true.
@@ -177,6 +187,18 @@ namespace Ep128Emu {
      * A zero or negative value means no limit.
      */
     void setSpeedPercentage(int speedPercentage_);
+    /*!
+     * Save a snapshot of the emulated machine to an in-memory rewind buffer
+     * every 'nFrames' (at 50 Hz) frames of emulated time, using at most
+     * 'memoryLimit' bytes. Zero or negative 'nFrames' disables rewinding.
+     */
+    void setRewindParameters(int nFrames, size_t memoryLimit);
+    /*!
+     * Restore the state from the most recent checkpoint of the rewind
+     * buffer, or the one before it if the last checkpoint was saved less
+     * than half of the checkpoint interval ago.
+     */
+    void rewind();
   // --------------------------------------------------------------------------
    private:
     virtual void run();
@@ -324,6 +346,15 @@ namespace Ep128Emu {
       virtual ~Message_StopDemo();
       virtual void process();
     };
+    class Message_Rewind : public Message {
+     public:
+      Message_Rewind(VMThread& vmThread_)
+        : Message(vmThread_)
+      {
+      }
+      virtual ~Message_Rewind();
+      virtual void process();
+    };
     class Message_Dummy : public Message {
      private:
       // should have enough space for all the other message types
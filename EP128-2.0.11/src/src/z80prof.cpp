@@ -0,0 +1,506 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "z80prof.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace Ep128Emu {
+
+  struct Z80ProfilerEntry {
+    std::string name;
+    uint64_t    cycles;
+    uint64_t    count;
+    Z80ProfilerEntry()
+      : cycles(0U),
+        count(0U)
+    {
+    }
+    // for sorting in descending order of cycles, then by name
+    bool operator<(const Z80ProfilerEntry& r) const
+    {
+      if (cycles != r.cycles)
+        return (cycles > r.cycles);
+      return (name < r.name);
+    }
+  };
+
+  static void addProfilerEntry(std::map< std::string, Z80ProfilerEntry >& m,
+                               const std::string& name,
+                               uint64_t cycles, uint64_t count)
+  {
+    Z80ProfilerEntry& e = m[name];
+    e.name = name;
+    e.cycles += cycles;
+    e.count += count;
+  }
+
+  static void sortProfilerEntries(
+      std::vector< Z80ProfilerEntry >& v,
+      const std::map< std::string, Z80ProfilerEntry >& m)
+  {
+    v.clear();
+    std::map< std::string, Z80ProfilerEntry >::const_iterator i;
+    for (i = m.begin(); i != m.end(); i++)
+      v.push_back(i->second);
+    std::sort(v.begin(), v.end());
+  }
+
+  static inline double percentage(uint64_t n, uint64_t total)
+  {
+    if (!total)
+      return 0.0;
+    return (double(int64_t(n)) * 100.0 / double(int64_t(total)));
+  }
+
+  // parse number in Sjasm format, returns false on error
+
+  static bool parseSymbolValue(const char *s, uint32_t& n)
+  {
+    int     base = 10;
+    size_t  len = std::strlen(s);
+    n = 0U;
+    if (len < 1)
+      return false;
+    if (s[0] == '$' || s[0] == '#') {
+      base = 16;
+      s++;
+      len--;
+    }
+    else if (len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+      base = 16;
+      s += 2;
+      len -= 2;
+    }
+    else if (len > 1 && (s[len - 1] == 'h' || s[len - 1] == 'H')) {
+      base = 16;
+      len--;
+    }
+    if (len < 1)
+      return false;
+    for (size_t i = 0; i < len; i++) {
+      char    c = s[i];
+      uint32_t  d = 0U;
+      if (c >= '0' && c <= '9')
+        d = uint32_t(c - '0');
+      else if (base == 16 && c >= 'A' && c <= 'F')
+        d = uint32_t(c - 'A') + 10U;
+      else if (base == 16 && c >= 'a' && c <= 'f')
+        d = uint32_t(c - 'a') + 10U;
+      else
+        return false;
+      n = (n * uint32_t(base)) + d;
+    }
+    return true;
+  }
+
+  // --------------------------------------------------------------------------
+
+  Z80Profiler::Z80Profiler()
+  {
+    for (int i = 0; i < 1024; i++) {
+      cycleCounts[i] = (uint64_t *) 0;
+      instructionCounts[i] = (uint32_t *) 0;
+    }
+    clear();
+  }
+
+  Z80Profiler::~Z80Profiler()
+  {
+    for (int i = 0; i < 1024; i++) {
+      if (cycleCounts[i])
+        delete[] cycleCounts[i];
+      if (instructionCounts[i])
+        delete[] instructionCounts[i];
+    }
+  }
+
+  void Z80Profiler::clear()
+  {
+    for (int i = 0; i < 1024; i++) {
+      if (cycleCounts[i]) {
+        delete[] cycleCounts[i];
+        cycleCounts[i] = (uint64_t *) 0;
+      }
+      if (instructionCounts[i]) {
+        delete[] instructionCounts[i];
+        instructionCounts[i] = (uint32_t *) 0;
+      }
+    }
+    callTree.clear();
+    callTreeChildren.clear();
+    // node 0 is the code that is not called from any recorded function
+    CallTreeNode  rootNode;
+    rootNode.addr = 0xFFFFFFFFU;
+    rootNode.parent = -1;
+    rootNode.selfCycles = 0U;
+    rootNode.calls = 0U;
+    callTree.push_back(rootNode);
+    stackDepth = 0;
+    currentNode = 0;
+    prvCycles = 0U;
+    cycleRemainder = 0U;
+    prvIndex = 0U;
+    prvAddr = 0;
+    prvSP = 0;
+    prvIsCall = false;
+    interruptFlag = false;
+    havePrvInstruction = false;
+  }
+
+  void Z80Profiler::allocateCounters(uint32_t n)
+  {
+    cycleCounts[n] = new uint64_t[16384];
+    try {
+      instructionCounts[n] = new uint32_t[16384];
+    }
+    catch (...) {
+      delete[] cycleCounts[n];
+      cycleCounts[n] = (uint64_t *) 0;
+      throw;
+    }
+    for (size_t i = 0; i < 16384; i++) {
+      cycleCounts[n][i] = 0U;
+      instructionCounts[n][i] = 0U;
+    }
+  }
+
+  void Z80Profiler::enterFunction(uint8_t segment, uint16_t addr, uint16_t sp)
+  {
+    interruptFlag = false;
+    uint32_t  a = (uint32_t(segment) << 16) | uint32_t(addr);
+    uint64_t  key = (uint64_t(uint32_t(currentNode)) << 32) | uint64_t(a);
+    int32_t   n = currentNode;
+    std::map< uint64_t, int32_t >::iterator i = callTreeChildren.find(key);
+    if (i != callTreeChildren.end()) {
+      n = i->second;
+    }
+    else if (callTree.size() < maxCallTreeNodes) {
+      CallTreeNode  tmp;
+      tmp.addr = a;
+      tmp.parent = currentNode;
+      tmp.selfCycles = 0U;
+      tmp.calls = 0U;
+      n = int32_t(callTree.size());
+      callTree.push_back(tmp);
+      callTreeChildren.insert(std::pair< uint64_t, int32_t >(key, n));
+    }
+    callTree[n].calls++;
+    if (stackDepth < maxStackDepth) {
+      stack[stackDepth].node = n;
+      stack[stackDepth].sp = sp;
+      stackDepth++;
+      currentNode = n;
+    }
+  }
+
+  void Z80Profiler::loadSymbols(const char *fileName)
+  {
+    if (!fileName || fileName[0] == '\0')
+      throw Exception("invalid symbol file name");
+    std::FILE *f = fileOpen(fileName, "rb");
+    if (!f)
+      throw Exception("error opening symbol file");
+    std::map< uint16_t, std::string >   newSymbols;
+    std::vector< std::string >  tokens;
+    std::string lineBuf;
+    bool    eofFlag = false;
+    do {
+      int     c = std::fgetc(f);
+      if (c == EOF)
+        eofFlag = true;
+      if (!(c == EOF || c == '\n' || c == '\r')) {
+        lineBuf += char(c);
+        continue;
+      }
+      // split line into tokens
+      tokens.clear();
+      std::string s;
+      for (size_t i = 0; i <= lineBuf.length(); i++) {
+        c = (i < lineBuf.length() ? int((unsigned char) lineBuf[i]) : 0);
+        if (c == ';')
+          c = 0;
+        if (c == 0 || c == ' ' || c == '\t' || c == ':' || c == '=') {
+          if (s.length() > 0) {
+            tokens.push_back(s);
+            s.clear();
+          }
+          if (c == '=')
+            tokens.push_back("=");
+          if (c == 0)
+            break;
+        }
+        else {
+          s += char(c);
+        }
+      }
+      lineBuf.clear();
+      if (tokens.size() == 3) {
+        const char  *t = tokens[1].c_str();
+        if (!((t[0] == 'E' || t[0] == 'e') && (t[1] == 'Q' || t[1] == 'q') &&
+              (t[2] == 'U' || t[2] == 'u') && t[3] == '\0') &&
+            tokens[1] != "=") {
+          continue;
+        }
+        tokens.erase(tokens.begin() + 1);
+      }
+      if (tokens.size() != 2)
+        continue;
+      uint32_t  n = 0U;
+      if (tokens[0].find('.') != std::string::npos ||
+          !parseSymbolValue(tokens[1].c_str(), n) || n > 0xFFFFU) {
+        continue;
+      }
+      // if there are multiple symbols with the same value, use the first
+      if (newSymbols.find(uint16_t(n)) == newSymbols.end())
+        newSymbols[uint16_t(n)] = tokens[0];
+    } while (!eofFlag);
+    std::fclose(f);
+    symbols = newSymbols;
+  }
+
+  void Z80Profiler::clearSymbols()
+  {
+    symbols.clear();
+  }
+
+  void Z80Profiler::getSymbolName(std::string& s,
+                                  uint8_t segment, uint16_t addr,
+                                  const uint8_t *symbolSegments,
+                                  bool exactMatch) const
+  {
+    char    tmpBuf[16];
+    if (!symbolSegments || symbolSegments[segment]) {
+      std::map< uint16_t, std::string >::const_iterator i =
+          symbols.upper_bound(addr);
+      if (i != symbols.begin()) {
+        i--;
+      }
+      // a symbol in a different 16K page cannot be in the same segment
+      if (i != symbols.end() && i->first <= addr &&
+          (i->first >> 14) == (addr >> 14)) {
+        s = i->second;
+        if (exactMatch && i->first != addr) {
+          std::sprintf(&(tmpBuf[0]), "+%X",
+                       (unsigned int) (addr - i->first));
+          s += &(tmpBuf[0]);
+        }
+        return;
+      }
+    }
+    if (exactMatch) {
+      std::sprintf(&(tmpBuf[0]), "%02X:%04X",
+                   (unsigned int) segment, (unsigned int) addr);
+    }
+    else {
+      // code without symbols is grouped by segment
+      std::sprintf(&(tmpBuf[0]), "[%02X]", (unsigned int) segment);
+    }
+    s = &(tmpBuf[0]);
+  }
+
+  void Z80Profiler::getNodeName(std::string& s, int32_t n,
+                                const uint8_t *symbolSegments) const
+  {
+    if (n <= 0) {
+      s = "[top]";
+      return;
+    }
+    getSymbolName(s, uint8_t(callTree[n].addr >> 16),
+                  uint16_t(callTree[n].addr & 0xFFFFU), symbolSegments, true);
+  }
+
+  void Z80Profiler::writeTextReport(std::FILE *f,
+                                    const uint8_t *symbolSegments) const
+  {
+    std::map< std::string, Z80ProfilerEntry > m;
+    std::vector< Z80ProfilerEntry >   v;
+    std::string s;
+    uint64_t  totalCycles = 0U;
+    uint64_t  totalInstructions = 0U;
+    // flat profile by symbol
+    for (uint32_t n = 0U; n < 1024U; n++) {
+      if (!cycleCounts[n])
+        continue;
+      uint8_t   segment = uint8_t(n & 0xFFU);
+      for (uint32_t i = 0U; i < 16384U; i++) {
+        if (!instructionCounts[n][i])
+          continue;
+        uint16_t  addr = uint16_t(((n >> 8) << 14) | i);
+        getSymbolName(s, segment, addr, symbolSegments, false);
+        addProfilerEntry(m, s, cycleCounts[n][i], instructionCounts[n][i]);
+        totalCycles += cycleCounts[n][i];
+        totalInstructions += instructionCounts[n][i];
+      }
+    }
+    std::fprintf(f, "Total: %.0f cycles, %.0f instructions\n\n",
+                 double(int64_t(totalCycles)),
+                 double(int64_t(totalInstructions)));
+    std::fprintf(f, "Flat profile:\n\n");
+    std::fprintf(f, "      cycles       %%  instructions  name\n");
+    sortProfilerEntries(v, m);
+    for (size_t i = 0; i < v.size(); i++) {
+      std::fprintf(f, "%12.0f  %6.2f  %12.0f  %s\n",
+                   double(int64_t(v[i].cycles)),
+                   percentage(v[i].cycles, totalCycles),
+                   double(int64_t(v[i].count)), v[i].name.c_str());
+    }
+    // hot spots by instruction address
+    m.clear();
+    for (uint32_t n = 0U; n < 1024U; n++) {
+      if (!cycleCounts[n])
+        continue;
+      uint8_t   segment = uint8_t(n & 0xFFU);
+      for (uint32_t i = 0U; i < 16384U; i++) {
+        if (!instructionCounts[n][i])
+          continue;
+        uint16_t  addr = uint16_t(((n >> 8) << 14) | i);
+        char      tmpBuf[16];
+        std::sprintf(&(tmpBuf[0]), "%02X:%04X  ",
+                     (unsigned int) segment, (unsigned int) addr);
+        getSymbolName(s, segment, addr, symbolSegments, true);
+        s = std::string(&(tmpBuf[0])) + s;
+        addProfilerEntry(m, s, cycleCounts[n][i], instructionCounts[n][i]);
+      }
+    }
+    sortProfilerEntries(v, m);
+    if (v.size() > 100)
+      v.resize(100);
+    std::fprintf(f, "\nHot spots:\n\n");
+    std::fprintf(f, "      cycles       %%  instructions  address  name\n");
+    for (size_t i = 0; i < v.size(); i++) {
+      std::fprintf(f, "%12.0f  %6.2f  %12.0f  %s\n",
+                   double(int64_t(v[i].cycles)),
+                   percentage(v[i].cycles, totalCycles),
+                   double(int64_t(v[i].count)), v[i].name.c_str());
+    }
+    // call graph
+    size_t  nNodes = callTree.size();
+    std::vector< uint64_t > inclusiveCycles(nNodes);
+    std::vector< std::string >  nodeNames(nNodes);
+    for (size_t i = 0; i < nNodes; i++) {
+      inclusiveCycles[i] = callTree[i].selfCycles;
+      getNodeName(nodeNames[i], int32_t(i), symbolSegments);
+    }
+    // child nodes are always created after their parent
+    for (size_t i = nNodes - 1; i > 0; i--)
+      inclusiveCycles[callTree[i].parent] += inclusiveCycles[i];
+    std::map< std::string, Z80ProfilerEntry > selfTime;
+    std::map< std::string, Z80ProfilerEntry > totalTime;
+    std::map< std::string, std::map< std::string, Z80ProfilerEntry > >
+        callees;
+    std::map< std::string, std::map< std::string, Z80ProfilerEntry > >
+        callers;
+    for (size_t i = 0; i < nNodes; i++) {
+      const std::string&  name = nodeNames[i];
+      addProfilerEntry(selfTime, name, callTree[i].selfCycles,
+                       callTree[i].calls);
+      // do not count the time of recursive calls more than once
+      bool    isRecursive = false;
+      for (int32_t j = callTree[i].parent; j >= 0; j = callTree[j].parent) {
+        if (nodeNames[j] == name) {
+          isRecursive = true;
+          break;
+        }
+      }
+      if (!isRecursive)
+        addProfilerEntry(totalTime, name, inclusiveCycles[i], 0U);
+      if (i > 0) {
+        const std::string&  parentName = nodeNames[callTree[i].parent];
+        addProfilerEntry(callees[parentName], name,
+                         inclusiveCycles[i], callTree[i].calls);
+        addProfilerEntry(callers[name], parentName, 0U, callTree[i].calls);
+      }
+    }
+    sortProfilerEntries(v, totalTime);
+    std::fprintf(f, "\nCall graph:\n\n");
+    std::fprintf(f, "   total cycles       %%   self cycles       %%"
+                    "       calls  name\n");
+    for (size_t i = 0; i < v.size(); i++) {
+      const Z80ProfilerEntry& e = selfTime[v[i].name];
+      std::fprintf(f, "%15.0f  %6.2f  %12.0f  %6.2f  %10.0f  %s\n",
+                   double(int64_t(v[i].cycles)),
+                   percentage(v[i].cycles, totalCycles),
+                   double(int64_t(e.cycles)),
+                   percentage(e.cycles, totalCycles),
+                   double(int64_t(e.count)), v[i].name.c_str());
+    }
+    for (size_t i = 0; i < v.size(); i++) {
+      if (!v[i].cycles)
+        continue;
+      std::fprintf(f, "\n%s\n", v[i].name.c_str());
+      std::vector< Z80ProfilerEntry >   tmp;
+      sortProfilerEntries(tmp, callers[v[i].name]);
+      for (size_t j = 0; j < tmp.size(); j++) {
+        std::fprintf(f, "    called by  %-24s %10.0f calls\n",
+                     tmp[j].name.c_str(), double(int64_t(tmp[j].count)));
+      }
+      sortProfilerEntries(tmp, callees[v[i].name]);
+      for (size_t j = 0; j < tmp.size(); j++) {
+        std::fprintf(f, "    calls      %-24s %10.0f calls %15.0f cycles\n",
+                     tmp[j].name.c_str(), double(int64_t(tmp[j].count)),
+                     double(int64_t(tmp[j].cycles)));
+      }
+    }
+  }
+
+  void Z80Profiler::writeCollapsedStacks(std::FILE *f,
+                                         const uint8_t *symbolSegments) const
+  {
+    // one line per call stack: the function names from the outermost to
+    // the innermost separated by ';', and the number of cycles
+    std::map< std::string, uint64_t > stacks;
+    std::vector< std::string >  nodeNames(callTree.size());
+    for (size_t i = 0; i < callTree.size(); i++)
+      getNodeName(nodeNames[i], int32_t(i), symbolSegments);
+    std::string s;
+    for (size_t i = 0; i < callTree.size(); i++) {
+      if (!callTree[i].selfCycles)
+        continue;
+      s = nodeNames[i];
+      for (int32_t j = callTree[i].parent; j > 0; j = callTree[j].parent)
+        s = nodeNames[j] + ';' + s;
+      stacks[s] += callTree[i].selfCycles;
+    }
+    std::map< std::string, uint64_t >::const_iterator i;
+    for (i = stacks.begin(); i != stacks.end(); i++) {
+      std::fprintf(f, "%s %.0f\n",
+                   i->first.c_str(), double(int64_t(i->second)));
+    }
+  }
+
+  void Z80Profiler::writeReport(std::FILE *f, int format,
+                                const uint8_t *symbolSegments) const
+  {
+    if (!f)
+      throw Exception("invalid profiler report file");
+    if (format == REPORT_COLLAPSED)
+      writeCollapsedStacks(f, symbolSegments);
+    else
+      writeTextReport(f, symbolSegments);
+    if (std::fflush(f) != 0 || std::ferror(f))
+      throw Exception("error writing profiler report file");
+  }
+
+}       // namespace Ep128Emu
+
@@ -0,0 +1,173 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2016 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef EP128EMU_Z80PROF_HPP
+#define EP128EMU_Z80PROF_HPP
+
+#include "ep128emu.hpp"
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Ep128Emu {
+
+  // Z80 profiler that counts the exact number of CPU cycles (including
+  // memory wait states) spent on each instruction of the emulated program.
+  // The cycles are attributed to (segment, address), and also to a call
+  // tree, which is built from a shadow stack of the CALL and RST
+  // instructions and interrupts executed; a function returns when the
+  // stack pointer is above the return address pushed by the call.
+  // The virtual machine calls instructionStart() at the opcode fetch of
+  // each instruction, with a cycle counter that includes all wait states.
+  // Symbol names are read from a Sjasm symbol file (see loadSymbols()).
+
+  class Z80Profiler {
+   public:
+    // maximum depth of the shadow stack
+    static const int maxStackDepth = 256;
+    // maximum number of call tree nodes; deeper calls are attributed to
+    // the caller when the limit is reached
+    static const size_t maxCallTreeNodes = 1000000;
+    // report formats for writeReport()
+    enum {
+      REPORT_TEXT = 0,          // flat profile, hot spots, and call graph
+      REPORT_COLLAPSED = 1      // collapsed stacks for flame graph tools
+    };
+   protected:
+    struct CallTreeNode {
+      uint32_t  addr;           // segment * 65536 + entry point address
+      int32_t   parent;
+      uint64_t  selfCycles;
+      uint64_t  calls;
+    };
+    struct StackFrame {
+      int32_t   node;
+      uint16_t  sp;             // stack pointer after the call
+    };
+    // cycle and instruction counts indexed with page * 256 + segment,
+    // then with the address bits 0 to 13; allocated on first use
+    uint64_t  *cycleCounts[1024];
+    uint32_t  *instructionCounts[1024];
+    std::vector< CallTreeNode >   callTree;
+    // parent node * 2^32 + address -> child node
+    std::map< uint64_t, int32_t > callTreeChildren;
+    StackFrame  stack[maxStackDepth];
+    int       stackDepth;
+    int32_t   currentNode;
+    uint64_t  prvCycles;        // in 2^-32 CPU cycle units
+    uint32_t  cycleRemainder;
+    uint32_t  prvIndex;
+    uint16_t  prvAddr;
+    uint16_t  prvSP;
+    bool      prvIsCall;
+    bool      interruptFlag;
+    bool      havePrvInstruction;
+    std::map< uint16_t, std::string >   symbols;
+    // --------
+    void allocateCounters(uint32_t n);
+    void enterFunction(uint8_t segment, uint16_t addr, uint16_t sp);
+    void getSymbolName(std::string& s, uint8_t segment, uint16_t addr,
+                       const uint8_t *symbolSegments, bool exactMatch) const;
+    void getNodeName(std::string& s, int32_t n,
+                     const uint8_t *symbolSegments) const;
+    void writeTextReport(std::FILE *f, const uint8_t *symbolSegments) const;
+    void writeCollapsedStacks(std::FILE *f,
+                              const uint8_t *symbolSegments) const;
+   public:
+    Z80Profiler();
+    virtual ~Z80Profiler();
+    // clear all collected data (the symbols are not changed)
+    void clear();
+    // should be called when a maskable or non-maskable interrupt is
+    // executed, so that the interrupt handler is recorded as a call
+    inline void interrupt()
+    {
+      interruptFlag = true;
+    }
+    // Called at the start of each instruction. 'cycles' is the total
+    // number of CPU cycles (in 2^-32 units, may wrap around) before the
+    // opcode fetch, 'segment' and 'addr' are the location of the opcode,
+    // and 'sp' is the value of the stack pointer.
+    EP128EMU_INLINE void instructionStart(uint64_t cycles,
+                                          uint8_t segment, uint16_t addr,
+                                          uint16_t sp, uint8_t opcode)
+    {
+      if (EP128EMU_EXPECT(havePrvInstruction)) {
+        uint64_t  d = (cycles - prvCycles) + uint64_t(cycleRemainder);
+        // ignore large gaps, e.g. after loading a snapshot
+        if (EP128EMU_EXPECT(d < (uint64_t(1) << 48))) {
+          cycleRemainder = uint32_t(d & 0xFFFFFFFFU);
+          d = d >> 32;
+          cycleCounts[prvIndex][prvAddr & 0x3FFF] += d;
+          instructionCounts[prvIndex][prvAddr & 0x3FFF]++;
+          callTree[currentNode].selfCycles += d;
+        }
+        // if enterFunction() or allocateCounters() throws, the previous
+        // instruction must not be counted again on the next call
+        havePrvInstruction = false;
+      }
+      // return from functions
+      while (stackDepth > 0 && sp > stack[stackDepth - 1].sp) {
+        stackDepth--;
+        currentNode = (stackDepth > 0 ? stack[stackDepth - 1].node : 0);
+      }
+      if (EP128EMU_UNLIKELY((prvIsCall && sp == uint16_t(prvSP - 2)) ||
+                            interruptFlag)) {
+        enterFunction(segment, addr, sp);
+      }
+      uint32_t  n = (uint32_t(addr >> 14) << 8) | uint32_t(segment);
+      // allocate the counters before the new instruction is recorded, so
+      // that prvIndex always refers to valid counters
+      if (EP128EMU_UNLIKELY(!cycleCounts[n]))
+        allocateCounters(n);
+      prvCycles = cycles;
+      prvIndex = n;
+      prvAddr = addr;
+      prvSP = sp;
+      // CALL nn, CALL cc,nn, or RST n
+      prvIsCall = (opcode == 0xCD || (opcode & 0xC7) == 0xC4 ||
+                   (opcode & 0xC7) == 0xC7);
+      havePrvInstruction = true;
+    }
+    // Load symbols from a file written by Sjasm, replacing any previously
+    // loaded ones. Each line is expected to be in 'NAME: EQU VALUE' format
+    // (the colon and EQU are optional, '=' is also allowed instead of
+    // EQU), where VALUE is a decimal number, or a hexadecimal one with a
+    // 0x, $, or # prefix or an h suffix. Comments after ';' and local
+    // labels (names containing a '.') are ignored. The symbol nearest to,
+    // but not above an address is used as its name.
+    // Throws Ep128Emu::Exception on error.
+    void loadSymbols(const char *fileName);
+    void clearSymbols();
+    // Write a report of the collected data to 'f' in the specified format
+    // (REPORT_TEXT or REPORT_COLLAPSED). If 'symbolSegments' is not NULL,
+    // symbols are only used for segments where it is non-zero (e.g. RAM),
+    // otherwise for all segments. Addresses without a symbol are printed
+    // in SS:AAAA (segment:address) format.
+    // Throws Ep128Emu::Exception on write errors.
+    void writeReport(std::FILE *f, int format,
+                     const uint8_t *symbolSegments = (uint8_t *) 0) const;
+  };
+
+}       // namespace Ep128Emu
+
+#endif  // EP128EMU_Z80PROF_HPP
+
@@ -211,6 +211,10 @@ namespace ZX128 {
     addressBusState.B.h = R.I;
     uint16_t  addr = uint16_t(R.PC.W.l);
     vm.memoryWaitM1(addr);
+    if (EP128EMU_UNLIKELY(int32_t(addr) == vm.exitAddress)) {
+      vm.updateCPUHalfCycles(4);
+      return vm.stopAtExitAddress();
+    }
     if (addr == 0x05E7) {
       readTapeFile();
       addr = uint16_t(R.PC.W.l);
@@ -579,8 +583,10 @@ namespace ZX128 {
     uint8_t   retval = 0xFF;
     if ((addr & 0xE0) == 0)
       retval = vm.joystickState;
-    else if ((addr & 0x01) == 0)
+    else if ((addr & 0x01) == 0) {
+      vm.tapeInputRead();
       retval = vm.ula.readPort(addr);
+    }
     else if ((addr & 0xC002) == 0xC000 && vm.spectrum128Mode)
       retval = vm.ay3.readRegister(vm.ayRegisterSelected & 0x0F);
     else
@@ -709,6 +715,17 @@ namespace ZX128 {
     vm.videoCapture->runOneCycle(vm.soundOutputSignal);
   }
 
+  uint8_t ZX128VM::stopAtExitAddress()
+  {
+    exitAddressReached = true;
+    // the HALT opcode returned is not executed while the CPU is stopped
+    z80.setStopFlag(true);
+    // return from run() after the current instruction
+    if (ulaCyclesRemainingH > 0)
+      ulaCyclesRemainingH = 0;
+    return 0x76;
+  }
+
   uint8_t ZX128VM::checkSingleStepModeBreak()
   {
     uint16_t  addr = z80.getReg().PC.W.l;
@@ -1053,17 +1070,8 @@ namespace ZX128 {
     // load file into memory
     std::vector<uint8_t>  buf;
     buf.resize(0x4000);
-    std::FILE   *f = Ep128Emu::fileOpen(fileName, "rb");
-    if (!f)
-      throw Ep128Emu::Exception("cannot open ROM file");
-    std::fseek(f, 0L, SEEK_END);
-    if (std::ftell(f) < long(offs + 0x4000)) {
-      std::fclose(f);
+    if (readROMFile(&(buf.front()), fileName, offs, 0x4000) < 0x4000L)
       throw Ep128Emu::Exception("ROM file is shorter than expected");
-    }
-    std::fseek(f, long(offs), SEEK_SET);
-    std::fread(&(buf.front()), 1, 0x4000, f);
-    std::fclose(f);
     // load new segment, or replace existing ROM
     memory.loadSegment(n, true, &(buf.front()), 0x4000);
   }
@@ -1124,6 +1132,10 @@ namespace ZX128 {
     if (demoFile != (Ep128Emu::File *) 0 && !isRecordingDemo)
       stopDemoRecording(true);
     vmStatus_.isRecordingDemo = isRecordingDemo;
+    perfCounters.getStatus(vmStatus_.perfCounters);
+    getAudioOutput().getBufferStatistics(vmStatus_.audioBufferLevel,
+                                         vmStatus_.audioUnderrunCnt,
+                                         vmStatus_.audioOverrunCnt);
   }
 
   void ZX128VM::openVideoCapture(
@@ -1330,6 +1342,12 @@ namespace ZX128 {
     singleStepModeNextAddr = addr;
   }
 
+  void ZX128VM::setExitAddress(int32_t addr)
+  {
+    VirtualMachine::setExitAddress(addr);
+    z80.setStopFlag(false);
+  }
+
   uint8_t ZX128VM::getMemoryPage(int n) const
   {
     return memory.getPage(uint8_t(n & 3));
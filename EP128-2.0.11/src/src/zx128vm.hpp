@@ -183,6 +183,8 @@ namespace ZX128 {
     void stopDemoPlayback();
     void stopDemoRecording(bool writeFile_);
     uint8_t checkSingleStepModeBreak();
+    // called on the first opcode byte read at the exit address
+    uint8_t stopAtExitAddress();
     void convertKeyboardState();
     void resetKeyboard();
     void initializeMemoryPaging();
@@ -305,6 +307,11 @@ namespace ZX128 {
      * of 2 or 4.
      */
     virtual void setSingleStepModeNextAddress(int32_t addr);
+    /*!
+     * Set an address where the emulated program is stopped
+     * (see VirtualMachine::setExitAddress()).
+     */
+    virtual void setExitAddress(int32_t addr);
     /*!
      * Returns the segment at page 'n' (0 to 3).
      */
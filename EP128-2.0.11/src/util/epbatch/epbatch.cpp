@@ -0,0 +1,674 @@
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// epbatch: run an Enterprise 128 snapshot without a window or audio
+// output, at unlimited speed, until an exit condition is met
+
+#include "ep128emu.hpp"
+#include "display.hpp"
+#include "soundio.hpp"
+#include "vm.hpp"
+#include "ep128vm.hpp"
+#include "zx128vm.hpp"
+#include "cpc464vm.hpp"
+#include "tvc64vm.hpp"
+#include "emucfg.hpp"
+#include "script.hpp"
+#include "system.hpp"
+#include "vmthread.hpp"
+#include "vmpool.hpp"
+#include "romstore.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+class EpBatch_LuaScript : public Ep128Emu::LuaScript {
+ public:
+  EpBatch_LuaScript(Ep128Emu::VirtualMachine& vm_)
+    : Ep128Emu::LuaScript(vm_)
+  {
+  }
+  virtual ~EpBatch_LuaScript();
+  virtual void errorCallback(const char *msg);
+  virtual void messageCallback(const char *msg);
+};
+
+EpBatch_LuaScript::~EpBatch_LuaScript()
+{
+}
+
+void EpBatch_LuaScript::errorCallback(const char *msg)
+{
+  std::fprintf(stderr, " *** Lua error: %s\n", msg);
+}
+
+void EpBatch_LuaScript::messageCallback(const char *msg)
+{
+  std::fprintf(stdout, "%s", msg);
+  std::fflush(stdout);
+}
+
+// ----------------------------------------------------------------------------
+
+struct EpBatchState {
+  Ep128Emu::VirtualMachine  *vm;
+  EpBatch_LuaScript         *luaScript;
+  int32_t   exitAddress;        // -1: not used
+  // 0: running, 1: exit address reached, 2: Lua condition, -1: error
+  int       exitReason;
+  uint16_t  exitPC;
+  // --------
+  EpBatchState()
+    : vm((Ep128Emu::VirtualMachine *) 0),
+      luaScript((EpBatch_LuaScript *) 0),
+      exitAddress(-1),
+      exitReason(0),
+      exitPC(0)
+  {
+  }
+};
+
+static void breakPointCallback(void *userData,
+                               int type, uint16_t addr, uint8_t value)
+{
+  EpBatchState& st = *(reinterpret_cast<EpBatchState *>(userData));
+  if (st.exitReason != 0)
+    return;
+  if (st.luaScript) {
+    if (st.luaScript->runBreakPointCallback(type, addr, value)) {
+      st.exitReason = 2;
+      st.exitPC = st.vm->getProgramCounter();
+    }
+  }
+}
+
+static void vmErrorCallback(void *userData, const char *msg)
+{
+  EpBatchState& st = *(reinterpret_cast<EpBatchState *>(userData));
+  std::fprintf(stderr, " *** error: %s\n", msg);
+  st.exitReason = -1;
+}
+
+static void cfgErrorFunc(void *userData, const char *msg)
+{
+  (void) userData;
+  std::fprintf(stderr, "WARNING: %s\n", msg);
+}
+
+static bool parseAddress(const char *s, int32_t& addr)
+{
+  char    *endp = (char *) 0;
+  long    n = std::strtol(s, &endp, 16);
+  if (!endp || endp == s || *endp != '\0' || n < 0L || n > 0xFFFFL)
+    return false;
+  addr = int32_t(n);
+  return true;
+}
+
+static void loadTextFile(std::string& buf, const char *fileName)
+{
+  buf.clear();
+  std::FILE *f = Ep128Emu::fileOpen(fileName, "rb");
+  if (!f)
+    throw Ep128Emu::Exception("error opening Lua script file");
+  while (true) {
+    int     c = std::fgetc(f);
+    if (c == EOF)
+      break;
+    buf += char(c);
+  }
+  std::fclose(f);
+}
+
+// ----------------------------------------------------------------------------
+
+static Ep128Emu::VirtualMachine * createVM(int machineType,
+                                          Ep128Emu::VideoDisplay& display_,
+                                          Ep128Emu::AudioOutput& audioOutput_)
+{
+  switch (machineType) {
+  case 0:
+    return new Ep128::Ep128VM(display_, audioOutput_);
+  case 1:
+    return new ZX128::ZX128VM(display_, audioOutput_);
+  case 2:
+    return new CPC464::CPC464VM(display_, audioOutput_);
+  case 3:
+    return new TVC64::TVC64VM(display_, audioOutput_);
+  }
+  throw Ep128Emu::Exception("invalid machine type");
+}
+
+// returns 0: Enterprise, 1: Spectrum, 2: CPC, 3: TVC (see gui/main.cpp)
+
+static int getSnapshotType(const char *fileName)
+{
+  Ep128Emu::File  f(fileName, false);
+  if (f.getBufferDataSize() < 40)
+    throw Ep128Emu::Exception("invalid snapshot file");
+  const unsigned char   *buf = f.getBufferData();
+  if (buf[0] != 0x45 || buf[1] != 0x50 || buf[2] != 0x80)
+    throw Ep128Emu::Exception("invalid snapshot file");
+  if ((buf[3] & 0xF0) >= 0x20 && (buf[3] & 0xF0) <= 0x40)
+    return (((buf[3] & 0xF0) >> 4) - 1);
+  if (buf[3] >= 0x0B)
+    throw Ep128Emu::Exception("unsupported machine type in snapshot file");
+  return 0;
+}
+
+// run all snapshots in parallel with Ep128Emu::VMPool, using the same
+// configuration and exit conditions for each of them
+
+static int runSnapshotsInParallel(int argc, char **argv,
+                                  const std::vector< const char * >& snapshots,
+                                  int nThreads, double maxCycles,
+                                  int32_t exitAddress, bool quietMode)
+{
+  static const char *baseConfigFiles[4] = {
+    "ep128cfg.dat", "zx128cfg.dat", "cpc_cfg.dat", "tvc_cfg.dat"
+  };
+  Ep128Emu::VMPool::Job job;
+  job.maxCycles = maxCycles;
+  job.exitAddress = exitAddress;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-cfg") == 0) {
+      job.configFiles.push_back(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-snapshot") == 0 ||
+             std::strcmp(argv[i], "-cycles") == 0 ||
+             std::strcmp(argv[i], "-pc") == 0 ||
+             std::strcmp(argv[i], "-speed") == 0 ||
+             std::strcmp(argv[i], "-threads") == 0) {
+      i++;
+    }
+    else if (std::strcmp(argv[i], "-quiet") == 0 ||
+             std::strcmp(argv[i], "-romref") == 0) {
+      continue;
+    }
+    else {
+      const char  *s = argv[i];
+      if (*s == '-')
+        s++;
+      if (*s == '-')
+        s++;
+      job.configSettings.push_back(s);
+    }
+  }
+  std::vector< int >  machineTypes(snapshots.size(), 0);
+  for (size_t i = 0; i < snapshots.size(); i++)
+    machineTypes[i] = getSnapshotType(snapshots[i]);
+  // map ROM images directly from the files, since they are shared by all
+  // machines anyway
+  Ep128Emu::ROMStore::setMemoryMapEnabled(true);
+  Ep128Emu::VMPool  vmPool(&createVM, nThreads, true);
+  Ep128Emu::Timer   realTime;
+  for (size_t i = 0; i < snapshots.size(); i++) {
+    job.machineType = machineTypes[i];
+    job.baseConfigFile = baseConfigFiles[machineTypes[i]];
+    job.snapshotFile = snapshots[i];
+    (void) vmPool.addJob(job);
+  }
+  int     retval = 0;
+  double  totalEmulatedTime = 0.0;
+  for (size_t i = 0; i < snapshots.size(); i++) {
+    vmPool.getJobResult(job, int(i));
+    totalEmulatedTime += job.emulatedTime;
+    if (job.exitReason < 0) {
+      std::fprintf(stderr, " *** %s: %s\n",
+                   snapshots[i], job.errorMessage.c_str());
+      retval = 2;
+    }
+    else if (!quietMode) {
+      std::fprintf(stderr, "%s: %s at PC=%04X, %.3f s (%u frames) "
+                           "in %.3f s\n",
+                   snapshots[i],
+                   (job.exitReason == 1 ?
+                    "exit address reached" : "cycle count reached"),
+                   (unsigned int) job.exitPC, job.emulatedTime,
+                   (unsigned int) job.frameCount, job.realTime);
+    }
+  }
+  if (!quietMode) {
+    double  elapsedTime = realTime.getRealTime();
+    std::fprintf(stderr, "%u snapshots on %d threads\n",
+                 (unsigned int) snapshots.size(), vmPool.getThreadCount());
+    std::fprintf(stderr, "emulated time: %.3f s\n", totalEmulatedTime);
+    std::fprintf(stderr, "real time:     %.3f s (%.0f%% speed)\n",
+                 elapsedTime,
+                 (elapsedTime > 0.0 ?
+                  (totalEmulatedTime * 100.0 / elapsedTime) : 0.0));
+  }
+  return retval;
+}
+
+static void printUsage(const char *prgName)
+{
+  std::fprintf(stderr, "Usage: %s [OPTIONS...]\n", prgName);
+  std::fprintf(stderr, "The allowed options are:\n");
+  std::fprintf(stderr,
+               "    -h | -help | --help "
+               "print this message\n");
+  std::fprintf(stderr,
+               "    -cfg <FILENAME>     "
+               "load ASCII format configuration file\n");
+  std::fprintf(stderr,
+               "    -snapshot <FNAME>   "
+               "load snapshot file on startup (may be used more than\n"
+               "                        once with -threads)\n");
+  std::fprintf(stderr,
+               "    -cycles <N>         "
+               "exit after N Z80 cycles (rounded up to 2 ms)\n");
+  std::fprintf(stderr,
+               "    -pc <ADDR>          "
+               "exit when the CPU executes the hexadecimal address\n");
+  std::fprintf(stderr,
+               "    -lua <FILENAME>     "
+               "run Lua script, exit when breakPointCallback()\n"
+               "                        returns true\n");
+  std::fprintf(stderr,
+               "    -speed <N>          "
+               "limit speed to N percent (default: 0 = no limit)\n");
+  std::fprintf(stderr,
+               "    -save <FILENAME>    "
+               "save snapshot on exit\n");
+  std::fprintf(stderr,
+               "    -romref             "
+               "save ROM segments in the snapshot as a hash of the\n"
+               "                        contents (the ROM images must be "
+               "available when\n"
+               "                        loading the snapshot)\n");
+  std::fprintf(stderr,
+               "    -trace <FILENAME>   "
+               "write binary execution trace (see eptrace)\n");
+  std::fprintf(stderr,
+               "    -profile <FILENAME> "
+               "write Z80 profiler report (flat profile, hot spots,\n"
+               "                        and call graph)\n");
+  std::fprintf(stderr,
+               "    -flamegraph <FNAME> "
+               "write Z80 profile as collapsed stacks for flame graph\n"
+               "                        tools\n");
+  std::fprintf(stderr,
+               "    -sym <FILENAME>     "
+               "read symbols for the profiler from a Sjasm symbol file\n");
+  std::fprintf(stderr,
+               "    -quiet              "
+               "do not print statistics on exit\n");
+  std::fprintf(stderr,
+               "    -threads <N>        "
+               "run all snapshots in parallel on N threads (0: one\n"
+               "                        per processor); any machine type "
+               "is allowed,\n"
+               "                        but -lua, -save, -trace, -profile, "
+               "and -flamegraph\n"
+               "                        are not supported\n");
+  std::fprintf(stderr,
+               "    OPTION=VALUE        "
+               "set configuration variable 'OPTION' to 'VALUE'\n");
+  std::fprintf(stderr,
+               "    OPTION              "
+               "set boolean configuration variable 'OPTION' to true\n");
+  std::fprintf(stderr,
+               "At least one of -cycles, -pc, or -lua is required. "
+               "Emulation stops at\nthe end of the 2 ms time slice "
+               "in which the exit condition is met.\n");
+  std::fprintf(stderr,
+               "The return value is 0 if an exit condition was met, "
+               "1 on errors\nduring startup, and 2 if the emulation "
+               "was stopped by an error.\n");
+}
+
+int main(int argc, char **argv)
+{
+  Ep128Emu::NullDisplay     *display = (Ep128Emu::NullDisplay *) 0;
+  Ep128Emu::AudioOutput     *audioOutput = (Ep128Emu::AudioOutput *) 0;
+  Ep128Emu::VirtualMachine  *vm = (Ep128Emu::VirtualMachine *) 0;
+#ifdef ENABLE_MIDI_PORT
+  Ep128Emu::MIDIPort        *midiPort = (Ep128Emu::MIDIPort *) 0;
+#endif
+  Ep128Emu::EmulatorConfiguration   *config =
+      (Ep128Emu::EmulatorConfiguration *) 0;
+  Ep128Emu::VMThread        *vmThread = (Ep128Emu::VMThread *) 0;
+  EpBatch_LuaScript         *luaScript = (EpBatch_LuaScript *) 0;
+  EpBatchState  st;
+  std::vector< const char * > snapshotNames;
+  const char    *snapshotName = (const char *) 0;
+  const char    *saveName = (const char *) 0;
+  const char    *luaName = (const char *) 0;
+  const char    *traceName = (const char *) 0;
+  const char    *profileName = (const char *) 0;
+  const char    *flameGraphName = (const char *) 0;
+  const char    *symbolFileName = (const char *) 0;
+  double    maxCycles = -1.0;
+  int       speedPercentage = 0;
+  int       nThreads = -1;          // -1: do not use VMPool
+  bool      quietMode = false;
+  bool      romReferenceMode = false;
+  int       retval = 0;
+
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-cfg") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing configuration file name");
+      }
+      else if (std::strcmp(argv[i], "-snapshot") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing snapshot file name");
+        snapshotName = argv[i];
+        snapshotNames.push_back(argv[i]);
+      }
+      else if (std::strcmp(argv[i], "-cycles") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing cycle count");
+        maxCycles = std::atof(argv[i]);
+        if (!(maxCycles > 0.0))
+          throw Ep128Emu::Exception("invalid cycle count");
+      }
+      else if (std::strcmp(argv[i], "-pc") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing exit address");
+        if (!parseAddress(argv[i], st.exitAddress))
+          throw Ep128Emu::Exception("invalid exit address");
+      }
+      else if (std::strcmp(argv[i], "-lua") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing Lua script file name");
+        luaName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-speed") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing speed percentage");
+        speedPercentage = int(std::atoi(argv[i]));
+      }
+      else if (std::strcmp(argv[i], "-save") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing snapshot file name");
+        saveName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-trace") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing trace file name");
+        traceName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-profile") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing profiler report file name");
+        profileName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-flamegraph") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing profiler report file name");
+        flameGraphName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-sym") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing symbol file name");
+        symbolFileName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-threads") == 0) {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing number of threads");
+        nThreads = int(std::atoi(argv[i]));
+        nThreads = (nThreads > 0 ? (nThreads < 256 ? nThreads : 256) : 0);
+      }
+      else if (std::strcmp(argv[i], "-quiet") == 0) {
+        quietMode = true;
+      }
+      else if (std::strcmp(argv[i], "-romref") == 0) {
+        romReferenceMode = true;
+      }
+      else if (std::strcmp(argv[i], "-h") == 0 ||
+               std::strcmp(argv[i], "-help") == 0 ||
+               std::strcmp(argv[i], "--help") == 0) {
+        printUsage(argv[0]);
+        return 0;
+      }
+    }
+    if (maxCycles <= 0.0 && st.exitAddress < 0 && !luaName)
+      throw Ep128Emu::Exception("no exit condition is specified");
+    if (snapshotNames.size() > 1 && nThreads < 0)
+      throw Ep128Emu::Exception("multiple snapshots require -threads");
+    if (nThreads >= 0) {
+      if (snapshotNames.size() < 1)
+        throw Ep128Emu::Exception("-threads requires at least one snapshot");
+      if (luaName || saveName || traceName || profileName ||
+          flameGraphName) {
+        throw Ep128Emu::Exception("-lua, -save, -trace, -profile, and "
+                                  "-flamegraph cannot be used with -threads");
+      }
+      return runSnapshotsInParallel(argc, argv, snapshotNames, nThreads,
+                                    maxCycles, st.exitAddress, quietMode);
+    }
+
+    display = new Ep128Emu::NullDisplay();
+    // the base class does not open any audio device
+    audioOutput = new Ep128Emu::AudioOutput();
+    vm = new Ep128::Ep128VM(*display, *audioOutput);
+    st.vm = vm;
+#ifdef ENABLE_MIDI_PORT
+    midiPort = new Ep128Emu::MIDIPort(*vm);
+#endif
+    config = new Ep128Emu::EmulatorConfiguration(*vm, *display, *audioOutput
+#ifdef ENABLE_MIDI_PORT
+                                                 , *midiPort
+#endif
+                                                 );
+    config->setErrorCallback(&cfgErrorFunc, (void *) 0);
+    // load base configuration of the GUI emulator (if available),
+    // but never run makecfg
+    try {
+      Ep128Emu::File  f("ep128cfg.dat", true);
+      config->registerChunkType(f);
+      f.processAllChunks();
+    }
+    catch (...) {
+    }
+    // fast tape loading disables the display, and runs more than one time
+    // slice at once, so it is only enabled if requested on the command line
+    // (tape.fastLoading=1), not by the GUI configuration
+    config->tape.fastLoading = false;
+    config->tapeSettingsChanged = true;
+    // check command line for any additional configuration
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-cfg") == 0) {
+        config->loadState(argv[++i], false);
+      }
+      else if (std::strcmp(argv[i], "-snapshot") == 0 ||
+               std::strcmp(argv[i], "-cycles") == 0 ||
+               std::strcmp(argv[i], "-pc") == 0 ||
+               std::strcmp(argv[i], "-lua") == 0 ||
+               std::strcmp(argv[i], "-speed") == 0 ||
+               std::strcmp(argv[i], "-save") == 0 ||
+               std::strcmp(argv[i], "-trace") == 0 ||
+               std::strcmp(argv[i], "-profile") == 0 ||
+               std::strcmp(argv[i], "-flamegraph") == 0 ||
+               std::strcmp(argv[i], "-sym") == 0 ||
+               std::strcmp(argv[i], "-threads") == 0) {
+        i++;
+      }
+      else if (std::strcmp(argv[i], "-quiet") == 0 ||
+               std::strcmp(argv[i], "-romref") == 0) {
+        continue;
+      }
+      else {
+        const char  *s = argv[i];
+        if (*s == '-')
+          s++;
+        if (*s == '-')
+          s++;
+        const char  *p = std::strchr(s, '=');
+        if (!p)
+          (*config)[s] = bool(true);
+        else {
+          std::string optName;
+          while (s != p) {
+            optName += (*s);
+            s++;
+          }
+          p++;
+          (*config)[optName] = p;
+        }
+      }
+    }
+    // no audio output, and the display only counts frames
+    config->sound.enabled = false;
+    config->display.enabled = true;
+    config->vm.speedPercentage = 0U;
+    config->soundSettingsChanged = true;
+    config->displaySettingsChanged = true;
+    config->applySettings();
+    if (snapshotName) {
+      Ep128Emu::File  f(snapshotName, false);
+      if (f.getBufferDataSize() < 40)
+        throw Ep128Emu::Exception("invalid snapshot file");
+      const unsigned char *buf = f.getBufferData();
+      if (buf[0] != 0x45 || buf[1] != 0x50 || buf[2] != 0x80 ||
+          buf[3] >= 0x0B) {
+        throw Ep128Emu::Exception("the snapshot file is not "
+                                  "in Enterprise 128 format");
+      }
+      vm->registerChunkTypes(f);
+      f.processAllChunks();
+    }
+    vm->setBreakPointCallback(&breakPointCallback, (void *) &st);
+    if (luaName) {
+      std::string luaCode;
+      loadTextFile(luaCode, luaName);
+      luaScript = new EpBatch_LuaScript(*vm);
+      st.luaScript = luaScript;
+      luaScript->loadScript(luaCode.c_str());
+    }
+    // not a breakpoint, so that the fast memory access paths can be used
+    vm->setExitAddress(st.exitAddress);
+    if (traceName) {
+      std::FILE *f = Ep128Emu::fileOpen(traceName, "wb");
+      if (!f)
+        throw Ep128Emu::Exception("error opening trace file");
+      vm->openExecutionTrace(f, ~(size_t(0)));
+    }
+    if (profileName || flameGraphName)
+      vm->startProfiler();
+
+    vmThread = new Ep128Emu::VMThread(*vm, (void *) &st);
+    vmThread->setErrorCallback(&vmErrorCallback);
+    if (vmThread->lock(0x7FFFFFFF) != 0)
+      throw Ep128Emu::Exception("error starting emulation thread");
+    vmThread->setSpeedPercentage(speedPercentage);
+    vmThread->pause(false);
+    // emulation is run by the main thread in 2 ms time slices
+    double  maxTime = -1.0;
+    if (maxCycles > 0.0)
+      maxTime = maxCycles / double(int(config->vm.cpuClockFrequency));
+    double  emulatedTime = 0.0;
+    Ep128Emu::Timer realTime;
+    while (st.exitReason == 0) {
+      if (maxTime >= 0.0 && emulatedTime >= (maxTime - 0.0000005))
+        break;
+      size_t  t = 0;
+      if (!vmThread->process(&t)) {
+        st.exitReason = -1;
+        break;
+      }
+      emulatedTime += (double(long(t)) * 0.000001);
+      if (vm->getIsExitAddressReached() && st.exitReason == 0) {
+        st.exitReason = 1;
+        st.exitPC = uint16_t(st.exitAddress);
+      }
+    }
+    double  elapsedTime = realTime.getRealTime();
+    if (st.exitReason >= 0 && saveName) {
+      Ep128Emu::File  f;
+      f.setROMReferenceMode(romReferenceMode);
+      vm->saveState(f);
+      f.writeFile(saveName);
+    }
+    if (profileName || flameGraphName) {
+      vm->stopProfiler();
+      for (int i = 0; i < 2; i++) {
+        const char  *fileName = (i == 0 ? profileName : flameGraphName);
+        if (!fileName)
+          continue;
+        std::FILE *f = Ep128Emu::fileOpen(fileName, "w");
+        if (!f)
+          throw Ep128Emu::Exception("error opening profiler report file");
+        try {
+          vm->writeProfilerReport(f, i, symbolFileName);
+        }
+        catch (...) {
+          std::fclose(f);
+          throw;
+        }
+        std::fclose(f);
+      }
+    }
+    if (!quietMode) {
+      const char  *reasonStr = "cycle count reached";
+      if (st.exitReason == 1)
+        reasonStr = "exit address reached";
+      else if (st.exitReason == 2)
+        reasonStr = "Lua condition met";
+      else if (st.exitReason < 0)
+        reasonStr = "emulation stopped on error";
+      std::fprintf(stderr, "%s at PC=%04X\n",
+                   reasonStr,
+                   (unsigned int) (st.exitReason > 0 ?
+                                   st.exitPC : vm->getProgramCounter()));
+      std::fprintf(stderr, "emulated time: %.3f s (%u frames)\n",
+                   emulatedTime, (unsigned int) display->getFrameCount());
+      std::fprintf(stderr, "real time:     %.3f s (%.0f%% speed)\n",
+                   elapsedTime,
+                   (elapsedTime > 0.0 ?
+                    (emulatedTime * 100.0 / elapsedTime) : 0.0));
+    }
+    if (st.exitReason < 0)
+      retval = 2;
+  }
+  catch (std::exception& e) {
+    std::fprintf(stderr, " *** error: %s\n", e.what());
+    retval = 1;
+  }
+  if (vmThread) {
+    vmThread->unlock();
+    delete vmThread;
+  }
+  if (luaScript)
+    delete luaScript;
+  if (config)
+    delete config;
+#ifdef ENABLE_MIDI_PORT
+  if (midiPort)
+    delete midiPort;
+#endif
+  if (vm)
+    delete vm;
+  if (display)
+    delete display;
+  if (audioOutput)
+    delete audioOutput;
+  return retval;
+}
+
@@ -0,0 +1,590 @@
+
+// ep128emu -- portable Enterprise 128 emulator
+// Copyright (C) 2003-2017 Istvan Varga <istvanv@users.sourceforge.net>
+// https://github.com/istvan-v/ep128emu/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// epbench: boot Enterprise 128 programs (e.g. the AGD test games) with a
+// loader snapshot, run each of them for a fixed number of frames without
+// a window, and report the host time per emulated frame in CSV format
+
+#include "ep128emu.hpp"
+#include "display.hpp"
+#include "soundio.hpp"
+#include "vm.hpp"
+#include "ep128vm.hpp"
+#include "emucfg.hpp"
+#include "perfcnt.hpp"
+#include "system.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef WIN32
+#  include <unistd.h>
+#else
+#  include <direct.h>
+#  include <process.h>
+#endif
+
+// the length of one frame in microseconds (50 Hz)
+static const size_t frameTime = 20000;
+
+// columns of the report after the program name and the number of frames
+enum {
+  COLUMN_TOTAL = 0,
+  COLUMN_Z80,
+  COLUMN_NICK,
+  COLUMN_DAVE,
+  COLUMN_AUDIO,
+  COLUMN_OTHER,
+  nColumns
+};
+
+static const char *columnNames[nColumns] = {
+  "total_ns", "z80_ns", "nick_ns", "dave_ns", "audio_ns", "other_ns"
+};
+
+struct EpBenchResult {
+  std::string name;
+  int       frames;
+  // host time per frame in nanoseconds
+  double    t[nColumns];
+};
+
+static void cfgErrorFunc(void *userData, const char *msg)
+{
+  (void) userData;
+  std::fprintf(stderr, "WARNING: %s\n", msg);
+}
+
+static void copyFile(const char *dstName, const char *srcName)
+{
+  std::vector< unsigned char >  buf;
+  std::FILE *f = Ep128Emu::fileOpen(srcName, "rb");
+  if (!f)
+    throw Ep128Emu::Exception("error opening program file");
+  while (true) {
+    int     c = std::fgetc(f);
+    if (c == EOF)
+      break;
+    buf.push_back((unsigned char) c);
+  }
+  std::fclose(f);
+  f = Ep128Emu::fileOpen(dstName, "wb");
+  if (!f)
+    throw Ep128Emu::Exception("error creating file in working directory");
+  bool    err = false;
+  if (buf.size() > 0)
+    err = (std::fwrite(&(buf.front()), 1, buf.size(), f) != buf.size());
+  if (std::fclose(f) != 0 || err)
+    throw Ep128Emu::Exception("error writing file in working directory");
+}
+
+static bool fileExists(const char *fileName)
+{
+  std::FILE *f = Ep128Emu::fileOpen(fileName, "rb");
+  if (!f)
+    return false;
+  std::fclose(f);
+  return true;
+}
+
+// create a new, empty directory for the files loaded by the benchmark,
+// so that no files of the user are overwritten or removed
+
+static void createTemporaryDirectory(std::string& dirName)
+{
+#ifndef WIN32
+  const char  *s = std::getenv("TMPDIR");
+  dirName = ((s != (char *) 0 && s[0] != '\0') ? s : "/tmp");
+  if (dirName[dirName.length() - 1] != '/')
+    dirName += '/';
+  dirName += "epbench.XXXXXX";
+  std::vector< char > tmp(dirName.begin(), dirName.end());
+  tmp.push_back('\0');
+  if (!mkdtemp(&(tmp.front()))) {
+    dirName.clear();
+    throw Ep128Emu::Exception("error creating temporary directory");
+  }
+  dirName = &(tmp.front());
+#else
+  std::string baseName;
+  Ep128Emu::getenv_UTF8(baseName, "TEMP");
+  if (baseName.empty())
+    baseName = ".";
+  if (baseName[baseName.length() - 1] != '\\')
+    baseName += '\\';
+  for (int i = 0; i < 100; i++) {
+    char    tmp[32];
+    std::sprintf(&(tmp[0]), "epbench.%d.%d", int(_getpid()), i);
+    dirName = baseName + &(tmp[0]);
+    if (Ep128Emu::mkdir_UTF8(dirName.c_str()) == 0)
+      return;
+  }
+  dirName.clear();
+  throw Ep128Emu::Exception("error creating temporary directory");
+#endif
+}
+
+static void removeDirectory(const char *dirName)
+{
+#ifndef WIN32
+  (void) rmdir(dirName);
+#else
+  wchar_t tmpBuf[512];
+  Ep128Emu::convertUTF8(&(tmpBuf[0]), dirName, 512);
+  (void) _wrmdir(&(tmpBuf[0]));
+#endif
+}
+
+// returns the base name of 'fileName' without the extension
+
+static std::string getProgramName(const char *fileName)
+{
+  std::string dirName;
+  std::string baseName;
+  Ep128Emu::splitPath(std::string(fileName), dirName, baseName);
+  size_t  n = baseName.rfind('.');
+  if (n != std::string::npos && n > 0)
+    baseName.resize(n);
+  return baseName;
+}
+
+// read a report written by an earlier run of epbench
+
+static void loadBaseline(std::map< std::string, EpBenchResult >& baseline,
+                         const char *fileName)
+{
+  baseline.clear();
+  std::FILE *f = Ep128Emu::fileOpen(fileName, "rb");
+  if (!f)
+    throw Ep128Emu::Exception("error opening baseline file");
+  std::string s;
+  bool    firstLine = true;
+  while (true) {
+    int     c = std::fgetc(f);
+    if (c != EOF && c != '\n') {
+      if (c != '\r')
+        s += char(c);
+      continue;
+    }
+    if (!firstLine && !s.empty()) {
+      EpBenchResult r;
+      size_t  n = s.find(',');
+      r.name = s.substr(0, n);
+      const char  *p = (n != std::string::npos ? s.c_str() + n : "");
+      int     i = -1;
+      for ( ; i < int(nColumns) && *p == ','; i++) {
+        char    *endp = (char *) 0;
+        double  tmp = std::strtod(p + 1, &endp);
+        if (!endp || endp == (p + 1))
+          break;
+        if (i < 0)
+          r.frames = int(tmp);
+        else
+          r.t[i] = tmp;
+        p = endp;
+      }
+      if (i < int(nColumns) || *p != '\0') {
+        std::fclose(f);
+        throw Ep128Emu::Exception("invalid baseline file format");
+      }
+      baseline[r.name] = r;
+    }
+    firstLine = false;
+    s.clear();
+    if (c == EOF)
+      break;
+  }
+  std::fclose(f);
+}
+
+static void loadSnapshot(Ep128Emu::VirtualMachine& vm, const char *fileName)
+{
+  Ep128Emu::File  f(fileName, false);
+  if (f.getBufferDataSize() < 40)
+    throw Ep128Emu::Exception("invalid snapshot file");
+  const unsigned char *buf = f.getBufferData();
+  if (buf[0] != 0x45 || buf[1] != 0x50 || buf[2] != 0x80 || buf[3] >= 0x0B) {
+    throw Ep128Emu::Exception("the snapshot file is not "
+                              "in Enterprise 128 format");
+  }
+  vm.registerChunkTypes(f);
+  f.processAllChunks();
+}
+
+// load the snapshot, run 'warmupFrames' frames (during which the program is
+// expected to be loaded and started), then measure 'nFrames' frames
+
+static void runProgram(EpBenchResult& r, Ep128Emu::VirtualMachine& vm,
+                       const char *snapshotName,
+                       int warmupFrames, int nFrames)
+{
+  loadSnapshot(vm, snapshotName);
+  for (int i = 0; i < warmupFrames; i++)
+    vm.run(frameTime);
+  vm.resetPerfCounters();
+  Ep128Emu::Timer t;
+  for (int i = 0; i < nFrames; i++)
+    vm.run(frameTime);
+  double  totalTime = t.getRealTime();
+  Ep128Emu::PerfCounters::Status  s;
+  vm.getPerfCounters(s);
+  double  scale = 1000000000.0 / double(nFrames);
+  r.frames = nFrames;
+  r.t[COLUMN_TOTAL] = totalTime * scale;
+  r.t[COLUMN_Z80] = s.time[Ep128Emu::PerfCounters::Z80] * scale;
+  r.t[COLUMN_NICK] = s.time[Ep128Emu::PerfCounters::NICK] * scale;
+  r.t[COLUMN_DAVE] = s.time[Ep128Emu::PerfCounters::DAVE] * scale;
+  r.t[COLUMN_AUDIO] =
+      s.time[Ep128Emu::PerfCounters::AUDIO_CONVERTER] * scale;
+  r.t[COLUMN_OTHER] = r.t[COLUMN_TOTAL];
+  for (int i = COLUMN_Z80; i <= COLUMN_AUDIO; i++)
+    r.t[COLUMN_OTHER] -= r.t[i];
+  if (r.t[COLUMN_OTHER] < 0.0)
+    r.t[COLUMN_OTHER] = 0.0;
+}
+
+static void writeReport(std::FILE *f, const std::vector< EpBenchResult >& v)
+{
+  std::fprintf(f, "program,frames");
+  for (int i = 0; i < int(nColumns); i++)
+    std::fprintf(f, ",%s", columnNames[i]);
+  std::fprintf(f, "\n");
+  for (size_t i = 0; i < v.size(); i++) {
+    std::fprintf(f, "%s,%d", v[i].name.c_str(), v[i].frames);
+    for (int j = 0; j < int(nColumns); j++)
+      std::fprintf(f, ",%.0f", v[i].t[j]);
+    std::fprintf(f, "\n");
+  }
+}
+
+// print the change relative to the baseline, and return the largest
+// increase of the total time in percents
+
+static double compareResults(
+    const std::vector< EpBenchResult >& v,
+    const std::map< std::string, EpBenchResult >& baseline)
+{
+  double  maxChange = -100.0;
+  std::fprintf(stderr, "%-16s %12s %8s %8s %8s %8s %8s\n",
+               "program", "ns/frame", "total", "z80", "nick", "dave",
+               "audio");
+  for (size_t i = 0; i < v.size(); i++) {
+    std::map< std::string, EpBenchResult >::const_iterator  j =
+        baseline.find(v[i].name);
+    if (j == baseline.end()) {
+      std::fprintf(stderr, "%-16s %12.0f   (not in baseline)\n",
+                   v[i].name.c_str(), v[i].t[COLUMN_TOTAL]);
+      continue;
+    }
+    std::fprintf(stderr, "%-16s %12.0f", v[i].name.c_str(),
+                 v[i].t[COLUMN_TOTAL]);
+    for (int k = COLUMN_TOTAL; k <= COLUMN_AUDIO; k++) {
+      if (j->second.t[k] < 1.0) {
+        std::fprintf(stderr, " %8s", "-");
+        continue;
+      }
+      double  d = (v[i].t[k] - j->second.t[k]) * 100.0 / j->second.t[k];
+      std::fprintf(stderr, " %+7.1f%%", d);
+      if (k == COLUMN_TOTAL && d > maxChange)
+        maxChange = d;
+    }
+    std::fprintf(stderr, "\n");
+  }
+  return maxChange;
+}
+
+static void printUsage(const char *progName)
+{
+  std::fprintf(stderr, "Usage: %s [OPTIONS...] PROGRAM...\n", progName);
+  std::fprintf(stderr, "The allowed options are:\n");
+  std::fprintf(stderr,
+               "    -h | -help | --help print this message\n");
+  std::fprintf(stderr,
+               "    -cfg <FILENAME>     "
+               "load ASCII format configuration file\n");
+  std::fprintf(stderr,
+               "    -snapshot <FNAME>   "
+               "loader snapshot (default: snapshot/agdgame.ep128s)\n");
+  std::fprintf(stderr,
+               "    -loadname <NAME>    "
+               "name of the file loaded by the snapshot with the FILE:\n"
+               "                        device (default: agdgame.com)\n");
+  std::fprintf(stderr,
+               "    -dir <DIRECTORY>    "
+               "directory where the file to be loaded is written;\n"
+               "                        an existing file is not "
+               "overwritten (default: a new\n"
+               "                        temporary directory)\n");
+  std::fprintf(stderr,
+               "    -warmup <N>         "
+               "frames to run before measuring (default: 100)\n");
+  std::fprintf(stderr,
+               "    -frames <N>         "
+               "frames to measure (default: 500)\n");
+  std::fprintf(stderr,
+               "    -runs <N>           "
+               "run each program N times, and report the fastest run\n"
+               "                        (default: 3)\n");
+  std::fprintf(stderr,
+               "    -o <FILENAME>       "
+               "write report to file instead of the standard output\n");
+  std::fprintf(stderr,
+               "    -baseline <FNAME>   "
+               "compare the results with an earlier report\n");
+  std::fprintf(stderr,
+               "    -threshold <N>      "
+               "return 3 if the total time of any program increased\n"
+               "                        by more than N percent compared "
+               "to the baseline\n");
+  std::fprintf(stderr,
+               "    OPTION=VALUE        "
+               "set configuration variable 'OPTION' to 'VALUE'\n");
+  std::fprintf(stderr,
+               "Each PROGRAM is copied to the working directory of the "
+               "FILE: device as\nthe file loaded by the snapshot (this "
+               "file is removed on exit). The report\nlists the host time "
+               "in nanoseconds per frame (20 ms of emulated time) for\n"
+               "each program, in total and for the Z80, NICK, DAVE, "
+               "and audio conversion.\n");
+}
+
+int main(int argc, char **argv)
+{
+  Ep128Emu::NullDisplay     *display = (Ep128Emu::NullDisplay *) 0;
+  Ep128Emu::AudioOutput     *audioOutput = (Ep128Emu::AudioOutput *) 0;
+  Ep128Emu::VirtualMachine  *vm = (Ep128Emu::VirtualMachine *) 0;
+#ifdef ENABLE_MIDI_PORT
+  Ep128Emu::MIDIPort        *midiPort = (Ep128Emu::MIDIPort *) 0;
+#endif
+  Ep128Emu::EmulatorConfiguration   *config =
+      (Ep128Emu::EmulatorConfiguration *) 0;
+  std::vector< const char * > programNames;
+  const char    *snapshotName = "snapshot/agdgame.ep128s";
+  const char    *loadName = "agdgame.com";
+  const char    *outputName = (const char *) 0;
+  const char    *baselineName = (const char *) 0;
+  std::string   workingDirectory;
+  std::string   tmpDirName;
+  std::string   tmpFileName;
+  int           warmupFrames = 100;
+  int           nFrames = 500;
+  int           nRuns = 3;
+  double        threshold = -1.0;
+  int           retval = 0;
+
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-h") == 0 ||
+          std::strcmp(argv[i], "-help") == 0 ||
+          std::strcmp(argv[i], "--help") == 0) {
+        printUsage(argv[0]);
+        return 0;
+      }
+      else if (std::strcmp(argv[i], "-cfg") == 0 ||
+               std::strcmp(argv[i], "-snapshot") == 0 ||
+               std::strcmp(argv[i], "-loadname") == 0 ||
+               std::strcmp(argv[i], "-dir") == 0 ||
+               std::strcmp(argv[i], "-warmup") == 0 ||
+               std::strcmp(argv[i], "-frames") == 0 ||
+               std::strcmp(argv[i], "-runs") == 0 ||
+               std::strcmp(argv[i], "-o") == 0 ||
+               std::strcmp(argv[i], "-baseline") == 0 ||
+               std::strcmp(argv[i], "-threshold") == 0) {
+        if ((i + 1) >= argc)
+          throw Ep128Emu::Exception("missing argument for option");
+        const char  *s = argv[i];
+        const char  *p = argv[++i];
+        if (std::strcmp(s, "-snapshot") == 0) {
+          snapshotName = p;
+        }
+        else if (std::strcmp(s, "-loadname") == 0) {
+          loadName = p;
+        }
+        else if (std::strcmp(s, "-dir") == 0) {
+          workingDirectory = p;
+        }
+        else if (std::strcmp(s, "-warmup") == 0) {
+          warmupFrames = int(std::atoi(p));
+          warmupFrames = (warmupFrames > 0 ? warmupFrames : 0);
+        }
+        else if (std::strcmp(s, "-frames") == 0) {
+          nFrames = int(std::atoi(p));
+          if (nFrames < 1)
+            throw Ep128Emu::Exception("invalid number of frames");
+        }
+        else if (std::strcmp(s, "-runs") == 0) {
+          nRuns = int(std::atoi(p));
+          if (nRuns < 1)
+            throw Ep128Emu::Exception("invalid number of runs");
+        }
+        else if (std::strcmp(s, "-o") == 0) {
+          outputName = p;
+        }
+        else if (std::strcmp(s, "-baseline") == 0) {
+          baselineName = p;
+        }
+        else if (std::strcmp(s, "-threshold") == 0) {
+          threshold = std::atof(p);
+          threshold = (threshold > 0.0 ? threshold : 0.0);
+        }
+      }
+      else if (argv[i][0] != '-' && !std::strchr(argv[i], '=')) {
+        programNames.push_back(argv[i]);
+      }
+    }
+    if (programNames.size() < 1) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    if (threshold >= 0.0 && !baselineName)
+      throw Ep128Emu::Exception("-threshold requires -baseline");
+    std::map< std::string, EpBenchResult >  baseline;
+    if (baselineName)
+      loadBaseline(baseline, baselineName);
+    if (workingDirectory.empty()) {
+      createTemporaryDirectory(tmpDirName);
+      workingDirectory = tmpDirName;
+    }
+
+    display = new Ep128Emu::NullDisplay();
+    audioOutput = new Ep128Emu::AudioOutput();
+    vm = new Ep128::Ep128VM(*display, *audioOutput);
+#ifdef ENABLE_MIDI_PORT
+    midiPort = new Ep128Emu::MIDIPort(*vm);
+#endif
+    config = new Ep128Emu::EmulatorConfiguration(*vm, *display, *audioOutput
+#ifdef ENABLE_MIDI_PORT
+                                                 , *midiPort
+#endif
+                                                 );
+    config->setErrorCallback(&cfgErrorFunc, (void *) 0);
+    // unlike epbatch, the configuration of the GUI emulator is not loaded,
+    // so that the results do not depend on the user's settings
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-cfg") == 0) {
+        config->loadState(argv[++i], false);
+      }
+      else if (argv[i][0] == '-') {
+        i++;
+      }
+      else if (std::strchr(argv[i], '=')) {
+        const char  *s = argv[i];
+        const char  *p = std::strchr(s, '=');
+        std::string optName;
+        while (s != p) {
+          optName += (*s);
+          s++;
+        }
+        p++;
+        (*config)[optName] = p;
+      }
+    }
+    config->sound.enabled = false;
+    config->display.enabled = true;
+    config->vm.speedPercentage = 0U;
+    config->soundSettingsChanged = true;
+    config->displaySettingsChanged = true;
+    (*config)["vm.enableFileIO"] = true;
+    (*config)["fileio.workingDirectory"] = workingDirectory;
+    config->applySettings();
+    // audio output is discarded, but it is still converted to the output
+    // sample rate, so that the cost of the conversion is included
+    audioOutput->setParameters(-1, float(config->sound.sampleRate),
+                               float(config->sound.latency));
+    vm->setAudioOutputHighQuality(config->sound.highQuality);
+    vm->setEnableAudioOutput(true);
+
+    std::string fileName = workingDirectory;
+    if (fileName.length() > 0 &&
+        fileName[fileName.length() - 1] != '/' &&
+        fileName[fileName.length() - 1] != '\\') {
+#ifndef WIN32
+      fileName += '/';
+#else
+      fileName += '\\';
+#endif
+    }
+    fileName += loadName;
+    if (fileExists(fileName.c_str())) {
+      throw Ep128Emu::Exception("the file to be loaded already exists in "
+                                "the working directory");
+    }
+    // from now on, the file is created by epbench, and is removed on exit
+    tmpFileName = fileName;
+    std::vector< EpBenchResult >  results;
+    for (size_t i = 0; i < programNames.size(); i++) {
+      copyFile(tmpFileName.c_str(), programNames[i]);
+      EpBenchResult r;
+      for (int j = 0; j < nRuns; j++) {
+        EpBenchResult tmp;
+        runProgram(tmp, *vm, snapshotName, warmupFrames, nFrames);
+        if (j == 0 || tmp.t[COLUMN_TOTAL] < r.t[COLUMN_TOTAL])
+          r = tmp;
+      }
+      r.name = getProgramName(programNames[i]);
+      results.push_back(r);
+    }
+    Ep128Emu::fileRemove(tmpFileName.c_str());
+    tmpFileName.clear();
+
+    if (outputName) {
+      std::FILE *f = Ep128Emu::fileOpen(outputName, "w");
+      if (!f)
+        throw Ep128Emu::Exception("error opening report file");
+      writeReport(f, results);
+      if (std::fclose(f) != 0)
+        throw Ep128Emu::Exception("error writing report file");
+    }
+    else {
+      writeReport(stdout, results);
+    }
+    if (baselineName) {
+      double  maxChange = compareResults(results, baseline);
+      if (threshold >= 0.0 && maxChange > threshold)
+        retval = 3;
+    }
+  }
+  catch (std::exception& e) {
+    std::fprintf(stderr, " *** error: %s\n", e.what());
+    retval = 1;
+  }
+  if (!tmpFileName.empty())
+    Ep128Emu::fileRemove(tmpFileName.c_str());
+  if (!tmpDirName.empty())
+    removeDirectory(tmpDirName.c_str());
+  if (config)
+    delete config;
+#ifdef ENABLE_MIDI_PORT
+  if (midiPort)
+    delete midiPort;
+#endif
+  if (vm)
+    delete vm;
+  if (display)
+    delete display;
+  if (audioOutput)
+    delete audioOutput;
+  return retval;
+}
+
@@ -137,8 +137,176 @@ namespace Ep128Compress {
     return true;
   }
 
+  bool Compressor::parallelProgressCallback(void *userData, int nDone)
+  {
+    Compressor& this_ = *(reinterpret_cast< Compressor * >(userData));
+    size_t  tmp = this_.parallelProgressBase
+                  + (size_t(nDone) * this_.parallelProgressStep);
+    return this_.setProgressPercentage(int(tmp * uint64_t(100)
+                                           / this_.progressMax));
+  }
+
+  bool Compressor::runParallel(
+      void (*func)(void *userData, int n, int threadNum), void *userData,
+      int nItems, size_t progressStep)
+  {
+    parallelProgressBase = progressCnt;
+    parallelProgressStep = progressStep;
+    if (!threadPool.run(func, userData, nItems,
+                        (progressDisplayEnabled ?
+                         &parallelProgressCallback : (bool (*)(void *, int)) 0),
+                        (void *) this)) {
+      return false;
+    }
+    if (progressDisplayEnabled)
+      progressCnt = progressCnt + (size_t(nItems) * progressStep);
+    return true;
+  }
+
+  Compressor * Compressor::createThreadCompressor(
+      std::vector< unsigned char >& tmpBuf)
+  {
+    (void) tmpBuf;
+    return (Compressor *) 0;
+  }
+
+  void Compressor::compressJob(CompressionJob& job)
+  {
+    (void) job;
+    throw Ep128Emu::Exception("internal error: "
+                              "block compression is not implemented");
+  }
+
+  void Compressor::compressJobCallback(void *userData, int n, int threadNum)
+  {
+    Compressor&     this_ = *(reinterpret_cast< Compressor * >(userData));
+    CompressionJob& job = this_.compressionJobs[n];
+    job.outBuf.clear();
+    this_.threadCompressors[threadNum]->compressJob(job);
+  }
+
+  void Compressor::createThreadCompressors(
+      std::vector< unsigned char >& tmpBuf)
+  {
+    // the per-thread compressors only use the block compression functions,
+    // which do not write to 'tmpBuf'
+    threadCompressors.reserve(size_t(getNumberOfThreads()));
+    while (int(threadCompressors.size()) < getNumberOfThreads()) {
+      Compressor  *c = createThreadCompressor(tmpBuf);
+      if (!c) {
+        deleteThreadCompressors();
+        break;
+      }
+      c->isThreadCompressor = true;
+      threadCompressors.push_back(c);
+    }
+  }
+
+  void Compressor::deleteThreadCompressors()
+  {
+    for (size_t i = 0; i < threadCompressors.size(); i++)
+      delete threadCompressors[i];
+    threadCompressors.clear();
+    compressionJobs.clear();
+  }
+
+  bool Compressor::runCompressionJobs()
+  {
+    return runParallel(&compressJobCallback, (void *) this,
+                       int(compressionJobs.size()), config.optimizeIterations);
+  }
+
+  bool Compressor::compressSplitCandidates(
+      std::map< uint64_t, size_t >& splitOptimizationCache,
+      const std::list< SplitOptimizationBlock >& splitPositions,
+      const std::vector< unsigned char >& inBuf, unsigned int startAddr)
+  {
+    compressionJobs.clear();
+    std::list< SplitOptimizationBlock >::const_iterator curBlock =
+        splitPositions.begin();
+    while (curBlock != splitPositions.end()) {
+      std::list< SplitOptimizationBlock >::const_iterator nxtBlock = curBlock;
+      nxtBlock++;
+      if (nxtBlock == splitPositions.end())
+        break;
+      if (((*curBlock).nBytes + (*nxtBlock).nBytes) > 65536) {
+        curBlock++;
+        continue;                       // limit block size to <= 64K
+      }
+      for (size_t i = 0; i < 3; i++) {
+        // i = 0: merged block, i = 1: first block, i = 2: second block
+        size_t  startPos =
+            (i < 2 ? (*curBlock).startPos : (*nxtBlock).startPos);
+        size_t  endPos =
+            (*nxtBlock).startPos + (i != 1 ? (*nxtBlock).nBytes : 0);
+        uint64_t  cacheKey = (uint64_t(startPos) << 32) | uint64_t(endPos);
+        if (splitOptimizationCache.find(cacheKey)
+            == splitOptimizationCache.end()) {
+          // store the job index until the compressed size is known
+          splitOptimizationCache[cacheKey] = compressionJobs.size();
+          compressionJobs.resize(compressionJobs.size() + 1);
+          CompressionJob& job = compressionJobs.back();
+          job.inBuf = &inBuf;
+          job.startAddr = startAddr;
+          job.isLastBlock = false;
+          job.fastMode = true;
+          job.startPos = startPos;
+          job.nBytes = endPos - startPos;
+        }
+      }
+      curBlock++;
+    }
+    if (!runCompressionJobs())
+      return false;
+    for (size_t i = 0; i < compressionJobs.size(); i++) {
+      const CompressionJob& job = compressionJobs[i];
+      // calculate compressed size
+      size_t  nBits = 0;
+      for (size_t j = 0; j < job.outBuf.size(); j++)
+        nBits += size_t((job.outBuf[j] & 0x7F000000U) >> 24);
+      uint64_t  cacheKey = (uint64_t(job.startPos) << 32)
+                           | uint64_t(job.startPos + job.nBytes);
+      splitOptimizationCache[cacheKey] = nBits;
+    }
+    compressionJobs.clear();
+    return true;
+  }
+
+  bool Compressor::compressBlocks(
+      std::vector< unsigned int >& outBufTmp,
+      const std::list< SplitOptimizationBlock >& splitPositions,
+      const std::vector< unsigned char >& inBuf, unsigned int startAddr,
+      bool isLastBlock)
+  {
+    compressionJobs.clear();
+    std::list< SplitOptimizationBlock >::const_iterator i_ =
+        splitPositions.begin();
+    for ( ; i_ != splitPositions.end(); i_++) {
+      compressionJobs.resize(compressionJobs.size() + 1);
+      CompressionJob& job = compressionJobs.back();
+      job.inBuf = &inBuf;
+      job.startAddr = startAddr;
+      job.isLastBlock =
+          (isLastBlock && ((*i_).startPos + (*i_).nBytes) >= inBuf.size());
+      job.fastMode = false;
+      job.startPos = (*i_).startPos;
+      job.nBytes = (*i_).nBytes;
+    }
+    if (!runCompressionJobs())
+      return false;
+    for (size_t i = 0; i < compressionJobs.size(); i++) {
+      outBufTmp.insert(outBufTmp.end(), compressionJobs[i].outBuf.begin(),
+                       compressionJobs[i].outBuf.end());
+    }
+    compressionJobs.clear();
+    return true;
+  }
+
   Compressor::Compressor(std::vector< unsigned char >& outBuf_)
-    : outBuf(outBuf_),
+    : threadPool(),
+      parallelProgressBase(0),
+      parallelProgressStep(0),
+      outBuf(outBuf_),
       progressCnt(0),
       progressMax(1),
       progressDisplayEnabled(false),
@@ -147,13 +315,22 @@ namespace Ep128Compress {
       progressMessageUserData((void *) 0),
       progressPercentageCallback(&defaultProgressPercentageCb),
       progressPercentageUserData((void *) 0),
-      config()
+      config(),
+      threadCompressors(),
+      compressionJobs(),
+      isThreadCompressor(false)
   {
     outBuf.clear();
   }
 
   Compressor::~Compressor()
   {
+    deleteThreadCompressors();
+  }
+
+  void Compressor::setNumberOfThreads(int n)
+  {
+    threadPool.setNumberOfThreads(n);
   }
 
   void Compressor::getCompressionParameters(CompressionParameters& cfg) const
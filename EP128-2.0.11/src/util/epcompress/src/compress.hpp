@@ -20,11 +20,23 @@
 #define EPCOMPRESS_COMPRESS_HPP
 
 #include "ep128emu.hpp"
+#include "system.hpp"
+#include "thrpool.hpp"
+
 #include <vector>
+#include <list>
+#include <map>
 
 namespace Ep128Compress {
 
   class Compressor {
+   private:
+    Ep128Emu::ThreadPool  threadPool;
+    size_t  parallelProgressBase;
+    size_t  parallelProgressStep;
+    // --------
+    static bool parallelProgressCallback(void *userData, int nDone);
+    static void compressJobCallback(void *userData, int n, int threadNum);
    public:
     class CompressionParameters {
      private:
@@ -44,6 +56,20 @@ namespace Ep128Compress {
       void setCompressionLevel(int n);
     };
    protected:
+    struct SplitOptimizationBlock {
+      size_t  startPos;
+      size_t  nBytes;
+    };
+    struct CompressionJob {
+      const std::vector< unsigned char > *inBuf;
+      unsigned int  startAddr;
+      bool    isLastBlock;
+      bool    fastMode;
+      size_t  startPos;
+      size_t  nBytes;
+      std::vector< unsigned int > outBuf;
+    };
+    // --------
     std::vector< unsigned char >& outBuf;
     size_t  progressCnt;
     size_t  progressMax;
@@ -54,12 +80,74 @@ namespace Ep128Compress {
     bool    (*progressPercentageCallback)(void *userData, int n);
     void    *progressPercentageUserData;
     CompressionParameters   config;
+    // compressor instances created by createThreadCompressors(), one per
+    // thread, and the blocks to be compressed by them
+    std::vector< Compressor * >     threadCompressors;
+    std::vector< CompressionJob >   compressionJobs;
+    // true if this compressor was created by createThreadCompressor(), and
+    // only shares the match search table of the compressor that created it
+    bool    isThreadCompressor;
     // --------
     void progressMessage(const char *msg);
     bool setProgressPercentage(int n);
+    /*!
+     * Call func(userData, n, threadNum) for all values of 'n' from 0 to
+     * nItems - 1, distributing the calls among the compression threads.
+     * 'threadNum' is in the range 0 to getNumberOfThreads() - 1, and can be
+     * used to select per-thread data; 'func' may only write data belonging
+     * to item 'n' or thread 'threadNum'.
+     * If the progress display is enabled, progressCnt is incremented by
+     * 'progressStep' for each item. The return value is false if the
+     * compression has been stopped. Exceptions thrown by 'func' are passed
+     * on to the caller (see Ep128Emu::ThreadPool::run()).
+     */
+    bool runParallel(void (*func)(void *userData, int n, int threadNum),
+                     void *userData, int nItems, size_t progressStep = 0);
+    /*!
+     * Create a compressor instance for a compression thread, which shares
+     * the match search table of this compressor, and is only used for
+     * compressing blocks with compressJob(). The default implementation
+     * returns NULL, meaning that blocks are not compressed in parallel.
+     */
+    virtual Compressor * createThreadCompressor(
+        std::vector< unsigned char >& tmpBuf);
+    /*!
+     * Compress job.nBytes bytes of *(job.inBuf) at job.startPos to
+     * job.outBuf, with the format and encode tables of a complete block.
+     * Only called on instances returned by createThreadCompressor().
+     */
+    virtual void compressJob(CompressionJob& job);
+    void createThreadCompressors(std::vector< unsigned char >& tmpBuf);
+    void deleteThreadCompressors();
+    // compress all blocks in 'compressionJobs' using multiple threads;
+    // the return value is false if the compression has been stopped
+    bool runCompressionJobs();
+    // calculate the compressed size of all blocks that may be tested by the
+    // next iteration of the split optimization, and store it in the cache
+    bool compressSplitCandidates(
+        std::map< uint64_t, size_t >& splitOptimizationCache,
+        const std::list< SplitOptimizationBlock >& splitPositions,
+        const std::vector< unsigned char >& inBuf, unsigned int startAddr);
+    // compress all blocks in 'splitPositions' using multiple threads, and
+    // append the results to 'outBufTmp' in the original order
+    bool compressBlocks(
+        std::vector< unsigned int >& outBufTmp,
+        const std::list< SplitOptimizationBlock >& splitPositions,
+        const std::vector< unsigned char >& inBuf, unsigned int startAddr,
+        bool isLastBlock);
    public:
     Compressor(std::vector< unsigned char >& outBuf_);
     virtual ~Compressor();
+    /*!
+     * Set the number of threads to be used for compressing blocks
+     * (1 to 64). The compressed data does not depend on the number of
+     * threads.
+     */
+    virtual void setNumberOfThreads(int n);
+    inline int getNumberOfThreads() const
+    {
+      return threadPool.getNumberOfThreads();
+    }
     virtual void getCompressionParameters(CompressionParameters& cfg) const;
     virtual void setCompressionParameters(const CompressionParameters& cfg);
     virtual void setCompressionLevel(int n);
@@ -684,6 +684,21 @@ namespace Ep128Compress {
     return true;
   }
 
+  Compressor * Compressor_M1::createThreadCompressor(
+      std::vector< unsigned char >& tmpBuf)
+  {
+    Compressor_M1 *c = new Compressor_M1(tmpBuf);
+    c->config = config;
+    c->searchTable = searchTable;
+    return c;
+  }
+
+  void Compressor_M1::compressJob(CompressionJob& job)
+  {
+    (void) compressData(job.outBuf, *(job.inBuf), job.isLastBlock,
+                        job.startPos, job.nBytes, job.fastMode);
+  }
+
   // --------------------------------------------------------------------------
 
   Compressor_M1::Compressor_M1(std::vector< unsigned char >& outBuf_)
@@ -707,7 +722,8 @@ namespace Ep128Compress {
 
   Compressor_M1::~Compressor_M1()
   {
-    if (searchTable)
+    // thread compressors share the search table of the main compressor
+    if (searchTable && !isThreadCompressor)
       delete searchTable;
   }
 
@@ -721,11 +737,13 @@ namespace Ep128Compress {
     if (inBuf.size() < 1)
       return true;
     progressDisplayEnabled = enableProgressDisplay;
+    std::vector< unsigned char >  threadOutBuf;
     try {
       if (enableProgressDisplay) {
         progressMessage("Compressing data");
         setProgressPercentage(0);
       }
+      deleteThreadCompressors();
       if (searchTable) {
         delete searchTable;
         searchTable = (DSearchTable *) 0;
@@ -740,6 +758,8 @@ namespace Ep128Compress {
                              offs1MaxValue, offs2MaxValue, maxOffs);
       }
       searchTable->findMatches(&(inBuf.front()), inBuf.size());
+      if (getNumberOfThreads() > 1)
+        createThreadCompressors(threadOutBuf);
       // split large files to improve statistical compression
       std::list< SplitOptimizationBlock >   splitPositions;
       std::map< uint64_t, size_t >          splitOptimizationCache;
@@ -780,6 +800,18 @@ namespace Ep128Compress {
       while (config.blockSize < 1) {
         size_t  bestMergePos = 0;
         long    bestMergeBits = 0x7FFFFFFFL;
+        if (threadCompressors.size() > 0) {
+          // compress the blocks not in the cache yet using multiple threads
+          if (!compressSplitCandidates(splitOptimizationCache, splitPositions,
+                                       inBuf, startAddr)) {
+            deleteThreadCompressors();
+            delete searchTable;
+            searchTable = (DSearchTable *) 0;
+            if (progressDisplayEnabled)
+              progressMessage("");
+            return false;
+          }
+        }
         // find the pair of blocks that reduce the total compressed size
         // the most when merged
         std::list< SplitOptimizationBlock >::iterator curBlock =
@@ -821,6 +853,7 @@ namespace Ep128Compress {
               std::vector< unsigned int > tmpBuf;
               if (!compressData(tmpBuf, inBuf, false,
                                 startPos, endPos - startPos, true)) {
+                deleteThreadCompressors();
                 delete searchTable;
                 searchTable = (DSearchTable *) 0;
                 if (progressDisplayEnabled)
@@ -875,6 +908,18 @@ namespace Ep128Compress {
         progressMax = progressCnt + tmp;
       }
       std::vector< unsigned int >   outBufTmp;
+      if (threadCompressors.size() > 0) {
+        if (!compressBlocks(outBufTmp, splitPositions, inBuf, startAddr,
+                            isLastBlock)) {
+          deleteThreadCompressors();
+          delete searchTable;
+          searchTable = (DSearchTable *) 0;
+          if (progressDisplayEnabled)
+            progressMessage("");
+          return false;
+        }
+        splitPositions.clear();         // all blocks are already compressed
+      }
       std::list< SplitOptimizationBlock >::iterator i_ = splitPositions.begin();
       while (i_ != splitPositions.end()) {
         std::vector< unsigned int > tmpBuf;
@@ -892,6 +937,7 @@ namespace Ep128Compress {
           outBufTmp.push_back(tmpBuf[i]);
         i_++;
       }
+      deleteThreadCompressors();
       delete searchTable;
       searchTable = (DSearchTable *) 0;
       if (progressDisplayEnabled) {
@@ -957,6 +1003,7 @@ namespace Ep128Compress {
       }
     }
     catch (...) {
+      deleteThreadCompressors();
       if (searchTable) {
         delete searchTable;
         searchTable = (DSearchTable *) 0;
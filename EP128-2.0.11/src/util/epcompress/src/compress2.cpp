@@ -564,6 +564,22 @@ namespace Ep128Compress {
     return true;
   }
 
+  Compressor * Compressor_M2::createThreadCompressor(
+      std::vector< unsigned char >& tmpBuf)
+  {
+    Compressor_M2 *c = new Compressor_M2(tmpBuf);
+    c->config = config;
+    c->searchTable = searchTable;
+    return c;
+  }
+
+  void Compressor_M2::compressJob(CompressionJob& job)
+  {
+    (void) compressData(job.outBuf, *(job.inBuf), job.startAddr,
+                        job.isLastBlock, job.startPos, job.nBytes,
+                        job.fastMode);
+  }
+
   // --------------------------------------------------------------------------
 
   Compressor_M2::Compressor_M2(std::vector< unsigned char >& outBuf_)
@@ -587,7 +603,8 @@ namespace Ep128Compress {
 
   Compressor_M2::~Compressor_M2()
   {
-    if (searchTable)
+    // thread compressors share the search table of the main compressor
+    if (searchTable && !isThreadCompressor)
       delete searchTable;
   }
 
@@ -600,11 +617,13 @@ namespace Ep128Compress {
     if (inBuf.size() < 1)
       return true;
     progressDisplayEnabled = enableProgressDisplay;
+    std::vector< unsigned char >  threadOutBuf;
     try {
       if (enableProgressDisplay) {
         progressMessage("Compressing data");
         setProgressPercentage(0);
       }
+      deleteThreadCompressors();
       if (searchTable) {
         delete searchTable;
         searchTable = (LZSearchTable *) 0;
@@ -619,6 +638,8 @@ namespace Ep128Compress {
                               offs1MaxValue, offs2MaxValue, maxOffs);
       }
       searchTable->findMatches(&(inBuf.front()), 0, inBuf.size());
+      if (getNumberOfThreads() > 1)
+        createThreadCompressors(threadOutBuf);
       // split large files to improve statistical compression
       std::list< SplitOptimizationBlock >   splitPositions;
       std::map< uint64_t, size_t >          splitOptimizationCache;
@@ -659,6 +680,18 @@ namespace Ep128Compress {
       while (config.blockSize < 1) {
         size_t  bestMergePos = 0;
         long    bestMergeBits = 0x7FFFFFFFL;
+        if (threadCompressors.size() > 0) {
+          // compress the blocks not in the cache yet using multiple threads
+          if (!compressSplitCandidates(splitOptimizationCache, splitPositions,
+                                       inBuf, startAddr)) {
+            deleteThreadCompressors();
+            delete searchTable;
+            searchTable = (LZSearchTable *) 0;
+            if (progressDisplayEnabled)
+              progressMessage("");
+            return false;
+          }
+        }
         // find the pair of blocks that reduce the total compressed size
         // the most when merged
         std::list< SplitOptimizationBlock >::iterator curBlock =
@@ -700,6 +733,7 @@ namespace Ep128Compress {
               std::vector< unsigned int > tmpBuf;
               if (!compressData(tmpBuf, inBuf, startAddr, false,
                                 startPos, endPos - startPos, true)) {
+                deleteThreadCompressors();
                 delete searchTable;
                 searchTable = (LZSearchTable *) 0;
                 if (progressDisplayEnabled)
@@ -754,6 +788,18 @@ namespace Ep128Compress {
         progressMax = progressCnt + tmp;
       }
       std::vector< unsigned int >   outBufTmp;
+      if (threadCompressors.size() > 0) {
+        if (!compressBlocks(outBufTmp, splitPositions, inBuf, startAddr,
+                            isLastBlock)) {
+          deleteThreadCompressors();
+          delete searchTable;
+          searchTable = (LZSearchTable *) 0;
+          if (progressDisplayEnabled)
+            progressMessage("");
+          return false;
+        }
+        splitPositions.clear();         // all blocks are already compressed
+      }
       std::list< SplitOptimizationBlock >::iterator i_ = splitPositions.begin();
       while (i_ != splitPositions.end()) {
         std::vector< unsigned int > tmpBuf;
@@ -771,6 +817,7 @@ namespace Ep128Compress {
           outBufTmp.push_back(tmpBuf[i]);
         i_++;
       }
+      deleteThreadCompressors();
       delete searchTable;
       searchTable = (LZSearchTable *) 0;
       if (progressDisplayEnabled) {
@@ -847,6 +894,7 @@ namespace Ep128Compress {
       }
     }
     catch (...) {
+      deleteThreadCompressors();
       if (searchTable) {
         delete searchTable;
         searchTable = (LZSearchTable *) 0;
@@ -24,6 +24,8 @@
 #include "comprlib.hpp"
 
 #include <vector>
+#include <list>
+#include <map>
 
 namespace Ep128Compress {
 
@@ -75,10 +77,6 @@ namespace Ep128Compress {
         len = 1;
       }
     };
-    struct SplitOptimizationBlock {
-      size_t  startPos;
-      size_t  nBytes;
-    };
     // --------
     EncodeTable   lengthEncodeTable;
     EncodeTable   offs1EncodeTable;
@@ -107,6 +105,10 @@ namespace Ep128Compress {
                       const std::vector< unsigned char >& inBuf,
                       bool isLastBlock, size_t offs = 0,
                       size_t nBytes = 0x7FFFFFFFUL, bool fastMode = false);
+   protected:
+    virtual Compressor * createThreadCompressor(
+        std::vector< unsigned char >& tmpBuf);
+    virtual void compressJob(CompressionJob& job);
    public:
     Compressor_M4(std::vector< unsigned char >& outBuf_);
     virtual ~Compressor_M4();
@@ -18,6 +18,7 @@
 
 #include "ep128emu.hpp"
 #include "compress.hpp"
+#include "comprlib.hpp"
 #include "decompm2.hpp"
 #include "pngwrite.hpp"
 #include "compress6.hpp"
@@ -51,6 +52,8 @@ static size_t blockSize = 0;
 static size_t volumeSize = 0;
 // encoding definition for compression type 6
 static const char *m6Encoding = (char *) 0;
+// number of threads to be used for compressing blocks (1 to 64)
+static int    nThreads = 1;
 
 static int readInputFile(std::vector< unsigned char >& inBuf,
                          const char *fileName)
@@ -298,6 +301,7 @@ static size_t compressFile(std::vector< unsigned char >& outBuf,
       config.maxOffset = maxOffset;
       config.blockSize = blockSize;
       compress->setCompressionParameters(config);
+      compress->setNumberOfThreads(nThreads);
       compress->compressData(tmpBuf, startAddr, true, true);
       delete compress;
       compress = (Ep128Compress::Compressor *) 0;
@@ -460,6 +464,18 @@ int main(int argc, char **argv)
         if (blockSize > 65536)
           blockSize = 65536;
       }
+      else if (tmp == "-mergesort") {
+        Ep128Compress::LZSearchTable::setSuffixSortAlgorithm(0);
+      }
+      else if (tmp == "-threads") {
+        if (++i >= argc)
+          throw Ep128Emu::Exception("missing argument for -threads");
+        nThreads = int(std::atoi(argv[i]));
+        if (nThreads < 1)
+          nThreads = 1;
+        if (nThreads > 64)
+          nThreads = 64;
+      }
       else if (tmp == "-V") {
         if (extractMode || testMode) {
           volumeSize = 4096;
@@ -727,6 +743,21 @@ int main(int argc, char **argv)
       std::printf("        force using a block size of N bytes (16 to 65536), "
                   "or optimize\n"
                   "        block sizes if N=0 (default: 0)\n");
+      std::printf("    -mergesort\n");
+      std::printf("        use merge sort instead of SA-IS for creating "
+                  "the suffix array in\n"
+                  "        the match finder (slower, the output is "
+                  "the same)\n");
+      std::printf("    -threads <N>\n");
+      std::printf("        compress blocks using N threads (1 to 64, "
+                  "default: 1); the output\n"
+                  "        does not depend on the number of threads, "
+                  "and only -m1, -m2\n"
+                  "        and -m4 use more than one thread; archives (-a) "
+                  "are compressed\n"
+                  "        as a single stream, so the files are not "
+                  "compressed separately,\n"
+                  "        but the blocks of the stream are\n");
       std::printf("    -V\n");
       std::printf("        enable reading split files (extract and test mode "
                   "only)\n");
@@ -140,21 +140,13 @@ namespace Ep128ImgConv {
       tmpPaletteV[i] = (paletteV[c0] * (1.0f - f)) + (paletteV[c1] * f);
     }
     double  totalError = 0.0;
+    double  minErrors[8];
     // 8x1
-    for (int i = 0; i < 8; i++) {
-      double  minErr = 1000000000.0;
-      float   y = inBufY[i];
-      float   u = inBufU[i];
-      float   v = inBufV[i];
-      for (int j = 0; j < 2; j++) {
-        double  err = Ep128ImgConv::calculateYUVErrorSqr(
-                          tmpPaletteY[j], tmpPaletteU[j], tmpPaletteV[j],
-                          y, u, v, colorErrorScale);
-        if (err < minErr)
-          minErr = err;
-      }
-      totalError += minErr;
-    }
+    calculateMinErrors(&(minErrors[0]), inBufY, inBufU, inBufV, 8,
+                       tmpPaletteY, tmpPaletteU, tmpPaletteV, 2,
+                       colorErrorScale);
+    for (int i = 0; i < 8; i++)
+      totalError += minErrors[i];
     if (ditherType == 0)
       return totalError;
     for (int i = 0; i < 4; i++) {
@@ -162,34 +154,24 @@ namespace Ep128ImgConv {
       inBufY[i] = (inBufY[i << 1] + inBufY[(i << 1) + 1]) * 0.5f;
       inBufU[i] = (inBufU[i << 1] + inBufU[(i << 1) + 1]) * 0.5f;
       inBufV[i] = (inBufV[i << 1] + inBufV[(i << 1) + 1]) * 0.5f;
-      double  minErr = 1000000000.0;
-      float   y = inBufY[i];
-      float   u = inBufU[i];
-      float   v = inBufV[i];
-      for (int j = 0; j < 3; j++) {
-        double  err = Ep128ImgConv::calculateYUVErrorSqr(
-                          tmpPaletteY[j], tmpPaletteU[j], tmpPaletteV[j],
-                          y, u, v, colorErrorScale);
-        if (err < minErr)
-          minErr = err;
-      }
-      totalError += (minErr * 3.0);
     }
+    calculateMinErrors(&(minErrors[0]), inBufY, inBufU, inBufV, 4,
+                       tmpPaletteY, tmpPaletteU, tmpPaletteV, 3,
+                       colorErrorScale);
+    for (int i = 0; i < 4; i++)
+      totalError += (minErrors[i] * 3.0);
     for (int i = 0; i < 2; i++) {
       // downsample to 2x1
-      double  minErr = 1000000000.0;
-      float   y = (inBufY[i << 1] + inBufY[(i << 1) + 1]) * 0.5f;
-      float   u = (inBufU[i << 1] + inBufU[(i << 1) + 1]) * 0.5f;
-      float   v = (inBufV[i << 1] + inBufV[(i << 1) + 1]) * 0.5f;
-      for (int j = 0; j < 5; j++) {
-        double  err = Ep128ImgConv::calculateYUVErrorSqr(
-                          tmpPaletteY[j], tmpPaletteU[j], tmpPaletteV[j],
-                          y, u, v, colorErrorScale);
-        if (err < minErr)
-          minErr = err;
-      }
-      totalError += (minErr * 2.0);
+      inBufY[i + 4] = (inBufY[i << 1] + inBufY[(i << 1) + 1]) * 0.5f;
+      inBufU[i + 4] = (inBufU[i << 1] + inBufU[(i << 1) + 1]) * 0.5f;
+      inBufV[i + 4] = (inBufV[i << 1] + inBufV[(i << 1) + 1]) * 0.5f;
     }
+    calculateMinErrors(&(minErrors[0]), &(inBufY[4]), &(inBufU[4]),
+                       &(inBufV[4]), 2,
+                       tmpPaletteY, tmpPaletteU, tmpPaletteV, 5,
+                       colorErrorScale);
+    for (int i = 0; i < 2; i++)
+      totalError += (minErrors[i] * 2.0);
     return totalError;
   }
 
@@ -394,64 +376,85 @@ namespace Ep128ImgConv {
   double ImageConv_Attr16::optimizeLineAttributes(int yc, bool usePalette,
                                                   int optimizeLevel)
   {
+    // the attribute cells of a line are independent of each other,
+    // and can be optimized in parallel
+    parallelLineNum = yc;
+    parallelUsePalette = usePalette;
+    parallelOptimizeLevel = optimizeLevel;
+    (void) runParallel(&optimizeAttrCellCallback, (void *) this, width >> 3);
     double  totalError = 0.0;
-    for (int xc = 0; xc < width; xc += 8) {
-      double  minErr = 1000000000.0;
-      int     bestColor0 = 0;
-      int     bestColor1 = 0;
-      if (usePalette) {
-        for (int c0 = 0; c0 < 15; c0++) {
-          for (int c1 = c0 + 1; c1 < 16; c1++) {
-            double  err = calculateAttrCellError(
-                              xc, yc, palette[yc][c0], palette[yc][c1]);
-            if (err < minErr) {
-              bestColor0 = palette[yc][c0];
-              bestColor1 = palette[yc][c1];
-              minErr = err;
-            }
+    for (int xc = 0; xc < width; xc += 8)
+      totalError += cellErrorTable[xc >> 3];
+    return totalError;
+  }
+
+  double ImageConv_Attr16::optimizeAttrCell(int xc, int yc, bool usePalette,
+                                            int optimizeLevel)
+  {
+    double  minErr = 1000000000.0;
+    int     bestColor0 = 0;
+    int     bestColor1 = 0;
+    if (usePalette) {
+      for (int c0 = 0; c0 < 15; c0++) {
+        for (int c1 = c0 + 1; c1 < 16; c1++) {
+          double  err = calculateAttrCellError(
+                            xc, yc, palette[yc][c0], palette[yc][c1]);
+          if (err < minErr) {
+            bestColor0 = palette[yc][c0];
+            bestColor1 = palette[yc][c1];
+            minErr = err;
           }
         }
       }
-      else {
-        double  bestError = 1000000000.0;
-        for (int l = 0; l < optimizeLevel; l++) {
-          int     tmp = 0;
-          setRandomSeed(tmp, uint32_t(l + 10000));
-          int     c0 = getRandomNumber(tmp) & 0xFF;
-          int     c1 = getRandomNumber(tmp) & 0xFF;
-          bool    doneFlag = false;
-          do {
-            doneFlag = true;
-            for (int i = 0; i < 256; i++) {
-              double  err = calculateAttrCellError(xc, yc, i, c1);
-              if (err < (minErr * 0.999999)) {
-                c0 = i;
-                minErr = err;
-                doneFlag = false;
-              }
+    }
+    else {
+      double  bestError = 1000000000.0;
+      for (int l = 0; l < optimizeLevel; l++) {
+        int     tmp = 0;
+        setRandomSeed(tmp, uint32_t(l + 10000));
+        int     c0 = getRandomNumber(tmp) & 0xFF;
+        int     c1 = getRandomNumber(tmp) & 0xFF;
+        bool    doneFlag = false;
+        do {
+          doneFlag = true;
+          for (int i = 0; i < 256; i++) {
+            double  err = calculateAttrCellError(xc, yc, i, c1);
+            if (err < (minErr * 0.999999)) {
+              c0 = i;
+              minErr = err;
+              doneFlag = false;
             }
-            for (int i = 0; i < 256; i++) {
-              double  err = calculateAttrCellError(xc, yc, c0, i);
-              if (err < (minErr * 0.999999)) {
-                c1 = i;
-                minErr = err;
-                doneFlag = false;
-              }
+          }
+          for (int i = 0; i < 256; i++) {
+            double  err = calculateAttrCellError(xc, yc, c0, i);
+            if (err < (minErr * 0.999999)) {
+              c1 = i;
+              minErr = err;
+              doneFlag = false;
             }
-          } while (!doneFlag);
-          if (minErr < bestError) {
-            bestColor0 = c0;
-            bestColor1 = c1;
-            bestError = minErr;
           }
+        } while (!doneFlag);
+        if (minErr < bestError) {
+          bestColor0 = c0;
+          bestColor1 = c1;
+          bestError = minErr;
         }
-        minErr = bestError;
       }
-      totalError += minErr;
-      attr0[yc][xc >> 3] = bestColor0;
-      attr1[yc][xc >> 3] = bestColor1;
+      minErr = bestError;
     }
-    return totalError;
+    attr0[yc][xc >> 3] = bestColor0;
+    attr1[yc][xc >> 3] = bestColor1;
+    return minErr;
+  }
+
+  void ImageConv_Attr16::optimizeAttrCellCallback(void *userData, int n)
+  {
+    ImageConv_Attr16&  this_ =
+        *(reinterpret_cast<ImageConv_Attr16 *>(userData));
+    this_.cellErrorTable[n] =
+        this_.optimizeAttrCell(n << 3, this_.parallelLineNum,
+                               this_.parallelUsePalette,
+                               this_.parallelOptimizeLevel);
   }
 
   double ImageConv_Attr16::optimizeImagePalette(int optimizeLevel,
@@ -728,21 +731,11 @@ namespace Ep128ImgConv {
     }
     for (int i = 0; i < 8; i++) {
       if (!fixedColors[i]) {
-        double  y = tmpPaletteY[i];
-        double  u = tmpPaletteU[i];
-        double  v = tmpPaletteV[i];
         double  bestError = 1000000000.0;
-        int     bestColor = 0;
-        for (int c = 0; c < 256; c++) {
-          double  err =
-              Ep128ImgConv::calculateYUVErrorSqr(
-                  paletteY[c], paletteU[c], paletteV[c],
-                  y, u, v, colorErrorScale);
-          if (err < bestError) {
-            bestError = err;
-            bestColor = c;
-          }
-        }
+        int     bestColor = findNearestColor(bestError,
+                                             paletteY, paletteU, paletteV, 256,
+                                             tmpPaletteY[i], tmpPaletteU[i],
+                                             tmpPaletteV[i], colorErrorScale);
         palette[yc][i] = (unsigned char) bestColor;
       }
     }
@@ -750,6 +743,47 @@ namespace Ep128ImgConv {
     return calculateLineError16(yc);
   }
 
+  void ImageConv_Attr16::optimizeLinePaletteCallback(void *userData, int n)
+  {
+    ImageConv_Attr16&  this_ =
+        *(reinterpret_cast<ImageConv_Attr16 *>(userData));
+    int     yc = this_.parallelLineNum + n;
+    this_.lineErrorTable[yc] = this_.optimizeLinePalette_fast(yc);
+  }
+
+  double ImageConv_Attr16::optimizeImagePalette_fast(double maxError)
+  {
+    // process lines in blocks, see ImageConverter::runParallel()
+    int     blockSize = getNumberOfThreads();
+    if (blockSize > 1)
+      blockSize = blockSize * 4;
+    unsigned char savedPalette[64 * 4 * 8];
+    double  err = 0.0;
+    bool    doneFlag = false;
+    for (int y0 = 0; y0 < height && !doneFlag; y0 += blockSize) {
+      int     nLines = height - y0;
+      if (nLines > blockSize)
+        nLines = blockSize;
+      for (int yc = 0; yc < nLines; yc++) {
+        for (int i = 0; i < 8; i++)
+          savedPalette[(yc << 3) + i] = palette[y0 + yc][i];
+      }
+      parallelLineNum = y0;
+      (void) runParallel(&optimizeLinePaletteCallback, (void *) this, nLines);
+      for (int yc = 0; yc < nLines; yc++) {
+        if (!doneFlag) {
+          err += lineErrorTable[y0 + yc];
+          doneFlag = (err > (maxError * 1.000001));
+        }
+        else {
+          for (int i = 0; i < 8; i++)
+            palette[y0 + yc][i] = savedPalette[(yc << 3) + i];
+        }
+      }
+    }
+    return err;
+  }
+
   void ImageConv_Attr16::pixelStoreCallback(void *userData, int xc, int yc,
                                             float y, float u, float v)
   {
@@ -795,7 +829,12 @@ namespace Ep128ImgConv {
       borderColor(0x00),
       ditherType(1),
       ditherDiffusion(0.95f),
-      errorTable((double *) 0)
+      errorTable((double *) 0),
+      lineErrorTable((double *) 0),
+      cellErrorTable((double *) 0),
+      parallelLineNum(0),
+      parallelUsePalette(false),
+      parallelOptimizeLevel(2)
   {
     for (int i = 0; i < 8; i++)
       fixedColors[i] = false;
@@ -806,6 +845,10 @@ namespace Ep128ImgConv {
   ImageConv_Attr16::~ImageConv_Attr16()
   {
     delete[] errorTable;
+    if (lineErrorTable)
+      delete[] lineErrorTable;
+    if (cellErrorTable)
+      delete[] cellErrorTable;
   }
 
   bool ImageConv_Attr16::processImage(
@@ -838,6 +881,14 @@ namespace Ep128ImgConv {
     palette.clear();
     attr0.clear();
     attr1.clear();
+    if (lineErrorTable)
+      delete[] lineErrorTable;
+    lineErrorTable = (double *) 0;
+    if (cellErrorTable)
+      delete[] cellErrorTable;
+    cellErrorTable = (double *) 0;
+    lineErrorTable = new double[height];
+    cellErrorTable = new double[width >> 3];
 
     initializePalettes();
     setFixBias(0);
@@ -869,11 +920,7 @@ namespace Ep128ImgConv {
         setFixBias(fb);
         double  err = 0.0;
         if (conversionQuality >= 9 && config.paletteResolution > 0) {
-          for (int yc = 0; yc < height; yc++) {
-            err += optimizeLinePalette_fast(yc);
-            if (err > (bestError * 1.000001))
-              break;
-          }
+          err = optimizeImagePalette_fast(bestError);
         }
         else {
           err = calculateTotalError16(bestError);
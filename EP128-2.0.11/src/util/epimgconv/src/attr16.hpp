@@ -45,6 +45,11 @@ namespace Ep128ImgConv {
     int           ditherType;
     float         ditherDiffusion;
     double        *errorTable;          // size = 256*256
+    double        *lineErrorTable;      // size = height
+    double        *cellErrorTable;      // size = width / 8
+    int           parallelLineNum;
+    bool          parallelUsePalette;
+    int           parallelOptimizeLevel;
     bool          fixedColors[8];
     float         paletteY[256];
     float         paletteU[256];
@@ -77,6 +82,9 @@ namespace Ep128ImgConv {
     double optimizeLinePalette(int yc, int optimizeLevel = 2);
     double optimizeLineAttributes(int yc, bool usePalette,
                                   int optimizeLevel = 2);
+    double optimizeAttrCell(int xc, int yc, bool usePalette,
+                            int optimizeLevel);
+    static void optimizeAttrCellCallback(void *userData, int n);
     double optimizeImagePalette(int optimizeLevel = 2,
                                 bool optimizeFixBias = false);
     void sortLinePalette(int yc);
@@ -84,6 +92,10 @@ namespace Ep128ImgConv {
     void ditherLine(long yc, bool updateError = true);
     void preDitherImage();
     double optimizeLinePalette_fast(int yc);
+    static void optimizeLinePaletteCallback(void *userData, int n);
+    // returns the sum of optimizeLinePalette_fast() for all lines, stopping
+    // early if 'maxError' is exceeded
+    double optimizeImagePalette_fast(double maxError);
     static void pixelStoreCallback(void *userData, int xc, int yc,
                                    float y, float u, float v);
     static void pixelStoreCallbackI(void *userData, int xc, int yc,
@@ -37,6 +37,18 @@
 #include <FL/Fl_Image.H>
 #include <FL/Fl_Shared_Image.H>
 
+#include <vector>
+
+#if (defined(__i386__) || defined(__x86_64__)) && !defined(__ICC) &&     \
+    ((defined(__GNUC__) && (__GNUC__ > 4 ||                             \
+                            (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || \
+     defined(__clang__))
+// SSE2 and AVX versions of the color error functions are compiled with
+// function specific target attributes, and selected at run time
+#  define EPIMGCONV_X86_SIMD    1
+#  include <immintrin.h>
+#endif
+
 static const int  ditherTable_Bayer[4096] = {
      0, 2048,  512, 2560,  128, 2176,  640, 2688,   32, 2080,  544, 2592,
    160, 2208,  672, 2720,    8, 2056,  520, 2568,  136, 2184,  648, 2696,
@@ -1478,7 +1490,8 @@ namespace Ep128ImgConv {
   // --------------------------------------------------------------------------
 
   ImageConverter::ImageConverter()
-    : progressMessageCallback(&defaultProgressMessageCb),
+    : threadPool(),
+      progressMessageCallback(&defaultProgressMessageCb),
       progressMessageUserData((void *) 0),
       progressPercentageCallback(&defaultProgressPercentageCb),
       progressPercentageUserData((void *) 0),
@@ -1490,6 +1503,52 @@ namespace Ep128ImgConv {
   {
   }
 
+  void ImageConverter::setNumberOfThreads(int n)
+  {
+    limitValue(n, 1, 64);
+    threadPool.setNumberOfThreads(n);
+  }
+
+  void ImageConverter::parallelLoopCallback(void *userData, int n,
+                                            int threadNum)
+  {
+    (void) threadNum;
+    ParallelLoopInfo& p = *(reinterpret_cast< ParallelLoopInfo * >(userData));
+    p.func(p.userData, n);
+  }
+
+  bool ImageConverter::parallelProgressCallback(void *userData, int nDone)
+  {
+    ParallelLoopInfo& p = *(reinterpret_cast< ParallelLoopInfo * >(userData));
+    return p.conv->setProgressPercentage(
+               ((p.progressBase + (nDone * p.progressStep)) * 100)
+               / p.progressMax);
+  }
+
+  bool ImageConverter::runParallel(void (*func)(void *userData, int n),
+                                   void *userData, int nItems,
+                                   int *progressCnt, int progressStep,
+                                   int progressMax)
+  {
+    ParallelLoopInfo  p;
+    p.conv = this;
+    p.func = func;
+    p.userData = userData;
+    p.progressCnt = progressCnt;
+    p.progressBase = (progressCnt ? *progressCnt : 0);
+    p.progressStep = progressStep;
+    p.progressMax = progressMax;
+    if (!threadPool.run(&parallelLoopCallback, (void *) &p, nItems,
+                        (progressCnt ? &parallelProgressCallback
+                                     : (bool (*)(void *, int)) 0),
+                        (void *) &p)) {
+      return false;
+    }
+    if (progressCnt)
+      *progressCnt = p.progressBase + (nItems * progressStep);
+    return true;
+  }
+
   bool ImageConverter::processImage(ImageData& imgData, const char *infileName,
                                     YUVImageConverter& imgConv,
                                     const ImageConvConfig& config)
@@ -1625,6 +1684,346 @@ namespace Ep128ImgConv {
     (void) getRandomNumber(seedValue);
   }
 
+  static int findNearestColor_Scalar(double& minErr,
+                                     const float *paletteY,
+                                     const float *paletteU,
+                                     const float *paletteV, int nColors,
+                                     double y, double u, double v,
+                                     double colorErrorScale)
+  {
+    double  bestError = 1000000000.0;
+    int     bestColor = 0;
+    for (int i = 0; i < nColors; i++) {
+      double  err = calculateYUVErrorSqr(paletteY[i], paletteU[i], paletteV[i],
+                                         y, u, v, colorErrorScale);
+      if (err < bestError) {
+        bestError = err;
+        bestColor = i;
+      }
+    }
+    minErr = bestError;
+    return bestColor;
+  }
+
+  static void calculateMinErrors_Scalar(double *minErrors,
+                                        const float *bufY, const float *bufU,
+                                        const float *bufV, int nPixels,
+                                        const float *paletteY,
+                                        const float *paletteU,
+                                        const float *paletteV, int nColors,
+                                        double colorErrorScale)
+  {
+    for (int n = 0; n < nPixels; n++) {
+      double  minErr = 1000000000.0;
+      for (int i = 0; i < nColors; i++) {
+        double  err = calculateYUVErrorSqr(paletteY[i], paletteU[i],
+                                           paletteV[i], bufY[n], bufU[n],
+                                           bufV[n], colorErrorScale);
+        if (err < minErr)
+          minErr = err;
+      }
+      minErrors[n] = minErr;
+    }
+  }
+
+#ifdef EPIMGCONV_X86_SIMD
+
+  // the SIMD functions calculate the errors in double precision, using the
+  // same operations in the same order as calculateYUVErrorSqr(); the
+  // nearest color is found by first calculating the minimum error, and
+  // then searching for the first palette entry that has the same error,
+  // which avoids a dependency on the index in the inner loop
+
+  __attribute__ ((__target__ ("sse2")))
+  static inline __m128d loadFloat2_SSE2(const float *p)
+  {
+    return _mm_cvtps_pd(_mm_castsi128_ps(
+                            _mm_loadl_epi64((const __m128i *) p)));
+  }
+
+  __attribute__ ((__target__ ("sse2")))
+  static int findNearestColor_SSE2(double& minErr,
+                                   const float *paletteY,
+                                   const float *paletteU,
+                                   const float *paletteV, int nColors,
+                                   double y, double u, double v,
+                                   double colorErrorScale)
+  {
+    double  errBuf[256];
+    __m128d yy = _mm_set1_pd(y);
+    __m128d uu = _mm_set1_pd(u);
+    __m128d vv = _mm_set1_pd(v);
+    __m128d scale = _mm_set1_pd(colorErrorScale);
+    __m128d minErr_ = _mm_set1_pd(1000000000.0);
+    int     n = (nColors < 256 ? nColors : 256) & (~(int(1)));
+    int     i = 0;
+    for ( ; i < n; i += 2) {
+      __m128d dy = _mm_sub_pd(loadFloat2_SSE2(paletteY + i), yy);
+      __m128d du = _mm_sub_pd(loadFloat2_SSE2(paletteU + i), uu);
+      __m128d dv = _mm_sub_pd(loadFloat2_SSE2(paletteV + i), vv);
+      __m128d err =
+          _mm_add_pd(_mm_mul_pd(dy, dy),
+                     _mm_mul_pd(scale, _mm_add_pd(_mm_mul_pd(du, du),
+                                                  _mm_mul_pd(dv, dv))));
+      _mm_storeu_pd(&(errBuf[i]), err);
+      // (err < minErr_ ? err : minErr_)
+      minErr_ = _mm_min_pd(err, minErr_);
+    }
+    minErr_ = _mm_min_pd(_mm_unpackhi_pd(minErr_, minErr_), minErr_);
+    double  bestError = _mm_cvtsd_f64(minErr_);
+    int     bestColor = 0;
+    if (bestError < 1000000000.0) {
+      while (errBuf[bestColor] != bestError)
+        bestColor++;
+    }
+    for ( ; i < nColors; i++) {
+      double  err = calculateYUVErrorSqr(paletteY[i], paletteU[i], paletteV[i],
+                                         y, u, v, colorErrorScale);
+      if (err < bestError) {
+        bestError = err;
+        bestColor = i;
+      }
+    }
+    minErr = bestError;
+    return bestColor;
+  }
+
+  __attribute__ ((__target__ ("sse2")))
+  static void calculateMinErrors_SSE2(double *minErrors,
+                                      const float *bufY, const float *bufU,
+                                      const float *bufV, int nPixels,
+                                      const float *paletteY,
+                                      const float *paletteU,
+                                      const float *paletteV, int nColors,
+                                      double colorErrorScale)
+  {
+    __m128d scale = _mm_set1_pd(colorErrorScale);
+    int     n = 0;
+    for ( ; (n + 2) <= nPixels; n += 2) {
+      __m128d yy = loadFloat2_SSE2(bufY + n);
+      __m128d uu = loadFloat2_SSE2(bufU + n);
+      __m128d vv = loadFloat2_SSE2(bufV + n);
+      __m128d minErr = _mm_set1_pd(1000000000.0);
+      for (int i = 0; i < nColors; i++) {
+        __m128d dy = _mm_sub_pd(_mm_set1_pd(double(paletteY[i])), yy);
+        __m128d du = _mm_sub_pd(_mm_set1_pd(double(paletteU[i])), uu);
+        __m128d dv = _mm_sub_pd(_mm_set1_pd(double(paletteV[i])), vv);
+        __m128d err =
+            _mm_add_pd(_mm_mul_pd(dy, dy),
+                       _mm_mul_pd(scale, _mm_add_pd(_mm_mul_pd(du, du),
+                                                    _mm_mul_pd(dv, dv))));
+        // (err < minErr ? err : minErr)
+        minErr = _mm_min_pd(err, minErr);
+      }
+      _mm_storeu_pd(minErrors + n, minErr);
+    }
+    if (n < nPixels) {
+      calculateMinErrors_Scalar(minErrors + n, bufY + n, bufU + n, bufV + n,
+                                nPixels - n, paletteY, paletteU, paletteV,
+                                nColors, colorErrorScale);
+    }
+  }
+
+  __attribute__ ((__target__ ("avx")))
+  static int findNearestColor_AVX(double& minErr,
+                                  const float *paletteY,
+                                  const float *paletteU,
+                                  const float *paletteV, int nColors,
+                                  double y, double u, double v,
+                                  double colorErrorScale)
+  {
+    double  errBuf[256];
+    __m256d yy = _mm256_set1_pd(y);
+    __m256d uu = _mm256_set1_pd(u);
+    __m256d vv = _mm256_set1_pd(v);
+    __m256d scale = _mm256_set1_pd(colorErrorScale);
+    __m256d minErr_ = _mm256_set1_pd(1000000000.0);
+    int     n = (nColors < 256 ? nColors : 256) & (~(int(3)));
+    int     i = 0;
+    for ( ; i < n; i += 4) {
+      __m256d dy = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(paletteY + i)),
+                                 yy);
+      __m256d du = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(paletteU + i)),
+                                 uu);
+      __m256d dv = _mm256_sub_pd(_mm256_cvtps_pd(_mm_loadu_ps(paletteV + i)),
+                                 vv);
+      __m256d err =
+          _mm256_add_pd(_mm256_mul_pd(dy, dy),
+                        _mm256_mul_pd(scale,
+                                      _mm256_add_pd(_mm256_mul_pd(du, du),
+                                                    _mm256_mul_pd(dv, dv))));
+      _mm256_storeu_pd(&(errBuf[i]), err);
+      // (err < minErr_ ? err : minErr_)
+      minErr_ = _mm256_min_pd(err, minErr_);
+    }
+    __m128d tmp = _mm_min_pd(_mm256_extractf128_pd(minErr_, 1),
+                             _mm256_castpd256_pd128(minErr_));
+    tmp = _mm_min_pd(_mm_unpackhi_pd(tmp, tmp), tmp);
+    double  bestError = _mm_cvtsd_f64(tmp);
+    int     bestColor = 0;
+    if (bestError < 1000000000.0) {
+      while (errBuf[bestColor] != bestError)
+        bestColor++;
+    }
+    for ( ; i < nColors; i++) {
+      double  err = calculateYUVErrorSqr(paletteY[i], paletteU[i], paletteV[i],
+                                         y, u, v, colorErrorScale);
+      if (err < bestError) {
+        bestError = err;
+        bestColor = i;
+      }
+    }
+    minErr = bestError;
+    return bestColor;
+  }
+
+  __attribute__ ((__target__ ("avx")))
+  static void calculateMinErrors_AVX(double *minErrors,
+                                     const float *bufY, const float *bufU,
+                                     const float *bufV, int nPixels,
+                                     const float *paletteY,
+                                     const float *paletteU,
+                                     const float *paletteV, int nColors,
+                                     double colorErrorScale)
+  {
+    __m256d scale = _mm256_set1_pd(colorErrorScale);
+    int     n = 0;
+    for ( ; (n + 4) <= nPixels; n += 4) {
+      __m256d yy = _mm256_cvtps_pd(_mm_loadu_ps(bufY + n));
+      __m256d uu = _mm256_cvtps_pd(_mm_loadu_ps(bufU + n));
+      __m256d vv = _mm256_cvtps_pd(_mm_loadu_ps(bufV + n));
+      __m256d minErr = _mm256_set1_pd(1000000000.0);
+      for (int i = 0; i < nColors; i++) {
+        __m256d dy = _mm256_sub_pd(_mm256_set1_pd(double(paletteY[i])), yy);
+        __m256d du = _mm256_sub_pd(_mm256_set1_pd(double(paletteU[i])), uu);
+        __m256d dv = _mm256_sub_pd(_mm256_set1_pd(double(paletteV[i])), vv);
+        __m256d err =
+            _mm256_add_pd(_mm256_mul_pd(dy, dy),
+                          _mm256_mul_pd(scale,
+                                        _mm256_add_pd(_mm256_mul_pd(du, du),
+                                                      _mm256_mul_pd(dv, dv))));
+        // (err < minErr ? err : minErr)
+        minErr = _mm256_min_pd(err, minErr);
+      }
+      _mm256_storeu_pd(minErrors + n, minErr);
+    }
+    if (n < nPixels) {
+      calculateMinErrors_SSE2(minErrors + n, bufY + n, bufU + n, bufV + n,
+                              nPixels - n, paletteY, paletteU, paletteV,
+                              nColors, colorErrorScale);
+    }
+  }
+
+#endif  // EPIMGCONV_X86_SIMD
+
+  FindNearestColorFunc    findNearestColorFunc = &findNearestColor_Scalar;
+  CalculateMinErrorsFunc  calculateMinErrorsFunc = &calculateMinErrors_Scalar;
+
+  void setUseScalarErrorCalculation(bool isEnabled)
+  {
+    findNearestColorFunc = &findNearestColor_Scalar;
+    calculateMinErrorsFunc = &calculateMinErrors_Scalar;
+#ifdef EPIMGCONV_X86_SIMD
+    if (!isEnabled) {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx")) {
+        findNearestColorFunc = &findNearestColor_AVX;
+        calculateMinErrorsFunc = &calculateMinErrors_AVX;
+      }
+      else if (__builtin_cpu_supports("sse2")) {
+        findNearestColorFunc = &findNearestColor_SSE2;
+        calculateMinErrorsFunc = &calculateMinErrors_SSE2;
+      }
+    }
+#else
+    (void) isEnabled;
+#endif
+  }
+
+  bool checkErrorCalculation()
+  {
+    static const FindNearestColorFunc   findNearestColorFuncs[2] = {
+#ifdef EPIMGCONV_X86_SIMD
+      &findNearestColor_SSE2, &findNearestColor_AVX
+#else
+      (FindNearestColorFunc) 0, (FindNearestColorFunc) 0
+#endif
+    };
+    static const CalculateMinErrorsFunc calculateMinErrorsFuncs[2] = {
+#ifdef EPIMGCONV_X86_SIMD
+      &calculateMinErrors_SSE2, &calculateMinErrors_AVX
+#else
+      (CalculateMinErrorsFunc) 0, (CalculateMinErrorsFunc) 0
+#endif
+    };
+    bool    haveFunc[2] = { false, false };
+#ifdef EPIMGCONV_X86_SIMD
+    __builtin_cpu_init();
+    haveFunc[0] = bool(__builtin_cpu_supports("sse2"));
+    haveFunc[1] = bool(__builtin_cpu_supports("avx"));
+#endif
+    std::vector< float >  buf(256 * 3 + 67 * 3);
+    float   *paletteY = &(buf.front());
+    float   *paletteU = paletteY + 256;
+    float   *paletteV = paletteU + 256;
+    float   *bufY = paletteV + 256;
+    float   *bufU = bufY + 67;
+    float   *bufV = bufU + 67;
+    double  minErrors1[67];
+    double  minErrors2[67];
+    int     seedValue = 0;
+    setRandomSeed(seedValue, 1U);
+    for (int k = 0; k < 2; k++) {
+      if (!haveFunc[k])
+        continue;
+      for (int nColors = 1; nColors <= 256; nColors++) {
+        for (size_t i = 0; i < buf.size(); i++) {
+          // Y is in the range 0 to 1, U and V are in the range -0.5 to 0.5
+          buf[i] = float(getRandomNumber(seedValue) & 0xFFFF) / 65535.0f;
+          if (!(i < 256 || (i >= 256 * 3 && i < 256 * 3 + 67)))
+            buf[i] = buf[i] - 0.5f;
+        }
+        int     nPixels = (nColors % 67) + 1;
+        double  colorErrorScale = double(nColors) / 256.0;
+        for (int n = 0; n < nPixels; n++) {
+          double  err1 = 0.0;
+          double  err2 = 0.0;
+          int     c1 = findNearestColor_Scalar(err1, paletteY, paletteU,
+                                               paletteV, nColors, bufY[n],
+                                               bufU[n], bufV[n],
+                                               colorErrorScale);
+          int     c2 = findNearestColorFuncs[k](err2, paletteY, paletteU,
+                                                paletteV, nColors, bufY[n],
+                                                bufU[n], bufV[n],
+                                                colorErrorScale);
+          if (c1 != c2 || std::memcmp(&err1, &err2, sizeof(double)) != 0)
+            return false;
+        }
+        calculateMinErrors_Scalar(&(minErrors1[0]), bufY, bufU, bufV,
+                                  nPixels, paletteY, paletteU, paletteV,
+                                  nColors, colorErrorScale);
+        calculateMinErrorsFuncs[k](&(minErrors2[0]), bufY, bufU, bufV,
+                                   nPixels, paletteY, paletteU, paletteV,
+                                   nColors, colorErrorScale);
+        if (std::memcmp(&(minErrors1[0]), &(minErrors2[0]),
+                        sizeof(double) * size_t(nPixels)) != 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  class ErrorCalculationInit_ {
+   public:
+    ErrorCalculationInit_()
+    {
+      setUseScalarErrorCalculation(false);
+    }
+  };
+
+  static ErrorCalculationInit_  errorCalculationInit_;
+
   void ditherLine(IndexedImage& ditheredImage, const YUVImage& inputImage,
                   YUVImage& ditherErrorImage,
                   long yc, int ditherType, double ditherDiffusion,
@@ -1650,6 +2049,16 @@ namespace Ep128ImgConv {
       h = ditherErrorImage.getHeight();
     if (yc < 0L || yc >= long(h))
       return;
+    float   linePaletteY[256];
+    float   linePaletteU[256];
+    float   linePaletteV[256];
+    int     nColors = int(linePaletteSize < 256 ? linePaletteSize : 256);
+    for (int i = 0; i < nColors; i++) {
+      int     c = linePalette[i];
+      linePaletteY[i] = epPaletteY[c];
+      linePaletteU[i] = epPaletteU[c];
+      linePaletteV[i] = epPaletteV[c];
+    }
     for (int xc = 0; xc < w; xc++) {
       if ((yc & 1L) != 0L)
         xc = (w - 1) - xc;
@@ -1660,19 +2069,12 @@ namespace Ep128ImgConv {
       float   u = u0 + ditherErrorImage.u(xc, yc);
       float   v = v0 + ditherErrorImage.v(xc, yc);
       limitYUVColor(y, u, v);
+      // find nearest color
       double  bestError = 1000000000.0;
-      int     bestColor = 0;
-      for (size_t i = 0; i < linePaletteSize; i++) {
-        // find nearest color
-        int     c = linePalette[i];
-        double  err =
-            calculateYUVErrorSqr(epPaletteY[c], epPaletteU[c], epPaletteV[c],
-                                 y, u, v, colorErrorScale);
-        if (err < bestError) {
-          bestColor = int(i);
-          bestError = err;
-        }
-      }
+      int     bestColor =
+          findNearestColor(bestError,
+                           linePaletteY, linePaletteU, linePaletteV, nColors,
+                           y, u, v, colorErrorScale);
       ditheredImage[yc][xc] = (unsigned char) (bestColor & 0xFF);
       limitYUVColorToRGB(y, u, v);
       float   yErr = (y0 + ((y - y0) * float(ditherDiffusion)))
@@ -2080,6 +2482,7 @@ namespace Ep128ImgConv {
         converter = new ImageConv_TVCPixel16();
         break;
       }
+      converter->setNumberOfThreads(config.nThreads);
       if (progressMessageCallback && progressPercentageCallback) {
         converter->setProgressMessageCallback(progressMessageCallback,
                                               progressCallbackUserData);
@@ -24,6 +24,8 @@
 #define EPIMGCONV_EPIMGCONV_HPP
 
 #include "ep128emu.hpp"
+#include "system.hpp"
+#include "thrpool.hpp"
 #include "img_cfg.hpp"
 
 #include <cmath>
@@ -231,6 +233,20 @@ namespace Ep128ImgConv {
   };
 
   class ImageConverter {
+   private:
+    struct ParallelLoopInfo {
+      ImageConverter  *conv;
+      void    (*func)(void *userData, int n);
+      void    *userData;
+      int     *progressCnt;
+      int     progressBase;
+      int     progressStep;
+      int     progressMax;
+    };
+    Ep128Emu::ThreadPool  threadPool;
+    // ----------------
+    static void parallelLoopCallback(void *userData, int n, int threadNum);
+    static bool parallelProgressCallback(void *userData, int nDone);
    protected:
     void    (*progressMessageCallback)(void *userData, const char *msg);
     void    *progressMessageUserData;
@@ -240,6 +256,15 @@ namespace Ep128ImgConv {
    public:
     ImageConverter();
     virtual ~ImageConverter();
+    /*!
+     * Set the number of threads to be used for the conversion (1 to 64).
+     * The converted image does not depend on the number of threads.
+     */
+    virtual void setNumberOfThreads(int n);
+    inline int getNumberOfThreads() const
+    {
+      return threadPool.getNumberOfThreads();
+    }
     // the return value is false if the processing has been stopped
     virtual bool processImage(ImageData& imgData, const char *infileName,
                               YUVImageConverter& imgConv,
@@ -253,6 +278,27 @@ namespace Ep128ImgConv {
    protected:
     virtual void progressMessage(const char *msg);
     virtual bool setProgressPercentage(int n);
+    /*!
+     * Call func(userData, n) for all values of 'n' from 0 to nItems - 1,
+     * distributing the calls among the conversion threads. 'func' may only
+     * write data belonging to item 'n', so that the results do not depend
+     * on the number or the order of the calls.
+     * If 'progressCnt' is not NULL, the progress display is updated as
+     * (*progressCnt * 100 / progressMax), with *progressCnt incremented by
+     * 'progressStep' for each item. The return value is false if the
+     * processing has been stopped. Exceptions thrown by 'func' are passed
+     * on to the caller (see Ep128Emu::ThreadPool::run()).
+     * Loops that optimize the palettes of a range of lines, and stop early
+     * when the total error exceeds a limit, call this function for blocks
+     * of lines (getNumberOfThreads() * 4 lines at a time). The line errors
+     * of a block are then summed in the original order, and the palettes
+     * of lines past the early exit point are restored from a copy, because
+     * the fast line palette optimization starts from the previous palette.
+     * This keeps the results identical to single-threaded conversion.
+     */
+    bool runParallel(void (*func)(void *userData, int n), void *userData,
+                     int nItems, int *progressCnt = (int *) 0,
+                     int progressStep = 1, int progressMax = 1);
   };
 
   static inline double calculateError(double a, double b)
@@ -341,6 +387,75 @@ namespace Ep128ImgConv {
 
   void setRandomSeed(int& seedValue, uint32_t n);
 
+  typedef int (*FindNearestColorFunc)(double& minErr,
+                                      const float *paletteY,
+                                      const float *paletteU,
+                                      const float *paletteV, int nColors,
+                                      double y, double u, double v,
+                                      double colorErrorScale);
+  typedef void (*CalculateMinErrorsFunc)(double *minErrors,
+                                         const float *bufY, const float *bufU,
+                                         const float *bufV, int nPixels,
+                                         const float *paletteY,
+                                         const float *paletteU,
+                                         const float *paletteV, int nColors,
+                                         double colorErrorScale);
+
+  extern FindNearestColorFunc   findNearestColorFunc;
+  extern CalculateMinErrorsFunc calculateMinErrorsFunc;
+
+  /*!
+   * Returns the index of the first color in the palette (defined by the
+   * 'nColors' entries of paletteY, paletteU, and paletteV) that has the
+   * smallest calculateYUVErrorSqr() distance from y, u, v, and stores the
+   * error in 'minErr'. If no color has an error less than 1000000000.0,
+   * the return value is zero.
+   */
+  static inline int findNearestColor(double& minErr,
+                                     const float *paletteY,
+                                     const float *paletteU,
+                                     const float *paletteV, int nColors,
+                                     double y, double u, double v,
+                                     double colorErrorScale)
+  {
+    return findNearestColorFunc(minErr, paletteY, paletteU, paletteV,
+                                nColors, y, u, v, colorErrorScale);
+  }
+
+  /*!
+   * For each of the 'nPixels' colors in bufY, bufU, and bufV, store in
+   * minErrors[n] the smallest calculateYUVErrorSqr() distance from the
+   * 'nColors' entries of the palette (at most 1000000000.0).
+   */
+  static inline void calculateMinErrors(double *minErrors,
+                                        const float *bufY, const float *bufU,
+                                        const float *bufV, int nPixels,
+                                        const float *paletteY,
+                                        const float *paletteU,
+                                        const float *paletteV, int nColors,
+                                        double colorErrorScale)
+  {
+    calculateMinErrorsFunc(minErrors, bufY, bufU, bufV, nPixels,
+                           paletteY, paletteU, paletteV, nColors,
+                           colorErrorScale);
+  }
+
+  /*!
+   * Use the scalar versions of findNearestColor() and calculateMinErrors()
+   * even if SSE2 or AVX is available. The SIMD versions perform the same
+   * double precision operations in the same order, so the results are
+   * expected to be identical; the scalar code is intended as a reference.
+   */
+  void setUseScalarErrorCalculation(bool isEnabled);
+
+  /*!
+   * Compare the results of the SIMD versions of findNearestColor() and
+   * calculateMinErrors() that are supported by the CPU with the scalar
+   * reference on pseudo-random input data. Returns true if all results are
+   * bit-exact (or there are no SIMD versions).
+   */
+  bool checkErrorCalculation();
+
   void ditherLine(IndexedImage& ditheredImage, const YUVImage& inputImage,
                   YUVImage& ditherErrorImage,
                   long yc, int ditherType, double ditherDiffusion,
@@ -224,6 +224,8 @@ namespace Ep128ImgConv {
     (*this)["noInterpolation"].setCallback(&configChangeCallbackBoolean,
                                            (void *) this, true);
     createKey("noCompress", noCompress);
+    createKey("nThreads", nThreads);
+    (*this)["nThreads"].setRange(1.0, 64.0);
   }
 
   ImageConvConfig::~ImageConvConfig()
@@ -257,6 +259,7 @@ namespace Ep128ImgConv {
       paletteColors[i] = -1;
     noInterpolation = false;
     noCompress = false;
+    nThreads = 1;
     configChangeFlag = true;
   }
 
@@ -61,6 +61,7 @@ namespace Ep128ImgConv {
     int     paletteColors[8];   // palette colors (0 to 255), or -1 to optimize
     bool    noInterpolation;    // disable interpolation if true
     bool    noCompress;         // no automatic compression of large programs
+    int     nThreads;           // number of conversion threads (1 to 64)
     bool    configChangeFlag;
    private:
     static void configChangeCallbackBoolean(void *userData_,
@@ -346,6 +346,7 @@ void Ep128ImgConvGUI::updateConfigWindow()
       noCompressValuator->activate();
     }
     colorErrorScaleValuator->value(config.colorErrorScale);
+    nThreadsValuator->value(double(config.nThreads));
     color0Valuator->value(double(config.paletteColors[0]));
     setWidgetColors(color0Display, color0TVCDisplay, config.paletteColors[0]);
     color1Valuator->value(double(config.paletteColors[1]));
@@ -95,7 +95,7 @@ static int convertColorValue(const char *s, bool isFixBias = false)
 static void parseCommandLine(Ep128ImgConv::ImageConvConfig& config,
                              std::string& infileName, std::string& outfileName,
                              bool& printUsageFlag, bool& helpFlag,
-                             int argc, char **argv)
+                             bool& checkSIMDFlag, int argc, char **argv)
 {
   infileName.clear();
   outfileName.clear();
@@ -231,6 +231,19 @@ static void parseCommandLine(Ep128ImgConv::ImageConvConfig& config,
         throw Ep128Emu::Exception("missing argument for '-nocompress'");
       config["noCompress"] = bool(std::atoi(argv[i]));
     }
+    else if (std::strcmp(s, "-threads") == 0) {
+      if (++i >= argc)
+        throw Ep128Emu::Exception("missing argument for '-threads'");
+      config["nThreads"] = int(std::atoi(argv[i]));
+    }
+    else if (std::strcmp(s, "-nosimd") == 0) {
+      if (++i >= argc)
+        throw Ep128Emu::Exception("missing argument for '-nosimd'");
+      Ep128ImgConv::setUseScalarErrorCalculation(bool(std::atoi(argv[i])));
+    }
+    else if (std::strcmp(s, "-checksimd") == 0) {
+      checkSIMDFlag = true;
+    }
     else if (std::strcmp(s, "-h") == 0 ||
              std::strcmp(s, "-help") == 0 ||
              std::strcmp(s, "--help") == 0) {
@@ -262,8 +275,18 @@ int main(int argc, char **argv)
     Ep128ImgConv::ImageConvConfig config;
     std::string infileName;
     std::string outfileName;
+    bool    checkSIMDFlag = false;
     parseCommandLine(config, infileName, outfileName, printUsageFlag, helpFlag,
-                     argc, argv);
+                     checkSIMDFlag, argc, argv);
+    if (checkSIMDFlag) {
+      if (!Ep128ImgConv::checkErrorCalculation()) {
+        throw Ep128Emu::Exception("SIMD color error calculation does not "
+                                  "match the scalar reference");
+      }
+      std::fprintf(stderr, "SIMD color error calculation matches the "
+                           "scalar reference\n");
+      return 0;
+    }
 #ifndef DISABLE_OPENGL_DISPLAY
     if (infileName.empty() && outfileName.empty()) {
       // if there are no file name arguments, run in GUI mode,
@@ -278,7 +301,7 @@ int main(int argc, char **argv)
       catch (...) {
       }
       parseCommandLine(config, infileName, outfileName,
-                       printUsageFlag, helpFlag, argc, argv);
+                       printUsageFlag, helpFlag, checkSIMDFlag, argc, argv);
       config.clearConfigurationChangeFlag();
       Ep128ImgConvGUI *gui = new Ep128ImgConvGUI(config);
       gui->run();
@@ -395,6 +418,18 @@ int main(int argc, char **argv)
                            "default: -1)\n");
       std::fprintf(stderr, "        set palette color N to C, or optimize if "
                            "C = -1\n");
+      std::fprintf(stderr, "    -threads <N>        (1 to 64, default: 1)\n");
+      std::fprintf(stderr, "        number of threads to use for the "
+                           "conversion; the output\n"
+                           "        does not depend on this setting\n");
+      std::fprintf(stderr, "    -nosimd <N>         (0 or 1, default: 0)\n");
+      std::fprintf(stderr, "        use the scalar reference code for color "
+                           "error calculation\n"
+                           "        instead of SSE2/AVX\n");
+      std::fprintf(stderr, "    -checksimd\n");
+      std::fprintf(stderr, "        check that the SSE2/AVX color error "
+                           "calculation gives the same\n"
+                           "        results as the scalar code, and exit\n");
       std::fprintf(stderr, "Color values can be specified in decimal or #RGB "
                            "format\n");
     }
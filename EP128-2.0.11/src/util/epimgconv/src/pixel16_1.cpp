@@ -362,6 +362,14 @@ namespace Ep128ImgConv {
     return bestError;
   }
 
+  void ImageConv_Pixel16_1::optimizeLinePaletteCallback(void *userData,
+                                                        int yc)
+  {
+    ImageConv_Pixel16_1&  this_ =
+        *(reinterpret_cast<ImageConv_Pixel16_1 *>(userData));
+    (void) this_.optimizeLinePalette(yc, this_.lineOptimizeLevel);
+  }
+
   void ImageConv_Pixel16_1::sortLinePalette(int yc)
   {
     // sort palette colors by bit-reversed color value
@@ -457,6 +465,7 @@ namespace Ep128ImgConv {
       borderColor(0x00),
       ditherType(1),
       ditherDiffusion(0.95f),
+      lineOptimizeLevel(2),
       errorTable((double *) 0)
   {
     for (int i = 0; i < 8; i++)
@@ -551,11 +560,10 @@ namespace Ep128ImgConv {
             }
           }
           setFixBias(bestFixBias);
-          for (int yc = 0; yc < height; yc++) {
-            if (!setProgressPercentage((progressCnt * 100) / progressMax))
-              return false;
-            optimizeLinePalette(yc, l + 1);
-            progressCnt += (l + 1);
+          lineOptimizeLevel = l + 1;
+          if (!runParallel(&optimizeLinePaletteCallback, (void *) this,
+                           height, &progressCnt, l + 1, progressMax)) {
+            return false;
           }
         }
       }
@@ -568,11 +576,10 @@ namespace Ep128ImgConv {
           double  bestError = 1000000000.0;
           for (int fb = 0; fb < 32; fb++) {
             setFixBias(fb);
-            for (int yc = 0; yc < height; yc++) {
-              if (!setProgressPercentage((progressCnt * 100) / progressMax))
-                return false;
-              optimizeLinePalette(yc, 2);
-              progressCnt += 2;
+            lineOptimizeLevel = 2;
+            if (!runParallel(&optimizeLinePaletteCallback, (void *) this,
+                             height, &progressCnt, 2, progressMax)) {
+              return false;
             }
             double  err = calculateTotalError(bestError);
             if (err < bestError) {
@@ -585,11 +592,10 @@ namespace Ep128ImgConv {
           bestFixBias = config.fixBias & 0x1F;
         }
         setFixBias(bestFixBias);
-        for (int yc = 0; yc < height; yc++) {
-          if (!setProgressPercentage((progressCnt * 100) / progressMax))
-            return false;
-          optimizeLinePalette(yc, optimizeLevel);
-          progressCnt += optimizeLevel;
+        lineOptimizeLevel = optimizeLevel;
+        if (!runParallel(&optimizeLinePaletteCallback, (void *) this,
+                         height, &progressCnt, optimizeLevel, progressMax)) {
+          return false;
         }
       }
     }
@@ -43,6 +43,7 @@ namespace Ep128ImgConv {
     int           borderColor;
     int           ditherType;
     float         ditherDiffusion;
+    int           lineOptimizeLevel;    // used by optimizeLinePaletteCallback
     double        *errorTable;          // size = 256*256
     bool          fixedColors[8];
     float         paletteY[256];
@@ -71,6 +72,7 @@ namespace Ep128ImgConv {
         double *errorCache = (double *) 0, double maxError = 1000000000.0);
     double calculateTotalError(double maxError = 1000000000.0);
     double optimizeLinePalette(int yc, int optimizeLevel = 2);
+    static void optimizeLinePaletteCallback(void *userData, int yc);
     double optimizeImagePalette(int optimizeLevel = 2,
                                 bool optimizeFixBias = false);
     void sortLinePalette(int yc);
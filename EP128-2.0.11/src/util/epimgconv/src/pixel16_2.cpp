@@ -85,6 +85,18 @@ namespace Ep128ImgConv {
         n++;
       }
     }
+    // colors that can be mixed with 'colorChanged'
+    float   mixPaletteY[16];
+    float   mixPaletteU[16];
+    float   mixPaletteV[16];
+    if (colorChanged >= 0) {
+      for (int i = 0; i < 16; i++) {
+        int     tmp = paletteMap[(colorChanged << 4) | i];
+        mixPaletteY[i] = tmpPaletteY[tmp];
+        mixPaletteU[i] = tmpPaletteU[tmp];
+        mixPaletteV[i] = tmpPaletteV[tmp];
+      }
+    }
     double  totalError = 0.0;
     float   tmpY = 0.0;
     float   tmpU = 0.0;
@@ -117,18 +129,9 @@ namespace Ep128ImgConv {
       }
       if (searchFlag) {
         double  minErr = 1000000000.0;
-        int     ci = 0;
-        for (int i = 0; i < 16; i++) {
-          double  err =
-              Ep128ImgConv::calculateYUVErrorSqr(tmpPaletteY[i],
-                                                 tmpPaletteU[i],
-                                                 tmpPaletteV[i],
-                                                 y, u, v, colorErrorScale);
-          if (err < minErr) {
-            minErr = err;
-            ci = i;
-          }
-        }
+        int     ci = findNearestColor(minErr,
+                                      tmpPaletteY, tmpPaletteU, tmpPaletteV,
+                                      16, y, u, v, colorErrorScale);
         if (colorIndexCache) {
           colorIndexCache[xc] = (unsigned char) ci;
           errorCache[xc] = minErr;
@@ -142,18 +145,9 @@ namespace Ep128ImgConv {
         if (int(colorIndexCache[width + (xc - 1)]) != colorChanged &&
             int(colorIndexCache[width + xc]) != colorChanged) {
           double  minErr2 = 1000000000.0;
-          int     ci = 0;
-          for (int i = 0; i < 16; i++) {
-            int     tmp = paletteMap[(colorChanged << 4) | i];
-            double  err =
-                Ep128ImgConv::calculateYUVErrorSqr(
-                    tmpPaletteY[tmp], tmpPaletteU[tmp], tmpPaletteV[tmp],
-                    tmpY, tmpU, tmpV, colorErrorScale);
-            if (err < minErr2) {
-              minErr2 = err;
-              ci = i;
-            }
-          }
+          int     ci = findNearestColor(minErr2,
+                                        mixPaletteY, mixPaletteU, mixPaletteV,
+                                        16, tmpY, tmpU, tmpV, colorErrorScale);
           double  minErr = errorCache[width + (xc >> 1)];
           if (minErr2 < minErr) {
             minErr = minErr2;
@@ -167,27 +161,9 @@ namespace Ep128ImgConv {
       }
       if (searchFlag) {
         double  minErr = 1000000000.0;
-        int     ci = 0;
-        for (int i = 0; i < 136; i += 2) {
-          double  err = Ep128ImgConv::calculateYUVErrorSqr(tmpPaletteY[i],
-                                                           tmpPaletteU[i],
-                                                           tmpPaletteV[i],
-                                                           tmpY, tmpU, tmpV,
-                                                           colorErrorScale);
-          if (err < minErr) {
-            minErr = err;
-            ci = i;
-          }
-          err = Ep128ImgConv::calculateYUVErrorSqr(tmpPaletteY[i + 1],
-                                                   tmpPaletteU[i + 1],
-                                                   tmpPaletteV[i + 1],
-                                                   tmpY, tmpU, tmpV,
-                                                   colorErrorScale);
-          if (err < minErr) {
-            minErr = err;
-            ci = i + 1;
-          }
-        }
+        int     ci = findNearestColor(minErr,
+                                      tmpPaletteY, tmpPaletteU, tmpPaletteV,
+                                      136, tmpY, tmpU, tmpV, colorErrorScale);
         if (colorIndexCache) {
           colorIndexCache[width + (xc - 1)] = (tmpPaletteI[ci] >> 4) & 0x0F;
           colorIndexCache[width + xc] = tmpPaletteI[ci] & 0x0F;
@@ -476,27 +452,63 @@ namespace Ep128ImgConv {
     }
     for (int i = 0; i < 8; i++) {
       if (!fixedColors[i]) {
-        double  y = tmpPaletteY[i];
-        double  u = tmpPaletteU[i];
-        double  v = tmpPaletteV[i];
         double  bestError = 1000000000.0;
-        int     bestColor = 0;
-        for (int c = 0; c < 256; c++) {
-          double  err =
-              Ep128ImgConv::calculateYUVErrorSqr(
-                  paletteY[c], paletteU[c], paletteV[c],
-                  y, u, v, colorErrorScale);
-          if (err < bestError) {
-            bestError = err;
-            bestColor = c;
-          }
-        }
+        int     bestColor = findNearestColor(bestError,
+                                             paletteY, paletteU, paletteV, 256,
+                                             tmpPaletteY[i], tmpPaletteU[i],
+                                             tmpPaletteV[i], colorErrorScale);
         palette[yc][i] = (unsigned char) bestColor;
       }
     }
     sortLinePalette(yc);
   }
 
+  void ImageConv_Pixel16_2::lineErrorCallback(void *userData, int n)
+  {
+    ImageConv_Pixel16_2&  this_ =
+        *(reinterpret_cast<ImageConv_Pixel16_2 *>(userData));
+    int     yc = this_.lineBlockOffset + n;
+    if (this_.fastLinePaletteFlag)
+      this_.optimizeLinePalette_fast(yc);
+    this_.lineErrorTable[yc] = this_.calculateLineError(yc);
+  }
+
+  double ImageConv_Pixel16_2::calculateFixBiasError(bool optimizePalettes,
+                                                    double maxError)
+  {
+    // process lines in blocks, see ImageConverter::runParallel()
+    int     blockSize = getNumberOfThreads();
+    if (blockSize > 1)
+      blockSize = blockSize * 4;
+    unsigned char savedPalette[64 * 4 * 8];
+    double  err = 0.0;
+    fastLinePaletteFlag = optimizePalettes;
+    for (int y0 = 0; y0 < height && err < (maxError * 1.000001);
+         y0 += blockSize) {
+      int     nLines = height - y0;
+      if (nLines > blockSize)
+        nLines = blockSize;
+      if (optimizePalettes) {
+        for (int yc = 0; yc < nLines; yc++) {
+          for (int i = 0; i < 8; i++)
+            savedPalette[(yc << 3) + i] = palette[y0 + yc][i];
+        }
+      }
+      lineBlockOffset = y0;
+      (void) runParallel(&lineErrorCallback, (void *) this, nLines);
+      for (int yc = 0; yc < nLines; yc++) {
+        if (err < (maxError * 1.000001)) {
+          err += lineErrorTable[y0 + yc];
+        }
+        else if (optimizePalettes) {
+          for (int i = 0; i < 8; i++)
+            palette[y0 + yc][i] = savedPalette[(yc << 3) + i];
+        }
+      }
+    }
+    return err;
+  }
+
   void ImageConv_Pixel16_2::pixelStoreCallback(void *userData, int xc, int yc,
                                                float y, float u, float v)
   {
@@ -539,7 +551,10 @@ namespace Ep128ImgConv {
       conversionQuality(3),
       borderColor(0x00),
       ditherType(1),
-      ditherDiffusion(0.95f)
+      ditherDiffusion(0.95f),
+      lineErrorTable((double *) 0),
+      lineBlockOffset(0),
+      fastLinePaletteFlag(false)
   {
     for (int i = 0; i < 8; i++)
       fixedColors[i] = false;
@@ -548,6 +563,8 @@ namespace Ep128ImgConv {
 
   ImageConv_Pixel16_2::~ImageConv_Pixel16_2()
   {
+    if (lineErrorTable)
+      delete[] lineErrorTable;
   }
 
   bool ImageConv_Pixel16_2::processImage(
@@ -576,6 +593,10 @@ namespace Ep128ImgConv {
     ditherErrorImage.clear();
     convertedImage.clear();
     palette.clear();
+    if (lineErrorTable)
+      delete[] lineErrorTable;
+    lineErrorTable = (double *) 0;
+    lineErrorTable = new double[height];
 
     initializePalettes();
     setFixBias(0);
@@ -615,14 +636,7 @@ namespace Ep128ImgConv {
           double  bestError = 1000000000.0;
           for (int fb = 0; fb < 32; fb++) {
             setFixBias(fb);
-            double  err = 0.0;
-            for (int yc = 0;
-                 yc < height && err < (bestError * 1.000001);
-                 yc++) {
-              if (l == 0)
-                optimizeLinePalette_fast(yc);
-              err += calculateLineError(yc);
-            }
+            double  err = calculateFixBiasError((l == 0), bestError);
             if (err < bestError) {
               bestFixBias = fb;
               bestError = err;
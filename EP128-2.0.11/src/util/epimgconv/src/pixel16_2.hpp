@@ -42,6 +42,9 @@ namespace Ep128ImgConv {
     int           borderColor;
     int           ditherType;
     float         ditherDiffusion;
+    double        *lineErrorTable;      // size = height
+    int           lineBlockOffset;
+    bool          fastLinePaletteFlag;
     bool          fixedColors[8];
     float         paletteY[256];
     float         paletteU[256];
@@ -71,6 +74,11 @@ namespace Ep128ImgConv {
     void sortLinePalette(int yc);
     void setFixedPalette();
     void optimizeLinePalette_fast(int yc);
+    static void lineErrorCallback(void *userData, int n);
+    // returns the sum of calculateLineError() for all lines, stopping early
+    // if 'maxError' is reached; if 'optimizePalettes' is true,
+    // optimizeLinePalette_fast() is called first for each line
+    double calculateFixBiasError(bool optimizePalettes, double maxError);
     static void pixelStoreCallback(void *userData, int xc, int yc,
                                    float y, float u, float v);
     static void pixelStoreCallbackI(void *userData, int xc, int yc,
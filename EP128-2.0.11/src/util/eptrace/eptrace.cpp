@@ -0,0 +1,278 @@
+
+// eptrace.cpp: decode binary execution trace files written by ep128emu
+// Copyright (C) 2007-2016 Istvan Varga <istvanv@users.sourceforge.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <exception>
+#include <new>
+#include <string>
+
+#include "ep128emu.hpp"
+#include "display.hpp"
+#include "soundio.hpp"
+#include "vm.hpp"
+#include "debuglib.hpp"
+#include "exectrace.hpp"
+
+using Ep128Emu::Exception;
+using Ep128Emu::ExecutionTrace;
+
+// virtual machine that only provides the opcode bytes stored in a trace
+// record to the disassembler
+
+class TraceRecordVM : public Ep128Emu::VirtualMachine {
+ private:
+  uint16_t  pc;
+  uint8_t   segment;
+  uint8_t   opcodeBytes[4];
+ public:
+  TraceRecordVM(Ep128Emu::VideoDisplay& display_,
+                Ep128Emu::AudioOutput& audioOutput_)
+    : Ep128Emu::VirtualMachine(display_, audioOutput_),
+      pc(0),
+      segment(0)
+  {
+    for (int i = 0; i < 4; i++)
+      opcodeBytes[i] = 0x00;
+  }
+  virtual ~TraceRecordVM()
+  {
+  }
+  void setRecord(const uint8_t *p)
+  {
+    pc = ExecutionTrace::getUInt16(p);
+    segment = p[2];
+    for (int i = 0; i < 4; i++)
+      opcodeBytes[i] = p[i + 4];
+  }
+  virtual uint8_t getMemoryPage(int n) const
+  {
+    if (n == int(pc >> 14))
+      return segment;
+    return 0x00;
+  }
+  virtual uint8_t readMemory(uint32_t addr, bool isCPUAddress = false) const
+  {
+    (void) isCPUAddress;
+    uint16_t  offs = uint16_t((addr - uint32_t(pc)) & 0xFFFFU);
+    if (offs < 4)
+      return opcodeBytes[offs];
+    return 0xFF;
+  }
+};
+
+// ----------------------------------------------------------------------------
+
+static bool parseHexArgument(uint32_t& n, const char *s, uint32_t maxValue)
+{
+  if (!Ep128Emu::parseHexNumber(n, s))
+    return false;
+  return (n <= maxValue);
+}
+
+static void printUsage(const char *prgName)
+{
+  std::fprintf(stderr, "Usage: %s [OPTIONS...] <TRACEFILE>\n", prgName);
+  std::fprintf(stderr, "Decodes binary trace files written by the TB "
+                       "monitor command, or epbatch -trace.\n");
+  std::fprintf(stderr, "The allowed options are:\n");
+  std::fprintf(stderr,
+               "    -flags <N>          "
+               "hexadecimal output format flags (default: 03):\n"
+               "                        "
+               "80: cycle count, 40: AF, 20: BC, 10: DE, 08: HL,\n"
+               "                        "
+               "04: SP, 02: segment, 01: disassembly\n");
+  std::fprintf(stderr,
+               "    -pc <START> <END>   "
+               "print instructions in the hexadecimal PC range only\n");
+  std::fprintf(stderr,
+               "    -seg <N>            "
+               "print instructions in segment N (hexadecimal) only\n");
+  std::fprintf(stderr,
+               "    -skip <N>           "
+               "skip the first N records of the file\n");
+  std::fprintf(stderr,
+               "    -n <N>              "
+               "print at most N instructions\n");
+  std::fprintf(stderr,
+               "    -o <FILENAME>       "
+               "write output to FILENAME instead of stdout\n");
+}
+
+int main(int argc, char **argv)
+{
+  Ep128Emu::NullDisplay *display = (Ep128Emu::NullDisplay *) 0;
+  Ep128Emu::AudioOutput *audioOutput = (Ep128Emu::AudioOutput *) 0;
+  TraceRecordVM         *vm = (TraceRecordVM *) 0;
+  std::FILE   *inFile = (std::FILE *) 0;
+  std::FILE   *outFile = (std::FILE *) 0;
+  const char  *inFileName = (const char *) 0;
+  const char  *outFileName = (const char *) 0;
+  uint32_t    flags = 0x03U;
+  uint32_t    minPC = 0x0000U;
+  uint32_t    maxPC = 0xFFFFU;
+  int         segmentFilter = -1;
+  double      skipCnt = 0.0;
+  double      maxCnt = -1.0;
+  int         retval = 0;
+
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-flags") == 0) {
+        if (++i >= argc || !parseHexArgument(flags, argv[i], 0xFFU))
+          throw Exception("invalid or missing -flags argument");
+      }
+      else if (std::strcmp(argv[i], "-pc") == 0) {
+        if ((i + 2) >= argc ||
+            !parseHexArgument(minPC, argv[i + 1], 0xFFFFU) ||
+            !parseHexArgument(maxPC, argv[i + 2], 0xFFFFU)) {
+          throw Exception("invalid or missing -pc arguments");
+        }
+        i = i + 2;
+      }
+      else if (std::strcmp(argv[i], "-seg") == 0) {
+        uint32_t  n = 0U;
+        if (++i >= argc || !parseHexArgument(n, argv[i], 0xFFU))
+          throw Exception("invalid or missing -seg argument");
+        segmentFilter = int(n);
+      }
+      else if (std::strcmp(argv[i], "-skip") == 0) {
+        if (++i >= argc)
+          throw Exception("missing -skip argument");
+        skipCnt = std::atof(argv[i]);
+      }
+      else if (std::strcmp(argv[i], "-n") == 0) {
+        if (++i >= argc)
+          throw Exception("missing -n argument");
+        maxCnt = std::atof(argv[i]);
+      }
+      else if (std::strcmp(argv[i], "-o") == 0) {
+        if (++i >= argc)
+          throw Exception("missing output file name");
+        outFileName = argv[i];
+      }
+      else if (std::strcmp(argv[i], "-h") == 0 ||
+               std::strcmp(argv[i], "-help") == 0 ||
+               std::strcmp(argv[i], "--help") == 0) {
+        printUsage(argv[0]);
+        return 0;
+      }
+      else if (argv[i][0] == '-' || inFileName) {
+        printUsage(argv[0]);
+        return -1;
+      }
+      else {
+        inFileName = argv[i];
+      }
+    }
+    if (!inFileName) {
+      printUsage(argv[0]);
+      return -1;
+    }
+    inFile = Ep128Emu::fileOpen(inFileName, "rb");
+    if (!inFile)
+      throw Exception("error opening trace file");
+    ExecutionTrace::readFileHeader(inFile);
+    if (outFileName) {
+      outFile = Ep128Emu::fileOpen(outFileName, "w");
+      if (!outFile)
+        throw Exception("error opening output file");
+    }
+    display = new Ep128Emu::NullDisplay();
+    audioOutput = new Ep128Emu::AudioOutput();
+    vm = new TraceRecordVM(*display, *audioOutput);
+    std::FILE *f = (outFile ? outFile : stdout);
+    uint8_t   recordBuf[ExecutionTrace::recordSize];
+    std::string disasmBuf;
+    disasmBuf.reserve(48);
+    double    recordCnt = 0.0;
+    double    printCnt = 0.0;
+    while (maxCnt < 0.0 || printCnt < maxCnt) {
+      if (std::fread(&(recordBuf[0]), sizeof(uint8_t),
+                     ExecutionTrace::recordSize, inFile)
+          != ExecutionTrace::recordSize) {
+        break;
+      }
+      recordCnt += 1.0;
+      if (recordCnt <= skipCnt)
+        continue;
+      const uint8_t *p = &(recordBuf[0]);
+      uint16_t  pc = ExecutionTrace::getUInt16(p);
+      if (uint32_t(pc) < minPC || uint32_t(pc) > maxPC)
+        continue;
+      if (segmentFilter >= 0 && int(p[2]) != segmentFilter)
+        continue;
+      printCnt += 1.0;
+      // use the same format as the TR monitor command
+      char    tmpBuf[128];
+      char    *bufp = &(tmpBuf[0]);
+      if (flags & 0x80) {
+        bufp += std::sprintf(bufp, "[%10.0f] ",
+                             double(ExecutionTrace::getUInt64(p + 8)));
+      }
+      const char  *regNames[5] = { "AF", "BC", "DE", "HL", "SP" };
+      for (int i = 0; i < 5; i++) {
+        if (flags & (0x40U >> i)) {
+          bufp += std::sprintf(bufp, "%s=%04X ", regNames[i],
+                               (unsigned int) ExecutionTrace::getUInt16(
+                                                  p + 16 + (i << 1)));
+        }
+      }
+      if (flags & 0x02) {
+        bufp = Ep128Emu::printHexNumber(bufp, p[2], 0, 2, 0);
+        *(bufp++) = ':';
+      }
+      bufp = Ep128Emu::printHexNumber(bufp, pc, 0, 4, 0);
+      if (flags & 0x01) {
+        vm->setRecord(p);
+        disasmBuf.clear();
+        Ep128::Z80Disassembler::disassembleInstruction(disasmBuf, *vm,
+                                                       pc, true);
+        if (disasmBuf.length() > 21 && disasmBuf.length() <= 40)
+          bufp += std::sprintf(bufp, "  %s", disasmBuf.c_str() + 21);
+      }
+      *(bufp++) = '\n';
+      *bufp = '\0';
+      if (std::fputs(&(tmpBuf[0]), f) == EOF)
+        throw Exception("error writing output file");
+    }
+  }
+  catch (std::exception& e) {
+    std::fprintf(stderr, " *** %s: %s\n", argv[0], e.what());
+    retval = -1;
+  }
+  if (outFile) {
+    if (std::fclose(outFile) != 0 && retval == 0) {
+      std::fprintf(stderr, " *** %s: error writing output file\n", argv[0]);
+      retval = -1;
+    }
+  }
+  if (inFile)
+    std::fclose(inFile);
+  if (vm)
+    delete vm;
+  if (display)
+    delete display;
+  if (audioOutput)
+    delete audioOutput;
+  return retval;
+}
+
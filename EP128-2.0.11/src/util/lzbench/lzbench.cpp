@@ -0,0 +1,166 @@
+
+// lzbench.cpp: compare the match finders of LZSearchTable
+// Copyright (C) 2007-2016 Istvan Varga <istvanv@users.sourceforge.net>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ep128emu.hpp"
+#include "system.hpp"
+#include "comprlib.hpp"
+
+using Ep128Emu::Exception;
+
+// match finder parameters (the defaults are those of epcompress -m2)
+static size_t minLength = 1;
+static size_t maxLength = 512;
+static size_t lengthMaxValue = 65535;
+static size_t maxOffs1 = 4096;
+static size_t maxOffs2 = 16384;
+static size_t maxOffset = 65536;
+// number of times each file is searched, the fastest time is reported
+static int    nIterations = 3;
+
+static void readInputFile(std::vector< unsigned char >& buf,
+                          const char *fileName)
+{
+  buf.clear();
+  std::FILE *f = std::fopen(fileName, "rb");
+  if (!f)
+    throw Exception("error opening input file");
+  int     c;
+  while ((c = std::fgetc(f)) != EOF)
+    buf.push_back((unsigned char) c);
+  std::fclose(f);
+}
+
+// returns the time in seconds taken by LZSearchTable::findMatches()
+static double findMatches(Ep128Compress::LZSearchTable& searchTable,
+                          const std::vector< unsigned char >& buf,
+                          int suffixSortAlgorithm)
+{
+  Ep128Compress::LZSearchTable::setSuffixSortAlgorithm(suffixSortAlgorithm);
+  double  bestTime = 1.0e9;
+  for (int i = 0; i < nIterations; i++) {
+    Ep128Emu::Timer t;
+    searchTable.findMatches(&(buf.front()), 0, buf.size());
+    double  tmp = t.getRealTime();
+    bestTime = (tmp < bestTime ? tmp : bestTime);
+  }
+  return bestTime;
+}
+
+static bool compareMatches(const Ep128Compress::LZSearchTable& t1,
+                           const Ep128Compress::LZSearchTable& t2,
+                           size_t nBytes)
+{
+  for (size_t i = 0; i < nBytes; i++) {
+    const unsigned int  *p1 = t1.getMatches(i);
+    const unsigned int  *p2 = t2.getMatches(i);
+    if (lengthMaxValue > 1023) {
+      if (*(p1++) != *(p2++))
+        return false;
+    }
+    do {
+      if (*p1 != *p2)
+        return false;
+      p2++;
+    } while (*(p1++) != 0U);
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector< std::string >  fileNames;
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "-maxlen") == 0 && (i + 1) < argc) {
+        maxLength = size_t(std::atoi(argv[++i]));
+        maxLength = (maxLength > 16 ? (maxLength < 1023 ? maxLength : 1023)
+                                    : 16);
+      }
+      else if (std::strcmp(argv[i], "-maxoffs") == 0 && (i + 1) < argc) {
+        maxOffset = size_t(std::atoi(argv[++i]));
+        maxOffset = (maxOffset > 16 ? (maxOffset < 524288 ? maxOffset : 524288)
+                                    : 16);
+      }
+      else if (std::strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+        nIterations = std::atoi(argv[++i]);
+        nIterations = (nIterations > 1 ? nIterations : 1);
+      }
+      else if (argv[i][0] == '-') {
+        fileNames.clear();
+        break;
+      }
+      else {
+        fileNames.push_back(argv[i]);
+      }
+    }
+    if (fileNames.size() < 1) {
+      std::fprintf(stderr, "Usage: %s [-maxlen N] [-maxoffs N] [-n N] "
+                           "FILES...\n", argv[0]);
+      std::fprintf(stderr, "  compares the merge sort and SA-IS match "
+                           "finders of LZSearchTable\n");
+      return -1;
+    }
+    std::printf("%-32s %8s %10s %10s %7s\n",
+                "file", "size", "merge (s)", "SA-IS (s)", "speedup");
+    double  totalTime1 = 0.0;
+    double  totalTime2 = 0.0;
+    bool    errorFlag = false;
+    std::vector< unsigned char >  buf;
+    for (size_t i = 0; i < fileNames.size(); i++) {
+      readInputFile(buf, fileNames[i].c_str());
+      if (buf.size() < 2)
+        continue;
+      size_t  maxOffs = (maxOffset < buf.size() ? maxOffset : buf.size());
+      Ep128Compress::LZSearchTable  t1(minLength, maxLength, lengthMaxValue,
+                                       maxOffs1, maxOffs2, maxOffs);
+      Ep128Compress::LZSearchTable  t2(minLength, maxLength, lengthMaxValue,
+                                       maxOffs1, maxOffs2, maxOffs);
+      double  time1 = findMatches(t1, buf, 0);
+      double  time2 = findMatches(t2, buf, 1);
+      totalTime1 += time1;
+      totalTime2 += time2;
+      bool    matchesEqual = compareMatches(t1, t2, buf.size());
+      errorFlag = errorFlag || !matchesEqual;
+      std::string fileName(fileNames[i]);
+      if (fileName.length() > 32)
+        fileName.erase(0, fileName.length() - 32);
+      std::printf("%-32s %8u %10.4f %10.4f %6.2fx%s\n",
+                  fileName.c_str(), (unsigned int) buf.size(), time1, time2,
+                  time1 / (time2 > 1.0e-6 ? time2 : 1.0e-6),
+                  (matchesEqual ? "" : "  MISMATCH"));
+    }
+    std::printf("%-32s %8s %10.4f %10.4f %6.2fx\n", "total", "",
+                totalTime1, totalTime2,
+                totalTime1 / (totalTime2 > 1.0e-6 ? totalTime2 : 1.0e-6));
+    return (errorFlag ? -1 : 0);
+  }
+  catch (std::exception& e) {
+    std::fprintf(stderr, " *** %s: %s\n", argv[0], e.what());
+  }
+  return -1;
+}
+
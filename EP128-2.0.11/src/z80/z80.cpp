@@ -60,8 +60,8 @@ namespace Ep128 {
 
   EP128EMU_INLINE void Z80::Index_CB_ExecuteInstruction()
   {
-    uint8_t Opcode = readOpcodeByte(3);
-    updateCycles(2);
+    uint8_t Opcode = fetchOpcodeByte(3);
+    updateCycles_(2);
     switch (Opcode) {
     case 0x000:
       {
@@ -1362,7 +1362,7 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::FD_ExecuteInstruction()
   {
     uint8_t Opcode;
-    Opcode = readOpcodeSecondByte(invalidIndexOpcodeTable);
+    Opcode = fetchOpcodeSecondByte(invalidIndexOpcodeTable);
     switch (Opcode) {
     case 0x000:
     case 0x001:
@@ -2156,7 +2156,7 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::DD_ExecuteInstruction()
   {
     uint8_t Opcode;
-    Opcode = readOpcodeSecondByte(invalidIndexOpcodeTable);
+    Opcode = fetchOpcodeSecondByte(invalidIndexOpcodeTable);
     switch (Opcode) {
     case 0x000:
     case 0x001:
@@ -2951,7 +2951,7 @@ namespace Ep128 {
   {
     INC_REFRESH(2);
     uint8_t Opcode;
-    Opcode = readOpcodeSecondByte();
+    Opcode = fetchOpcodeSecondByte();
     switch (Opcode) {
     case 0x000:
     case 0x001:
@@ -3187,7 +3187,7 @@ namespace Ep128 {
       {
         LD_I_A();
         ADD_PC(2);
-        updateCycle();
+        updateCycle_();
       }
       break;
     case 0x048:
@@ -3237,7 +3237,7 @@ namespace Ep128 {
       {
         LD_R_A();
         ADD_PC(2);
-        updateCycle();
+        updateCycle_();
       }
       break;
     case 0x050:
@@ -3287,7 +3287,7 @@ namespace Ep128 {
       {
         LD_A_I();
         ADD_PC(2);
-        updateCycle();
+        updateCycle_();
 #ifndef Z80_ENABLE_CMOS
         checkNMOSBug();
 #endif
@@ -3340,7 +3340,7 @@ namespace Ep128 {
       {
         LD_A_R();
         ADD_PC(2);
-        updateCycle();
+        updateCycle_();
 #ifndef Z80_ENABLE_CMOS
         checkNMOSBug();
 #endif
@@ -3549,14 +3549,14 @@ namespace Ep128 {
       {
         LDI();
         ADD_PC(2);
-        updateCycles(2);
+        updateCycles_(2);
       }
       break;
     case 0x0a1:
       {
         CPI();
         ADD_PC(2);
-        updateCycles(5);
+        updateCycles_(5);
       }
       break;
     case 0x0a2:
@@ -3575,14 +3575,14 @@ namespace Ep128 {
       {
         LDD();
         ADD_PC(2);
-        updateCycles(2);
+        updateCycles_(2);
       }
       break;
     case 0x0a9:
       {
         CPD();
         ADD_PC(2);
-        updateCycles(5);
+        updateCycles_(5);
       }
       break;
     case 0x0aa:
@@ -3601,11 +3601,11 @@ namespace Ep128 {
       {
         LDI();
         if (Z80_TEST_PARITY_EVEN) {
-          updateCycles(7);
+          updateCycles_(7);
         }
         else {
           ADD_PC(2);
-          updateCycles(2);
+          updateCycles_(2);
         }
       }
       break;
@@ -3614,11 +3614,11 @@ namespace Ep128 {
         CPI();
         if ((Z80_FLAGS_REG & (Z80_PARITY_FLAG | Z80_ZERO_FLAG))
             == Z80_PARITY_FLAG) {
-          updateCycles(10);
+          updateCycles_(10);
         }
         else {
           ADD_PC(2);
-          updateCycles(5);
+          updateCycles_(5);
         }
       }
       break;
@@ -3628,7 +3628,7 @@ namespace Ep128 {
         if (Z80_FLAGS_REG & Z80_ZERO_FLAG)
           ADD_PC(2);
         else
-          updateCycles(5);
+          updateCycles_(5);
       }
       break;
     case 0x0b3:
@@ -3637,18 +3637,18 @@ namespace Ep128 {
         if (Z80_FLAGS_REG & Z80_ZERO_FLAG)
           ADD_PC(2);
         else
-          updateCycles(5);
+          updateCycles_(5);
       }
       break;
     case 0x0b8:
       {
         LDD();
         if (Z80_FLAGS_REG & Z80_PARITY_FLAG) {
-          updateCycles(7);
+          updateCycles_(7);
         }
         else {
           ADD_PC(2);
-          updateCycles(2);
+          updateCycles_(2);
         }
       }
       break;
@@ -3657,11 +3657,11 @@ namespace Ep128 {
         CPD();
         if ((Z80_FLAGS_REG & (Z80_PARITY_FLAG | Z80_ZERO_FLAG))
             == Z80_PARITY_FLAG) {
-          updateCycles(10);
+          updateCycles_(10);
         }
         else {
           ADD_PC(2);
-          updateCycles(5);
+          updateCycles_(5);
         }
       }
       break;
@@ -3671,7 +3671,7 @@ namespace Ep128 {
         if (Z80_FLAGS_REG & Z80_ZERO_FLAG)
           ADD_PC(2);
         else
-          updateCycles(5);
+          updateCycles_(5);
       }
       break;
     case 0x0bb:
@@ -3680,7 +3680,7 @@ namespace Ep128 {
         if (Z80_FLAGS_REG & Z80_ZERO_FLAG)
           ADD_PC(2);
         else
-          updateCycles(5);
+          updateCycles_(5);
       }
       break;
     default:
@@ -3700,7 +3700,7 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::CB_ExecuteInstruction()
   {
     uint8_t Opcode;
-    Opcode = readOpcodeSecondByte();
+    Opcode = fetchOpcodeSecondByte();
     switch (Opcode) {
     case 0x000:
       {
@@ -5001,7 +5001,7 @@ namespace Ep128 {
   void Z80::executeInstruction()
   {
     uint8_t Opcode;
-    Opcode = readOpcodeFirstByte();
+    Opcode = fetchOpcodeFirstByte();
     switch (Opcode) {
     case 0x000:
       {
@@ -5230,7 +5230,7 @@ namespace Ep128 {
           JR();
         }
         else {
-          (void) readOpcodeByte(1);
+          (void) fetchOpcodeByte(1);
           ADD_PC(2);
         }
         INC_REFRESH(1);
@@ -5291,7 +5291,7 @@ namespace Ep128 {
           JR();
         }
         else {
-          (void) readOpcodeByte(1);
+          (void) fetchOpcodeByte(1);
           ADD_PC(2);
         }
         INC_REFRESH(1);
@@ -5352,7 +5352,7 @@ namespace Ep128 {
           JR();
         }
         else {
-          (void) readOpcodeByte(1);
+          (void) fetchOpcodeByte(1);
           ADD_PC(2);
         }
         INC_REFRESH(1);
@@ -5413,7 +5413,7 @@ namespace Ep128 {
           JR();
         }
         else {
-          (void) readOpcodeByte(1);
+          (void) fetchOpcodeByte(1);
           ADD_PC(2);
         }
         INC_REFRESH(1);
@@ -5842,6 +5842,8 @@ namespace Ep128 {
       break;
     case 0x076:
       {
+        if (EP128EMU_UNLIKELY(stopFlag))
+          return;                       // see setStopFlag()
         HALT();
         INC_REFRESH(1);
       }
@@ -6374,7 +6376,7 @@ namespace Ep128 {
       break;
     case 0x0c0:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_ZERO_NOT_SET) {
           RETURN();
         }
@@ -6397,7 +6399,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6415,7 +6417,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6443,7 +6445,7 @@ namespace Ep128 {
       break;
     case 0x0c8:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_ZERO_SET) {
           RETURN();
         }
@@ -6465,7 +6467,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6482,7 +6484,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6509,7 +6511,7 @@ namespace Ep128 {
       break;
     case 0x0d0:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_CARRY_NOT_SET) {
           RETURN();
         }
@@ -6532,7 +6534,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6551,7 +6553,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6579,7 +6581,7 @@ namespace Ep128 {
       break;
     case 0x0d8:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_CARRY_SET) {
           RETURN();
         }
@@ -6604,7 +6606,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6623,7 +6625,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6650,7 +6652,7 @@ namespace Ep128 {
       break;
     case 0x0e0:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_PARITY_ODD) {
           RETURN();
         }
@@ -6673,7 +6675,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6692,7 +6694,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6720,7 +6722,7 @@ namespace Ep128 {
       break;
     case 0x0e8:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_PARITY_EVEN) {
           RETURN();
         }
@@ -6742,7 +6744,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6761,7 +6763,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6787,7 +6789,7 @@ namespace Ep128 {
       break;
     case 0x0f0:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_POSITIVE) {
           RETURN();
         }
@@ -6810,7 +6812,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6831,7 +6833,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6859,7 +6861,7 @@ namespace Ep128 {
       break;
     case 0x0f8:
       {
-        updateCycle();
+        updateCycle_();
         if (Z80_TEST_MINUS) {
           RETURN();
         }
@@ -6882,7 +6884,7 @@ namespace Ep128 {
           JP();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
@@ -6903,7 +6905,7 @@ namespace Ep128 {
           CALL();
         }
         else {
-          (void) readOpcodeWord(1);
+          (void) fetchOpcodeWord(1);
           ADD_PC(3);
         }
         INC_REFRESH(1);
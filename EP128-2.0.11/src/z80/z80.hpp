@@ -190,6 +190,15 @@ namespace Ep128 {
     static Z80Tables  t;
     Z80_REGISTERS   R;
     int32_t newPCAddress;
+    // memory access fast path, see setFastMemoryAccess()
+    const uint8_t * const *fastReadTable;
+    // same as fastReadTable, but for the first opcode byte (M1 cycle)
+    const uint8_t * const *fastOpcodeReadTable;
+    uint8_t * const *fastWriteTable;
+    int64_t *fastCycleCnt;
+    int64_t fastCycles_M1;
+    int64_t fastCycles;
+    bool    stopFlag;
    private:
     EP128EMU_INLINE void Index_CB_ExecuteInstruction();
     EP128EMU_INLINE void FD_ExecuteInstruction();
@@ -276,6 +285,39 @@ namespace Ep128 {
      */
     void loadState(Ep128Emu::File::Buffer&);
     void registerChunkType(Ep128Emu::File&);
+    /*!
+     * Enable the inline memory access fast path of the instruction decoder.
+     * If 'cycleCnt' is not NULL, updateCycle() and updateCycles() are not
+     * called, and the number of cycles (in 2^-32 units) is subtracted from
+     * '*cycleCnt' instead. 'readTbl' and 'writeTbl' are tables of 4 pointers
+     * indexed with the CPU address (page * 16384 + offset); if the pointer
+     * for a page is not NULL, then opcodes and data are read from it or
+     * written to it without calling the virtual functions, and 'cycles_M1'
+     * (opcode M1 cycles) or 'cycles' (other memory cycles) is subtracted
+     * from '*cycleCnt'. This can be used for memory with fixed wait states,
+     * and without breakpoints or other side effects of the access.
+     * If 'fastOpcodeRead' is false, readOpcodeFirstByte() is always called
+     * for the first byte of each instruction, even if 'readTbl' is used for
+     * all other reads.
+     * Calling this function with no arguments disables the fast path.
+     */
+    void setFastMemoryAccess(int64_t *cycleCnt = (int64_t *) 0,
+                             const uint8_t * const *readTbl =
+                                 (uint8_t * const *) 0,
+                             uint8_t * const *writeTbl = (uint8_t * const *) 0,
+                             int64_t cycles_M1 = 0, int64_t cycles = 0,
+                             bool fastOpcodeRead = true);
+    /*!
+     * If 'isStopped' is true, a 76h (HALT) opcode returned by
+     * readOpcodeFirstByte() is not executed, and executeInstruction() returns
+     * without changing the state of the CPU or checking interrupts; only the
+     * cycles of the opcode read are used. This allows readOpcodeFirstByte()
+     * to stop the CPU before the instruction at the current PC.
+     */
+    inline void setStopFlag(bool isStopped)
+    {
+      stopFlag = isStopped;
+    }
    protected:
     /*!
      * Called when a maskable interrupt is to be executed. Subclasses should
@@ -354,6 +396,148 @@ namespace Ep128 {
       if (EP128EMU_UNLIKELY(R.Flags & (Z80_NMI_FLAG | Z80_SET_PC_FLAG)))
         this->NMI();
     }
+    // these are used by the instruction decoder instead of calling the
+    // virtual memory access and updateCycle*() functions directly
+    // NOTE: instructions are not cached in pre-decoded form; the machines
+    // return to their video slot loop after every instruction, so threaded
+    // dispatch could not chain handlers, and a decoded cache would only
+    // save the second switch of prefixed opcodes (at most ~13% of the
+    // instructions) at the cost of checking for invalidation on each write
+    EP128EMU_INLINE uint8_t fetchOpcodeFirstByte()
+    {
+      if (fastOpcodeReadTable) {
+        uint16_t  addr = uint16_t(R.PC.W.l);
+        const uint8_t *p = fastOpcodeReadTable[addr >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0)) {
+          *fastCycleCnt -= fastCycles_M1;
+          return p[addr];
+        }
+      }
+      return readOpcodeFirstByte();
+    }
+    EP128EMU_INLINE uint8_t fetchOpcodeSecondByte(
+        const bool *invalidOpcodeTable = (bool *) 0)
+    {
+      if (fastReadTable) {
+        uint16_t  addr = (uint16_t(R.PC.W.l) + uint16_t(1)) & uint16_t(0xFFFF);
+        const uint8_t *p = fastReadTable[addr >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0)) {
+          uint8_t b = p[addr];
+          if (!(invalidOpcodeTable && invalidOpcodeTable[b]))
+            *fastCycleCnt -= fastCycles_M1;
+          return b;
+        }
+      }
+      return readOpcodeSecondByte(invalidOpcodeTable);
+    }
+    EP128EMU_INLINE uint8_t fetchOpcodeByte(int offset)
+    {
+      if (fastReadTable) {
+        uint16_t  addr = uint16_t((int(R.PC.W.l) + offset) & 0xFFFF);
+        const uint8_t *p = fastReadTable[addr >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0)) {
+          *fastCycleCnt -= fastCycles;
+          return p[addr];
+        }
+      }
+      return readOpcodeByte(offset);
+    }
+    EP128EMU_INLINE uint16_t fetchOpcodeWord(int offset)
+    {
+      if (fastReadTable) {
+        uint16_t  addr = uint16_t((int(R.PC.W.l) + offset) & 0xFFFF);
+        uint16_t  addr2 = (addr + uint16_t(1)) & uint16_t(0xFFFF);
+        const uint8_t *p = fastReadTable[addr >> 14];
+        const uint8_t *p2 = fastReadTable[addr2 >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0 && p2 != (uint8_t *) 0)) {
+          *fastCycleCnt -= (fastCycles + fastCycles);
+          return (uint16_t(p[addr]) | (uint16_t(p2[addr2]) << 8));
+        }
+      }
+      return readOpcodeWord(offset);
+    }
+    EP128EMU_INLINE uint8_t readMemory_(uint16_t addr)
+    {
+      if (fastReadTable) {
+        const uint8_t *p = fastReadTable[addr >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0)) {
+          *fastCycleCnt -= fastCycles;
+          return p[addr];
+        }
+      }
+      return readMemory(addr);
+    }
+    EP128EMU_INLINE uint16_t readMemoryWord_(uint16_t addr)
+    {
+      if (fastReadTable) {
+        uint16_t  addr2 = (addr + uint16_t(1)) & uint16_t(0xFFFF);
+        const uint8_t *p = fastReadTable[addr >> 14];
+        const uint8_t *p2 = fastReadTable[addr2 >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0 && p2 != (uint8_t *) 0)) {
+          *fastCycleCnt -= (fastCycles + fastCycles);
+          return (uint16_t(p[addr]) | (uint16_t(p2[addr2]) << 8));
+        }
+      }
+      return readMemoryWord(addr);
+    }
+    EP128EMU_INLINE void writeMemory_(uint16_t addr, uint8_t value)
+    {
+      if (fastWriteTable) {
+        uint8_t *p = fastWriteTable[addr >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0)) {
+          *fastCycleCnt -= fastCycles;
+          p[addr] = value;
+          return;
+        }
+      }
+      writeMemory(addr, value);
+    }
+    EP128EMU_INLINE void writeMemoryWord_(uint16_t addr, uint16_t value)
+    {
+      if (fastWriteTable) {
+        uint16_t  addr2 = (addr + uint16_t(1)) & uint16_t(0xFFFF);
+        uint8_t *p = fastWriteTable[addr >> 14];
+        uint8_t *p2 = fastWriteTable[addr2 >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0 && p2 != (uint8_t *) 0)) {
+          *fastCycleCnt -= (fastCycles + fastCycles);
+          p[addr] = uint8_t(value & 0xFF);
+          p2[addr2] = uint8_t(value >> 8);
+          return;
+        }
+      }
+      writeMemoryWord(addr, value);
+    }
+    EP128EMU_INLINE void pushWord_(uint16_t value)
+    {
+      if (fastWriteTable) {
+        uint16_t  addr = (uint16_t(R.SP.W) - uint16_t(2)) & uint16_t(0xFFFF);
+        uint16_t  addr2 = (addr + uint16_t(1)) & uint16_t(0xFFFF);
+        uint8_t *p = fastWriteTable[addr >> 14];
+        uint8_t *p2 = fastWriteTable[addr2 >> 14];
+        if (EP128EMU_EXPECT(p != (uint8_t *) 0 && p2 != (uint8_t *) 0)) {
+          *fastCycleCnt -= ((int64_t(1) << 32) + fastCycles + fastCycles);
+          R.SP.W = addr;
+          p2[addr2] = uint8_t(value >> 8);
+          p[addr] = uint8_t(value & 0xFF);
+          return;
+        }
+      }
+      pushWord(value);
+    }
+    EP128EMU_INLINE void updateCycle_()
+    {
+      if (fastCycleCnt)
+        *fastCycleCnt -= (int64_t(1) << 32);
+      else
+        updateCycle();
+    }
+    EP128EMU_INLINE void updateCycles_(int cycles)
+    {
+      if (fastCycleCnt)
+        *fastCycleCnt -= (int64_t(cycles) << 32);
+      else
+        updateCycles(cycles);
+    }
   };
 
 }       // namespace Ep128
@@ -24,8 +24,8 @@ namespace Ep128 {
   EP128EMU_INLINE Z80_BYTE Z80::RD_BYTE_INDEX_(Z80_WORD Index)
   {
     SETUP_INDEXED_ADDRESS(Index);
-    updateCycles(5);
-    return readMemory(R.IndexPlusOffset);
+    updateCycles_(5);
+    return readMemory_(R.IndexPlusOffset);
   }
 
   /*----------------------------------*/
@@ -34,13 +34,13 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::WR_BYTE_INDEX_(Z80_WORD Index, Z80_BYTE Data)
   {
     SETUP_INDEXED_ADDRESS(Index);
-    updateCycles(5);
-    writeMemory(R.IndexPlusOffset, Data);
+    updateCycles_(5);
+    writeMemory_(R.IndexPlusOffset, Data);
   }
 
   EP128EMU_INLINE void Z80::LD_HL_n()
   {
-    writeMemory(R.HL.W, readOpcodeByte(1));
+    writeMemory_(R.HL.W, fetchOpcodeByte(1));
   }
 
   /*---------------------------*/
@@ -50,95 +50,95 @@ namespace Ep128 {
   {
     Z80_WORD Data;
 
-    Data = readMemoryWord(R.SP.W);
+    Data = readMemoryWord_(R.SP.W);
     R.SP.W += 2;
     return Data;
   }
 
   EP128EMU_INLINE void Z80::ADD_A_HL()
   {
-    ADD_A_X(readMemory(R.HL.W));
+    ADD_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::ADD_A_n()
   {
-    ADD_A_X(readOpcodeByte(1));
+    ADD_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::ADC_A_HL()
   {
-    ADC_A_X(readMemory(R.HL.W));
+    ADC_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::ADC_A_n()
   {
-    ADC_A_X(readOpcodeByte(1));
+    ADC_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::SUB_A_HL()
   {
-    SUB_A_X(readMemory(R.HL.W));
+    SUB_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::SUB_A_n()
   {
-    SUB_A_X(readOpcodeByte(1));
+    SUB_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::SBC_A_HL()
   {
-    SBC_A_X(readMemory(R.HL.W));
+    SBC_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::SBC_A_n()
   {
-    SBC_A_X(readOpcodeByte(1));
+    SBC_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::CP_A_HL()
   {
-    CP_A_X(readMemory(R.HL.W));
+    CP_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::CP_A_n()
   {
-    CP_A_X(readOpcodeByte(1));
+    CP_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::AND_A_n()
   {
-    AND_A_X(readOpcodeByte(1));
+    AND_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::AND_A_HL()
   {
-    AND_A_X(readMemory(R.HL.W));
+    AND_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::XOR_A_n()
   {
-    XOR_A_X(readOpcodeByte(1));
+    XOR_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::XOR_A_HL()
   {
-    XOR_A_X(readMemory(R.HL.W));
+    XOR_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::OR_A_HL()
   {
-    OR_A_X(readMemory(R.HL.W));
+    OR_A_X(readMemory_(R.HL.W));
   }
 
   EP128EMU_INLINE void Z80::OR_A_n()
   {
-    OR_A_X(readOpcodeByte(1));
+    OR_A_X(fetchOpcodeByte(1));
   }
 
   EP128EMU_INLINE void Z80::OUT_n_A()
   {
     /* A in upper byte of port, Data in lower byte of port */
-    doOut((Z80_WORD) readOpcodeByte(1) | ((Z80_WORD) (R.AF.B.h) << 8),
+    doOut((Z80_WORD) fetchOpcodeByte(1) | ((Z80_WORD) (R.AF.B.h) << 8),
           R.AF.B.h);
   }
 
@@ -146,7 +146,7 @@ namespace Ep128 {
   {
     /* A in upper byte of port, data in lower byte of port */
     R.AF.B.h =
-        doIn((Z80_WORD) readOpcodeByte(1) | ((Z80_WORD) (R.AF.B.h) << 8));
+        doIn((Z80_WORD) fetchOpcodeByte(1) | ((Z80_WORD) (R.AF.B.h) << 8));
   }
 
   EP128EMU_INLINE void Z80::RRA()
@@ -159,9 +159,9 @@ namespace Ep128 {
 
   EP128EMU_INLINE void Z80::RRD()
   {
-    Z80_BYTE  tempByte = readMemory(R.HL.W);
-    updateCycles(4);
-    writeMemory(R.HL.W, Z80_BYTE(((tempByte >> 4) | (R.AF.B.h << 4))));
+    Z80_BYTE  tempByte = readMemory_(R.HL.W);
+    updateCycles_(4);
+    writeMemory_(R.HL.W, Z80_BYTE(((tempByte >> 4) | (R.AF.B.h << 4))));
     R.AF.B.h = (R.AF.B.h & 0xF0) | (tempByte & 0x0F);
 
     Z80_FLAGS_REG = (Z80_FLAGS_REG & Z80_CARRY_FLAG)
@@ -170,9 +170,9 @@ namespace Ep128 {
 
   EP128EMU_INLINE void Z80::RLD()
   {
-    Z80_BYTE  tempByte = readMemory(R.HL.W);
-    updateCycles(4);
-    writeMemory(R.HL.W, Z80_BYTE((tempByte << 4) | (R.AF.B.h & 0x0F)));
+    Z80_BYTE  tempByte = readMemory_(R.HL.W);
+    updateCycles_(4);
+    writeMemory_(R.HL.W, Z80_BYTE((tempByte << 4) | (R.AF.B.h & 0x0F)));
     R.AF.B.h = (R.AF.B.h & 0xF0) | (tempByte >> 4);
 
     Z80_FLAGS_REG = (Z80_FLAGS_REG & Z80_CARRY_FLAG)
@@ -185,7 +185,7 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::JP()
   {
     /* set program counter to sub-routine address */
-    R.PC.W.l = readOpcodeWord(1);
+    R.PC.W.l = fetchOpcodeWord(1);
   }
 
   /*------------------------------------*/
@@ -194,9 +194,9 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::JR()
   {
     R.PC.W.l =
-        Z80_WORD((R.PC.W.l + 2 + int(Z80_BYTE_OFFSET(readOpcodeByte(1))))
+        Z80_WORD((R.PC.W.l + 2 + int(Z80_BYTE_OFFSET(fetchOpcodeByte(1))))
                  & 0xFFFF);
-    updateCycles(5);
+    updateCycles_(5);
   }
 
   /*--------------------*/
@@ -204,7 +204,7 @@ namespace Ep128 {
 
   EP128EMU_INLINE void Z80::CALL()
   {
-    Z80_WORD  tempWord = readOpcodeWord(1);
+    Z80_WORD  tempWord = fetchOpcodeWord(1);
     /* store return address on stack */
     PUSH(Z80_WORD(R.PC.W.l + 3));
     /* set program counter to sub-routine address */
@@ -214,13 +214,13 @@ namespace Ep128 {
   EP128EMU_INLINE void Z80::DJNZ_dd()
   {
     /* decrement B */
-    updateCycle();
+    updateCycle_();
     R.BC.B.h--;
 
     /* if zero */
     if (R.BC.B.h == 0) {
       /* continue */
-      (void) readOpcodeByte(1);
+      (void) fetchOpcodeByte(1);
       R.PC.W.l += 2;
     }
     else {
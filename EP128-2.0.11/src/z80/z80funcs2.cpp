@@ -163,6 +163,13 @@ namespace Ep128 {
   }
 
   Z80::Z80()
+    : fastReadTable((uint8_t * const *) 0),
+      fastOpcodeReadTable((uint8_t * const *) 0),
+      fastWriteTable((uint8_t * const *) 0),
+      fastCycleCnt((int64_t *) 0),
+      fastCycles_M1(0),
+      fastCycles(0),
+      stopFlag(false)
   {
     std::memset(&R, 0, sizeof(Z80_REGISTERS));
     int     seed = 0;
@@ -205,6 +212,25 @@ namespace Ep128 {
     R.Flags = R.Flags | Z80_SET_PC_FLAG;
   }
 
+  void Z80::setFastMemoryAccess(int64_t *cycleCnt,
+                                const uint8_t * const *readTbl,
+                                uint8_t * const *writeTbl,
+                                int64_t cycles_M1, int64_t cycles,
+                                bool fastOpcodeRead)
+  {
+    if (!cycleCnt) {
+      readTbl = (uint8_t * const *) 0;
+      writeTbl = (uint8_t * const *) 0;
+    }
+    fastReadTable = readTbl;
+    fastOpcodeReadTable =
+        (fastOpcodeRead ? readTbl : (const uint8_t * const *) 0);
+    fastWriteTable = writeTbl;
+    fastCycleCnt = cycleCnt;
+    fastCycles_M1 = cycles_M1;
+    fastCycles = cycles;
+  }
+
   void Z80::NMI()
   {
     if (R.Flags & Z80_SET_PC_FLAG) {
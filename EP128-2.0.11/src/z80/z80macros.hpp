@@ -21,13 +21,13 @@
 
 #include "z80.hpp"
 
-#define RD_BYTE_INDEX()         readMemory(R.IndexPlusOffset)
-#define WR_BYTE_INDEX(Data)     writeMemory(R.IndexPlusOffset, (Data))
+#define RD_BYTE_INDEX()         readMemory_(R.IndexPlusOffset)
+#define WR_BYTE_INDEX(Data)     writeMemory_(R.IndexPlusOffset, (Data))
 
 #define INC_REFRESH(Count)      R.R += (Count)
 
 #define SETUP_INDEXED_ADDRESS(Index)            \
-        R.IndexPlusOffset = (Index) + (Z80_BYTE_OFFSET) readOpcodeByte(2)
+        R.IndexPlusOffset = (Index) + (Z80_BYTE_OFFSET) fetchOpcodeByte(2)
 
 /* overflow caused, when both are + or -, and result is different. */
 #define SET_OVERFLOW_FLAG_A_ADD(Reg, Result)                            \
@@ -130,27 +130,27 @@
                     | t.zeroSignParityTable[(Register) & 0xFF];         \
 }
 
-#define LD_R_n(Register)        Register = readOpcodeByte(1)
+#define LD_R_n(Register)        Register = fetchOpcodeByte(1)
 
-#define LD_RI_n(Register)       Register = readOpcodeByte(2)
+#define LD_RI_n(Register)       Register = fetchOpcodeByte(2)
 
-#define LD_R_HL(Register)       Register = readMemory(R.HL.W)
+#define LD_R_HL(Register)       Register = readMemory_(R.HL.W)
 
 #define LD_R_INDEX(Index, Register)     Register = RD_BYTE_INDEX_(Index)
 
 #define LD_INDEX_R(Index, Register)     WR_BYTE_INDEX_(Index, (Register))
 
-#define LD_HL_R(Register)       writeMemory(R.HL.W, (Register))
+#define LD_HL_R(Register)       writeMemory_(R.HL.W, (Register))
 
-#define LD_A_RR(Register)       R.AF.B.h = readMemory(Register)
+#define LD_A_RR(Register)       R.AF.B.h = readMemory_(Register)
 
-#define LD_RR_A(Register)       writeMemory((Register), R.AF.B.h)
+#define LD_RR_A(Register)       writeMemory_((Register), R.AF.B.h)
 
 #define LD_INDEX_n(Index)                                               \
 {                                                                       \
         SETUP_INDEXED_ADDRESS(Index);                                   \
-        Z80_BYTE  tempByte = readOpcodeByte(3);                         \
-        updateCycles(2);                                                \
+        Z80_BYTE  tempByte = fetchOpcodeByte(3);                        \
+        updateCycles_(2);                                               \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -163,17 +163,17 @@
 
 #define RES_HL(AndMask)                                                 \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         RES(AndMask, tempByte);                                         \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define RES_INDEX(AndMask)                                              \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RES(AndMask, tempByte);                                         \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -185,17 +185,17 @@
 
 #define SET_HL(OrMask)                                                  \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         SET(OrMask, tempByte);                                          \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define SET_INDEX(OrMask)                                               \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SET(OrMask, tempByte);                                          \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -211,8 +211,8 @@
 
 #define BIT_HL(BitIndex)                                                \
 {                                                                       \
-        BIT(BitIndex, readMemory(R.HL.W));                              \
-        updateCycle();                                                  \
+        BIT(BitIndex, readMemory_(R.HL.W));                             \
+        updateCycle_();                                                 \
 }
 
 #define BIT_INDEX(BitIndex)                                             \
@@ -222,7 +222,7 @@
                          & (~(Z80_UNUSED_FLAG1 | Z80_UNUSED_FLAG2)))    \
                         | (Z80_BYTE(R.IndexPlusOffset >> 8)             \
                            & (Z80_UNUSED_FLAG1 | Z80_UNUSED_FLAG2));    \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
 }
 
 /*------------------*/
@@ -256,17 +256,17 @@
 
 #define RL_HL()                                                         \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         RL_WITH_FLAGS(tempByte);                                        \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define RL_INDEX()                                                      \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RL_WITH_FLAGS(tempByte);                                        \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -287,17 +287,17 @@
 
 #define RR_HL()                                                         \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         RR_WITH_FLAGS(tempByte);                                        \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define RR_INDEX()                                                      \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RR_WITH_FLAGS(tempByte);                                        \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -319,17 +319,17 @@
 
 #define RLC_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         RLC_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define RLC_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RLC_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -349,17 +349,17 @@
 
 #define RRC_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         RRC_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define RRC_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RRC_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -379,17 +379,17 @@
 
 #define SLA_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         SLA_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define SLA_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SLA_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -409,17 +409,17 @@
 
 #define SRA_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         SRA_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define SRA_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SRA_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -439,17 +439,17 @@
 
 #define SRL_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         SRL_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define SRL_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SRL_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -469,17 +469,17 @@
 
 #define SLL_HL()                                                        \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         SLL_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define SLL_INDEX()                                                     \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SLL_WITH_FLAGS(tempByte);                                       \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -541,17 +541,17 @@
 
 #define INC_HL_()                                                       \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         INC_X(tempByte);                                                \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define _INC_INDEX_(Index)                                              \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX_(Index);                     \
         INC_X(tempByte);                                                \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -576,33 +576,33 @@
 
 #define DEC_HL_()                                                       \
 {                                                                       \
-        Z80_BYTE  tempByte = readMemory(R.HL.W);                        \
+        Z80_BYTE  tempByte = readMemory_(R.HL.W);                       \
         DEC_X(tempByte);                                                \
-        updateCycle();                                                  \
-        writeMemory(R.HL.W, tempByte);                                  \
+        updateCycle_();                                                 \
+        writeMemory_(R.HL.W, tempByte);                                 \
 }
 
 #define _DEC_INDEX_(Index)                                              \
 {                                                                       \
         Z80_BYTE  tempByte = RD_BYTE_INDEX_(Index);                     \
         DEC_X(tempByte);                                                \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
 /*-----------------*/
 
-#define LD_RR_nn(Register)      Register = readOpcodeWord(1)
+#define LD_RR_nn(Register)      Register = fetchOpcodeWord(1)
 
-#define LD_INDEXRR_nn(Index)    Index = readOpcodeWord(2)
+#define LD_INDEXRR_nn(Index)    Index = fetchOpcodeWord(2)
 
-#define LD_INDEXRR_nnnn(Index)  Index = readMemoryWord(readOpcodeWord(2))
+#define LD_INDEXRR_nnnn(Index)  Index = readMemoryWord_(fetchOpcodeWord(2))
 
-#define LD_nnnn_INDEXRR(Index)  writeMemoryWord(readOpcodeWord(2), (Index))
+#define LD_nnnn_INDEXRR(Index)  writeMemoryWord_(fetchOpcodeWord(2), (Index))
 
-#define LD_RR_nnnn(Register)    Register = readMemoryWord(readOpcodeWord(2))
+#define LD_RR_nnnn(Register)    Register = readMemoryWord_(fetchOpcodeWord(2))
 
-#define LD_nnnn_RR(Register)    writeMemoryWord(readOpcodeWord(2), (Register))
+#define LD_nnnn_RR(Register)    writeMemoryWord_(fetchOpcodeWord(2), (Register))
 
 /*--------*/
 /* Macros */
@@ -692,7 +692,7 @@
         Register1 = Z80_WORD(Result);                                   \
         Z80_FLAGS_REG = (Z80_FLAGS_REG & (0xD7 ^ Z80_SUBTRACT_FLAG))    \
                         | (Z80_BYTE(Result >> 8) & 0x28);               \
-        updateCycles(7);                                                \
+        updateCycles_(7);                                               \
 }
 
 #define ADC_HL_rr(Register)                                             \
@@ -706,7 +706,7 @@
         SET_ZERO_FLAG16(R.HL.W);                                        \
         Z80_FLAGS_REG = (Z80_FLAGS_REG & 0x55)                          \
                         | (Z80_BYTE(Result >> 8) & 0xA8);               \
-        updateCycles(7);                                                \
+        updateCycles_(7);                                               \
 }
 
 #define SBC_HL_rr(Register)                                             \
@@ -720,7 +720,7 @@
         SET_ZERO_FLAG16(R.HL.W);                                        \
         Z80_FLAGS_REG = (Z80_FLAGS_REG & 0x55) | Z80_SUBTRACT_FLAG      \
                         | (Z80_BYTE(Result >> 8) & 0xA8);               \
-        updateCycles(7);                                                \
+        updateCycles_(7);                                               \
 }
 
 /* do a SLA of index and copy into reg specified */
@@ -729,7 +729,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SLA_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -739,7 +739,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SRA_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -749,7 +749,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SLL_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -759,7 +759,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SRL_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -768,7 +768,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RLC_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -777,7 +777,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RRC_WITH_FLAGS(tempByte);                                       \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -786,7 +786,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RR_WITH_FLAGS(tempByte);                                        \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -795,7 +795,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RL_WITH_FLAGS(tempByte);                                        \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -804,7 +804,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         SET(OrMask, tempByte);                                          \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -813,7 +813,7 @@
         Z80_BYTE  tempByte = RD_BYTE_INDEX();                           \
         RES(AndMask, tempByte);                                         \
         Reg = tempByte;                                                 \
-        updateCycle();                                                  \
+        updateCycle_();                                                 \
         WR_BYTE_INDEX(tempByte);                                        \
 }
 
@@ -824,7 +824,7 @@
 /*-------------------------*/
 /* put a word on the stack */
 
-#define PUSH(Data)              pushWord(Data)
+#define PUSH(Data)              pushWord_(Data)
 
 /*----------------------------------------------------*/
 /* perform a RST which is equivalent to a 1 byte CALL */
@@ -849,14 +849,14 @@
 #define INC_rp(x)                                                       \
 {                                                                       \
         x++;                                                            \
-        updateCycles(2);                                                \
+        updateCycles_(2);                                               \
 }
 
 /* decrement register pair */
 #define DEC_rp(x)                                                       \
 {                                                                       \
         x--;                                                            \
-        updateCycles(2);                                                \
+        updateCycles_(2);                                               \
 }
 
 /* swap two words */
@@ -872,7 +872,7 @@
 #define LD_SP_rp(x)                                                     \
 {                                                                       \
         R.SP.W = (x);                                                   \
-        updateCycles(2);                                                \
+        updateCycles_(2);                                               \
 }
 
 /* EX (SP), HL */
@@ -881,7 +881,7 @@
         Z80_WORD  temp = POP();                                         \
         PUSH(Register);                                                 \
         Register = temp;                                                \
-        updateCycles(2);                                                \
+        updateCycles_(2);                                               \
 }
 
 #define ADD_PC(x)               (R.PC.W.l += (x))
@@ -1062,8 +1062,8 @@
 /* LDI */
 #define LDI()                                                           \
 {                                                                       \
-        Z80_BYTE  Data = readMemory(R.HL.W);                            \
-        writeMemory(R.DE.W, Data);                                      \
+        Z80_BYTE  Data = readMemory_(R.HL.W);                           \
+        writeMemory_(R.DE.W, Data);                                     \
         R.HL.W++;                                                       \
         R.DE.W++;                                                       \
         R.BC.W--;                                                       \
@@ -1078,8 +1078,8 @@
 /* LDD */
 #define LDD()                                                           \
 {                                                                       \
-        Z80_BYTE  Data = readMemory(R.HL.W);                            \
-        writeMemory(R.DE.W, Data);                                      \
+        Z80_BYTE  Data = readMemory_(R.HL.W);                           \
+        writeMemory_(R.DE.W, Data);                                     \
         R.HL.W--;                                                       \
         R.DE.W--;                                                       \
         R.BC.W--;                                                       \
@@ -1094,29 +1094,29 @@
 #define LD_HL_nnnn()                                                    \
 {                                                                       \
         Z80_WORD  Addr;                                                 \
-        Addr =  readOpcodeWord(1);                                      \
-        R.HL.W = readMemoryWord(Addr);                                  \
+        Addr =  fetchOpcodeWord(1);                                      \
+        R.HL.W = readMemoryWord_(Addr);                                 \
 }
 
 #define LD_nnnn_HL()                                                    \
 {                                                                       \
         Z80_WORD  Addr;                                                 \
-        Addr =  readOpcodeWord(1);                                      \
-        writeMemoryWord(Addr,R.HL.W);                                   \
+        Addr =  fetchOpcodeWord(1);                                      \
+        writeMemoryWord_(Addr,R.HL.W);                                  \
 }
 
 #define LD_A_nnnn()                                                     \
 {                                                                       \
         Z80_WORD  Addr;                                                 \
-        Addr = readOpcodeWord(1);                                       \
-        R.AF.B.h = readMemory(Addr);                                    \
+        Addr = fetchOpcodeWord(1);                                       \
+        R.AF.B.h = readMemory_(Addr);                                   \
 }
 
 #define LD_nnnn_A()                                                     \
 {                                                                       \
         Z80_WORD  Addr;                                                 \
-        Addr = readOpcodeWord(1);                                       \
-        writeMemory(Addr,R.AF.B.h);                                     \
+        Addr = fetchOpcodeWord(1);                                       \
+        writeMemory_(Addr,R.AF.B.h);                                    \
 }
 
 /*-----------------------------------*/